@@ -72,19 +72,28 @@
 #include <Wire.h>
 #include <Adafruit_BMP280.h>
 #include <Adafruit_Sensor.h>
+#include <Preferences.h>
+#include "oraclebox_events.h"   // generated from pi/native/schema/satellite_events.jsonl
 
 // ==================== CONFIGURATION ====================
 // WiFi Settings (OracleBox Hub - optional, device works standalone)
 #define WIFI_SSID "OracleBox-Network"
 #define WIFI_PASSWORD "yourpassword"
 
-// Device Identity
+// Device Identity (build flags can override, e.g. -DDEVICE_ID='"rempod_02"')
+#ifndef DEVICE_ID
 #define DEVICE_ID "rempod_01"
+#endif
+#ifndef LOCATION
 #define LOCATION "hallway"
+#endif
 
 // Hub Settings (optional - only used if WiFi available)
 #define HUB_IP "192.168.4.1"
 #define HUB_PORT 8888
+#define HUB_RECONNECT_INTERVAL 5000   // ms between persistent hub link attempts
+#define HUB_CONNECT_TIMEOUT_MS 300    // bound how long a link attempt can stall detection
+#define HUB_RX_LINE_MAX 2048          // a full set_rules table (16 rules, ~100 bytes each) fits
 
 // REM Detection Settings
 #define AT42_POLL_INTERVAL 30       // milliseconds between AT42 checks
@@ -103,6 +112,11 @@
 // Calibration Settings
 #define CALIBRATION_TIME 8000       // 8 seconds calibration window
 
+// Local rules (loaded from NVS, replaced by the hub's set_rules command)
+#define MAX_LOCAL_RULES 16
+#define LOCAL_RULES_NVS_NAMESPACE "rules"
+#define LOCAL_RULES_VERSION 1
+
 // ==================== PIN DEFINITIONS ====================
 // AT42QT1011 Capacitive Touch Sensor
 const int AT42_OUT_PIN = 4;         // Main REM field detect
@@ -142,6 +156,8 @@ const int LED5_BLUE = 1;  // TX0 - only use after Serial.end()
 
 // ==================== STATE VARIABLES ====================
 WiFiClient client;
+WiFiClient hubLink;                   // persistent connection (no handshake per event)
+unsigned long lastHubAttempt = 0;
 Adafruit_BMP280 bmp;
 
 // REM detection
@@ -153,6 +169,8 @@ bool remEventActive = false;
 // Temperature monitoring
 float baselineTemp = 0.0;
 float baselinePressure = 0.0;
+float lastTemp = 0.0;                 // most recent reading from checkTemperature()
+float lastPressure = 0.0;
 unsigned long lastTempCheck = 0;
 bool tempDeviation = false;
 
@@ -164,6 +182,39 @@ unsigned long lastBatteryCheck = 0;
 bool calibrationComplete = false;
 bool serialActive = true;
 
+// ==================== LOCAL RULE TABLE ====================
+enum RuleFeature : uint8_t {
+  FEAT_AT42,            // AT42 output (0/1)
+  FEAT_TRIGGER_COUNT,   // REM trigger accumulator 0-10
+  FEAT_TEMP_DELTA,      // deviation from baseline, 0.1 F
+  FEAT_PRESSURE_DELTA,  // deviation from baseline, 0.1 hPa
+  FEAT_HUB_LINK,        // persistent hub link up (0/1)
+  FEAT_BATTERY,         // percent
+  FEAT_COUNT
+};
+enum RuleOp : uint8_t { OP_GE, OP_LE, OP_EQ, OP_NE, OP_COUNT };
+enum RuleAction : uint8_t { ACT_LED, ACT_BEEP, ACT_REPORT, ACT_COUNT };
+
+struct LocalRule {          // stored verbatim in NVS - bump LOCAL_RULES_VERSION on change
+  uint8_t feature;
+  uint8_t op;
+  int16_t value;
+  uint8_t action;
+  uint8_t arg[3];           // LED color
+  uint8_t led;              // LED 1-5, 0 = all
+  uint16_t argMs;           // LED hold time or beep length
+  uint16_t repeatMs;        // 0 = fire once per rising edge
+};
+
+LocalRule localRules[MAX_LOCAL_RULES];
+uint8_t localRuleCount = 0;
+uint32_t localRuleActive = 0;                  // condition state from the last pass (bit per rule)
+unsigned long localRuleFiredAt[MAX_LOCAL_RULES];
+unsigned long ruleLedUntil = 0;                // a rule owns the LEDs until then (0 = none)
+unsigned long ruleBeepUntil = 0;
+String hubRxLine;                              // partial command line from the hub
+bool hubRxOverflow = false;                     // hubRxLine passed HUB_RX_LINE_MAX; drop the line
+
 // ==================== FUNCTION DECLARATIONS ====================
 bool connectWiFi();
 void runCalibration();
@@ -176,7 +227,13 @@ void displayTempDeviation(float tempDelta, bool isCooling);
 void armedState();
 void calibrationAnimation();
 void startupHardwareTest();
+void loadLocalRules();
+bool compileLocalRules(JsonArray rules, String& error);
+void runLocalRules();
+void pollHubLink();
+bool ensureHubLink();
 void sendEventToHub(const char* event, int strength, float temp, float pressure);
+void sendRuleFiredToHub(uint8_t index);
 int readBattery();
 
 // ==================== SETUP ====================
@@ -306,6 +363,9 @@ void setup() {
   // Run calibration with LED animations
   runCalibration();
   
+  // Custom behaviors saved by the hub
+  loadLocalRules();
+  
   // ============ PHASE 3: READY / IDLE ============
   calibrationComplete = true;
   
@@ -330,6 +390,14 @@ void loop() {
     checkREMField();
   }
   
+  // Custom behaviors (evaluated every tick, no hub round-trip)
+  runLocalRules();
+  
+  // Keep the hub link open so the hub can push new rules
+  if (WiFi.status() == WL_CONNECTED && ensureHubLink()) {
+    pollHubLink();
+  }
+  
   // Check temperature periodically
   if (millis() - lastTempCheck >= TEMP_CHECK_INTERVAL) {
     lastTempCheck = millis();
@@ -354,7 +422,7 @@ void loop() {
   if (!remEventActive && !tempDeviation) {
     // Subtle heartbeat on center LED every 2 seconds
     static unsigned long lastHeartbeat = 0;
-    if (millis() - lastHeartbeat > 2000) {
+    if (millis() - lastHeartbeat > 2000 && ruleLedUntil == 0) {
       lastHeartbeat = millis();
         setLED(5, 30, 0, 0);  // brighter red pulse
         delay(100);
@@ -515,14 +583,16 @@ void checkREMField() {
       int strength = map(triggerCount, TRIGGER_THRESHOLD, MAX_TRIGGER_COUNT, 1, 10);
       strength = constrain(strength, 1, 10);
       
+      // Send to hub first - it may route this to other satellites, and the
+      // LED/buzzer display below blocks for up to ~1.5 s. Uses the last
+      // periodic reading instead of re-initializing the BMP280 here.
+      float currentTemp = lastTemp != 0.0 ? lastTemp : baselineTemp;
+      float currentPressure = lastPressure != 0.0 ? lastPressure : baselinePressure;
+      sendEventToHub("em_trigger", strength, currentTemp, currentPressure);
+      
       // Display LED + buzzer based on strength
       displayREMEvent(strength);
       
-      // Send to hub
-      float currentTemp = bmp.begin(0x76) ? (bmp.readTemperature() * 9.0 / 5.0 + 32.0) : baselineTemp;
-      float currentPressure = bmp.begin(0x76) ? (bmp.readPressure() / 100.0) : baselinePressure;
-      sendEventToHub("em_trigger", strength, currentTemp, currentPressure);
-      
       remEventActive = false;
     }
   }
@@ -585,6 +655,8 @@ void checkTemperature() {
   
   float currentTemp = bmp.readTemperature() * 9.0 / 5.0 + 32.0;  // °F
   float currentPressure = bmp.readPressure() / 100.0;  // hPa
+  lastTemp = currentTemp;
+  lastPressure = currentPressure;
   
   float tempDelta = currentTemp - baselineTemp;
   
@@ -688,6 +760,260 @@ void armedState() {
   setLED(5, 20, 0, 0);  // Dim red
 }
 
+// ==================== LOCAL RULES ====================
+// Small table interpreter so custom behaviors run on the pod at sensor rate
+// without a hub round-trip. Each rule compares one sensor feature against a
+// threshold and runs one action on the condition's rising edge (and again
+// every repeatMs while it stays true). The table is compiled from the hub's
+// set_rules command and kept in NVS; evaluation is a fixed pass over at most
+// MAX_LOCAL_RULES entries per loop() tick.
+static const char* const RULE_FEATURE_NAMES[FEAT_COUNT] = {
+  "at42", "trigger_count", "temp_delta", "pressure_delta", "hub_link", "battery"
+};
+static const char* const RULE_OP_NAMES[OP_COUNT] = { ">=", "<=", "==", "!=" };
+static const char* const RULE_ACTION_NAMES[ACT_COUNT] = { "led", "beep", "report" };
+
+static int ruleNameIndex(const char* name, const char* const* names, int count) {
+  for (int i = 0; i < count; i++) {
+    if (strcmp(name, names[i]) == 0) return i;
+  }
+  return -1;
+}
+
+// A table read back from NVS is checked again before use - the indices in it
+// go straight into lookup tables.
+static bool validLocalRule(const LocalRule& rule) {
+  if (rule.feature >= FEAT_COUNT || rule.op >= OP_COUNT || rule.action >= ACT_COUNT) return false;
+  if (rule.led > 5) return false;
+  return true;
+}
+
+// Reads an optional whole-number rule field. Anything that is not a number in
+// [lo, hi] is rejected instead of being truncated into the packed table.
+static bool ruleNumber(JsonVariant v, int32_t fallback, int32_t lo, int32_t hi,
+                       int32_t& out, uint8_t index, const char* key, String& error) {
+  if (v.isNull()) {
+    out = fallback;
+    return true;
+  }
+  double d = v.is<double>() ? v.as<double>() : NAN;
+  if (!(d >= lo && d <= hi) || d != floor(d)) {
+    error = "rule " + String(index) + ": " + key + " out of range (" + String(lo) + ".." + String(hi) + ")";
+    return false;
+  }
+  out = (int32_t)d;
+  return true;
+}
+
+void loadLocalRules() {
+  Preferences prefs;
+  localRuleCount = 0;
+  if (!prefs.begin(LOCAL_RULES_NVS_NAMESPACE, true)) return;
+  size_t len = prefs.getBytesLength("table");
+  if (prefs.getUChar("ver", 0) == LOCAL_RULES_VERSION && len % sizeof(LocalRule) == 0 &&
+      len <= sizeof(localRules)) {
+    prefs.getBytes("table", localRules, len);
+    localRuleCount = len / sizeof(LocalRule);
+  }
+  prefs.end();
+  for (uint8_t i = 0; i < localRuleCount; i++) {
+    if (!validLocalRule(localRules[i])) {
+      localRuleCount = 0;     // corrupt table - wait for the hub to push a new one
+      break;
+    }
+  }
+  localRuleActive = 0;
+  memset(localRuleFiredAt, 0, sizeof(localRuleFiredAt));
+}
+
+static void saveLocalRules() {
+  Preferences prefs;
+  if (!prefs.begin(LOCAL_RULES_NVS_NAMESPACE, false)) return;
+  prefs.putUChar("ver", LOCAL_RULES_VERSION);
+  prefs.putBytes("table", localRules, localRuleCount * sizeof(LocalRule));
+  prefs.end();
+}
+
+// Compiles [{"if":"trigger_count","op":">=","value":6,"do":"led","led":5,"rgb":[255,0,0]}, ...]
+// into the binary table. Nothing changes unless every rule is valid.
+bool compileLocalRules(JsonArray rules, String& error) {
+  LocalRule table[MAX_LOCAL_RULES];
+  uint8_t count = 0;
+  
+  for (JsonObject r : rules) {
+    if (count >= MAX_LOCAL_RULES) {
+      error = "too many rules";
+      return false;
+    }
+    LocalRule& rule = table[count];
+    memset(&rule, 0, sizeof(rule));
+    
+    int feature = ruleNameIndex(r["if"] | "", RULE_FEATURE_NAMES, FEAT_COUNT);
+    int op = ruleNameIndex(r["op"] | ">=", RULE_OP_NAMES, OP_COUNT);
+    int action = ruleNameIndex(r["do"] | "", RULE_ACTION_NAMES, ACT_COUNT);
+    if (feature < 0 || op < 0 || action < 0) {
+      error = "rule " + String(count) + ": unknown if/op/do";
+      return false;
+    }
+    int32_t value, ms, repeatMs;
+    if (!ruleNumber(r["value"], 1, INT16_MIN, INT16_MAX, value, count, "value", error) ||
+        !ruleNumber(r["ms"], 0, 0, 65535, ms, count, "ms", error) ||
+        !ruleNumber(r["repeat_ms"], 0, 0, 65535, repeatMs, count, "repeat_ms", error)) {
+      return false;
+    }
+    rule.feature = feature;
+    rule.op = op;
+    rule.value = value;
+    rule.action = action;
+    rule.argMs = ms;
+    rule.repeatMs = repeatMs;
+    
+    if (action == ACT_LED) {
+      for (int c = 0; c < 3; c++) {
+        int32_t level;
+        if (!ruleNumber(r["rgb"][c], 0, 0, 255, level, count, "rgb", error)) return false;
+        rule.arg[c] = level;
+      }
+      int32_t led;
+      if (!ruleNumber(r["led"], 0, 0, 5, led, count, "led", error)) return false;
+      rule.led = led;                                    // 0 = all
+      if (rule.argMs == 0) rule.argMs = 1000;
+    } else if (action == ACT_BEEP) {
+      if (rule.argMs == 0) rule.argMs = 100;
+    }
+    count++;
+  }
+  
+  memcpy(localRules, table, count * sizeof(LocalRule));
+  localRuleCount = count;
+  localRuleActive = 0;
+  memset(localRuleFiredAt, 0, sizeof(localRuleFiredAt));
+  saveLocalRules();
+  return true;
+}
+
+static int32_t readRuleFeature(uint8_t feature) {
+  switch (feature) {
+    case FEAT_AT42:           return digitalRead(AT42_OUT_PIN) == HIGH ? 1 : 0;
+    case FEAT_TRIGGER_COUNT:  return triggerCount;
+    case FEAT_TEMP_DELTA:     return lastTemp != 0.0 ? (int32_t)((lastTemp - baselineTemp) * 10.0) : 0;
+    case FEAT_PRESSURE_DELTA: return lastPressure != 0.0 ? (int32_t)((lastPressure - baselinePressure) * 10.0) : 0;
+    case FEAT_HUB_LINK:       return hubLink.connected() ? 1 : 0;
+    case FEAT_BATTERY:        return batteryPercent;
+  }
+  return 0;
+}
+
+static void runRuleAction(uint8_t index, const LocalRule& rule) {
+  switch (rule.action) {
+    case ACT_LED:
+      if (rule.led == 0) setAllLEDs(rule.arg[0], rule.arg[1], rule.arg[2]);
+      else setLED(rule.led, rule.arg[0], rule.arg[1], rule.arg[2]);
+      ruleLedUntil = millis() + rule.argMs;
+      break;
+    case ACT_BEEP:
+      digitalWrite(BUZZER_PIN, HIGH);
+      ruleBeepUntil = millis() + rule.argMs;
+      break;
+    case ACT_REPORT:
+      sendRuleFiredToHub(index);
+      break;
+  }
+}
+
+void runLocalRules() {
+  unsigned long now = millis();
+  
+  // Expire timed actions started by earlier passes
+  if (ruleBeepUntil != 0 && (long)(now - ruleBeepUntil) >= 0) {
+    digitalWrite(BUZZER_PIN, LOW);
+    ruleBeepUntil = 0;
+  }
+  if (ruleLedUntil != 0 && (long)(now - ruleLedUntil) >= 0) {
+    armedState();
+    ruleLedUntil = 0;
+  }
+  
+  for (uint8_t i = 0; i < localRuleCount; i++) {
+    const LocalRule& rule = localRules[i];
+    int32_t v = readRuleFeature(rule.feature);
+    bool cond;
+    switch (rule.op) {
+      case OP_GE: cond = v >= rule.value; break;
+      case OP_LE: cond = v <= rule.value; break;
+      case OP_EQ: cond = v == rule.value; break;
+      default:    cond = v != rule.value; break;
+    }
+    
+    uint32_t bit = 1UL << i;
+    bool wasActive = (localRuleActive & bit) != 0;
+    if (!cond) {
+      localRuleActive &= ~bit;
+      continue;
+    }
+    localRuleActive |= bit;
+    if (!wasActive || (rule.repeatMs > 0 && now - localRuleFiredAt[i] >= rule.repeatMs)) {
+      localRuleFiredAt[i] = now;
+      runRuleAction(i, rule);
+    }
+  }
+}
+
+static void replyToHub(JsonDocument& reply) {
+  String line;
+  serializeJson(reply, line);
+  line += '\n';
+  hubLink.write((const uint8_t*)line.c_str(), line.length());
+}
+
+// Handles commands the hub pushes over the persistent link (set_rules)
+void pollHubLink() {
+  while (hubLink.connected() && hubLink.available()) {
+    char c = (char)hubLink.read();
+    if (c != '\n') {
+      if (c == '\r') continue;
+      if (hubRxLine.length() < HUB_RX_LINE_MAX) hubRxLine += c;
+      else hubRxOverflow = true;
+      continue;
+    }
+    
+    JsonDocument reply;
+    reply["device"] = "rempod";
+    reply["id"] = DEVICE_ID;
+    
+    // Dropped whole rather than parsed cut short; a rule table gets a reason
+    if (hubRxOverflow) {
+      bool wasRules = hubRxLine.indexOf("\"set_rules\"") >= 0;
+      hubRxLine = "";
+      hubRxOverflow = false;
+      if (wasRules) {
+        reply["event"] = "rules_rejected";
+        reply["error"] = "line too long";
+        replyToHub(reply);
+      }
+      continue;
+    }
+    
+    JsonDocument doc;
+    DeserializationError err = deserializeJson(doc, hubRxLine);
+    hubRxLine = "";
+    if (err) continue;
+    
+    const char* cmd = doc["cmd"] | "";
+    if (strcmp(cmd, "set_rules") == 0) {
+      String error;
+      if (compileLocalRules(doc["rules"].as<JsonArray>(), error)) {
+        reply["event"] = "rules_loaded";
+        reply["count"] = localRuleCount;
+      } else {
+        reply["event"] = "rules_rejected";
+        reply["error"] = error;
+      }
+      replyToHub(reply);
+    }
+  }
+}
+
 // ==================== WIFI CONNECTION ====================
 bool connectWiFi() {
   Serial.print("      Connecting to WiFi: ");
@@ -714,37 +1040,87 @@ bool connectWiFi() {
 }
 
 // ==================== HUB COMMUNICATION ====================
-void sendEventToHub(const char* event, int strength, float temp, float pressure) {
+// Events go over a persistent connection with Nagle disabled, so the hub can
+// route an em_trigger to other satellites without a TCP handshake first.
+// Falls back to a one-shot connection when the link cannot be opened.
+bool ensureHubLink() {
+  if (hubLink.connected()) return true;
+  if (lastHubAttempt != 0 && millis() - lastHubAttempt < HUB_RECONNECT_INTERVAL) return false;
+  lastHubAttempt = millis();
+  
+  if (!hubLink.connect(HUB_IP, HUB_PORT, HUB_CONNECT_TIMEOUT_MS)) return false;
+  hubLink.setNoDelay(true);
+  hubRxLine = "";
+  hubRxOverflow = false;
+  
+  // Identify right away so the hub can push rules before the first event
+  JsonDocument hello;
+  hello["device"] = "rempod";
+  hello["id"] = DEVICE_ID;
+  hello["location"] = LOCATION;
+  hello["event"] = "hello";
+  String line;
+  serializeJson(hello, line);
+  line += '\n';
+  hubLink.write((const uint8_t*)line.c_str(), line.length());
+  return true;
+}
+
+// Sends one encoded line over the persistent link, or a one-shot connection
+// when the link is down
+static void writeLineToHub(const char* line, size_t len) {
   if (WiFi.status() != WL_CONNECTED) {
     // Hub offline - event logged locally only (no Serial available)
     return;
   }
   
-  if (!client.connect(HUB_IP, HUB_PORT)) {
+  // Send as a single write
+  if (ensureHubLink()) {
+    if (hubLink.write((const uint8_t*)line, len) == len) {
+      return;
+    }
+    hubLink.stop();
+  }
+  
+  if (!client.connect(HUB_IP, HUB_PORT, HUB_CONNECT_TIMEOUT_MS)) {
     // Hub unreachable
     return;
   }
-  
-  // Create JSON message
-  JsonDocument doc;
-  doc["device"] = "rempod";
-  doc["id"] = DEVICE_ID;
-  doc["location"] = LOCATION;
-  doc["event"] = event;
-  doc["strength"] = strength;
-  doc["temperature"] = temp;
-  doc["pressure"] = pressure;
-  doc["battery"] = batteryPercent;
-  doc["timestamp"] = millis() / 1000;
-  
-  // Serialize and send
-  String jsonString;
-  serializeJson(doc, jsonString);
-  client.println(jsonString);
+  client.write((const uint8_t*)line, len);
   client.flush();
   client.stop();
 }
 
+void sendEventToHub(const char* event, int strength, float temp, float pressure) {
+  // Encoded by the schema's generated encoder into a stack buffer
+  oraclebox::RempodEvent ev;
+  ev.id = DEVICE_ID;
+  ev.location = LOCATION;
+  ev.event = event;
+  ev.strength = strength;
+  ev.temperature = temp;
+  ev.pressure = pressure;
+  ev.battery = batteryPercent;
+  ev.timestamp = (int32_t)(millis() / 1000);
+  char line[oraclebox::REMPOD_EVENT_MAX_BYTES];
+  size_t len = oraclebox::encodeRempodEvent(line, ev);
+  writeLineToHub(line, len);
+}
+
+// A local "report" rule fired - the rule index goes in its own field
+void sendRuleFiredToHub(uint8_t index) {
+  oraclebox::RempodRuleFired ev;
+  ev.id = DEVICE_ID;
+  ev.location = LOCATION;
+  ev.event = "rule_fired";
+  ev.rule = index;
+  ev.battery = batteryPercent;
+  ev.timestamp = (int32_t)(millis() / 1000);
+  char line[oraclebox::REMPOD_RULE_FIRED_MAX_BYTES];
+  size_t len = oraclebox::encodeRempodRuleFired(line, ev);
+  writeLineToHub(line, len);
+}
+
 // ==================== BATTERY MONITORING ====================
 int readBattery() {
   // For now, simulate battery drain (replace with real voltage monitoring)
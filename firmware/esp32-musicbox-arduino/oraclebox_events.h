@@ -0,0 +1,189 @@
+// Generated by event_schema_gen from pi/native/schema/satellite_events.jsonl.
+// Do not edit; change the schema and rebuild.
+
+#ifndef ORACLEBOX_EVENTS_H
+#define ORACLEBOX_EVENTS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+namespace oraclebox {
+
+// ==================== ENCODERS ====================
+
+namespace wire {
+
+// Copies a string literal; its length is a compile-time constant.
+template <size_t N>
+inline char* putLiteral(char* p, const char (&s)[N]) {
+  memcpy(p, s, N - 1);
+  return p + N - 1;
+}
+
+// At most maxLen bytes of s, escaping quotes and backslashes and dropping
+// control characters.
+inline char* putString(char* p, const char* s, size_t maxLen) {
+  if (!s) return p;
+  for (size_t n = 0; n < maxLen && s[n]; n++) {
+    char c = s[n];
+    if ((unsigned char)c < 0x20) continue;
+    if (c == '"' || c == '\\') *p++ = '\\';
+    *p++ = c;
+  }
+  return p;
+}
+
+inline char* putInt(char* p, int32_t v, int32_t lo, int32_t hi) {
+  if (v < lo) v = lo;
+  if (v > hi) v = hi;
+  uint32_t u = (uint32_t)v;
+  if (v < 0) {
+    *p++ = '-';
+    u = 0u - u;
+  }
+  char digits[10];
+  int n = 0;
+  do {
+    digits[n++] = (char)('0' + u % 10);
+    u /= 10;
+  } while (u);
+  while (n) *p++ = digits[--n];
+  return p;
+}
+
+// Fixed point with `scale` = 10^decimals; no printf, single-precision math.
+inline char* putFixed(char* p, float v, float lo, float hi, int32_t scale) {
+  if (!(v >= lo)) v = lo;   // also catches NaN
+  if (v > hi) v = hi;
+  float scaled = v * (float)scale;
+  int32_t q = (int32_t)(scaled < 0 ? scaled - 0.5f : scaled + 0.5f);
+  if (q < 0) {
+    *p++ = '-';
+    q = -q;
+  }
+  p = putInt(p, q / scale, 0, INT32_MAX);
+  if (scale > 1) {
+    *p++ = '.';
+    int32_t frac = q % scale;
+    for (int32_t d = scale / 10; d > 0; d /= 10) *p++ = (char)('0' + frac / d % 10);
+  }
+  return p;
+}
+
+}  // namespace wire
+
+// {"device":"rempod","id":...,"location":...,"event":...,"strength":...,"temperature":...,"pressure":...,"battery":...,"timestamp":...}
+struct RempodEvent {
+  const char* id;
+  const char* location;
+  const char* event;
+  int32_t strength;
+  float temperature;
+  float pressure;
+  int32_t battery;
+  int32_t timestamp;
+};
+
+// Longest line encodeRempodEvent() writes, with '\n' and the NUL
+constexpr size_t REMPOD_EVENT_MAX_BYTES = 269;
+
+// Writes one protocol line ("{...}\n", NUL-terminated) and returns its
+// length. Values are clamped to the schema's ranges.
+inline size_t encodeRempodEvent(char (&out)[REMPOD_EVENT_MAX_BYTES], const RempodEvent& e) {
+  char* p = out;
+  p = wire::putLiteral(p, "{\"device\":\"rempod\",\"id\":\"");
+  p = wire::putString(p, e.id, 15);
+  p = wire::putLiteral(p, "\",\"location\":\"");
+  p = wire::putString(p, e.location, 15);
+  p = wire::putLiteral(p, "\",\"event\":\"");
+  p = wire::putString(p, e.event, 31);
+  p = wire::putLiteral(p, "\",\"strength\":");
+  p = wire::putInt(p, e.strength, 0, 1000);
+  p = wire::putLiteral(p, ",\"temperature\":");
+  p = wire::putFixed(p, e.temperature, -40.0f, 185.0f, 100);
+  p = wire::putLiteral(p, ",\"pressure\":");
+  p = wire::putFixed(p, e.pressure, 0.0f, 1100.0f, 100);
+  p = wire::putLiteral(p, ",\"battery\":");
+  p = wire::putInt(p, e.battery, 0, 100);
+  p = wire::putLiteral(p, ",\"timestamp\":");
+  p = wire::putInt(p, e.timestamp, 0, 2147483647);
+  p = wire::putLiteral(p, "}\n");
+  *p = '\0';
+  return (size_t)(p - out);
+}
+
+// {"device":"rempod","id":...,"location":...,"event":...,"rule":...,"battery":...,"timestamp":...}
+struct RempodRuleFired {
+  const char* id;
+  const char* location;
+  const char* event;
+  int32_t rule;
+  int32_t battery;
+  int32_t timestamp;
+};
+
+// Longest line encodeRempodRuleFired() writes, with '\n' and the NUL
+constexpr size_t REMPOD_RULE_FIRED_MAX_BYTES = 223;
+
+// Writes one protocol line ("{...}\n", NUL-terminated) and returns its
+// length. Values are clamped to the schema's ranges.
+inline size_t encodeRempodRuleFired(char (&out)[REMPOD_RULE_FIRED_MAX_BYTES], const RempodRuleFired& e) {
+  char* p = out;
+  p = wire::putLiteral(p, "{\"device\":\"rempod\",\"id\":\"");
+  p = wire::putString(p, e.id, 15);
+  p = wire::putLiteral(p, "\",\"location\":\"");
+  p = wire::putString(p, e.location, 15);
+  p = wire::putLiteral(p, "\",\"event\":\"");
+  p = wire::putString(p, e.event, 31);
+  p = wire::putLiteral(p, "\",\"rule\":");
+  p = wire::putInt(p, e.rule, 0, 15);
+  p = wire::putLiteral(p, ",\"battery\":");
+  p = wire::putInt(p, e.battery, 0, 100);
+  p = wire::putLiteral(p, ",\"timestamp\":");
+  p = wire::putInt(p, e.timestamp, 0, 2147483647);
+  p = wire::putLiteral(p, "}\n");
+  *p = '\0';
+  return (size_t)(p - out);
+}
+
+// {"device":"musicbox","id":...,"location":...,"event":...,"melody":...,"duration":...,"battery":...,"timestamp":...}
+struct MusicboxEvent {
+  const char* id;
+  const char* location;
+  const char* event;
+  const char* melody;
+  int32_t duration;
+  int32_t battery;
+  int32_t timestamp;
+};
+
+// Longest line encodeMusicboxEvent() writes, with '\n' and the NUL
+constexpr size_t MUSICBOX_EVENT_MAX_BYTES = 307;
+
+// Writes one protocol line ("{...}\n", NUL-terminated) and returns its
+// length. Values are clamped to the schema's ranges.
+inline size_t encodeMusicboxEvent(char (&out)[MUSICBOX_EVENT_MAX_BYTES], const MusicboxEvent& e) {
+  char* p = out;
+  p = wire::putLiteral(p, "{\"device\":\"musicbox\",\"id\":\"");
+  p = wire::putString(p, e.id, 15);
+  p = wire::putLiteral(p, "\",\"location\":\"");
+  p = wire::putString(p, e.location, 15);
+  p = wire::putLiteral(p, "\",\"event\":\"");
+  p = wire::putString(p, e.event, 31);
+  p = wire::putLiteral(p, "\",\"melody\":\"");
+  p = wire::putString(p, e.melody, 31);
+  p = wire::putLiteral(p, "\",\"duration\":");
+  p = wire::putInt(p, e.duration, 0, 600000);
+  p = wire::putLiteral(p, ",\"battery\":");
+  p = wire::putInt(p, e.battery, 0, 100);
+  p = wire::putLiteral(p, ",\"timestamp\":");
+  p = wire::putInt(p, e.timestamp, 0, 2147483647);
+  p = wire::putLiteral(p, "}\n");
+  *p = '\0';
+  return (size_t)(p - out);
+}
+
+}  // namespace oraclebox
+
+#endif
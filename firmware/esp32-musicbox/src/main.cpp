@@ -1,8 +1,8 @@
 #include <Arduino.h>
 #include <WiFi.h>
-#include <ArduinoJson.h>
 #include "config.h"
 #include "melodies.h"
+#include "oraclebox_events.h"   // generated from pi/native/schema/satellite_events.jsonl
 
 // Pin Definitions (Music Box - Finalized Hardware)
 const int PIR_PIN = 4;            // AM312 PIR motion sensor OUTPUT
@@ -215,26 +215,24 @@ void sendEventToHub(const char* event, const char* melody, int duration) {
     return;
   }
   
-  // Create JSON message
-  JsonDocument doc;
-  doc["device"] = "musicbox";
-  doc["id"] = DEVICE_ID;
-  doc["location"] = LOCATION;
-  doc["event"] = event;
-  doc["melody"] = melody;
-  doc["duration"] = duration;
-  doc["battery"] = batteryPercent;
-  doc["timestamp"] = millis() / 1000;
-  
-  // Serialize and send
-  String jsonString;
-  serializeJson(doc, jsonString);
-  client.println(jsonString);
+  // Encoded by the schema's generated encoder into a stack buffer
+  oraclebox::MusicboxEvent ev;
+  ev.id = DEVICE_ID;
+  ev.location = LOCATION;
+  ev.event = event;
+  ev.melody = melody;
+  ev.duration = duration;
+  ev.battery = batteryPercent;
+  ev.timestamp = (int32_t)(millis() / 1000);
+  char line[oraclebox::MUSICBOX_EVENT_MAX_BYTES];
+  size_t len = oraclebox::encodeMusicboxEvent(line, ev);
+  
+  client.write((const uint8_t*)line, len);
   client.flush();
   client.stop();
   
   Serial.print("[OK] Event sent: ");
-  Serial.println(jsonString);
+  Serial.print(line);
 }
 
 int readBattery() {
@@ -3,7 +3,7 @@
  * Hardware: ESP32 Dev Module
  * 
  * PINOUT:
- *   GPIO27 -> Passive Buzzer
+ *   GPIO27 -> Passive Buzzer (LEDC PWM, duty = volume)
  *   GPIO14 -> RGB LED Red
  *   GPIO26 -> RGB LED Green
  *   GPIO25 -> RGB LED Blue
@@ -28,19 +28,32 @@
 #include <WiFi.h>
 #include <ArduinoJson.h>
 #include <math.h>
+#include <esp_timer.h>
+#include <Preferences.h>
+#include "oraclebox_events.h"   // generated from pi/native/schema/satellite_events.jsonl
 
 // ==================== CONFIGURATION ====================
 // WiFi Settings (OracleBox Hub - optional, device works standalone)
 #define WIFI_SSID "OracleBox-Network"
 #define WIFI_PASSWORD "yourpassword"
 
-// Device Identity
+// Device Identity (build flags can override, e.g. -DDEVICE_ID='"musicbox_02"')
+#ifndef DEVICE_ID
 #define DEVICE_ID "musicbox_01"
+#endif
+#ifndef LOCATION
 #define LOCATION "bedroom"
+#endif
 
 // Hub Settings (optional - only used if WiFi available)
 #define HUB_IP "192.168.4.1"
 #define HUB_PORT 8888
+#define HUB_RECONNECT_INTERVAL 5000   // ms between persistent hub link attempts
+#define HUB_CONNECT_TIMEOUT_MS 300    // bound how long a link attempt can stall loop()
+#define HUB_RX_LINE_MAX 2048          // a full set_rules table (16 rules, ~100 bytes each) fits
+#define TIME_SYNC_INTERVAL 30000      // ms between clock sync bursts
+#define TIME_SYNC_SAMPLES 8           // exchanges per burst (lowest round trip wins)
+#define TIME_SYNC_TIMEOUT_MS 150      // give up on a single exchange after this long
 
 // Melody Selection: "twinkle_star", "lullaby", "carousel", "creepy_doll", "weasel", "tiptoe", "rosie"
 #define MELODY "twinkle_star"
@@ -52,9 +65,41 @@
 #define BATTERY_CHECK_INTERVAL 60000  // Check battery every 60 seconds
 #define BATTERY_LOW_THRESHOLD 20      // Low battery warning at 20%
 
+// Motion-Reactive Sequencer
+// Intensity (0.0 still -> 1.0 frantic) is derived from PIR activity and
+// continuously scales tempo, articulation and buzzer dynamics.
+#define INTENSITY_TIME_CONSTANT 1500  // ms - PIR activity smoothing window
+#define SEQ_LOOKAHEAD_MS 120          // notes are scheduled this far ahead of playback
+#define TEMPO_SCALE_CALM 1.35f        // note duration multiplier at zero intensity (dragging)
+#define TEMPO_SCALE_FRANTIC 0.65f     // note duration multiplier at full intensity (rushed)
+#define GAP_FRACTION_CALM 0.06f       // inter-note gap as fraction of note slot (legato)
+#define GAP_FRACTION_FRANTIC 0.35f    // inter-note gap at full intensity (staccato)
+#define VELOCITY_CALM 70              // buzzer level 0-255 at zero intensity
+#define VELOCITY_FRANTIC 255          // buzzer level 0-255 at full intensity
+
+// Buzzer Voice (LEDC duty envelope + vibrato, runs on its own timer)
+#define BUZZER_VOLUME 255             // master volume 0-255 (lower for late-night sessions)
+#define BUZZER_CONTROL_RATE_HZ 1000   // envelope/vibrato update rate
+#define BUZZER_ATTACK_MS 15           // rise to full level at note start
+#define BUZZER_DECAY_MS 250           // fall from full level to sustain
+#define BUZZER_SUSTAIN_LEVEL 150      // held level 0-255 after decay
+#define BUZZER_RELEASE_MS 60          // fade out after note off
+#define BUZZER_DYNAMIC_RANGE_DB 36    // loudness span covered by level 1-255
+#define VIBRATO_DEPTH_CENTS 18        // pitch wobble depth (+/- cents)
+#define VIBRATO_RATE_HZ 5.5f          // pitch wobble rate
+#define VIBRATO_DELAY_MS 180          // vibrato starts after this long on a note
+#define VIBRATO_FADE_MS 150           // ...and reaches full depth over this long
+
+// Local rules (loaded from NVS, replaced by the hub's set_rules command)
+#define MAX_LOCAL_RULES 16
+#define LOCAL_RULES_NVS_NAMESPACE "rules"
+#define LOCAL_RULES_VERSION 2
+
 // ==================== PIN DEFINITIONS ====================
 const int PIR_PIN = 4;            // AM312 PIR motion sensor OUTPUT
-const int BUZZER_PIN = 27;        // Passive buzzer (tone output)
+const int BUZZER_PIN = 27;        // Passive buzzer (LEDC output)
+const int BUZZER_LEDC_CHANNEL = 0;    // LEDC channel driving the buzzer
+const int BUZZER_LEDC_RES_BITS = 10;  // LEDC duty resolution (50% duty = 512)
 const int RGB_LED_RED = 14;       // RGB LED - RED pin
 const int RGB_LED_GREEN = 26;     // RGB LED - GREEN pin
 const int RGB_LED_BLUE = 25;      // RGB LED - BLUE pin
@@ -182,6 +227,7 @@ const int melody_rosie_length = 17;
 
 // ==================== STATE VARIABLES ====================
 WiFiClient client;
+WiFiClient hubLink;                   // persistent connection (hub can push commands)
 unsigned long lastTrigger = 0;
 unsigned long lastBatteryCheck = 0;
 bool motionDetected = false;
@@ -190,13 +236,127 @@ int batteryPercent = 100;
 // Proximity / intensity level: 1 = weak, 2 = strong, 3 = extra-strong
 int strengthLevel = 1;
 
+// Motion intensity (0.0 = still, 1.0 = frantic), fed by PIR activity
+float motionIntensity = 0.0f;
+float pirActivity = 0.0f;         // smoothed fraction of time PIR is HIGH
+float pirBurst = 0.0f;            // decaying count of recent PIR re-triggers
+int lastPirState = LOW;
+unsigned long lastIntensityUpdate = 0;
+
+// Active melody (selected by loadMelody)
+const char* activeMelodyName = MELODY;
+const int* activeNotes = melody_twinkle_star;
+const int* activeDurations = durations_twinkle_star;
+int activeLength = melody_twinkle_length;
+
 // Melody playback state (for motion-reactive pause/resume)
-int currentNoteIndex = 0;
-unsigned long noteStartTime = 0;
-unsigned long elapsedInCurrentNote = 0;
+volatile int currentNoteIndex = 0;
+volatile unsigned long noteStartTime = 0;
+volatile unsigned long noteReleaseTime = 0;
 bool melodyPlaying = false;
 bool melodyPaused = false;
 
+// Lookahead scheduler: loop() queues timestamped note events a little ahead
+// of playback and an esp_timer fires them on time, so note timing does not
+// depend on loop() jitter while tempo/articulation change mid-melody.
+enum SeqEventType { SEQ_NOTE_ON, SEQ_NOTE_OFF, SEQ_MELODY_END };
+
+struct SeqEvent {
+  int64_t atUs;       // esp_timer time the event fires
+  uint8_t type;       // SeqEventType
+  uint8_t velocity;   // buzzer level 0-255 (NOTE_ON)
+  int16_t index;      // melody position (NOTE_ON)
+  int freq;           // Hz (NOTE_ON)
+  int32_t slotUs;     // scheduled note slot length (NOTE_ON)
+};
+
+#define SEQ_QUEUE_SIZE 16
+SeqEvent seqQueue[SEQ_QUEUE_SIZE];
+volatile uint8_t seqHead = 0;         // next event consumed by the timer callback
+volatile uint8_t seqTail = 0;         // next free slot written by loop()
+portMUX_TYPE seqMux = portMUX_INITIALIZER_UNLOCKED;
+esp_timer_handle_t seqTimer = nullptr;
+
+int64_t seqCursorUs = 0;              // timeline position of the next note to schedule
+int seqNextIndex = 0;                 // next melody position to schedule
+float seqResumeFraction = 1.0f;       // remaining part of a note interrupted by a pause
+bool seqEndScheduled = false;
+volatile bool seqNoteSounding = false;
+volatile int64_t seqNoteOnUs = 0;     // start of the sounding note
+volatile int32_t seqNoteSlotUs = 0;   // slot length of the sounding note
+volatile bool melodyFinished = false;
+
+// ==================== HUB LINK / CLOCK SYNC ====================
+unsigned long lastHubAttempt = 0;
+unsigned long lastTimeSync = 0;
+bool hubLinkWasUp = false;
+String hubRxLine;                     // partial command line from the hub
+bool hubRxOverflow = false;           // hubRxLine passed HUB_RX_LINE_MAX; drop the line
+int64_t hubClockOffsetUs = 0;         // hub time = esp_timer_get_time() + offset
+int64_t hubClockRttUs = 0;            // round trip of the sample the offset came from
+bool hubClockSynced = false;
+volatile bool onsetArmed = false;     // capture the first note of a hub-scheduled melody
+volatile bool onsetReady = false;
+volatile int64_t onsetLocalUs = 0;
+int64_t onsetScheduledLocalUs = 0;
+
+// Buzzer voice state (owned by the buzzer control timer, guarded by buzzerMux)
+enum BuzzerStage { BUZZER_IDLE, BUZZER_ATTACK, BUZZER_DECAY, BUZZER_SUSTAIN, BUZZER_RELEASE };
+
+#define VIBRATO_TABLE_SIZE 64
+uint16_t buzzerDutyTable[256];                 // level 0-255 -> LEDC duty
+uint32_t vibratoRatioTable[VIBRATO_TABLE_SIZE]; // one LFO cycle of pitch ratios (Q16)
+uint32_t buzzerAttackStep = 0;                 // envelope increments per control tick (Q16)
+uint32_t buzzerDecayStep = 0;
+uint32_t buzzerReleaseStep = 0;
+uint32_t vibratoPhaseStep = 0;                 // Q16 table positions per control tick
+uint32_t vibratoDelayTicks = 0;
+uint32_t vibratoFadeTicks = 1;
+
+volatile uint8_t buzzerStage = BUZZER_IDLE;
+volatile uint32_t buzzerEnv = 0;               // envelope level, Q16 (65535 = full)
+volatile int buzzerFreq = 0;                   // base pitch of the sounding note
+volatile uint8_t buzzerVelocity = 0;
+volatile uint8_t buzzerVolume = BUZZER_VOLUME;
+volatile int64_t buzzerToneOffUs = 0;          // auto note-off time for buzzerTone()
+uint32_t buzzerNoteTicks = 0;
+uint32_t vibratoPhase = 0;
+uint32_t buzzerLastDuty = 0;                   // LEDC as last written - only the tick writes it
+uint32_t buzzerLastFreq = 0;
+bool buzzerTimerRunning = false;
+portMUX_TYPE buzzerMux = portMUX_INITIALIZER_UNLOCKED;
+esp_timer_handle_t buzzerTimer = nullptr;
+
+// ==================== LOCAL RULE TABLE ====================
+enum RuleFeature : uint8_t {
+  FEAT_PIR,          // PIR output (0/1)
+  FEAT_INTENSITY,    // motion intensity x100
+  FEAT_STRENGTH,     // strength level 1-3
+  FEAT_MOTION_MS,    // how long motion has lasted
+  FEAT_PLAYING,      // melody playing (0/1)
+  FEAT_HUB_LINK,     // persistent hub link up (0/1)
+  FEAT_BATTERY,      // percent
+  FEAT_COUNT
+};
+enum RuleOp : uint8_t { OP_GE, OP_LE, OP_EQ, OP_NE, OP_COUNT };
+enum RuleAction : uint8_t { ACT_PLAY, ACT_STOP, ACT_LED, ACT_CHIRP, ACT_VOLUME, ACT_COUNT };
+
+struct LocalRule {          // stored verbatim in NVS - bump LOCAL_RULES_VERSION on change
+  uint8_t feature;
+  uint8_t op;
+  int32_t value;            // motion_ms thresholds go past 32 s
+  uint8_t action;
+  uint8_t arg[3];           // melody index / RGB / chirp freq (10 Hz units) / volume
+  uint16_t argMs;           // LED hold time or chirp length
+  uint16_t repeatMs;        // 0 = fire once per rising edge
+};
+
+LocalRule localRules[MAX_LOCAL_RULES];
+uint8_t localRuleCount = 0;
+uint32_t localRuleActive = 0;                  // condition state from the last pass (bit per rule)
+unsigned long localRuleFiredAt[MAX_LOCAL_RULES];
+unsigned long ruleLedUntil = 0;                // a rule owns the RGB LED until then
+
 // ==================== FUNCTION DECLARATIONS ====================
 bool connectWiFi();
 void displayBatteryLevel(int percent);
@@ -205,7 +365,32 @@ void playMelody();
 void playMelodyStep();
 void updateMelodyRGB();
 void resetMelodyState();
+void updateMotionIntensity(int pirState);
+bool loadMelody(const char* name);
+void startSequencer();
+void startSequencerAt(const char* melody, int64_t startLocalUs);
+void pauseSequencer();
+void resumeSequencer();
+void stopSequencer();
+void scheduleMelodyAhead();
+void onSequencerTimer(void* arg);
+void buzzerBegin();
+void buzzerNoteOn(int freq, uint8_t velocity);
+void buzzerNoteOff();
+void buzzerTone(int freq, unsigned long durationMs);
+void setBuzzerVolume(uint8_t volume);
+void onBuzzerTick(void* arg);
+void loadLocalRules();
+bool compileLocalRules(JsonArray rules, String& error);
+void runLocalRules();
 void sendEventToHub(const char* event, const char* melody, int duration);
+bool sendJsonToHub(JsonDocument& doc);
+bool sendLineToHub(const char* line, size_t len);
+void maintainHubLink();
+void pollHubLink();
+void handleHubCommand(JsonDocument& doc);
+bool runTimeSyncBurst();
+void reportMelodyOnset();
 int readBattery();
 
 // ==================== SETUP ====================
@@ -221,6 +406,18 @@ void setup() {
   pinMode(RGB_LED_GREEN, OUTPUT);
   pinMode(RGB_LED_BLUE, OUTPUT);
 
+  // Melody sequencer timer (fires scheduled note events independently of loop())
+  esp_timer_create_args_t seqTimerArgs = {};
+  seqTimerArgs.callback = &onSequencerTimer;
+  seqTimerArgs.name = "melody_seq";
+  esp_timer_create(&seqTimerArgs, &seqTimer);
+
+  // Buzzer voice: LEDC output, precomputed tables, envelope/vibrato timer
+  buzzerBegin();
+  
+  // Custom behaviors saved by the hub
+  loadLocalRules();
+
   // ---------------- SYSTEM SELF-TEST ----------------
   Serial.println("[SELF-TEST] Checking hardware...");
 
@@ -243,11 +440,11 @@ void setup() {
   digitalWrite(RGB_LED_BLUE, LOW);
 
   // Buzzer chirp
-  tone(BUZZER_PIN, NOTE_C5, 120);
+  buzzerTone(NOTE_C5, 120);
   delay(150);
-  tone(BUZZER_PIN, NOTE_E5, 120);
+  buzzerTone(NOTE_E5, 120);
   delay(150);
-  noTone(BUZZER_PIN);
+  buzzerNoteOff();
 
   Serial.println("[SELF-TEST] Hardware OK");
 
@@ -263,7 +460,7 @@ void setup() {
   for (int i = 0; i < 2; i++) {
     digitalWrite(RGB_LED_GREEN, HIGH);
     digitalWrite(RGB_LED_BLUE, HIGH);
-    tone(BUZZER_PIN, NOTE_C5, 100);
+    buzzerTone(NOTE_C5, 100);
     delay(150);
     digitalWrite(RGB_LED_GREEN, LOW);
     digitalWrite(RGB_LED_BLUE, LOW);
@@ -279,12 +476,12 @@ void setup() {
   if (hubConnected) {
     // Solid GREEN = Hub connected
     digitalWrite(RGB_LED_GREEN, HIGH);
-    tone(BUZZER_PIN, NOTE_G5, 200);
+    buzzerTone(NOTE_G5, 200);
     delay(200);
-    noTone(BUZZER_PIN);
-    tone(BUZZER_PIN, NOTE_C6, 300);
+    buzzerNoteOff();
+    buzzerTone(NOTE_C6, 300);
     delay(300);
-    noTone(BUZZER_PIN);
+    buzzerNoteOff();
     Serial.println("      [OK] Hub connection: ONLINE\n");
     delay(500);
     digitalWrite(RGB_LED_GREEN, LOW);
@@ -292,10 +489,10 @@ void setup() {
     // Red FLASHES = No hub connection
     for (int i = 0; i < 3; i++) {
       digitalWrite(RGB_LED_RED, HIGH);
-      tone(BUZZER_PIN, NOTE_C4, 150);
+      buzzerTone(NOTE_C4, 150);
       delay(150);
       digitalWrite(RGB_LED_RED, LOW);
-      noTone(BUZZER_PIN);
+      buzzerNoteOff();
       delay(100);
     }
     Serial.println("      [WARN] Hub connection: OFFLINE (standalone mode)\n");
@@ -323,13 +520,13 @@ void setup() {
   Serial.println("\n[TIP] Wave hand over PIR sensor to trigger melody!");
   
   // Final ready tone - ascending notes
-  tone(BUZZER_PIN, NOTE_C5, 100);
+  buzzerTone(NOTE_C5, 100);
   delay(120);
-  tone(BUZZER_PIN, NOTE_E5, 100);
+  buzzerTone(NOTE_E5, 100);
   delay(120);
-  tone(BUZZER_PIN, NOTE_G5, 200);
+  buzzerTone(NOTE_G5, 200);
   delay(220);
-  noTone(BUZZER_PIN);
+  buzzerNoteOff();
   
   // Ensure idle red at end of startup
   digitalWrite(RGB_LED_RED, HIGH);
@@ -343,7 +540,7 @@ void loop() {
   static unsigned long lastIdleCheck = 0;
   if (millis() - lastIdleCheck > 250) {   // check every 250ms
     lastIdleCheck = millis();
-    if (!motionDetected && !melodyPlaying) {
+    if (!motionDetected && !melodyPlaying && (long)(millis() - ruleLedUntil) >= 0) {
       // Force LED to solid red (idle state)
       digitalWrite(RGB_LED_RED, HIGH);
       digitalWrite(RGB_LED_GREEN, LOW);
@@ -354,10 +551,24 @@ void loop() {
   // Check for motion
   checkMotion();
   
+  // Custom behaviors (evaluated every tick, no hub round-trip)
+  runLocalRules();
+  
+  // Hub link: reconnect, take pushed commands, keep the clock synced
+  maintainHubLink();
+  pollHubLink();
+  if (hubLink.connected() && !melodyPlaying &&
+      (!hubClockSynced || millis() - lastTimeSync > TIME_SYNC_INTERVAL)) {
+    runTimeSyncBurst();
+  }
+  
   // Continue playing melody if active
   if (melodyPlaying) {
     playMelodyStep();
   }
+  if (onsetReady) {
+    reportMelodyOnset();
+  }
   
   // Battery monitoring
   if (millis() - lastBatteryCheck > BATTERY_CHECK_INTERVAL) {
@@ -410,11 +621,11 @@ void displayBatteryLevel(int percent) {
     // HIGH (>75%) - Solid GREEN + ascending tone
     Serial.println("FULL");
     digitalWrite(RGB_LED_GREEN, HIGH);
-    tone(BUZZER_PIN, NOTE_G5, 150);
+    buzzerTone(NOTE_G5, 150);
     delay(150);
-    tone(BUZZER_PIN, NOTE_C6, 150);
+    buzzerTone(NOTE_C6, 150);
     delay(150);
-    noTone(BUZZER_PIN);
+    buzzerNoteOff();
     delay(300);
     digitalWrite(RGB_LED_GREEN, LOW);
     
@@ -423,9 +634,9 @@ void displayBatteryLevel(int percent) {
     Serial.println("GOOD");
     digitalWrite(RGB_LED_GREEN, HIGH);
     digitalWrite(RGB_LED_BLUE, HIGH);
-    tone(BUZZER_PIN, NOTE_G5, 300);
+    buzzerTone(NOTE_G5, 300);
     delay(300);
-    noTone(BUZZER_PIN);
+    buzzerNoteOff();
     delay(300);
     digitalWrite(RGB_LED_GREEN, LOW);
     digitalWrite(RGB_LED_BLUE, LOW);
@@ -435,11 +646,11 @@ void displayBatteryLevel(int percent) {
     Serial.println("LOW");
     digitalWrite(RGB_LED_RED, HIGH);
     digitalWrite(RGB_LED_GREEN, HIGH);
-    tone(BUZZER_PIN, NOTE_E5, 200);
+    buzzerTone(NOTE_E5, 200);
     delay(200);
-    tone(BUZZER_PIN, NOTE_D5, 200);
+    buzzerTone(NOTE_D5, 200);
     delay(200);
-    noTone(BUZZER_PIN);
+    buzzerNoteOff();
     delay(300);
     digitalWrite(RGB_LED_RED, LOW);
     digitalWrite(RGB_LED_GREEN, LOW);
@@ -449,12 +660,12 @@ void displayBatteryLevel(int percent) {
     Serial.println("CRITICAL");
     for (int i = 0; i < 3; i++) {
       digitalWrite(RGB_LED_RED, HIGH);
-      tone(BUZZER_PIN, NOTE_E5, 100);
+      buzzerTone(NOTE_E5, 100);
       delay(100);
       digitalWrite(RGB_LED_RED, LOW);
-      tone(BUZZER_PIN, NOTE_C5, 100);
+      buzzerTone(NOTE_C5, 100);
       delay(100);
-      noTone(BUZZER_PIN);
+      buzzerNoteOff();
       delay(50);
     }
   }
@@ -463,6 +674,7 @@ void displayBatteryLevel(int percent) {
 // ==================== MOTION DETECTION ====================
 void checkMotion() {
   int pirState = digitalRead(PIR_PIN);
+  updateMotionIntensity(pirState);
   
   if (pirState == HIGH) {
     // Motion detected
@@ -481,10 +693,11 @@ void checkMotion() {
       Serial.println("[*] Starting melody playback");
       melodyPlaying = true;
       melodyPaused = false;
+      startSequencer();
     } else if (melodyPaused) {
       Serial.println("[*] Resuming melody from pause");
       melodyPaused = false;
-      noteStartTime = millis() - elapsedInCurrentNote; // Resume from paused position
+      resumeSequencer(); // Resume from paused position
     }
     
   } else {
@@ -497,8 +710,7 @@ void checkMotion() {
       if (melodyPlaying && !melodyPaused) {
         // Pause the melody
         melodyPaused = true;
-        elapsedInCurrentNote = millis() - noteStartTime;
-        noTone(BUZZER_PIN);
+        pauseSequencer();
         
         // Set LED to dim red during pause
         analogWrite(RGB_LED_RED, 50);
@@ -533,103 +745,26 @@ void playMelodyStep() {
     return; // Don't play while paused
   }
   
-  const int* notes;
-  const int* durations;
-  int length;
-  
-  // Select melody based on config
-  if (strcmp(MELODY, "lullaby") == 0) {
-    notes = melody_lullaby;
-    durations = durations_lullaby;
-    length = melody_lullaby_length;
-  } else if (strcmp(MELODY, "carousel") == 0) {
-    notes = melody_carousel;
-    durations = durations_carousel;
-    length = melody_carousel_length;
-  } else if (strcmp(MELODY, "creepy_doll") == 0) {
-    notes = melody_creepy_doll;
-    durations = durations_creepy_doll;
-    length = melody_creepy_doll_length;
-  } else if (strcmp(MELODY, "weasel") == 0) {
-    notes = melody_weasel;
-    durations = durations_weasel;
-    length = melody_weasel_length;
-  } else if (strcmp(MELODY, "tiptoe") == 0) {
-    notes = melody_tiptoe;
-    durations = durations_tiptoe;
-    length = melody_tiptoe_length;
-  } else if (strcmp(MELODY, "rosie") == 0) {
-    notes = melody_rosie;
-    durations = durations_rosie;
-    length = melody_rosie_length;
-  } else {
-    // Default: twinkle_star
-    notes = melody_twinkle_star;
-    durations = durations_twinkle_star;
-    length = melody_twinkle_length;
-  }
+  // Queue upcoming notes with the current tempo/articulation/dynamics
+  scheduleMelodyAhead();
   
-  // Initialize note if starting fresh
-  if (noteStartTime == 0) {
-    noteStartTime = millis();
-    tone(BUZZER_PIN, notes[currentNoteIndex]);
-    Serial.print("[*] Playing note ");
-    Serial.print(currentNoteIndex + 1);
-    Serial.print("/");
-    Serial.print(length);
-    Serial.print(" | strength level = ");
-    Serial.println(strengthLevel);
+  if (melodyFinished) {
+    // Motion ended during melody - last note has been released
+    Serial.println("[OK] Melody complete - stopping");
+    resetMelodyState();
+    return;
   }
   
-  // Check if current note duration completed
-  unsigned long elapsed = millis() - noteStartTime;
-  int noteDuration = durations[currentNoteIndex];
-  
-  if (elapsed < noteDuration) {
+  if ((long)(millis() - ruleLedUntil) < 0) {
+    // A local rule is holding the LED
+  } else if (seqNoteSounding) {
     // Still playing current note - update RGB
     updateMelodyRGB();
-  } else {
-    // Note finished - move to next
-    noTone(BUZZER_PIN);
-    
-    // Small gap between notes
-    if (strengthLevel == 3 && elapsed < noteDuration + 30) {
-      // White strobe for extra-strong
-      digitalWrite(RGB_LED_RED, HIGH);
-      digitalWrite(RGB_LED_GREEN, HIGH);
-      digitalWrite(RGB_LED_BLUE, HIGH);
-      return;
-    }
-    
-    if (elapsed < noteDuration + 50) {
-      return; // Gap between notes
-    }
-    
-    // Advance to next note
-    currentNoteIndex++;
-    
-    if (currentNoteIndex >= length) {
-      // Melody complete - check if should loop
-      if (digitalRead(PIR_PIN) == HIGH) {
-        // Motion still present - loop melody and increase strength
-        Serial.println("[*] Melody complete - looping");
-        currentNoteIndex = 0;
-        if (strengthLevel < 3) {
-          strengthLevel++;
-          Serial.print("[!] Strength increased to level ");
-          Serial.println(strengthLevel);
-        }
-      } else {
-        // Motion ended during melody - stop
-        Serial.println("[OK] Melody complete - stopping");
-        resetMelodyState();
-        return;
-      }
-    }
-    
-    // Start next note
-    noteStartTime = millis();
-    tone(BUZZER_PIN, notes[currentNoteIndex]);
+  } else if (strengthLevel == 3 && millis() - noteReleaseTime < 30) {
+    // White strobe for extra-strong during the gap between notes
+    digitalWrite(RGB_LED_RED, HIGH);
+    digitalWrite(RGB_LED_GREEN, HIGH);
+    digitalWrite(RGB_LED_BLUE, HIGH);
   }
 }
 
@@ -671,13 +806,12 @@ void updateMelodyRGB() {
 }
 
 void resetMelodyState() {
+  stopSequencer();
   melodyPlaying = false;
   melodyPaused = false;
   currentNoteIndex = 0;
   noteStartTime = 0;
-  elapsedInCurrentNote = 0;
   strengthLevel = 1;
-  noTone(BUZZER_PIN);
   
   // Return to solid red idle
   digitalWrite(RGB_LED_RED, HIGH);
@@ -685,7 +819,971 @@ void resetMelodyState() {
   digitalWrite(RGB_LED_BLUE, LOW);
 }
 
+// ==================== MOTION INTENSITY ====================
+void updateMotionIntensity(int pirState) {
+  unsigned long now = millis();
+  float dt = (float)(now - lastIntensityUpdate);
+  lastIntensityUpdate = now;
+  if (dt <= 0.0f) return;
+  if (dt > 1000.0f) dt = 1000.0f;
+  
+  // Smoothed PIR duty (how much of the recent window the sensor was HIGH)
+  float alpha = dt / (INTENSITY_TIME_CONSTANT + dt);
+  pirActivity += alpha * ((pirState == HIGH ? 1.0f : 0.0f) - pirActivity);
+  
+  // Re-triggers (new rising edges) add a burst that decays over the same window
+  pirBurst *= expf(-dt / INTENSITY_TIME_CONSTANT);
+  if (pirState == HIGH && lastPirState == LOW) {
+    pirBurst = min(1.0f, pirBurst + 0.34f);
+  }
+  lastPirState = pirState;
+  
+  float intensity = 0.6f * pirActivity + 0.4f * pirBurst + 0.15f * (strengthLevel - 1);
+  motionIntensity = constrain(intensity, 0.0f, 1.0f);
+}
+
+// ==================== MELODY SEQUENCER ====================
+bool loadMelody(const char* name) {
+  if (strcmp(name, "lullaby") == 0) {
+    activeNotes = melody_lullaby;
+    activeDurations = durations_lullaby;
+    activeLength = melody_lullaby_length;
+  } else if (strcmp(name, "carousel") == 0) {
+    activeNotes = melody_carousel;
+    activeDurations = durations_carousel;
+    activeLength = melody_carousel_length;
+  } else if (strcmp(name, "creepy_doll") == 0) {
+    activeNotes = melody_creepy_doll;
+    activeDurations = durations_creepy_doll;
+    activeLength = melody_creepy_doll_length;
+  } else if (strcmp(name, "weasel") == 0) {
+    activeNotes = melody_weasel;
+    activeDurations = durations_weasel;
+    activeLength = melody_weasel_length;
+  } else if (strcmp(name, "tiptoe") == 0) {
+    activeNotes = melody_tiptoe;
+    activeDurations = durations_tiptoe;
+    activeLength = melody_tiptoe_length;
+  } else if (strcmp(name, "rosie") == 0) {
+    activeNotes = melody_rosie;
+    activeDurations = durations_rosie;
+    activeLength = melody_rosie_length;
+  } else {
+    // Default: twinkle_star
+    activeNotes = melody_twinkle_star;
+    activeDurations = durations_twinkle_star;
+    activeLength = melody_twinkle_length;
+    activeMelodyName = "twinkle_star";
+    return strcmp(name, "twinkle_star") == 0;
+  }
+  activeMelodyName = name;
+  return true;
+}
+
+static uint8_t seqQueueCount() {
+  return (uint8_t)((seqTail + SEQ_QUEUE_SIZE - seqHead) % SEQ_QUEUE_SIZE);
+}
+
+static void armSequencerTimer() {
+  portENTER_CRITICAL(&seqMux);
+  bool pending = (seqHead != seqTail);
+  int64_t at = pending ? seqQueue[seqHead].atUs : 0;
+  portEXIT_CRITICAL(&seqMux);
+  
+  esp_timer_stop(seqTimer);  // not running is fine
+  if (pending) {
+    int64_t wait = at - esp_timer_get_time();
+    esp_timer_start_once(seqTimer, wait > 0 ? wait : 1);
+  }
+}
+
+static void pushSeqEvent(const SeqEvent& ev) {
+  portENTER_CRITICAL(&seqMux);
+  bool wasEmpty = (seqHead == seqTail);
+  seqQueue[seqTail] = ev;
+  seqTail = (seqTail + 1) % SEQ_QUEUE_SIZE;
+  portEXIT_CRITICAL(&seqMux);
+  
+  // Events are queued in time order, so only an empty queue needs re-arming
+  if (wasEmpty) armSequencerTimer();
+}
+
+static bool popDueSeqEvent(int64_t now, SeqEvent* out) {
+  bool due = false;
+  portENTER_CRITICAL(&seqMux);
+  if (seqHead != seqTail && seqQueue[seqHead].atUs <= now) {
+    *out = seqQueue[seqHead];
+    seqHead = (seqHead + 1) % SEQ_QUEUE_SIZE;
+    due = true;
+  }
+  portEXIT_CRITICAL(&seqMux);
+  return due;
+}
+
+// Drops every queued event; returns the melody position of the first note
+// that never started, or -1 if no NOTE_ON was pending
+static int flushSeqQueue() {
+  esp_timer_stop(seqTimer);
+  int firstUnplayed = -1;
+  portENTER_CRITICAL(&seqMux);
+  for (uint8_t i = seqHead; i != seqTail; i = (i + 1) % SEQ_QUEUE_SIZE) {
+    if (seqQueue[i].type == SEQ_NOTE_ON) {
+      firstUnplayed = seqQueue[i].index;
+      break;
+    }
+  }
+  seqHead = seqTail;
+  portEXIT_CRITICAL(&seqMux);
+  return firstUnplayed;
+}
+
+void onSequencerTimer(void* arg) {
+  // Runs in the esp_timer task: fire every event that is due, then re-arm
+  SeqEvent ev;
+  while (popDueSeqEvent(esp_timer_get_time(), &ev)) {
+    switch (ev.type) {
+      case SEQ_NOTE_ON:
+        buzzerNoteOn(ev.freq, ev.velocity);
+        if (onsetArmed && ev.index == 0) {
+          onsetLocalUs = esp_timer_get_time();
+          onsetArmed = false;
+          onsetReady = true;
+        }
+        currentNoteIndex = ev.index;
+        seqNoteOnUs = ev.atUs;
+        seqNoteSlotUs = ev.slotUs;
+        noteStartTime = millis();
+        seqNoteSounding = true;
+        break;
+      case SEQ_NOTE_OFF:
+        buzzerNoteOff();
+        noteReleaseTime = millis();
+        seqNoteSounding = false;
+        break;
+      case SEQ_MELODY_END:
+        melodyFinished = true;
+        break;
+    }
+  }
+  armSequencerTimer();
+}
+
+void startSequencer() {
+  onsetArmed = false;
+  startSequencerAt(MELODY, esp_timer_get_time() + 2000);  // small lead so the first note is on time
+}
+
+// First note sounds at startLocalUs (esp_timer clock). Nothing is queued until
+// the start time comes within the lookahead window.
+void startSequencerAt(const char* melody, int64_t startLocalUs) {
+  flushSeqQueue();
+  loadMelody(melody);
+  seqNextIndex = 0;
+  seqResumeFraction = 1.0f;
+  seqEndScheduled = false;
+  seqNoteSounding = false;
+  melodyFinished = false;
+  seqCursorUs = startLocalUs;
+  scheduleMelodyAhead();
+}
+
+void pauseSequencer() {
+  int firstUnplayed = flushSeqQueue();
+  buzzerNoteOff();
+  
+  // Resume from the interrupted note, keeping only the part that was not played
+  if (seqNoteSounding && seqNoteSlotUs > 0) {
+    float played = (float)(esp_timer_get_time() - seqNoteOnUs) / seqNoteSlotUs;
+    seqNextIndex = currentNoteIndex;
+    seqResumeFraction = constrain(1.0f - played, 0.1f, 1.0f);
+  } else if (firstUnplayed >= 0) {
+    // Between notes (or before the first one): the lookahead already moved
+    // seqNextIndex past notes that were just flushed
+    seqNextIndex = firstUnplayed;
+    seqResumeFraction = 1.0f;
+  } else if (noteStartTime != 0) {
+    seqNextIndex = currentNoteIndex + 1;
+    seqResumeFraction = 1.0f;
+  }
+  seqNoteSounding = false;
+  seqEndScheduled = false;
+  melodyFinished = false;
+}
+
+void resumeSequencer() {
+  seqCursorUs = esp_timer_get_time() + 2000;
+  scheduleMelodyAhead();
+}
+
+void stopSequencer() {
+  flushSeqQueue();
+  buzzerNoteOff();
+  seqNoteSounding = false;
+  seqEndScheduled = false;
+  melodyFinished = false;
+  seqNextIndex = 0;
+  seqResumeFraction = 1.0f;
+}
+
+void scheduleMelodyAhead() {
+  int64_t now = esp_timer_get_time();
+  
+  // loop() stalled past the lookahead (e.g. blocking hub send) - re-anchor
+  // instead of firing a burst of overdue notes
+  if (seqCursorUs < now && seqQueueCount() == 0) {
+    seqCursorUs = now + 2000;
+  }
+  
+  int64_t horizon = now + (int64_t)SEQ_LOOKAHEAD_MS * 1000;
+  while (!seqEndScheduled && seqCursorUs < horizon && seqQueueCount() < SEQ_QUEUE_SIZE - 3) {
+    if (seqNextIndex >= activeLength) {
+      // Melody complete - check if should loop
+      if (digitalRead(PIR_PIN) == HIGH) {
+        // Motion still present - loop melody and increase strength
+        Serial.println("[*] Melody complete - looping");
+        seqNextIndex = 0;
+        if (strengthLevel < 3) {
+          strengthLevel++;
+          Serial.print("[!] Strength increased to level ");
+          Serial.println(strengthLevel);
+        }
+      } else {
+        SeqEvent end = {};
+        end.atUs = seqCursorUs;
+        end.type = SEQ_MELODY_END;
+        pushSeqEvent(end);
+        seqEndScheduled = true;
+        break;
+      }
+    }
+    
+    // Parameters are sampled per note, so they follow intensity mid-melody
+    float intensity = motionIntensity;
+    float tempoScale = TEMPO_SCALE_CALM + (TEMPO_SCALE_FRANTIC - TEMPO_SCALE_CALM) * intensity;
+    float gapFraction = GAP_FRACTION_CALM + (GAP_FRACTION_FRANTIC - GAP_FRACTION_CALM) * intensity;
+    uint8_t velocity = (uint8_t)(VELOCITY_CALM + (VELOCITY_FRANTIC - VELOCITY_CALM) * intensity);
+    
+    int32_t slotUs = (int32_t)(activeDurations[seqNextIndex] * 1000.0f * tempoScale * seqResumeFraction);
+    int32_t soundUs = (int32_t)(slotUs * (1.0f - gapFraction));
+    
+    SeqEvent on = {};
+    on.atUs = seqCursorUs;
+    on.type = SEQ_NOTE_ON;
+    on.velocity = velocity;
+    on.index = (int16_t)seqNextIndex;
+    on.freq = activeNotes[seqNextIndex];
+    on.slotUs = slotUs;
+    pushSeqEvent(on);
+    
+    SeqEvent off = {};
+    off.atUs = seqCursorUs + soundUs;
+    off.type = SEQ_NOTE_OFF;
+    pushSeqEvent(off);
+    
+    if (seqResumeFraction >= 1.0f && seqNextIndex == 0) {
+      Serial.print("[*] Playing ");
+      Serial.print(activeMelodyName);
+      Serial.print(" | strength level = ");
+      Serial.print(strengthLevel);
+      Serial.print(" | intensity = ");
+      Serial.println(intensity, 2);
+    }
+    
+    seqCursorUs += slotUs;
+    seqResumeFraction = 1.0f;
+    seqNextIndex++;
+  }
+}
+
+// ==================== LOCAL RULES ====================
+// Small table interpreter so custom behaviors run on the device at sensor
+// rate, with or without the hub. Each rule compares one sensor feature
+// against a threshold and runs one action on the condition's rising edge
+// (and again every repeatMs while it stays true). The table is compiled
+// from the hub's set_rules command and kept in NVS; evaluation is a fixed
+// pass over at most MAX_LOCAL_RULES entries per loop() tick.
+static const char* const RULE_FEATURE_NAMES[FEAT_COUNT] = {
+  "pir", "intensity", "strength", "motion_ms", "playing", "hub_link", "battery"
+};
+static const char* const RULE_OP_NAMES[OP_COUNT] = { ">=", "<=", "==", "!=" };
+static const char* const RULE_ACTION_NAMES[ACT_COUNT] = { "play", "stop", "led", "chirp", "volume" };
+static const char* const RULE_MELODY_NAMES[] = {
+  "twinkle_star", "lullaby", "carousel", "creepy_doll", "weasel", "tiptoe", "rosie"
+};
+static const int RULE_MELODY_COUNT = sizeof(RULE_MELODY_NAMES) / sizeof(RULE_MELODY_NAMES[0]);
+
+static int ruleNameIndex(const char* name, const char* const* names, int count) {
+  for (int i = 0; i < count; i++) {
+    if (strcmp(name, names[i]) == 0) return i;
+  }
+  return -1;
+}
+
+// A table read back from NVS is checked again before use - the indices in it
+// go straight into lookup tables.
+static bool validLocalRule(const LocalRule& rule) {
+  if (rule.feature >= FEAT_COUNT || rule.op >= OP_COUNT || rule.action >= ACT_COUNT) return false;
+  if (rule.action == ACT_PLAY && rule.arg[0] >= RULE_MELODY_COUNT) return false;
+  if (rule.action == ACT_CHIRP && rule.arg[0] == 0) return false;
+  return true;
+}
+
+// Reads an optional whole-number rule field. Anything that is not a number in
+// [lo, hi] is rejected instead of being truncated into the packed table.
+static bool ruleNumber(JsonVariant v, int32_t fallback, int32_t lo, int32_t hi,
+                       int32_t& out, uint8_t index, const char* key, String& error) {
+  if (v.isNull()) {
+    out = fallback;
+    return true;
+  }
+  double d = v.is<double>() ? v.as<double>() : NAN;
+  if (!(d >= lo && d <= hi) || d != floor(d)) {
+    error = "rule " + String(index) + ": " + key + " out of range (" + String(lo) + ".." + String(hi) + ")";
+    return false;
+  }
+  out = (int32_t)d;
+  return true;
+}
+
+void loadLocalRules() {
+  Preferences prefs;
+  localRuleCount = 0;
+  if (!prefs.begin(LOCAL_RULES_NVS_NAMESPACE, true)) return;
+  size_t len = prefs.getBytesLength("table");
+  if (prefs.getUChar("ver", 0) == LOCAL_RULES_VERSION && len % sizeof(LocalRule) == 0 &&
+      len <= sizeof(localRules)) {
+    prefs.getBytes("table", localRules, len);
+    localRuleCount = len / sizeof(LocalRule);
+  }
+  prefs.end();
+  for (uint8_t i = 0; i < localRuleCount; i++) {
+    if (!validLocalRule(localRules[i])) {
+      Serial.println("[WARN] Local rule table in NVS is corrupt - ignored");
+      localRuleCount = 0;
+      break;
+    }
+  }
+  
+  localRuleActive = 0;
+  memset(localRuleFiredAt, 0, sizeof(localRuleFiredAt));
+  Serial.print("[OK] Local rules loaded: ");
+  Serial.println(localRuleCount);
+}
+
+static void saveLocalRules() {
+  Preferences prefs;
+  if (!prefs.begin(LOCAL_RULES_NVS_NAMESPACE, false)) return;
+  prefs.putUChar("ver", LOCAL_RULES_VERSION);
+  prefs.putBytes("table", localRules, localRuleCount * sizeof(LocalRule));
+  prefs.end();
+}
+
+// Compiles [{"if":"intensity","op":">=","value":70,"do":"play","melody":"rosie"}, ...]
+// into the binary table. Nothing changes unless every rule is valid.
+bool compileLocalRules(JsonArray rules, String& error) {
+  LocalRule table[MAX_LOCAL_RULES];
+  uint8_t count = 0;
+  
+  for (JsonObject r : rules) {
+    if (count >= MAX_LOCAL_RULES) {
+      error = "too many rules";
+      return false;
+    }
+    LocalRule& rule = table[count];
+    memset(&rule, 0, sizeof(rule));
+    
+    int feature = ruleNameIndex(r["if"] | "", RULE_FEATURE_NAMES, FEAT_COUNT);
+    int op = ruleNameIndex(r["op"] | ">=", RULE_OP_NAMES, OP_COUNT);
+    int action = ruleNameIndex(r["do"] | "", RULE_ACTION_NAMES, ACT_COUNT);
+    if (feature < 0 || op < 0 || action < 0) {
+      error = "rule " + String(count) + ": unknown if/op/do";
+      return false;
+    }
+    int32_t value, ms, repeatMs;
+    if (!ruleNumber(r["value"], 1, INT32_MIN, INT32_MAX, value, count, "value", error) ||
+        !ruleNumber(r["ms"], 0, 0, 65535, ms, count, "ms", error) ||
+        !ruleNumber(r["repeat_ms"], 0, 0, 65535, repeatMs, count, "repeat_ms", error)) {
+      return false;
+    }
+    rule.feature = feature;
+    rule.op = op;
+    rule.value = value;
+    rule.action = action;
+    rule.argMs = ms;
+    rule.repeatMs = repeatMs;
+    
+    if (action == ACT_PLAY) {
+      int melody = ruleNameIndex(r["melody"] | MELODY, RULE_MELODY_NAMES, RULE_MELODY_COUNT);
+      if (melody < 0) {
+        error = "rule " + String(count) + ": unknown melody";
+        return false;
+      }
+      rule.arg[0] = melody;
+    } else if (action == ACT_LED) {
+      for (int c = 0; c < 3; c++) {
+        int32_t level;
+        if (!ruleNumber(r["rgb"][c], 0, 0, 255, level, count, "rgb", error)) return false;
+        rule.arg[c] = level;
+      }
+      if (rule.argMs == 0) rule.argMs = 1000;
+    } else if (action == ACT_CHIRP) {
+      int32_t freq;
+      if (!ruleNumber(r["freq"], 880, 50, 2550, freq, count, "freq", error)) return false;
+      rule.arg[0] = (freq + 5) / 10;                     // 10 Hz units
+      if (rule.argMs == 0) rule.argMs = 150;
+    } else if (action == ACT_VOLUME) {
+      int32_t level;
+      if (!ruleNumber(r["level"], BUZZER_VOLUME, 0, 255, level, count, "level", error)) return false;
+      rule.arg[0] = level;
+    }
+    count++;
+  }
+  
+  memcpy(localRules, table, count * sizeof(LocalRule));
+  localRuleCount = count;
+  localRuleActive = 0;
+  memset(localRuleFiredAt, 0, sizeof(localRuleFiredAt));
+  saveLocalRules();
+  return true;
+}
+
+static int32_t readRuleFeature(uint8_t feature) {
+  switch (feature) {
+    case FEAT_PIR:       return digitalRead(PIR_PIN) == HIGH ? 1 : 0;
+    case FEAT_INTENSITY: return (int32_t)(motionIntensity * 100.0f);
+    case FEAT_STRENGTH:  return strengthLevel;
+    case FEAT_MOTION_MS: return motionDetected ? (int32_t)(millis() - lastTrigger) : 0;
+    case FEAT_PLAYING:   return melodyPlaying ? 1 : 0;
+    case FEAT_HUB_LINK:  return hubLink.connected() ? 1 : 0;
+    case FEAT_BATTERY:   return batteryPercent;
+  }
+  return 0;
+}
+
+static void runRuleAction(const LocalRule& rule) {
+  switch (rule.action) {
+    case ACT_PLAY:
+      if (melodyPlaying) break;
+      melodyPlaying = true;
+      melodyPaused = false;
+      onsetArmed = false;
+      startSequencerAt(RULE_MELODY_NAMES[rule.arg[0]], esp_timer_get_time() + 2000);
+      break;
+    case ACT_STOP:
+      if (melodyPlaying) resetMelodyState();
+      break;
+    case ACT_LED:
+      analogWrite(RGB_LED_RED, rule.arg[0]);
+      analogWrite(RGB_LED_GREEN, rule.arg[1]);
+      analogWrite(RGB_LED_BLUE, rule.arg[2]);
+      ruleLedUntil = millis() + rule.argMs;
+      break;
+    case ACT_CHIRP:
+      buzzerTone(rule.arg[0] * 10, rule.argMs);
+      break;
+    case ACT_VOLUME:
+      setBuzzerVolume(rule.arg[0]);
+      break;
+  }
+}
+
+void runLocalRules() {
+  unsigned long now = millis();
+  for (uint8_t i = 0; i < localRuleCount; i++) {
+    const LocalRule& rule = localRules[i];
+    int32_t v = readRuleFeature(rule.feature);
+    bool cond;
+    switch (rule.op) {
+      case OP_GE: cond = v >= rule.value; break;
+      case OP_LE: cond = v <= rule.value; break;
+      case OP_EQ: cond = v == rule.value; break;
+      default:    cond = v != rule.value; break;
+    }
+    
+    uint32_t bit = 1UL << i;
+    bool wasActive = (localRuleActive & bit) != 0;
+    if (!cond) {
+      localRuleActive &= ~bit;
+      continue;
+    }
+    localRuleActive |= bit;
+    if (!wasActive || (rule.repeatMs > 0 && now - localRuleFiredAt[i] >= rule.repeatMs)) {
+      localRuleFiredAt[i] = now;
+      runRuleAction(rule);
+    }
+  }
+}
+
+// ==================== BUZZER VOICE ====================
+// The passive buzzer is driven by LEDC directly instead of tone(): duty sets
+// loudness (a square wave's fundamental peaks at 50% duty), and a periodic
+// esp_timer shapes every note with an attack/decay/release envelope and a
+// delayed vibrato. All curves are precomputed so the control tick is only
+// table lookups and integer math, and nothing depends on loop() timing.
+// Only the tick writes LEDC; note on/off from loop() or the sequencer just
+// update the voice under buzzerMux. esp_timer calls take their own lock, so
+// they are made outside the critical section.
+
+static void buzzerWriteDuty(uint32_t duty) {
+#if ESP_ARDUINO_VERSION_MAJOR >= 3
+  ledcWrite(BUZZER_PIN, duty);
+#else
+  ledcWrite(BUZZER_LEDC_CHANNEL, duty);
+#endif
+}
+
+static void buzzerWriteFreq(uint32_t freq) {
+#if ESP_ARDUINO_VERSION_MAJOR >= 3
+  ledcChangeFrequency(BUZZER_PIN, freq, BUZZER_LEDC_RES_BITS);
+#else
+  ledcChangeFrequency(BUZZER_LEDC_CHANNEL, freq, BUZZER_LEDC_RES_BITS);
+#endif
+}
+
+void buzzerBegin() {
+  // Level -> duty: level 1-255 spans BUZZER_DYNAMIC_RANGE_DB of loudness.
+  // Fundamental amplitude of a square wave is proportional to sin(pi * duty),
+  // so invert that to get the duty for each target amplitude.
+  const float maxDuty = (float)(1 << BUZZER_LEDC_RES_BITS);
+  buzzerDutyTable[0] = 0;
+  for (int level = 1; level < 256; level++) {
+    float db = ((float)level / 255.0f - 1.0f) * BUZZER_DYNAMIC_RANGE_DB;
+    float amplitude = powf(10.0f, db / 20.0f);
+    float duty = asinf(amplitude) / (float)M_PI;  // 0.0 - 0.5
+    buzzerDutyTable[level] = (uint16_t)max(1.0f, duty * maxDuty + 0.5f);
+  }
+  
+  // One vibrato cycle as pitch ratios in Q16 (1.0 = 65536)
+  for (int i = 0; i < VIBRATO_TABLE_SIZE; i++) {
+    float cents = VIBRATO_DEPTH_CENTS * sinf(2.0f * (float)M_PI * i / VIBRATO_TABLE_SIZE);
+    vibratoRatioTable[i] = (uint32_t)(powf(2.0f, cents / 1200.0f) * 65536.0f + 0.5f);
+  }
+  
+  // Envelope slopes per control tick (Q16 full scale = 65535)
+  const uint32_t full = 65535;
+  const uint32_t sustain = (uint32_t)BUZZER_SUSTAIN_LEVEL * 257;
+  buzzerAttackStep = max(1UL, (unsigned long)(full * 1000UL / ((unsigned long)BUZZER_ATTACK_MS * BUZZER_CONTROL_RATE_HZ)));
+  buzzerDecayStep = max(1UL, (unsigned long)((full - sustain) * 1000UL / ((unsigned long)BUZZER_DECAY_MS * BUZZER_CONTROL_RATE_HZ)));
+  buzzerReleaseStep = max(1UL, (unsigned long)(full * 1000UL / ((unsigned long)BUZZER_RELEASE_MS * BUZZER_CONTROL_RATE_HZ)));
+  vibratoPhaseStep = (uint32_t)(VIBRATO_RATE_HZ * VIBRATO_TABLE_SIZE * 65536.0f / BUZZER_CONTROL_RATE_HZ);
+  vibratoDelayTicks = (uint32_t)VIBRATO_DELAY_MS * BUZZER_CONTROL_RATE_HZ / 1000;
+  vibratoFadeTicks = max(1UL, (unsigned long)VIBRATO_FADE_MS * BUZZER_CONTROL_RATE_HZ / 1000);
+  
+  // LEDC output stays attached; silence is duty 0
+#if ESP_ARDUINO_VERSION_MAJOR >= 3
+  ledcAttachChannel(BUZZER_PIN, NOTE_C5, BUZZER_LEDC_RES_BITS, BUZZER_LEDC_CHANNEL);
+#else
+  ledcSetup(BUZZER_LEDC_CHANNEL, NOTE_C5, BUZZER_LEDC_RES_BITS);
+  ledcAttachPin(BUZZER_PIN, BUZZER_LEDC_CHANNEL);
+#endif
+  buzzerWriteDuty(0);
+  buzzerLastFreq = NOTE_C5;
+  
+  esp_timer_create_args_t buzzerTimerArgs = {};
+  buzzerTimerArgs.callback = &onBuzzerTick;
+  buzzerTimerArgs.name = "buzzer_voice";
+  esp_timer_create(&buzzerTimerArgs, &buzzerTimer);
+}
+
+// ESP_ERR_INVALID_STATE just means the timer is still running
+static void startBuzzerTimer() {
+  esp_timer_start_periodic(buzzerTimer, 1000000UL / BUZZER_CONTROL_RATE_HZ);
+}
+
+void onBuzzerTick(void* arg) {
+  portENTER_CRITICAL(&buzzerMux);
+  if (buzzerToneOffUs != 0 && esp_timer_get_time() >= buzzerToneOffUs) {
+    buzzerToneOffUs = 0;
+    if (buzzerStage != BUZZER_IDLE) buzzerStage = BUZZER_RELEASE;
+  }
+  
+  uint32_t env = buzzerEnv;
+  const uint32_t sustain = (uint32_t)BUZZER_SUSTAIN_LEVEL * 257;
+  switch (buzzerStage) {
+    case BUZZER_ATTACK:
+      env += buzzerAttackStep;
+      if (env >= 65535) { env = 65535; buzzerStage = BUZZER_DECAY; }
+      break;
+    case BUZZER_DECAY:
+      env = (env > sustain + buzzerDecayStep) ? env - buzzerDecayStep : sustain;
+      if (env == sustain) buzzerStage = BUZZER_SUSTAIN;
+      break;
+    case BUZZER_RELEASE:
+      env = (env > buzzerReleaseStep) ? env - buzzerReleaseStep : 0;
+      if (env == 0) buzzerStage = BUZZER_IDLE;
+      break;
+    default:
+      break;
+  }
+  buzzerEnv = env;
+  
+  // Loudness = envelope x note velocity x master volume -> level 0-255 -> duty
+  uint32_t level = ((env >> 8) * buzzerVelocity * buzzerVolume) / (255UL * 255UL);
+  uint32_t duty = buzzerDutyTable[level > 255 ? 255 : level];
+  
+  // Vibrato starts VIBRATO_DELAY_MS into a sustained note, its depth rising
+  // linearly to full over VIBRATO_FADE_MS
+  uint32_t freq = buzzerFreq;
+  buzzerNoteTicks++;
+  if (buzzerNoteTicks > vibratoDelayTicks && freq > 0) {
+    vibratoPhase += vibratoPhaseStep;
+    int32_t bend = (int32_t)vibratoRatioTable[(vibratoPhase >> 16) % VIBRATO_TABLE_SIZE] - 65536;
+    uint32_t faded = buzzerNoteTicks - vibratoDelayTicks;
+    if (faded < vibratoFadeTicks) bend = bend * (int32_t)faded / (int32_t)vibratoFadeTicks;
+    freq = (uint32_t)(((uint64_t)freq * (uint32_t)(65536 + bend)) >> 16);
+  }
+  bool idle = (buzzerStage == BUZZER_IDLE);
+  portEXIT_CRITICAL(&buzzerMux);
+  
+  if (freq > 0 && freq != buzzerLastFreq && !idle) {
+    buzzerWriteFreq(freq);
+    buzzerLastFreq = freq;
+  }
+  if (duty != buzzerLastDuty) {
+    buzzerWriteDuty(duty);
+    buzzerLastDuty = duty;
+  }
+  
+  // Nothing sounding - stop ticking until the next note
+  if (idle) {
+    portENTER_CRITICAL(&buzzerMux);
+    bool stop = buzzerStage == BUZZER_IDLE && buzzerTimerRunning;
+    if (stop) buzzerTimerRunning = false;
+    portEXIT_CRITICAL(&buzzerMux);
+    if (!stop) return;
+    esp_timer_stop(buzzerTimer);
+    
+    // A note that came in before the stop found the timer running, so its
+    // start was a no-op - restart for it
+    portENTER_CRITICAL(&buzzerMux);
+    bool restart = buzzerStage != BUZZER_IDLE;
+    if (restart) buzzerTimerRunning = true;
+    portEXIT_CRITICAL(&buzzerMux);
+    if (restart) startBuzzerTimer();
+  }
+}
+
+void buzzerNoteOn(int freq, uint8_t velocity) {
+  portENTER_CRITICAL(&buzzerMux);
+  buzzerFreq = freq;
+  buzzerVelocity = velocity;
+  buzzerStage = BUZZER_ATTACK;  // retrigger from the current level (no click)
+  buzzerToneOffUs = 0;
+  buzzerNoteTicks = 0;
+  vibratoPhase = 0;
+  bool start = !buzzerTimerRunning;
+  buzzerTimerRunning = true;
+  portEXIT_CRITICAL(&buzzerMux);
+  
+  // Pitch and loudness both follow on the next tick
+  if (start) startBuzzerTimer();
+}
+
+void buzzerNoteOff() {
+  portENTER_CRITICAL(&buzzerMux);
+  if (buzzerStage != BUZZER_IDLE) buzzerStage = BUZZER_RELEASE;
+  buzzerToneOffUs = 0;
+  portEXIT_CRITICAL(&buzzerMux);
+}
+
+void buzzerTone(int freq, unsigned long durationMs) {
+  // Non-blocking like tone(pin, freq, duration): releases on its own
+  buzzerNoteOn(freq, 255);
+  portENTER_CRITICAL(&buzzerMux);
+  buzzerToneOffUs = esp_timer_get_time() + (int64_t)durationMs * 1000;
+  portEXIT_CRITICAL(&buzzerMux);
+}
+
+void setBuzzerVolume(uint8_t volume) {
+  buzzerVolume = volume;
+}
+
 // ==================== HUB COMMUNICATION ====================
+// The music box keeps one TCP connection open to the hub so the hub can push
+// commands (play_at) and answer clock sync requests. Events go over the same
+// connection; if it is down they fall back to a one-shot connect/send/close.
+void maintainHubLink() {
+  if (WiFi.status() != WL_CONNECTED) return;
+  if (hubLink.connected()) return;
+  
+  if (hubLinkWasUp) {
+    Serial.println("[WARN] Hub link lost");
+    hubLinkWasUp = false;
+    hubClockSynced = false;
+    hubRxLine = "";
+    hubRxOverflow = false;
+  }
+  
+  // Connecting blocks loop(); never do it mid-melody
+  if (melodyPlaying) return;
+  if (lastHubAttempt != 0 && millis() - lastHubAttempt < HUB_RECONNECT_INTERVAL) return;
+  lastHubAttempt = millis();
+  
+  if (!hubLink.connect(HUB_IP, HUB_PORT, HUB_CONNECT_TIMEOUT_MS)) return;
+  hubLink.setNoDelay(true);
+  hubLinkWasUp = true;
+  
+  JsonDocument hello;
+  hello["device"] = "musicbox";
+  hello["id"] = DEVICE_ID;
+  hello["location"] = LOCATION;
+  hello["event"] = "hello";
+  hello["melody"] = MELODY;
+  hello["battery"] = batteryPercent;
+  if (sendJsonToHub(hello)) {
+    Serial.println("[OK] Hub link up");
+  }
+}
+
+// One write per line so TCP_NODELAY sends it as a single segment
+bool sendJsonToHub(JsonDocument& doc) {
+  if (!hubLink.connected()) return false;
+  String line;
+  serializeJson(doc, line);
+  line += '\n';
+  return sendLineToHub(line.c_str(), line.length());
+}
+
+// Writes one complete protocol line ("{...}\n") over the persistent link
+bool sendLineToHub(const char* line, size_t len) {
+  if (!hubLink.connected()) return false;
+  if (hubLink.write((const uint8_t*)line, len) != len) {
+    Serial.println("[WARN] Hub link write failed - closing");
+    hubLink.stop();
+    return false;
+  }
+  return true;
+}
+
+// Appends available bytes to hubRxLine; true once a full line is buffered
+static bool readHubLine() {
+  while (hubLink.available()) {
+    char c = (char)hubLink.read();
+    if (c == '\n') return true;
+    if (c == '\r') continue;
+    if (hubRxLine.length() < HUB_RX_LINE_MAX) hubRxLine += c;
+    else hubRxOverflow = true;
+  }
+  return false;
+}
+
+// A line longer than HUB_RX_LINE_MAX is dropped whole rather than parsed cut
+// short. If it was a rule table, the hub is told why it was not applied.
+static bool dropLongHubLine() {
+  if (!hubRxOverflow) return false;
+  bool wasRules = hubRxLine.indexOf("\"set_rules\"") >= 0;
+  hubRxLine = "";
+  hubRxOverflow = false;
+  Serial.println("[WARN] Hub line too long - dropped");
+  if (wasRules) {
+    JsonDocument reply;
+    reply["device"] = "musicbox";
+    reply["id"] = DEVICE_ID;
+    reply["event"] = "rules_rejected";
+    reply["error"] = "line too long";
+    sendJsonToHub(reply);
+  }
+  return true;
+}
+
+void pollHubLink() {
+  if (!hubLink.connected()) return;
+  while (readHubLine()) {
+    if (dropLongHubLine()) continue;
+    JsonDocument doc;
+    DeserializationError err = deserializeJson(doc, hubRxLine);
+    hubRxLine = "";
+    if (err) {
+      Serial.print("[WARN] Bad hub command: ");
+      Serial.println(err.c_str());
+      continue;
+    }
+    handleHubCommand(doc);
+  }
+}
+
+// Commands outlive their JsonDocument, so the melody name is copied out
+static const char* hubMelodyName(JsonDocument& doc) {
+  static char melodyName[24];
+  strncpy(melodyName, doc["melody"] | MELODY, sizeof(melodyName) - 1);
+  melodyName[sizeof(melodyName) - 1] = '\0';
+  return melodyName;
+}
+
+void handleHubCommand(JsonDocument& doc) {
+  const char* cmd = doc["cmd"] | "";
+  
+  if (strcmp(cmd, "play_at") == 0) {
+    // Synchronized playback: start the melody at hub time "at"
+    const char* melodyName = hubMelodyName(doc);
+    int64_t atHubUs = doc["at"].as<int64_t>();
+    
+    if (!hubClockSynced) {
+      Serial.println("[WARN] play_at ignored - clock not synced yet");
+      return;
+    }
+    int64_t startLocalUs = atHubUs - hubClockOffsetUs;
+    int64_t leadUs = startLocalUs - esp_timer_get_time();
+    
+    Serial.print("[*] Hub play_at: ");
+    Serial.print(melodyName);
+    Serial.print(" in ");
+    Serial.print((long)(leadUs / 1000));
+    Serial.println(" ms");
+    
+    if (melodyPlaying) {
+      resetMelodyState();
+    }
+    melodyPlaying = true;
+    melodyPaused = false;
+    onsetScheduledLocalUs = startLocalUs;
+    onsetReady = false;
+    onsetArmed = true;
+    startSequencerAt(melodyName, startLocalUs);
+  } else if (strcmp(cmd, "play") == 0) {
+    // Reflex routed by the hub from another satellite - play right away
+    const char* melodyName = hubMelodyName(doc);
+    Serial.print("[*] Hub reflex: ");
+    Serial.println(melodyName);
+    
+    if (melodyPlaying) {
+      resetMelodyState();
+    }
+    melodyPlaying = true;
+    melodyPaused = false;
+    onsetArmed = false;
+    int64_t startLocalUs = esp_timer_get_time() + 2000;
+    startSequencerAt(melodyName, startLocalUs);
+    
+    // Ack so the hub can measure trigger -> first note latency
+    if (!doc["route_us"].isNull()) {
+      JsonDocument ack;
+      ack["device"] = "musicbox";
+      ack["id"] = DEVICE_ID;
+      ack["event"] = "reflex_ack";
+      ack["route_us"] = doc["route_us"].as<int64_t>();
+      ack["route_id"] = doc["route_id"] | (int64_t)0;
+      if (hubClockSynced) {
+        ack["action_hub_us"] = startLocalUs + hubClockOffsetUs;
+      }
+      sendJsonToHub(ack);
+    }
+  } else if (strcmp(cmd, "set_rules") == 0) {
+    // Replace the local rule table (persisted to NVS)
+    String error;
+    JsonDocument reply;
+    reply["device"] = "musicbox";
+    reply["id"] = DEVICE_ID;
+    if (compileLocalRules(doc["rules"].as<JsonArray>(), error)) {
+      Serial.print("[OK] Local rules updated: ");
+      Serial.println(localRuleCount);
+      reply["event"] = "rules_loaded";
+      reply["count"] = localRuleCount;
+    } else {
+      Serial.print("[WARN] Rules rejected: ");
+      Serial.println(error);
+      reply["event"] = "rules_rejected";
+      reply["error"] = error;
+    }
+    sendJsonToHub(reply);
+  } else if (strcmp(cmd, "time_sync") == 0) {
+    // Late reply from an abandoned exchange - nothing to do
+  }
+}
+
+// NTP-style exchange with the hub. t0/t3 are local send/receive times and
+// t1/t2 are the hub's receive/reply times, so
+//   offset = ((t1 - t0) + (t2 - t3)) / 2, rtt = (t3 - t0) - (t2 - t1).
+// The sample with the smallest round trip has the least queuing asymmetry,
+// so only that one is kept. Blocks loop() for a few ms per sample.
+bool runTimeSyncBurst() {
+  lastTimeSync = millis();
+  int64_t bestRtt = INT64_MAX;
+  int64_t bestOffset = 0;
+  
+  for (int i = 0; i < TIME_SYNC_SAMPLES && hubLink.connected(); i++) {
+    JsonDocument req;
+    int64_t t0 = esp_timer_get_time();
+    req["device"] = "musicbox";
+    req["id"] = DEVICE_ID;
+    req["event"] = "time_sync";
+    req["t0"] = t0;
+    if (!sendJsonToHub(req)) break;
+    
+    unsigned long waitStart = millis();
+    while (millis() - waitStart < TIME_SYNC_TIMEOUT_MS && hubLink.connected()) {
+      if (!readHubLine()) {
+        yield();
+        continue;
+      }
+      int64_t t3 = esp_timer_get_time();
+      if (dropLongHubLine()) continue;
+      JsonDocument reply;
+      DeserializationError err = deserializeJson(reply, hubRxLine);
+      hubRxLine = "";
+      if (err) continue;
+      
+      const char* cmd = reply["cmd"] | "";
+      if (strcmp(cmd, "time_sync") != 0 || reply["t0"].as<int64_t>() != t0) {
+        handleHubCommand(reply);  // something else arrived mid-burst
+        continue;
+      }
+      int64_t t1 = reply["t1"].as<int64_t>();
+      int64_t t2 = reply["t2"].as<int64_t>();
+      int64_t rtt = (t3 - t0) - (t2 - t1);
+      if (rtt >= 0 && rtt < bestRtt) {
+        bestRtt = rtt;
+        bestOffset = ((t1 - t0) + (t2 - t3)) / 2;
+      }
+      break;
+    }
+  }
+  
+  if (bestRtt == INT64_MAX) {
+    Serial.println("[WARN] Time sync failed - no replies");
+    return false;
+  }
+  hubClockOffsetUs = bestOffset;
+  hubClockRttUs = bestRtt;
+  hubClockSynced = true;
+  
+  Serial.print("[OK] Clock synced: offset ");
+  Serial.print((long)(bestOffset / 1000));
+  Serial.print(" ms, rtt ");
+  Serial.print((long)bestRtt);
+  Serial.println(" us");
+  
+  JsonDocument doc;
+  doc["device"] = "musicbox";
+  doc["id"] = DEVICE_ID;
+  doc["event"] = "time_synced";
+  doc["offset_us"] = hubClockOffsetUs;
+  doc["rtt_us"] = hubClockRttUs;
+  sendJsonToHub(doc);
+  return true;
+}
+
+// Reports when the first note of a hub-scheduled melody actually sounded,
+// in hub time, so the hub can measure the spread across boxes
+void reportMelodyOnset() {
+  onsetReady = false;
+  int64_t lateUs = onsetLocalUs - onsetScheduledLocalUs;
+  
+  JsonDocument doc;
+  doc["device"] = "musicbox";
+  doc["id"] = DEVICE_ID;
+  doc["event"] = "melody_onset";
+  doc["melody"] = activeMelodyName;
+  doc["onset_hub_us"] = onsetLocalUs + hubClockOffsetUs;
+  doc["scheduled_hub_us"] = onsetScheduledLocalUs + hubClockOffsetUs;
+  doc["late_us"] = lateUs;
+  sendJsonToHub(doc);
+  
+  Serial.print("[OK] Synchronized onset, late by ");
+  Serial.print((long)lateUs);
+  Serial.println(" us");
+}
+
 void sendEventToHub(const char* event, const char* melody, int duration) {
   if (WiFi.status() != WL_CONNECTED) {
     Serial.println("[INFO] Hub offline - event logged locally only");
@@ -695,31 +1793,35 @@ void sendEventToHub(const char* event, const char* melody, int duration) {
   Serial.print("[*] Sending event to hub: ");
   Serial.println(event);
   
-  if (!client.connect(HUB_IP, HUB_PORT)) {
-    Serial.println("[INFO] Hub unreachable - event logged locally only");
+  // Encoded by the schema's generated encoder into a stack buffer
+  oraclebox::MusicboxEvent ev;
+  ev.id = DEVICE_ID;
+  ev.location = LOCATION;
+  ev.event = event;
+  ev.melody = melody;
+  ev.duration = duration;
+  ev.battery = batteryPercent;
+  ev.timestamp = (int32_t)(millis() / 1000);
+  char line[oraclebox::MUSICBOX_EVENT_MAX_BYTES];
+  size_t len = oraclebox::encodeMusicboxEvent(line, ev);
+  
+  if (sendLineToHub(line, len)) {
+    Serial.print("[OK] Event sent: ");
+    Serial.print(line);
     return;
   }
   
-  // Create JSON message
-  JsonDocument doc;
-  doc["device"] = "musicbox";
-  doc["id"] = DEVICE_ID;
-  doc["location"] = LOCATION;
-  doc["event"] = event;
-  doc["melody"] = melody;
-  doc["duration"] = duration;
-  doc["battery"] = batteryPercent;
-  doc["timestamp"] = millis() / 1000;
-  
-  // Serialize and send
-  String jsonString;
-  serializeJson(doc, jsonString);
-  client.println(jsonString);
+  // No persistent link - one-shot connection like older firmware
+  if (!client.connect(HUB_IP, HUB_PORT, HUB_CONNECT_TIMEOUT_MS)) {
+    Serial.println("[INFO] Hub unreachable - event logged locally only");
+    return;
+  }
+  client.write((const uint8_t*)line, len);
   client.flush();
   client.stop();
   
   Serial.print("[OK] Event sent: ");
-  Serial.println(jsonString);
+  Serial.print(line);
 }
 
 // ==================== BATTERY MONITORING ====================
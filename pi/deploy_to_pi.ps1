@@ -16,8 +16,12 @@ if (-not (Test-Path "oraclebox.py")) {
     exit 1
 }
 
-Write-Host "[*] Copying oraclebox.py to Pi..." -ForegroundColor Yellow
+Write-Host "[*] Copying oraclebox.py and event_bus.py to Pi..." -ForegroundColor Yellow
+$RemoteDir = $RemotePath.Substring(0, $RemotePath.LastIndexOf('/'))
 scp oraclebox.py "${PiUser}@${PiHost}:${RemotePath}"
+if ($LASTEXITCODE -eq 0) {
+    scp event_bus.py "${PiUser}@${PiHost}:${RemoteDir}/event_bus.py"
+}
 
 if ($LASTEXITCODE -eq 0) {
     Write-Host "[OK] File copied successfully" -ForegroundColor Green
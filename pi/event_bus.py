@@ -0,0 +1,219 @@
+#!/usr/bin/env python3
+"""
+OracleBox satellite event bus reader.
+
+oraclebox_hubd --bus publishes every satellite event into a ring in shared
+memory (/dev/shm/oraclebox_events; layout in
+native/include/oraclebox/event_bus.h). This module maps that ring read-only
+and decodes records straight out of the mapping - no socket, no pipe, no
+intermediate copy. Any number of readers can follow the ring; the hub never
+waits for them, and a reader that falls a full ring behind skips ahead and
+counts what it missed in `dropped`.
+
+Readers sleep on the ring's futex doorbell, which the hub rings once per
+batch of events.
+
+Run directly to tail the bus:
+    python3 event_bus.py
+"""
+
+import ctypes
+import ctypes.util
+import os
+import platform
+import struct
+import time
+from collections import namedtuple
+
+BUS_PATH = "/dev/shm/oraclebox_events"
+
+_MAGIC = b"OBBUS001"
+_VERSION = 1
+_HEADER_BYTES = 256
+_WRITE_SEQ_OFFSET = 64
+_DOORBELL_OFFSET = 128
+_STATE_LIVE = 1
+
+# Must match struct BusRecord
+_RECORD = struct.Struct("<Qq16s16s32siffi")
+_HEADER = struct.Struct("<8sIIII")
+_U64 = struct.Struct("<Q")
+_U32 = struct.Struct("<I")
+
+BusEvent = namedtuple(
+    "BusEvent", "seq time_us device location event strength temperature pressure value"
+)
+
+# futex(2) syscall numbers for the boards OracleBox runs on
+_FUTEX_SYSCALL = {"x86_64": 202, "aarch64": 98, "armv7l": 240, "armv6l": 240}
+_FUTEX_WAIT = 0
+
+_libc = ctypes.CDLL(ctypes.util.find_library("c"), use_errno=True)
+_libc.mmap.restype = ctypes.c_void_p
+_libc.mmap.argtypes = (ctypes.c_void_p, ctypes.c_size_t, ctypes.c_int, ctypes.c_int,
+                       ctypes.c_int, ctypes.c_long)
+_libc.munmap.argtypes = (ctypes.c_void_p, ctypes.c_size_t)
+_libc.syscall.restype = ctypes.c_long
+_PROT_READ = 1
+_MAP_SHARED = 1
+_MAP_FAILED = ctypes.c_void_p(-1).value
+
+
+class _Timespec(ctypes.Structure):
+    _fields_ = [("tv_sec", ctypes.c_long), ("tv_nsec", ctypes.c_long)]
+
+
+def _cstr(raw):
+    return raw.split(b"\0", 1)[0].decode("utf-8", "replace")
+
+
+class EventBusReader:
+    """Follows the hub's event ring. Not thread-safe; use one per thread."""
+
+    def __init__(self, path=BUS_PATH, from_start=False):
+        self.path = path
+        self.from_start = from_start
+        self.dropped = 0
+        self._addr = None
+        self._size = 0
+        self._buf = None
+        self._capacity = 0
+        self._mask = 0
+        self._next = 1
+        self._inode = None
+        self._futex_nr = _FUTEX_SYSCALL.get(platform.machine())
+
+    # -------------------- MAPPING --------------------
+
+    def attach(self):
+        """Maps the bus. Returns False if the hub is not publishing."""
+        self.detach()
+        try:
+            fd = os.open(self.path, os.O_RDONLY)
+        except OSError:
+            return False
+        try:
+            st = os.fstat(fd)
+            if st.st_size < _HEADER_BYTES:
+                return False
+            addr = _libc.mmap(None, st.st_size, _PROT_READ, _MAP_SHARED, fd, 0)
+        finally:
+            os.close(fd)
+        if addr in (None, _MAP_FAILED):
+            return False
+
+        buf = (ctypes.c_char * st.st_size).from_address(addr)
+        magic, version, record_size, capacity, _state = _HEADER.unpack_from(buf, 0)
+        if (magic != _MAGIC or version != _VERSION or record_size != _RECORD.size
+                or st.st_size < _HEADER_BYTES + capacity * _RECORD.size):
+            _libc.munmap(addr, st.st_size)
+            return False
+
+        self._addr, self._size, self._buf = addr, st.st_size, buf
+        self._capacity, self._mask = capacity, capacity - 1
+        self._inode = st.st_ino
+        head = self._write_seq()
+        if self.from_start:
+            self._next = head - capacity + 1 if head >= capacity else 1
+        else:
+            self._next = head + 1
+        return True
+
+    def detach(self):
+        if self._addr is not None:
+            self._buf = None
+            _libc.munmap(self._addr, self._size)
+            self._addr = None
+
+    @property
+    def attached(self):
+        return self._addr is not None
+
+    def stale(self):
+        """True once the hub closed or restarted the bus; call attach() again."""
+        if self._addr is None:
+            return True
+        if _U32.unpack_from(self._buf, 20)[0] != _STATE_LIVE:
+            return True
+        try:
+            return os.stat(self.path).st_ino != self._inode
+        except OSError:
+            return True
+
+    # -------------------- READING --------------------
+
+    def _write_seq(self):
+        # 64-bit loads can tear on 32-bit ARM, so read until two agree
+        while True:
+            a = _U64.unpack_from(self._buf, _WRITE_SEQ_OFFSET)[0]
+            b = _U64.unpack_from(self._buf, _WRITE_SEQ_OFFSET)[0]
+            if a == b:
+                return a
+
+    def read(self, max_events=None):
+        """Yields the events published since the last call, oldest first."""
+        if self._addr is None:
+            return
+        buf = self._buf
+        count = 0
+        head = self._write_seq()
+        while self._next <= head and (max_events is None or count < max_events):
+            oldest = head - self._mask if head > self._mask else 1
+            if self._next < oldest:
+                self.dropped += oldest - self._next
+                self._next = oldest
+
+            off = _HEADER_BYTES + ((self._next - 1) & self._mask) * _RECORD.size
+            before = _U64.unpack_from(buf, off)[0]
+            rec = _RECORD.unpack_from(buf, off)
+            after = _U64.unpack_from(buf, off)[0]
+            if before != self._next or after != self._next:
+                # Overwritten while we read it; resync on the next pass
+                head = self._write_seq()
+                if head - self._next < self._capacity:
+                    self._next += 1
+                    self.dropped += 1
+                continue
+
+            yield BusEvent(self._next, rec[1], _cstr(rec[2]), _cstr(rec[3]), _cstr(rec[4]),
+                           rec[5], rec[6], rec[7], rec[8])
+            self._next += 1
+            count += 1
+
+    def wait(self, timeout_s=1.0):
+        """Sleeps until the hub publishes or timeout_s passes."""
+        if self._addr is None:
+            time.sleep(timeout_s)
+            return
+        bell = _U32.unpack_from(self._buf, _DOORBELL_OFFSET)[0]
+        if self._next <= self._write_seq() or self.stale():
+            return
+        if self._futex_nr is None:
+            time.sleep(min(timeout_s, 0.01))
+            return
+        ts = _Timespec(int(timeout_s), int((timeout_s % 1.0) * 1e9))
+        _libc.syscall(ctypes.c_long(self._futex_nr), ctypes.c_void_p(self._addr + _DOORBELL_OFFSET),
+                      ctypes.c_int(_FUTEX_WAIT), ctypes.c_uint32(bell), ctypes.byref(ts),
+                      ctypes.c_void_p(None), ctypes.c_int(0))
+
+
+def main():
+    reader = EventBusReader()
+    print(f"[BUS] Waiting for {BUS_PATH} (oraclebox_hubd --bus)...")
+    while True:
+        if reader.stale():
+            if not reader.attach():
+                time.sleep(1.0)
+                continue
+            print(f"[BUS] Attached to {BUS_PATH}")
+        for ev in reader.read():
+            print(f"[BUS] {ev.seq:>8} {ev.device:<14} {ev.location:<10} {ev.event:<20} "
+                  f"strength={ev.strength} temp={ev.temperature:.1f} value={ev.value}")
+        reader.wait(1.0)
+
+
+if __name__ == "__main__":
+    try:
+        main()
+    except KeyboardInterrupt:
+        pass
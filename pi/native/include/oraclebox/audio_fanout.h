@@ -0,0 +1,181 @@
+#ifndef ORACLEBOX_AUDIO_FANOUT_H
+#define ORACLEBOX_AUDIO_FANOUT_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "oraclebox/sound_player.h"
+#include "oraclebox/spsc_ring.h"
+
+namespace oraclebox {
+
+// ==================== BLOCK POOL ====================
+
+// One block of processed audio, S16 interleaved stereo. The producer writes
+// into it once; every sink then reads the same memory.
+struct AudioBlock {
+  int16_t* samples = nullptr;    // pool-owned, maxFrames() frames
+  size_t frames = 0;
+  int64_t timeUs = 0;            // hub time it was published
+  std::atomic<int> refs{0};      // 0 = free
+};
+
+// A fixed set of blocks, allocated once. acquire() hands out a free one
+// holding a single reference. Every holder releases its own reference, and
+// the block is free again when the count reaches zero. Only the producer
+// acquires, and only a block at zero references can be taken, so neither
+// side ever locks.
+class BlockPool {
+public:
+  BlockPool(size_t blocks, size_t maxFrames);
+  BlockPool(const BlockPool&) = delete;
+  BlockPool& operator=(const BlockPool&) = delete;
+
+  // Producer only; nullptr if every block is held (a sink is behind by the
+  // whole pool).
+  AudioBlock* acquire();
+  static void retain(AudioBlock* b) { b->refs.fetch_add(1, std::memory_order_relaxed); }
+  static void release(AudioBlock* b) { b->refs.fetch_sub(1, std::memory_order_acq_rel); }
+
+  size_t blocks() const { return count_; }
+  size_t maxFrames() const { return maxFrames_; }
+  size_t inUse() const;
+
+private:
+  size_t count_, maxFrames_;
+  std::vector<int16_t> storage_;
+  std::unique_ptr<AudioBlock[]> blocks_;
+  size_t next_ = 0;              // where acquire() starts looking
+};
+
+// ==================== SINKS ====================
+
+// Where a fan-out sink's blocks go. write() is called on the sink's own
+// thread and may block for as long as it likes. Only that sink falls behind.
+class AudioSink {
+public:
+  virtual ~AudioSink() = default;
+  // False when the sink is gone for good (device lost, reader exited).
+  virtual bool write(const int16_t* samples, size_t frames) = 0;
+};
+
+// Raw S16 to a file descriptor (stdout: the pipeline's aplay or the mixer).
+class FdSink : public AudioSink {
+public:
+  explicit FdSink(int fd) : fd_(fd) {}
+  bool write(const int16_t* samples, size_t frames) override;
+
+protected:
+  int fd_;
+};
+
+// Raw S16 into a shell command's stdin, e.g. aplay on a Bluetooth or Pulse
+// device. The command runs until the sink is destroyed.
+class PipeSink : public FdSink {
+public:
+  explicit PipeSink(const std::string& command);
+  ~PipeSink() override;
+  bool isOpen() const { return pipe_ != nullptr; }
+
+private:
+  FILE* pipe_;
+};
+
+// An ALSA device through PcmOutput ("null" or a build without ALSA: the
+// clock-paced stand-in).
+class PcmSink : public AudioSink {
+public:
+  bool open(const std::string& device, int rate);
+  bool write(const int16_t* samples, size_t frames) override;
+
+private:
+  PcmOutput out_;
+};
+
+// A WAV file. The header's sizes are brought up to date about once a second,
+// so a recording cut off by a crash or power loss still opens.
+class WavRecorder : public AudioSink {
+public:
+  ~WavRecorder() override;
+  bool open(const std::string& path, int rate);
+  bool write(const int16_t* samples, size_t frames) override;
+  void close();
+
+private:
+  void updateHeader();
+
+  FILE* f_ = nullptr;
+  int rate_ = 0;
+  uint64_t dataBytes_ = 0, sinceHeader_ = 0;
+};
+
+// ==================== FAN-OUT ====================
+
+// Publishes each block from a BlockPool to every sink without copying it.
+// Each sink has a bounded queue of block references and a thread that
+// writes them at the sink's own pace. publish() never blocks. A sink with
+// a full queue misses that block, and the miss is counted against it. A
+// stalled recorder never holds up the speaker.
+//
+// A sink whose write() fails keeps draining its queue, and the blocks count
+// as dropped, so it never pins pool blocks.
+class AudioFanout {
+public:
+  static constexpr size_t QUEUE_BLOCKS = 32;   // 320 ms of 10 ms blocks
+
+  struct SinkStats {
+    std::string name;
+    uint64_t written = 0;
+    uint64_t dropped = 0;        // queue full, or the sink had failed
+    size_t queued = 0;
+    bool failed = false;
+  };
+
+  AudioFanout() = default;
+  ~AudioFanout();
+  AudioFanout(const AudioFanout&) = delete;
+  AudioFanout& operator=(const AudioFanout&) = delete;
+
+  // Before start(). Returns the sink's index in stats().
+  size_t add(std::string name, std::unique_ptr<AudioSink> sink);
+  // Enough blocks for every queue to fill, plus the one being produced.
+  size_t poolBlocksNeeded() const { return sinks_.size() * (QUEUE_BLOCKS + 1) + 2; }
+
+  void start();
+  // Lets each sink finish what is queued, then joins the threads.
+  void stop();
+
+  // Producer: queues b on every sink with room, then drops the caller's
+  // reference.
+  void publish(AudioBlock* b);
+
+  bool failed(size_t index) const { return sinks_[index]->failed.load(std::memory_order_relaxed); }
+  std::vector<SinkStats> stats() const;
+
+private:
+  struct Sink {
+    std::string name;
+    std::unique_ptr<AudioSink> out;
+    SpscRing<AudioBlock*, QUEUE_BLOCKS> queue;
+    int wakeFd = -1;             // eventfd, rung on each push
+    std::thread thread;
+    std::atomic<uint64_t> written{0}, dropped{0};
+    std::atomic<bool> failed{false};
+  };
+
+  void run(Sink& s);
+
+  std::vector<std::unique_ptr<Sink>> sinks_;
+  std::atomic<bool> quit_{false};
+  bool started_ = false;
+};
+
+}  // namespace oraclebox
+
+#endif
@@ -0,0 +1,138 @@
+#ifndef ORACLEBOX_CORRELATOR_H
+#define ORACLEBOX_CORRELATOR_H
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "oraclebox/json_line.h"
+#include "oraclebox/reflex_router.h"
+#include "oraclebox/satellite_link.h"
+
+namespace oraclebox {
+
+// Which events qualify for one step of a pattern. Same fields as a reflex
+// rule's trigger: source is a device id, a device type or "*".
+struct PatternStep {
+  std::string source = "*";
+  std::string event;
+  std::string field;
+  ReflexRule::Op op = ReflexRule::Op::Any;
+  double value = 0.0;
+};
+
+// "first" followed by "then" within within_ms, e.g. motion at a music box
+// then an EM spike at a REM pod within 3 s:
+//
+//   {"name":"motion_then_em","within_ms":3000,
+//    "first":{"source":"musicbox","event":"motion_detected"},
+//    "then":{"source":"rempod","event":"em_trigger","field":"strength","op":">=","value":3}}
+//
+// "distinct" says what the two events must differ in: "device" (default),
+// "location" (e.g. temperature drops in two rooms) or "none".
+struct CorrelationPattern {
+  enum class Distinct : uint8_t { None, Device, Location };
+
+  std::string name;
+  PatternStep first;
+  PatternStep then;
+  int withinMs = 0;
+  Distinct distinct = Distinct::Device;
+  int cooldownMs = 0;
+};
+
+struct Incident {
+  uint32_t pattern;         // see Correlator::pattern()
+  int firstDevice;          // see Correlator::deviceId() / location()
+  int thenDevice;
+  int64_t firstUs;          // hub receive times
+  int64_t thenUs;
+  double firstValue;        // step field, or strength when the step has none
+  double thenValue;
+};
+
+// Streaming correlator over the live satellite events.
+//
+// Each pattern keeps a fixed ring of recent events that matched its first
+// step. An event matching a then step evicts expired candidates from the
+// front of that ring and pairs with the newest one still in the window, so
+// the work per event is amortized O(1) for each pattern that listens for
+// its event type, and memory is WINDOW_CAPACITY candidates per pattern no
+// matter the event rate. A candidate pairs at most once.
+//
+// Receive times need not arrive in order: link shards hand events over
+// slightly out of order. Candidates expire against the newest time seen so
+// far, and a then event only pairs with a candidate from its own window
+// that is not later than itself.
+class Correlator {
+public:
+  static constexpr int WINDOW_CAPACITY = 64;
+
+  using IncidentHandler = std::function<void(const Incident& incident)>;
+
+  // Patterns file: one pattern per line, blank lines and '#' comments ignored.
+  bool loadFile(const std::string& path);
+  bool addPattern(const JsonLine& def, std::string* error);
+  size_t patternCount() const { return patterns_.size(); }
+  const CorrelationPattern& pattern(uint32_t index) const { return patterns_[index]; }
+
+  void onIncident(IncidentHandler handler) { incidentHandler_ = std::move(handler); }
+
+  // Feeds one event. Returns the number of incidents raised.
+  int process(const SatelliteConn& from, const JsonLine& msg, int64_t rxUs);
+
+  const std::string& deviceId(int device) const { return devices_[device].id; }
+  const std::string& location(int device) const { return devices_[device].location; }
+
+  int64_t evaluated() const { return evaluated_; }
+  int64_t incidents() const { return incidents_; }
+  int64_t suppressed() const { return suppressed_; }
+
+private:
+  struct Candidate {
+    int64_t timeUs;
+    double value;
+    uint16_t device;
+    bool used;
+  };
+  // Ring of first-step candidates, oldest at head
+  struct Window {
+    std::array<Candidate, WINDOW_CAPACITY> ring;
+    uint32_t head = 0;
+    uint32_t size = 0;
+    int64_t lastIncidentUs = 0;
+  };
+  struct StepRef {
+    uint32_t pattern;
+    bool isThen;
+  };
+  struct Device {
+    std::string id;
+    std::string location;
+  };
+
+  static uint64_t hash(std::string_view event);
+  static bool parseStep(std::string_view raw, PatternStep& step, std::string* error);
+  static bool stepMatches(const PatternStep& step, const SatelliteConn& from, const JsonLine& msg);
+  int internDevice(const SatelliteConn& from);
+  bool pair(uint32_t p, int device, double value, int64_t rxUs);
+
+  std::vector<CorrelationPattern> patterns_;
+  std::vector<Window> windows_;                            // one per pattern
+  std::unordered_map<uint64_t, std::vector<StepRef>> byEvent_;
+  std::vector<Device> devices_;
+  std::unordered_map<std::string, int> deviceByName_;
+  IncidentHandler incidentHandler_;
+  int64_t evaluated_ = 0;
+  int64_t incidents_ = 0;
+  int64_t suppressed_ = 0;
+  int64_t latestUs_ = 0;                                   // newest rxUs processed
+};
+
+}  // namespace oraclebox
+
+#endif
@@ -0,0 +1,151 @@
+#ifndef ORACLEBOX_EVENT_BUS_H
+#define ORACLEBOX_EVENT_BUS_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace oraclebox {
+
+// One satellite event on the bus. Fixed width; pi/event_bus.py mirrors this
+// layout ("<Qq16s16s32siffi"), so change both together.
+struct BusRecord {
+  uint64_t seq;             // publication number, 1-based (set by publish())
+  int64_t timeUs;           // hub wall clock
+  char device[16];          // NUL-padded device id
+  char location[16];
+  char event[32];           // event name, "incident:<pattern>" for incidents
+  int32_t strength;
+  float temperature;
+  float pressure;
+  int32_t value;            // event-specific extra (duration, battery, gap ms)
+};
+static_assert(sizeof(BusRecord) == 96, "BusRecord is shared with Python readers");
+
+// Copies s into a fixed field, truncating and NUL-padding.
+template <size_t N>
+void setBusField(char (&field)[N], std::string_view s) {
+  size_t n = s.size() < N - 1 ? s.size() : N - 1;
+  for (size_t i = 0; i < n; i++) field[i] = s[i];
+  for (size_t i = n; i < N; i++) field[i] = '\0';
+}
+
+// Shared-memory layout, also mirrored by pi/event_bus.py:
+//   0    magic "OBBUS001"
+//   8    u32 version, u32 record size, u32 capacity (power of two), u32 state
+//   64   u64 write sequence (last published record)
+//   128  u32 doorbell (futex word)
+//   256  capacity records
+struct BusHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t recordSize;
+  uint32_t capacity;
+  uint32_t state;           // 1 = live, 2 = closed by the producer
+  alignas(64) uint64_t writeSeq;
+  alignas(64) uint32_t doorbell;
+};
+
+// Single-producer, multi-consumer event ring in POSIX shared memory
+// (/dev/shm/<name>), from oraclebox_hubd to local consumers such as
+// oraclebox.py, a recorder or an offline correlator.
+//
+// The producer never waits for readers: it overwrites the oldest record, and
+// each reader keeps its own position, so any number of readers can follow
+// at full rate without slowing ingestion. A reader that falls a whole ring
+// behind skips ahead and counts the records it lost. Each slot carries its
+// sequence number, written last on publish and checked before and after a
+// read, so a reader can tell a torn record from a complete one.
+//
+// Readers sleep on a futex in the shared header. notify() rings it once per
+// batch of publishes (call it after each SatelliteLink::poll()), so a burst of
+// events costs one wakeup, not one per event.
+//
+// The producer is one process, but it may publish from several threads
+// without a lock: claim() hands out sequence numbers atomically, the slots
+// are filled in parallel, and commit() advances the write sequence in claim
+// order, so readers see exactly what a single producer would give them.
+class EventBus {
+public:
+  static constexpr uint32_t DEFAULT_CAPACITY = 4096;     // 384 KB
+  static constexpr const char* DEFAULT_NAME = "/oraclebox_events";
+
+  explicit EventBus(std::string name = DEFAULT_NAME);
+  ~EventBus();
+  EventBus(const EventBus&) = delete;
+  EventBus& operator=(const EventBus&) = delete;
+
+  // Replaces any previous segment of that name; readers of the old one see
+  // it closed (or stale, after a crash) and re-attach.
+  bool create(uint32_t capacity = DEFAULT_CAPACITY);
+  void close();
+  bool isOpen() const { return header_ != nullptr; }
+
+  // claim(1) + write() + commit().
+  void publish(BusRecord rec);
+  // Reserves n consecutive sequence numbers and returns the first.
+  uint64_t claim(uint32_t n);
+  // Fills the slot of a claimed sequence number.
+  void write(uint64_t seq, BusRecord rec);
+  // Publishes a claim once every earlier claim is published.
+  void commit(uint64_t first, uint32_t n);
+  // Wakes sleeping readers if anything was published since the last call.
+  void notify();
+
+  uint64_t published() const { return __atomic_load_n(&seq_, __ATOMIC_RELAXED); }
+
+private:
+  std::string name_;
+  BusHeader* header_ = nullptr;
+  BusRecord* ring_ = nullptr;
+  size_t mapBytes_ = 0;
+  uint32_t mask_ = 0;
+  uint64_t seq_ = 0;            // last claimed; header_->writeSeq is the last committed
+  uint64_t notifiedSeq_ = 0;
+};
+
+// Reader side, for native consumers (pi/event_bus.py is the Python one).
+class EventBusReader {
+public:
+  enum class Status { Ok, Empty, Overrun };
+
+  EventBusReader() = default;
+  ~EventBusReader();
+  EventBusReader(const EventBusReader&) = delete;
+  EventBusReader& operator=(const EventBusReader&) = delete;
+
+  // Maps the bus and starts at the newest record (fromStart = oldest kept).
+  bool attach(const std::string& name = EventBus::DEFAULT_NAME, bool fromStart = false);
+  void detach();
+
+  // Copies the next record into out. Overrun means the producer lapped this
+  // reader; it has skipped to the oldest record still in the ring.
+  Status next(BusRecord& out);
+
+  // Sleeps until the producer rings the doorbell or timeoutMs passes.
+  void wait(int timeoutMs);
+
+  // True once the producer closed or replaced the segment.
+  bool stale() const;
+
+  uint64_t dropped() const { return dropped_; }
+
+  // The mapped ring itself, for zero-copy views (the Python bindings). Slot
+  // seq & (capacity - 1) holds record seq until the producer laps it.
+  const BusRecord* ring() const { return ring_; }
+  uint32_t capacity() const { return mask_ + 1; }
+
+private:
+  std::string name_;
+  const BusHeader* header_ = nullptr;
+  const BusRecord* ring_ = nullptr;
+  size_t mapBytes_ = 0;
+  uint32_t mask_ = 0;
+  uint64_t next_ = 1;
+  uint64_t dropped_ = 0;
+  uint64_t inode_ = 0;
+};
+
+}  // namespace oraclebox
+
+#endif
@@ -0,0 +1,209 @@
+#ifndef ORACLEBOX_EVENT_STORE_H
+#define ORACLEBOX_EVENT_STORE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace oraclebox {
+
+// One satellite event as stored on disk. Fixed width so a segment is a plain
+// array and any record can be reached by index.
+struct EventRecord {
+  int64_t timeUs;         // wall clock, microseconds since the epoch
+  uint16_t device;        // index into EventStore::devices()
+  uint8_t type;           // index into EventStore::types()
+  uint8_t battery;        // percent
+  int32_t strength;       // rempod strength / deviation x10, 0 if absent
+  float temperature;      // F, NaN if the event had none
+  float pressure;         // hPa, NaN if the event had none
+  int32_t value;          // event-specific extra (musicbox duration, ...)
+  uint32_t commit;        // RECORD_COMMIT once the record is complete
+};
+static_assert(sizeof(EventRecord) == 32, "EventRecord is an on-disk format");
+
+struct DeviceInfo {
+  std::string id;         // "rempod_01"
+  std::string kind;       // "rempod", "musicbox"
+  std::string location;   // "hallway"
+};
+
+struct EventQuery {
+  int64_t fromUs = INT64_MIN;   // inclusive
+  int64_t toUs = INT64_MAX;     // exclusive
+  int device = -1;              // -1 = any
+  int type = -1;                // -1 = any
+};
+
+// Append-only event store for the hub.
+//
+// Events are written to segment files of fixed capacity. Each segment is
+// preallocated and mmap'd, and appends are plain memory stores. Dirty pages
+// go out in one msync per flush interval instead of a write per event,
+// which keeps the SD card doing few, larger writes. Each segment header
+// carries a sparse time index (the time of every INDEX_STRIDE'th record)
+// and a bitmap of devices present. A range scan skips whole segments by
+// time and device, then binary-searches the sparse index and reads at most
+// one stride of records before it reaches the window.
+//
+// Records are kept in time order: a record older than the last one (wall
+// clock stepped back) is stored with the last time.
+//
+// Device ids and event names are interned in catalog.jsonl, next to the
+// segments. Calls are made by one thread at a time (the caller's lock), and
+// scans run between appends. Writers on several threads can keep that lock
+// short with reserve() and fill(): only claiming slots is serialized, and the
+// records are copied in outside the lock.
+class EventStore {
+public:
+  static constexpr uint32_t RECORD_COMMIT = 0x4F425631;   // "OBV1"
+  static constexpr uint32_t SEGMENT_CAPACITY = 65536;     // 2 MB of records
+  static constexpr uint32_t INDEX_STRIDE = 256;
+  static constexpr int MAX_DEVICES = 256;                 // per-segment device bitmap
+  static constexpr int64_t DEFAULT_FLUSH_US = 2000000;
+
+  explicit EventStore(std::string dir);
+  ~EventStore();
+  EventStore(const EventStore&) = delete;
+  EventStore& operator=(const EventStore&) = delete;
+
+  // Creates the directory if needed, loads the catalog and maps existing
+  // segments. The newest segment is recovered up to its last complete record.
+  bool open(bool readOnly = false);
+  void close();
+
+  // Interns a device / event name, persisting new entries to the catalog.
+  int deviceIndex(std::string_view id, std::string_view kind, std::string_view location);
+  int typeIndex(std::string_view name);
+  int findDevice(std::string_view id) const;
+  int findType(std::string_view name) const;
+  const std::vector<DeviceInfo>& devices() const { return devices_; }
+  const std::vector<std::string>& types() const { return types_; }
+
+  bool append(EventRecord rec);
+
+  // Slots claimed by reserve() in the active segment.
+  struct Segment;
+  struct Reservation {
+    Segment* segment = nullptr;
+    uint32_t first = 0;     // slot of the first record
+    uint32_t count = 0;     // records taken, possibly fewer than asked for
+    int64_t floorUs = 0;    // records are stamped no earlier than this
+  };
+  // Claims slots for up to n of recs, sealing a full segment first; call
+  // again for the rest when it takes fewer. Needs the caller's lock, like
+  // every other call.
+  Reservation reserve(const EventRecord* recs, uint32_t n);
+  // Copies the reserved records in without the lock. They become visible
+  // once every earlier reservation's are, so the count only ever covers
+  // complete records.
+  void fill(const Reservation& r, const EventRecord* recs);
+
+  // Pushes dirty pages to the card: MS_ASYNC when the interval has passed,
+  // MS_SYNC (plus header) when sync is requested or a segment is sealed.
+  void maybeFlush(int64_t nowUs);
+  void flush(bool sync);
+  void setFlushInterval(int64_t us) { flushIntervalUs_ = us; }
+
+  // Calls fn(const EventRecord&) for every record matching q, in time order.
+  // Returns the number of records visited.
+  template <typename Fn>
+  size_t scan(const EventQuery& q, Fn&& fn) const;
+
+  // Re-maps segments another process appended since open() (read-only use).
+  bool refresh();
+
+  size_t segmentCount() const { return segments_.size(); }
+  // Raw access for indexes built on top of the store. Pointers stay valid
+  // until close(); the newest segment's count grows as events are appended.
+  const EventRecord* segmentRecords(size_t segment) const { return segments_[segment]->records(); }
+  uint32_t segmentRecordCount(size_t segment) const { return segments_[segment]->count(); }
+  uint64_t recordCount() const;
+  int64_t firstTimeUs() const;
+  int64_t lastTimeUs() const;
+
+  struct SegmentHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t recordSize;
+    uint32_t capacity;
+    uint32_t indexStride;
+    int64_t firstTimeUs;
+    int64_t lastTimeUs;
+    uint32_t count;             // complete records (recovery re-checks commit words past it)
+    uint32_t reserved;
+    uint64_t deviceMask[MAX_DEVICES / 64];
+    int64_t index[SEGMENT_CAPACITY / INDEX_STRIDE];   // time of record k * INDEX_STRIDE
+  };
+
+  struct Segment {
+    std::string path;
+    uint32_t number = 0;
+    int fd = -1;
+    uint8_t* map = nullptr;
+    size_t mapBytes = 0;
+    bool writable = false;
+    SegmentHeader* header() const { return (SegmentHeader*)map; }
+    EventRecord* records() const { return (EventRecord*)(map + HEADER_BYTES); }
+    uint32_t count() const { return __atomic_load_n(&header()->count, __ATOMIC_ACQUIRE); }
+  };
+
+private:
+  static constexpr size_t HEADER_BYTES = 4096;
+
+  bool loadCatalog();
+  bool appendCatalog(const std::string& line);
+  bool mapSegment(const std::string& path, uint32_t number, bool writable, Segment& seg);
+  bool createSegment(uint32_t number);
+  void recoverTail(Segment& seg);
+  void unmapSegment(Segment& seg);
+  static uint32_t lowerBound(const Segment& seg, int64_t timeUs);
+
+  std::string dir_;
+  bool readOnly_ = false;
+  int catalogFd_ = -1;
+  std::vector<DeviceInfo> devices_;
+  std::vector<std::string> types_;
+  std::unordered_map<std::string, int> deviceByName_;
+  std::unordered_map<std::string, int> typeByName_;
+  std::vector<std::unique_ptr<Segment>> segments_;
+  int64_t lastAppendUs_ = INT64_MIN;
+  uint32_t reserved_ = 0;       // slots of the active segment claimed so far
+  int64_t flushIntervalUs_ = DEFAULT_FLUSH_US;
+  int64_t lastFlushUs_ = 0;
+  size_t dirtyFrom_ = 0;        // first record of the active segment not yet msync'd
+  bool dirty_ = false;
+};
+
+template <typename Fn>
+size_t EventStore::scan(const EventQuery& q, Fn&& fn) const {
+  size_t visited = 0;
+  for (const auto& segPtr : segments_) {
+    const Segment& seg = *segPtr;
+    const SegmentHeader* h = seg.header();
+    uint32_t n = seg.count();
+    if (n == 0 || h->firstTimeUs >= q.toUs || h->lastTimeUs < q.fromUs) continue;
+    if (q.device >= 0 && q.device < MAX_DEVICES &&
+        !(h->deviceMask[q.device / 64] & (1ULL << (q.device % 64)))) {
+      continue;
+    }
+    const EventRecord* recs = seg.records();
+    for (uint32_t i = lowerBound(seg, q.fromUs); i < n; i++) {
+      const EventRecord& r = recs[i];
+      if (r.timeUs >= q.toUs) break;
+      visited++;
+      if (q.device >= 0 && r.device != q.device) continue;
+      if (q.type >= 0 && r.type != q.type) continue;
+      fn(r);
+    }
+  }
+  return visited;
+}
+
+}  // namespace oraclebox
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef ORACLEBOX_FFT_H
+#define ORACLEBOX_FFT_H
+
+#include <cstddef>
+#include <vector>
+
+namespace oraclebox {
+
+// In-place radix-2 complex FFT on split real/imaginary arrays.
+//
+// The data and twiddles are kept as separate float arrays, and each stage's
+// twiddles are stored contiguously. The innermost butterfly loop therefore
+// walks plain float arrays with unit stride, which the compiler vectorizes
+// (NEON on the Pi, SSE on a dev box). n must be a power of two.
+class Fft {
+public:
+  Fft() = default;
+  explicit Fft(size_t n) { setup(n); }
+
+  void setup(size_t n);
+  size_t size() const { return n_; }
+
+  void forward(float* re, float* im) const;
+  // Scaled by 1/n, so inverse(forward(x)) == x
+  void inverse(float* re, float* im) const;
+
+private:
+  void permute(float* re, float* im) const;
+
+  size_t n_ = 0;
+  std::vector<size_t> swaps_;      // bit-reversal pairs, flattened
+  std::vector<float> twRe_, twIm_; // per stage: half twiddles, stage after stage
+};
+
+}  // namespace oraclebox
+
+#endif
@@ -0,0 +1,133 @@
+#ifndef ORACLEBOX_FM_SWEEP_H
+#define ORACLEBOX_FM_SWEEP_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace oraclebox {
+
+// TEA5767 FM tuner on /dev/i2c-<bus>, programmed with the same control bytes
+// as oraclebox.py's tea5767_write(): high-side injection, 32.768 kHz
+// crystal, soft mute / high cut / stereo noise cancelling on.
+class Tea5767 {
+public:
+  static constexpr uint8_t DEFAULT_ADDRESS = 0x60;
+
+  Tea5767() = default;
+  ~Tea5767();
+  Tea5767(const Tea5767&) = delete;
+  Tea5767& operator=(const Tea5767&) = delete;
+
+  bool open(int bus, uint8_t address = DEFAULT_ADDRESS);
+  void close();
+  bool isOpen() const { return fd_ >= 0; }
+
+  // 76.0 - 108.0 MHz. One 5-byte I2C write.
+  bool tune(double mhz, bool mono = false);
+  bool readStatus(uint8_t status[5]);
+
+private:
+  int fd_ = -1;
+};
+
+// The spirit box sweep: steps the tuner across the band on its own thread.
+//
+// Steps are scheduled on absolute CLOCK_MONOTONIC deadlines, so the step
+// period stays at delayMs no matter how long the I2C write or anything else
+// took, and Python thread scheduling never stretches it. Consumers that
+// react to steps (the sweep LED) call waitStep(), which blocks without
+// holding anything the sweep needs.
+//
+// Each step's frequency is fixed one period ahead, when its deadline is
+// set, and announced then as "RETUNE <mhz> <hub us>" on the retune pipe
+// (oraclebox_fx's control FIFO). The audio engine shares CLOCK_MONOTONIC,
+// so it knows the input frame each retune lands on before that audio
+// arrives. Direction and band changes therefore apply from the step after
+// the announced one.
+//
+// Without an open tuner (no I2C bus) the engine still runs and reports
+// steps, which is how it is exercised off the Pi.
+class SweepEngine {
+public:
+  struct Step {
+    uint64_t seq = 0;         // 1-based, 0 = no step yet
+    double mhz = 0.0;
+    int64_t timeUs = 0;       // hub time the tuner was written
+  };
+
+  struct Stats {
+    uint64_t steps = 0;
+    uint64_t i2cErrors = 0;
+    uint64_t late = 0;        // steps written more than 1 ms after their deadline
+    double maxLateMs = 0.0;
+    double meanLateMs = 0.0;
+  };
+
+  SweepEngine() = default;
+  ~SweepEngine();
+  SweepEngine(const SweepEngine&) = delete;
+  SweepEngine& operator=(const SweepEngine&) = delete;
+
+  // Opens the tuner; returns false (and runs without one) if it is absent.
+  bool openTuner(int bus, uint8_t address = Tea5767::DEFAULT_ADDRESS);
+
+  void start();
+  void stop();
+
+  // Safe from any thread; take effect on the next step.
+  void setRunning(bool running);
+  void setDelayMs(int ms);
+  void setDirection(int direction);   // 1 = up, -1 = down
+  void setMono(bool mono) { mono_.store(mono); }
+  // Band in tenths of MHz (default 88.0 - 108.0 in 0.2 MHz steps).
+  void setBand(int lowTenths, int highTenths, int stepTenths);
+  // FIFO that steps (and manual tunes) are announced on; empty for none.
+  // Nothing is written while no one has it open for reading.
+  void setRetunePipe(const std::string& path);
+
+  bool running() const { return running_.load(); }
+  int delayMs() const { return delayMs_.load(); }
+  int direction() const { return direction_.load(); }
+
+  // Tunes immediately, outside the sweep (manual tuning).
+  bool tune(double mhz);
+
+  // Waits until a step newer than afterSeq happens or timeoutMs passes.
+  // Returns the latest step (seq == afterSeq on timeout).
+  Step waitStep(uint64_t afterSeq, int timeoutMs);
+  Step lastStep();
+
+  Stats stats();
+
+private:
+  void run();
+  void announce(double mhz, int64_t atUs);
+
+  Tea5767 tuner_;
+  std::mutex tunerMutex_;
+  std::thread thread_;
+  std::atomic<bool> quit_{false};
+  std::atomic<bool> running_{false};
+  std::atomic<int> delayMs_{100};
+  std::atomic<int> direction_{1};
+  std::atomic<bool> mono_{false};
+  std::atomic<int> lowTenths_{880};
+  std::atomic<int> highTenths_{1080};
+  std::atomic<int> stepTenths_{2};
+  std::mutex pipeMutex_;
+  std::string retunePipe_;
+
+  std::mutex stepMutex_;
+  std::condition_variable stepCv_;
+  Step last_;
+  Stats stats_;
+  double lateSumMs_ = 0.0;
+};
+
+}  // namespace oraclebox
+
+#endif
@@ -0,0 +1,420 @@
+#ifndef ORACLEBOX_FX_ENGINE_H
+#define ORACLEBOX_FX_ENGINE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "oraclebox/fft.h"
+#include "oraclebox/resampler.h"
+
+namespace oraclebox {
+
+// FxConfig, as oraclebox.py keeps it (same names, units and ranges).
+struct FxParams {
+  int bpLow = 500;             // Hz, 100-2000
+  int bpHigh = 2600;           // Hz, 300-5000
+  int reverbRoom = 30;         // 0-100
+  int reverbDamping = 45;
+  int reverbWet = 85;
+  int reverbDry = 65;
+  int contrastAmount = 18;     // 0-40
+  int preGainDb = -6;          // -24-0
+  int postGainDb = 8;          // 0-18
+  int noiseReduce = 0;         // 0-100, 0 = off
+  int agcTargetDb = -18;       // -30 to -6, RMS level the AGC holds
+  int lookaheadMs = 5;         // 1-20, limiter look-ahead
+  int retuneMuteMs = 8;        // 0-30, input muted after each retune, 0 = off
+};
+
+// ==================== STAGES ====================
+
+// RBJ two-pole filter, Q 0.707 (what sox's highpass/lowpass default to).
+class Biquad {
+public:
+  void highpass(double hz, double rate) { design(hz, rate, true); }
+  void lowpass(double hz, double rate) { design(hz, rate, false); }
+  void reset() { z1_ = z2_ = 0.0f; }
+  void process(float* x, size_t n);
+
+private:
+  void design(double hz, double rate, bool high);
+  float b0_ = 1, b1_ = 0, b2_ = 0, a1_ = 0, a2_ = 0;
+  float z1_ = 0, z2_ = 0;
+};
+
+// Linear-phase FIR with symmetric taps, run direct-form: sox's `sinc`
+// band-pass. The cost is taps per sample, and the taps for a given
+// transition width grow with the rate, so it scales with rate squared.
+class FirFilter {
+public:
+  static std::vector<float> designBandpass(double lowHz, double highHz, double rate);
+
+  void bandpass(double lowHz, double highHz, double rate) { setTaps(designBandpass(lowHz, highHz, rate)); }
+  void setTaps(std::vector<float> taps);
+  // New taps of the same length, without allocating: the output blends
+  // from the old taps' to the new over fadeLen samples.
+  void switchTaps(const std::vector<float>& taps, size_t fadeLen);
+  void reset();
+  void process(float* x, size_t n);
+  size_t taps() const { return taps_.size(); }
+
+private:
+  std::vector<float> taps_, fromTaps_;
+  size_t fadeLeft_ = 0, fadeLen_ = 0;
+  std::vector<float> history_;   // mirrored, as in PolyphaseResampler
+  size_t head_ = 0;
+};
+
+// Spectral noise suppression for the static between stations.
+//
+// Overlap-add over frames of up to 16 ms (256 samples at 16 kHz) with a
+// sqrt-Hann window at 50% overlap, so it delays the signal by one frame.
+// The noise spectrum is learned from frames that look like static: over
+// 300-3400 Hz their spectrum is flat (geometric over arithmetic mean, about
+// 0.56 for white noise, well under that for voices and music). It also
+// follows any bin that drops below it, so it never sits above a quiet
+// floor for long. Gains are Wiener with a decision-directed SNR estimate,
+// which keeps the leftover static from turning into "musical" tones, and
+// never go below the floor `amount` sets (0 to -24 dB).
+class NoiseSuppressor {
+public:
+  void setup(int amount, double rate);
+  void reset();
+  void process(float* x, size_t n);
+  bool enabled() const { return floor_ < 1.0f; }
+  size_t latency() const { return frame_.size(); }
+
+private:
+  void processFrame();
+
+  Fft fft_;
+  size_t hop_ = 0, fill_ = 0;
+  size_t bandLow_ = 0, bandHigh_ = 0;     // bins for the flatness check
+  float floor_ = 1.0f;
+  std::vector<float> window_;
+  std::vector<float> frame_, ola_, out_;  // input frame, overlap-add, output hop
+  std::vector<float> re_, im_;
+  std::vector<float> noise_, lastClean_;  // per bin: noise power, last |S|^2
+  bool learned_ = false;
+};
+
+// Program-dependent AGC, in place of sox's fixed `compand`.
+//
+// Holds the RMS level (over about 300 ms) at a target. Gain comes down at
+// up to 30 dB/s and goes up at 8 dB/s. It goes up more slowly still
+// (2 dB/s) when the level has been steady, so a held station is not pumped.
+// Below -50 dBFS the gain is held instead of raised, so silence and quiet
+// gaps are not lifted into hiss. Range -12 to +16 dB, the compand curve's
+// most lift.
+//
+// The target may be changed from any thread while process() runs.
+class Agc {
+public:
+  void setup(double rate);
+  void reset();
+  void setTargetDb(float db) { targetDb_.store(db, std::memory_order_relaxed); }
+  void process(float* x, size_t n);
+  float gainDb() const { return gainDb_; }
+
+private:
+  static constexpr size_t STEP = 16;   // samples per gain update
+
+  std::atomic<float> targetDb_{-18.0f};
+  float powerCoef_ = 0, slowCoef_ = 0;
+  float power_ = 0, slowDb_ = -100.0f;
+  float gainDb_ = 0, gain_ = 1;
+  float upDb_ = 0, steadyUpDb_ = 0, downDb_ = 0;   // per STEP
+};
+
+// Look-ahead peak limiter, the chain's last stage. The signal is delayed
+// by the look-ahead, and a sliding maximum of |x| over that window is kept
+// with a monotonic deque (amortized O(1) per sample). The gain therefore
+// starts coming down before a peak arrives. It reaches the needed
+// reduction within the window and recovers over 100 ms. A hard clip at
+// the ceiling catches what the smoothing leaves over.
+class LookaheadLimiter {
+public:
+  static constexpr float CEILING = 0.891f;   // -1 dBFS
+
+  void setup(int lookaheadMs, double rate);
+  void reset();
+  void process(float* x, size_t n);
+  size_t latency() const { return delay_.size(); }
+
+private:
+  struct Peak {
+    size_t index;
+    float value;
+  };
+
+  std::vector<float> delay_;
+  size_t pos_ = 0, count_ = 0;       // count_: samples seen
+  std::vector<Peak> deque_;          // power-of-two ring
+  size_t front_ = 0, back_ = 0;      // back_ - front_ entries
+  float attack_ = 0, release_ = 0;
+  float gain_ = 1.0f;
+};
+
+// Feedback delay network reverb in fixed point: eight delay lines of Q15
+// samples, mixed through an 8x8 Hadamard matrix, with a one-pole damping
+// filter in each line's loop. It replaces sox's `reverb` (a stereo
+// Freeverb: twelve filters per channel, in float).
+//
+// room sets the decay time (0.25-2.5 s to -60 dB), damping the
+// high-frequency loss per pass, wet and dry the mix. The line lengths
+// depend only on the rate, so setup() with new levels keeps the tail
+// playing.
+//
+// The delay lines are walked in runs up to the first one's wrap. Inside a
+// run each sample is read where it was written a line length ago and the
+// new one written in its place, with the eight lines side by side in one
+// loop body and no wrap checks.
+class FdnReverb {
+public:
+  static constexpr int LINES = 8;
+
+  // What FxParams set, for one rate
+  struct Settings {
+    int32_t feedback[LINES] = {};       // Q15, the line's decay / sqrt(8)
+    int32_t damp = 0;                   // Q15, share of the new sample kept
+    float wet = 0, dry = 0;
+  };
+  static Settings design(const FxParams& p, double rate);
+
+  void setup(const FxParams& p, double rate);
+  // New settings at the same rate: decay and damping change at once, the
+  // wet and dry levels ramp over fadeLen samples.
+  void switchSettings(const Settings& s, size_t fadeLen);
+  void reset();
+  void process(float* x, size_t n);
+
+private:
+  static size_t lineLength(int k, double rate);
+  void processRun(float* x, size_t n);
+
+  std::vector<int16_t> lines_[LINES];   // Q15
+  size_t pos_[LINES] = {};
+  int32_t state_[LINES] = {};           // damping filters
+  Settings settings_;
+  float wet_ = 0, dry_ = 0;             // current, ramping to settings_
+  float wetStep_ = 0, dryStep_ = 0;
+  size_t fadeLeft_ = 0;
+};
+
+// ==================== PRESETS ====================
+
+// One preset compiled for one rate: everything a preset switch changes
+// (FxConfig.apply_preset()'s fields), computed ahead of time.
+struct CompiledFx {
+  std::string name;
+  FxParams params;
+  int rate = 0;
+  std::vector<float> bandpass;
+  FdnReverb::Settings reverb;
+  float preGain = 1, postGain = 1, contrast = 0;
+
+  static void compile(CompiledFx& out, const std::string& name, const FxParams& p, int rate);
+};
+
+// Compiled presets by name, for one engine's internal rate. Defining a
+// name again compiles a new version; the old one is kept (a few KB) until
+// the cache goes, since an engine may still be fading out of it. The
+// pointers handed out stay valid for the cache's lifetime.
+class FxPresetCache {
+public:
+  explicit FxPresetCache(int rate) : rate_(rate) {}
+
+  const CompiledFx* define(const std::string& name, const FxParams& p);
+  // One flat JSON object with "name" and FxConfig's preset keys (bp_low,
+  // reverb_room, ...), as in FX_PRESETS. Keys left out keep FxParams'
+  // defaults. nullptr if there is no name.
+  const CompiledFx* defineJson(std::string_view line);
+  // A file of such lines; returns how many were defined.
+  int load(const std::string& path);
+  const CompiledFx* find(const std::string& name) const;
+  size_t size() const;
+
+private:
+  int rate_;
+  mutable std::mutex mutex_;
+  std::vector<std::unique_ptr<CompiledFx>> all_;
+  std::unordered_map<std::string, const CompiledFx*> byName_;
+};
+
+// ==================== RETUNES ====================
+
+// Maps the input stream's frames to hub time (CLOCK_MONOTONIC), the clock
+// the sweep schedules retunes on. A read returns some time after its last
+// frame was captured (arecord hands audio over a period at a time), so the
+// earliest arrival seen gives the stream's offset. The offset also creeps
+// up after later reads, so that drift between the sound card's clock and
+// the hub clock is followed.
+class StreamClock {
+public:
+  explicit StreamClock(int rate) : rate_(rate) {}
+
+  // A read returned at nowUs with framesEnd frames read in total.
+  void onRead(int64_t nowUs, uint64_t framesEnd);
+  bool valid() const { return valid_; }
+  // The input frame captured at hub time us.
+  int64_t frameAt(int64_t us) const;
+  int64_t timeOf(int64_t frame) const;
+
+private:
+  static constexpr double DRIFT = 1e-3;   // share of the excess taken per read
+
+  int rate_;
+  bool valid_ = false;
+  double offsetUs_ = 0;                   // hub time of frame 0
+};
+
+// Mutes the input around each retune. While the TEA5767's PLL settles it
+// clicks, and the click's timing drifts against the audio blocks. Each
+// retune is placed at an input frame. The gain ramps down over FADE_MS,
+// reaching zero at that frame. It stays at zero for the settle time, then
+// ramps back up. The gain depends only on the frame number, so both
+// channels of a stereo block can go through it.
+class RetuneGate {
+public:
+  static constexpr int FADE_MS = 2;
+  static constexpr size_t MAX_PENDING = 8;
+
+  void setup(int muteMs, double rate);
+  void schedule(int64_t frame);
+  // x holds frames [first, first + n).
+  void process(float* x, size_t n, int64_t first) const;
+  // Drops retunes whose window ends before frame `end`.
+  void retire(int64_t end);
+  size_t pending() const { return count_; }
+
+private:
+  float gainAt(int64_t d) const;   // d = frame - retune frame
+
+  int64_t mute_ = 0;
+  std::vector<float> ramp_;        // 0 to 1 over FADE_MS, raised cosine
+  int64_t frames_[MAX_PENDING] = {};
+  size_t count_ = 0;
+};
+
+// ==================== ENGINE ====================
+
+// The FX chain of build_sox_cmd_from_fx(), run natively:
+//
+//   highpass 250, lowpass 4800, (noise suppression), AGC, gain pre,
+//   sinc bp_low-bp_high, contrast, reverb, gain post, limiter, then both
+//   channels to both outputs
+//
+// (sox had a fixed `compand` where the AGC is and nothing after the post
+// gain.)
+//
+// sox ran all of it on two channels at 48 kHz and only collapsed them at
+// the end, though the FM source is mono. The engine downmixes at the input,
+// resamples to internalRate (16 kHz by default, enough for the 4.8 kHz
+// lowpass) with a polyphase filter, runs the chain once, resamples back
+// and writes the one channel to both outputs. Mode::Stereo keeps sox's
+// layout (two chains at the I/O rate) for comparison.
+//
+// Retunes are muted at the input (RetuneGate), before any stage can ring
+// with the click.
+//
+// Input and output are S16 interleaved stereo at ioRate. Output runs a few
+// samples behind the input (the filters' delay), so a call returns about
+// as many frames as it was given, not exactly as many.
+class FxEngine {
+public:
+  enum class Mode { Mono, Stereo };
+
+  static constexpr int IO_RATE = 48000;
+  static constexpr int DEFAULT_INTERNAL_RATE = 16000;
+  static constexpr int HIGHPASS_HZ = 250;
+  static constexpr int LOWPASS_HZ = 4800;
+
+  explicit FxEngine(int internalRate = DEFAULT_INTERNAL_RATE, Mode mode = Mode::Mono, int ioRate = IO_RATE);
+
+  // Rebuilds the stages for p. Filter state is kept where the stage
+  // allows, so a change costs no gap. Not while process() runs.
+  void configure(const FxParams& p);
+  // The control plane's live settings: safe from any thread while
+  // process() runs, and applied from its next call.
+  void setPreGainDb(float db);
+  void setPostGainDb(float db);
+  void setAgcTargetDb(float db);
+
+  // Switches to a compiled preset (of this engine's internal rate), from
+  // any thread. process() picks it up at its next call with one atomic
+  // exchange, and crossfades over FADE_MS: the band-pass runs both tap sets
+  // and blends, the reverb levels, gains and contrast ramp.
+  bool select(const CompiledFx* fx);
+  static constexpr int FADE_MS = 5;
+
+  struct SwitchStats {
+    uint64_t switches = 0;
+    double lastUs = 0, maxUs = 0;   // select() to the first sample processed with it
+  };
+  SwitchStats switchStats() const;
+
+  // A retune lands on input frame `frame` (frames counted from the first
+  // process() call). Call between process() calls, on the same thread.
+  // Returns false if that frame has already been processed. The part of the
+  // window still ahead is muted all the same.
+  bool retuneAt(int64_t frame);
+  // Input frames processed so far; the next call starts at this one.
+  int64_t framesIn() const { return framesIn_; }
+
+  // Not while process() runs (a preset switch updates it)
+  const FxParams& params() const { return params_; }
+  int internalRate() const { return internalRate_; }
+  int ioRate() const { return ioRate_; }
+  Mode mode() const { return mode_; }
+  size_t bandpassTaps() const { return chains_[0].bandpass.taps(); }
+
+  // Most frames one call can return for `frames` in.
+  size_t maxOutput(size_t frames) const { return frames + 8; }
+  size_t process(const int16_t* in, size_t frames, int16_t* out);
+
+private:
+  struct Chain {
+    Biquad highpass, lowpass;
+    NoiseSuppressor denoise;
+    Agc agc;
+    FirFilter bandpass;
+    FdnReverb reverb;
+    LookaheadLimiter limiter;
+  };
+
+  // Gains and contrast, ramped from one block's to the next's
+  struct Levels {
+    float pre = 1, post = 1, contrast = 0;
+  };
+
+  void applyPending();
+  void runChain(Chain& c, float* x, size_t n, const Levels& from, const Levels& to);
+
+  int internalRate_, ioRate_;
+  Mode mode_;
+  FxParams params_;
+  std::atomic<float> preGain_{1.0f}, postGain_{1.0f};
+  float contrast_ = 0;
+  Levels now_;                   // audio side: as the last block ended
+
+  std::atomic<const CompiledFx*> pending_{nullptr};
+  std::atomic<int64_t> pendingSinceUs_{0};
+  std::atomic<uint64_t> switches_{0};
+  std::atomic<int64_t> lastSwitchUs_{0}, maxSwitchUs_{0};
+  Chain chains_[2];              // Mono uses the first
+  RetuneGate retunes_;
+  int64_t framesIn_ = 0;
+  PolyphaseResampler down_, up_;
+  std::vector<float> in_, work_, out_, right_;
+};
+
+}  // namespace oraclebox
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef ORACLEBOX_HUB_CLOCK_H
+#define ORACLEBOX_HUB_CLOCK_H
+
+#include <cstdint>
+#include <ctime>
+
+namespace oraclebox {
+
+// Hub time in microseconds (CLOCK_MONOTONIC).
+// Satellites estimate their offset to this clock with the time_sync
+// exchange, so every "at"/"onset" timestamp on the wire is in hub time.
+inline int64_t hubNowUs() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+// Wall clock in microseconds since the epoch, for stored event timestamps
+// (queries are phrased as "between 2 and 3 am").
+inline int64_t hubWallUs() {
+  timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return (int64_t)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+}  // namespace oraclebox
+
+#endif
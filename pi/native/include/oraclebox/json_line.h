@@ -0,0 +1,76 @@
+#ifndef ORACLEBOX_JSON_LINE_H
+#define ORACLEBOX_JSON_LINE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace oraclebox {
+
+// Parser for one line of the satellite protocol: a flat JSON object with
+// string/number/bool values, as produced by sendEventToHub() on the ESP32s.
+// Nested objects/arrays are kept as raw text. Views returned by the accessors
+// stay valid until the next parse().
+class JsonLine {
+public:
+  static constexpr int MAX_FIELDS = 32;
+
+  bool parse(std::string_view line);
+
+  bool has(std::string_view key) const;
+  std::string_view str(std::string_view key, std::string_view def = {}) const;
+  double num(std::string_view key, double def = 0.0) const;
+  int64_t i64(std::string_view key, int64_t def = 0) const;
+  bool boolean(std::string_view key, bool def = false) const;
+
+  int fieldCount() const { return count_; }
+  std::string_view keyAt(int i) const { return fields_[i].key; }
+  std::string_view valueAt(int i) const { return fields_[i].value; }
+
+private:
+  struct Field {
+    std::string_view key;
+    std::string_view value;
+    bool isString;
+  };
+
+  const Field* find(std::string_view key) const;
+
+  std::string buf_;
+  Field fields_[MAX_FIELDS];
+  int count_ = 0;
+};
+
+// Builds one protocol line ("{...}\n") for sending to a satellite.
+class JsonWriter {
+public:
+  JsonWriter& add(std::string_view key, std::string_view value);
+  JsonWriter& add(std::string_view key, const char* value);
+  JsonWriter& add(std::string_view key, int64_t value);
+  JsonWriter& add(std::string_view key, int value);
+  JsonWriter& add(std::string_view key, double value);
+  JsonWriter& add(std::string_view key, bool value);
+  // Fields already in JSON form ("k":v,...), e.g. an object from a rules
+  // file without its braces. Trusted as is.
+  JsonWriter& raw(std::string_view fields);
+
+  std::string line() const;
+
+private:
+  void key(std::string_view k);
+
+  std::string body_;
+};
+
+// Longest line a satellite accepts from the hub (HUB_RX_LINE_MAX in the
+// sketches). A longer one is dropped whole.
+constexpr size_t SATELLITE_LINE_MAX = 2048;
+
+// JSON text with the whitespace outside strings removed, e.g. a hand-edited
+// rules file made into part of one protocol line.
+std::string compactJson(std::string_view text);
+
+}  // namespace oraclebox
+
+#endif
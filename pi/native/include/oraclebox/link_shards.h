@@ -0,0 +1,90 @@
+#ifndef ORACLEBOX_LINK_SHARDS_H
+#define ORACLEBOX_LINK_SHARDS_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "oraclebox/satellite_link.h"
+
+namespace oraclebox {
+
+// Satellite ingestion spread over several threads.
+//
+// Each shard is a SatelliteLink with its own epoll loop and thread, all
+// listening on the same port with SO_REUSEPORT, so the kernel balances new
+// connections across shards and a connection stays on the shard that
+// accepted it. Reading, line splitting, JSON parsing and time_sync replies
+// happen on the shard thread without any shared lock.
+//
+// Handlers run on shard threads, concurrently when there is more than one
+// shard; the caller serializes whatever state they share. Commands can be
+// sent from any thread: a device directory maps each device id to its
+// shard, and a command for a device on another shard is posted to that
+// shard's thread.
+class LinkShards : public CommandSink {
+public:
+  using LineHandler = SatelliteLink::LineHandler;
+  using ConnHandler = SatelliteLink::ConnHandler;
+  // Called on a shard thread after each poll() that dispatched lines.
+  using BatchHandler = std::function<void()>;
+
+  explicit LinkShards(int shards = 1);
+  ~LinkShards();
+  LinkShards(const LinkShards&) = delete;
+  LinkShards& operator=(const LinkShards&) = delete;
+
+  // Set these before listen() / start().
+  void setRateLimit(double linesPerSec, double burst);
+  void onLine(LineHandler handler) { lineHandler_ = std::move(handler); }
+  void onDisconnect(ConnHandler handler) { disconnectHandler_ = std::move(handler); }
+  void onBatch(BatchHandler handler) { batchHandler_ = std::move(handler); }
+
+  bool listen(uint16_t port);
+  void start();
+  // Stops and joins the shard threads; connections are closed.
+  void stop();
+
+  bool sendTo(std::string_view deviceId, std::string_view line) override;
+  int broadcast(std::string_view deviceType, std::string_view line) override;
+
+  int shardCount() const { return (int)shards_.size(); }
+  size_t connectionCount() const;
+  uint64_t linesDispatched() const;
+  uint64_t throttleCount() const;
+
+private:
+  struct Shard {
+    SatelliteLink link;
+    std::thread thread;
+    std::atomic<uint64_t> lines{0};
+    std::atomic<size_t> conns{0};
+    std::atomic<uint64_t> throttled{0};
+  };
+  struct DeviceRoute {
+    int shard;
+    std::string type;
+  };
+
+  void run(int index);
+  int currentShard() const;
+  int shardOf(std::string_view deviceId);
+
+  std::vector<std::unique_ptr<Shard>> shards_;
+  std::atomic<bool> running_{false};
+  std::mutex directoryMutex_;
+  std::unordered_map<std::string, DeviceRoute> directory_;
+  LineHandler lineHandler_;
+  ConnHandler disconnectHandler_;
+  BatchHandler batchHandler_;
+};
+
+}  // namespace oraclebox
+
+#endif
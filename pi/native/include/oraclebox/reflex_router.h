@@ -0,0 +1,125 @@
+#ifndef ORACLEBOX_REFLEX_ROUTER_H
+#define ORACLEBOX_REFLEX_ROUTER_H
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "oraclebox/json_line.h"
+#include "oraclebox/satellite_link.h"
+
+namespace oraclebox {
+
+// One declarative routing rule, e.g. "an em_trigger from rempod_01 with
+// strength >= 3 plays creepy_doll on musicbox_01". Written as one JSON line:
+//
+//   {"name":"hall_to_bedroom","source":"rempod_01","event":"em_trigger",
+//    "field":"strength","op":">=","value":3,"target":"musicbox_01",
+//    "cooldown_ms":2000,"send":{"cmd":"play","melody":"creepy_doll"}}
+//
+// source/target match a device id or a device type; source "*" matches any
+// device. field/op/value are optional (no condition = every such event).
+struct ReflexRule {
+  enum class Op : uint8_t { Any, Eq, Ne, Lt, Le, Gt, Ge };
+
+  std::string name;
+  std::string source;
+  std::string event;
+  std::string field;
+  Op op = Op::Any;
+  double value = 0.0;
+  std::string target;
+  std::string command;   // fields of the "send" object, as JSON text without the braces
+  int cooldownMs = 0;
+};
+
+// Rule condition helpers, shared with the correlator's pattern steps.
+bool parseRuleOp(std::string_view s, ReflexRule::Op& op);
+bool evalRuleOp(ReflexRule::Op op, double v, double value);
+
+// Reflex latency accounting. Samples are hub receive time of the trigger
+// event to the moment the target acted (see ReflexRouter::onAck).
+class ReflexStats {
+public:
+  static constexpr int BUCKET_US = 500;
+  static constexpr int BUCKETS = 400;   // 0 - 200 ms, last bucket = overflow
+
+  void add(int64_t us);
+  int64_t count() const { return count_; }
+  double meanMs() const { return count_ ? sumUs_ / 1000.0 / count_ : 0.0; }
+  double maxMs() const { return maxUs_ / 1000.0; }
+  double percentileMs(double p) const;
+  void reset() { *this = ReflexStats(); }
+
+private:
+  uint32_t buckets_[BUCKETS] = {};
+  int64_t count_ = 0;
+  int64_t sumUs_ = 0;
+  int64_t maxUs_ = 0;
+};
+
+// Compiles rules into a hash table keyed by (source, event) so each incoming
+// event costs three lookups (device id, device type, "*") and no allocation.
+// Matching rules are pushed to their targets over the link (CommandSink) with the
+// trigger's receive time attached as "route_us" and a per-dispatch
+// "route_id"; targets echo both back in a reflex_ack so end-to-end latency
+// can be measured.
+class ReflexRouter {
+public:
+  // Rules file: one rule per line, blank lines and '#' comments ignored.
+  bool loadFile(const std::string& path);
+  // Call compile() after adding rules; route() only sees compiled rules.
+  bool addRule(const JsonLine& def, std::string* error);
+  void compile();
+  size_t ruleCount() const { return rules_.size(); }
+
+  // Evaluates one event and pushes every matching command.
+  // Returns the number of commands sent.
+  int route(CommandSink& link, const SatelliteConn& from, const JsonLine& msg, int64_t rxUs);
+
+  // Handles {"event":"reflex_ack","route_us":..,"route_id":..,"action_hub_us":..}. Targets
+  // with a synced clock report when they acted in hub time; otherwise half
+  // of the command's round trip is used. Returns false if msg is not an ack.
+  bool onAck(const JsonLine& msg, int64_t rxUs);
+
+  const ReflexStats& stats() const { return stats_; }
+  ReflexStats& stats() { return stats_; }
+  int64_t evaluated() const { return evaluated_; }
+  int64_t fired() const { return fired_; }
+  int64_t suppressed() const { return suppressed_; }
+
+private:
+  struct Compiled {
+    uint32_t rule;         // index into rules_, which addRule() may reallocate
+    int64_t lastFiredUs;
+  };
+  struct Span {
+    uint32_t first;
+    uint32_t count;
+  };
+
+  static uint64_t key(std::string_view source, std::string_view event);
+  static bool matches(const ReflexRule& rule, const JsonLine& msg);
+  int fire(CommandSink& link, Compiled& c, const SatelliteConn& from, int64_t rxUs);
+
+  std::vector<ReflexRule> rules_;
+  std::vector<Compiled> compiled_;
+  std::unordered_map<uint64_t, Span> table_;
+  void expireAcks(int64_t now);
+
+  // route_us can repeat (shards share the clock), so sends are keyed by id
+  std::unordered_map<int64_t, int64_t> pendingSendUs_;   // route_id -> send time
+  std::deque<int64_t> pendingOrder_;                     // route_id keys, oldest first
+  int64_t nextRouteId_ = 1;
+  ReflexStats stats_;
+  int64_t evaluated_ = 0;
+  int64_t fired_ = 0;
+  int64_t suppressed_ = 0;
+};
+
+}  // namespace oraclebox
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef ORACLEBOX_RESAMPLER_H
+#define ORACLEBOX_RESAMPLER_H
+
+#include <cstddef>
+#include <vector>
+
+namespace oraclebox {
+
+// Kaiser-windowed sinc lowpass, `taps` long, cutoff in Hz at `rate`, unity
+// gain at DC. Shared by the resampler and the FX engine's band-pass.
+std::vector<float> designLowpass(int taps, double cutoffHz, double rate, double attenuationDb);
+
+// Rational-ratio polyphase resampler for one channel of float samples.
+//
+// outRate/inRate is reduced to L/M. The prototype lowpass is split into L
+// phases of TAPS_PER_PHASE taps, and each output sample is one phase's dot
+// product with the newest input. 48k -> 16k is L/M = 1/3: one phase of 32
+// taps, evaluated for every third input.
+//
+// The prototype is flat to 0.3 of the lower rate (4.8 kHz at 16k, where
+// the FX chain's own lowpass sits) and stops from 0.7 of it, about 70 dB
+// down for 3:1. What folds back lands above the passband, where the chain
+// removes it, so 32 taps do the work of a few hundred.
+class PolyphaseResampler {
+public:
+  static constexpr int TAPS_PER_PHASE = 32;
+
+  PolyphaseResampler() = default;
+  PolyphaseResampler(int inRate, int outRate) { setup(inRate, outRate); }
+
+  void setup(int inRate, int outRate);
+  void reset();
+
+  int inRate() const { return inRate_; }
+  int outRate() const { return outRate_; }
+  bool passthrough() const { return up_ == down_; }
+  // Most output samples n inputs can produce.
+  size_t maxOutput(size_t n) const { return n * up_ / down_ + 2; }
+
+  // Returns the number of samples written to out.
+  size_t process(const float* in, size_t n, float* out);
+
+private:
+  int inRate_ = 0, outRate_ = 0;
+  int up_ = 1, down_ = 1;       // L, M
+  int phase_ = 0;
+  std::vector<float> phases_;   // up_ x TAPS_PER_PHASE, each phase reversed
+  std::vector<float> history_;  // newest TAPS_PER_PHASE inputs, mirrored
+  size_t head_ = 0;
+};
+
+}  // namespace oraclebox
+
+#endif
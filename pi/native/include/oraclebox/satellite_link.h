@@ -0,0 +1,173 @@
+#ifndef ORACLEBOX_SATELLITE_LINK_H
+#define ORACLEBOX_SATELLITE_LINK_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "oraclebox/json_line.h"
+
+namespace oraclebox {
+
+// One TCP connection from an ESP32 satellite (port 8888).
+// Older firmware connects, sends one line and disconnects; current firmware
+// keeps the connection open so the hub can push commands back.
+struct SatelliteConn {
+  int fd = -1;
+  std::string peer;         // "ip:port"
+  std::string address;      // peer ip, the rate limit key of lines without an id
+  std::string deviceId;     // learned from the first line with an "id"
+  std::string deviceType;   // "musicbox", "rempod", ...
+  std::string location;
+  int64_t connectedUs = 0;
+  int64_t lastSeenUs = 0;
+  std::string rx;           // partial line being received
+  std::string tx;           // bytes not yet accepted by the socket
+  bool wantWrite = false;   // EPOLLOUT armed while tx is backed up
+  bool closing = false;     // dropped after the current poll() dispatch
+  int64_t retryUs = 0;      // throttled: when its bucket has a token again
+  bool throttled = false;   // out of tokens: lines wait in rx, socket not read
+};
+
+// Token buckets for the satellite rate limit, one per device id. A hub's
+// links share one limiter, so a satellite has the same budget whichever
+// shard it lands on and cannot refill it by reconnecting. Thread-safe; the
+// buckets are spread over a few locks so shards rarely contend.
+class RateLimiter {
+public:
+  // linesPerSec <= 0 disables the limit.
+  RateLimiter(double linesPerSec, double burst);
+  RateLimiter(const RateLimiter&) = delete;
+  RateLimiter& operator=(const RateLimiter&) = delete;
+
+  bool enabled() const { return ratePerUs_ > 0.0; }
+  // Takes one line's token from key's bucket. Returns 0 if there was one,
+  // otherwise how many microseconds until there will be.
+  int64_t take(std::string_view key, int64_t nowUs);
+
+private:
+  struct Bucket {
+    double tokens;
+    int64_t refillUs;       // when tokens was last refilled
+  };
+  struct Stripe {
+    std::mutex mutex;
+    std::unordered_map<std::string, Bucket> buckets;
+    size_t pruneAt = 64;    // drop idle buckets when the map grows past this
+  };
+  static constexpr size_t STRIPES = 16;
+
+  double ratePerUs_;        // tokens per microsecond
+  double burst_;
+  Stripe stripes_[STRIPES];
+};
+
+// Where commands for satellites go: a SatelliteLink, or LinkShards when
+// connections are spread over several threads.
+class CommandSink {
+public:
+  virtual ~CommandSink() = default;
+  // Queues a line for one device / all devices of a type ("" = every device).
+  virtual bool sendTo(std::string_view deviceId, std::string_view line) = 0;
+  virtual int broadcast(std::string_view deviceType, std::string_view line) = 0;
+};
+
+// Single-threaded epoll server for the satellite line protocol.
+// Call poll() from one thread; handlers run inside poll().
+// time_sync requests are answered inside the link so replies carry the
+// receive timestamp of the read that delivered them.
+//
+// With a rate limit, each device has a token bucket (see RateLimiter). A
+// connection whose device runs out of tokens is not read until it has some
+// again, so its backlog waits in its own socket buffer (and TCP slows it
+// down) instead of delaying the other satellites' lines. Lines are charged
+// to the device id, read from a connection's first line before it is
+// dispatched, or to the peer address if the line has none.
+class SatelliteLink : public CommandSink {
+public:
+  // rxUs is the hub time the line's bytes were read from the socket.
+  using LineHandler = std::function<void(SatelliteConn& conn, const JsonLine& msg, int64_t rxUs)>;
+  using ConnHandler = std::function<void(SatelliteConn& conn)>;
+
+  SatelliteLink();
+  ~SatelliteLink();
+  SatelliteLink(const SatelliteLink&) = delete;
+  SatelliteLink& operator=(const SatelliteLink&) = delete;
+
+  // Set before listen(). Lets several links, one per thread, listen on the
+  // same port; the kernel spreads new connections across them.
+  void setReusePort(bool on) { reusePort_ = on; }
+  // linesPerSec <= 0 disables the limit.
+  void setRateLimit(double linesPerSec, double burst);
+  // Shares one limiter between several links (null = unlimited).
+  void setRateLimiter(std::shared_ptr<RateLimiter> limiter) { limiter_ = std::move(limiter); }
+
+  bool listen(uint16_t port);
+  void close();
+
+  void onLine(LineHandler handler) { lineHandler_ = std::move(handler); }
+  void onDisconnect(ConnHandler handler) { disconnectHandler_ = std::move(handler); }
+  // Called once a connection's device id is known (first line with "id").
+  void onIdentify(ConnHandler handler) { identifyHandler_ = std::move(handler); }
+
+  // Runs fn on the thread that calls poll(), waking it if needed.
+  // The only SatelliteLink method that is safe to call from other threads.
+  void post(std::function<void(SatelliteLink&)> fn);
+
+  // Waits up to timeoutMs for socket activity and dispatches it.
+  // Returns the number of lines dispatched, or -1 on a fatal error.
+  int poll(int timeoutMs);
+
+  // Queues a line for one device / all devices of a type ("" = every device).
+  bool sendTo(std::string_view deviceId, std::string_view line) override;
+  int broadcast(std::string_view deviceType, std::string_view line) override;
+
+  SatelliteConn* findDevice(std::string_view deviceId);
+  size_t connectionCount() const { return conns_.size(); }
+  uint64_t throttleCount() const { return throttleCount_; }
+
+  template <typename Fn>
+  void forEach(Fn&& fn) {
+    for (auto& kv : conns_) fn(*kv.second);
+  }
+
+private:
+  void acceptAll();
+  void readConn(SatelliteConn& conn, int64_t rxUs, int& dispatched);
+  std::string_view rateKey(const SatelliteConn& conn, std::string_view line);
+  bool takeToken(SatelliteConn& conn, std::string_view line, int64_t nowUs);
+  void setThrottled(SatelliteConn& conn, bool throttled);
+  bool drainRx(SatelliteConn& conn, int64_t nowUs, int& dispatched, bool limited = true);
+  int serviceThrottled(int64_t nowUs, int& dispatched);
+  void updateEvents(SatelliteConn& conn);
+  void runPosted();
+  bool flushConn(SatelliteConn& conn);
+  bool queueSend(SatelliteConn& conn, std::string_view line);
+  void dropConn(int fd);
+  void reapClosing();
+  void handleLine(SatelliteConn& conn, std::string_view line, int64_t rxUs);
+
+  int listenFd_ = -1;
+  int epollFd_ = -1;
+  int wakeFd_ = -1;
+  bool reusePort_ = false;
+  std::shared_ptr<RateLimiter> limiter_;   // null = unlimited
+  int throttledConns_ = 0;
+  uint64_t throttleCount_ = 0;
+  std::mutex postMutex_;
+  std::vector<std::function<void(SatelliteLink&)>> posted_;
+  std::unordered_map<int, std::unique_ptr<SatelliteConn>> conns_;
+  LineHandler lineHandler_;
+  ConnHandler disconnectHandler_;
+  ConnHandler identifyHandler_;
+  JsonLine msg_;
+};
+
+}  // namespace oraclebox
+
+#endif
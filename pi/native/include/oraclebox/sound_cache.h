@@ -0,0 +1,117 @@
+#ifndef ORACLEBOX_SOUND_CACHE_H
+#define ORACLEBOX_SOUND_CACHE_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace oraclebox {
+
+// A sound decoded once into exactly what the output device takes: S16
+// interleaved stereo at the cache's rate. Playing it is a memcpy.
+struct PcmClip {
+  std::string name;              // file name, as play_sound() is given it
+  std::string path;
+  std::vector<int16_t> samples;  // L R L R ...
+
+  size_t frames() const { return samples.size() / 2; }
+};
+
+// Incremental decoder to S16 stereo at `rate`: feed it a file's bytes in
+// any chunking, as they are read or arrive, and the output grows as they
+// go. WAV (PCM 8/16/24/32-bit or float, any channel count) is parsed and
+// resampled here; MP3 streams through one mpg123 process.
+class PcmDecoder {
+public:
+  enum class Format { Wav, Mp3 };
+
+  // From the file name's extension; false if neither.
+  static bool formatOf(const std::string& name, Format& format);
+
+  PcmDecoder(Format format, int rate, const std::string& label);
+  ~PcmDecoder();
+  PcmDecoder(const PcmDecoder&) = delete;
+  PcmDecoder& operator=(const PcmDecoder&) = delete;
+
+  // False once the stream is known to be bad; later bytes are ignored.
+  bool feed(const uint8_t* data, size_t n);
+  // Flushes the decoder and moves the whole output to out.
+  bool finish(std::vector<int16_t>& out);
+  size_t framesDecoded() const;
+
+private:
+  bool parseWavHeader();
+  void feedWavData(const uint8_t* data, size_t n);
+  void resample(bool last);
+  bool startMp3();
+  void readMp3();
+  void stopMp3();
+
+  Format format_;
+  int rate_;
+  std::string label_;
+  bool failed_ = false;
+  mutable std::mutex outMutex_;
+  std::vector<int16_t> out_;
+
+  // WAV: header bytes until the data chunk, then frames
+  std::vector<uint8_t> header_;
+  size_t headerPos_ = 12;
+  bool inData_ = false;
+  uint64_t dataLeft_ = 0;
+  int wavFormat_ = 0, channels_ = 0, srcRate_ = 0, bits_ = 0;
+  std::vector<uint8_t> partial_;  // bytes of an incomplete frame
+  // Linear resampler: input frames from base_ on, next output frame
+  std::vector<float> pending_;
+  uint64_t base_ = 0;
+  uint64_t outIndex_ = 0;
+
+  // MP3
+  int pid_ = -1;
+  int inFd_ = -1;                 // mpg123's stdin (a socket, for MSG_NOSIGNAL)
+  int outFd_ = -1;
+  std::thread reader_;
+};
+
+// Decodes a .wav or .mp3 file into S16 stereo at `rate`.
+bool decodeSoundFile(const std::string& path, int rate, std::vector<int16_t>& out);
+
+// The trigger sounds, decoded at startup instead of on every trigger.
+//
+// Names are file names. A name found in more than one folder keeps the
+// first, so loading the folders in play_sound()'s search order finds the
+// same file it would. Clips are shared: a clip replaced by a reload stays
+// alive until the player lets go of it.
+class SoundCache {
+public:
+  static constexpr int DEFAULT_RATE = 48000;
+
+  explicit SoundCache(int rate = DEFAULT_RATE) : rate_(rate) {}
+
+  int rate() const { return rate_; }
+
+  // Every .wav/.mp3 directly in dir; returns how many were added.
+  int loadDirectory(const std::string& dir);
+  // Decodes path under name, replacing any clip of that name.
+  bool loadFile(const std::string& path, const std::string& name);
+  // Adds an already decoded clip, replacing any clip of its name.
+  void add(std::shared_ptr<const PcmClip> clip);
+
+  std::shared_ptr<const PcmClip> find(const std::string& name) const;
+  std::vector<std::string> names() const;
+  size_t size() const;
+  size_t bytes() const;
+
+private:
+  int rate_;
+  mutable std::mutex mutex_;
+  std::unordered_map<std::string, std::shared_ptr<const PcmClip>> clips_;
+};
+
+}  // namespace oraclebox
+
+#endif
@@ -0,0 +1,120 @@
+#ifndef ORACLEBOX_SOUND_LIBRARY_H
+#define ORACLEBOX_SOUND_LIBRARY_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "oraclebox/sound_cache.h"
+
+namespace oraclebox {
+
+struct SoundInfo {
+  enum Format : uint8_t { Wav, Mp3, Ogg, Flac };
+
+  std::string name;
+  std::string folder;            // tag of the folder it is in
+  std::string path;
+  Format format = Wav;
+  uint64_t bytes = 0;
+  int64_t mtimeNs = 0;
+  uint32_t durationMs = 0;       // 0 if the header did not say
+  uint32_t sampleRate = 0;
+  uint8_t channels = 0;
+  bool cached = false;           // decoded in the SoundCache, from this path
+};
+
+// Reads duration, rate and channels from a sound file's header: the WAV
+// fmt/data chunks, or the first MP3 frame (and its Xing/Info frame count).
+// OGG and FLAC are listed without them.
+bool probeSoundFile(const std::string& path, SoundInfo& info);
+
+// Every sound file in the sound folders, kept in memory instead of listed
+// and stat'ed on each call.
+//
+// Folders are added in play_sound()'s search order. A name in more than
+// one folder resolves to the first, the same file play_sound() would find.
+// lookup() is one hash lookup per folder the name is in.
+//
+// After start() an inotify thread keeps the index current: a file closed
+// after writing, or moved in, is probed again; a file deleted or moved out
+// is dropped. Hidden files (in-flight uploads) are ignored. A folder that
+// does not exist yet is picked up when it is created in its parent.
+//
+// save() writes the index in a compact binary form. start() loads it
+// first, and a file whose size and mtime match its entry is not opened
+// again, so startup costs a readdir and a stat per file.
+class SoundLibrary {
+public:
+  static constexpr uint32_t INDEX_MAGIC = 0x4F425349;   // "OBSI"
+  static constexpr uint32_t INDEX_VERSION = 1;
+
+  struct Stats {
+    size_t sounds = 0;
+    uint64_t probed = 0;         // headers read
+    uint64_t reused = 0;         // entries taken from the saved index
+    uint64_t events = 0;         // inotify changes applied
+    uint64_t lookups = 0;
+  };
+
+  // cache, if given, answers SoundInfo::cached.
+  explicit SoundLibrary(const SoundCache* cache = nullptr) : cache_(cache) {}
+  ~SoundLibrary();
+  SoundLibrary(const SoundLibrary&) = delete;
+  SoundLibrary& operator=(const SoundLibrary&) = delete;
+
+  // Before start(), in search order.
+  void addFolder(const std::string& tag, const std::string& path);
+
+  // Loads indexPath (if given and readable), scans the folders and starts
+  // watching them. False if inotify is unavailable; the index is still
+  // built, but is only updated by rescan().
+  bool start(const std::string& indexPath = "");
+  void stop();
+  void rescan();
+  bool save(const std::string& indexPath) const;
+
+  bool lookup(const std::string& name, SoundInfo& out) const;
+  std::string pathOf(const std::string& name) const;
+  // Sorted names in one folder, or in all of them (each name once).
+  std::vector<std::string> names(const std::string& tag = "") const;
+  Stats stats() const;
+
+private:
+  struct Folder {
+    std::string tag;
+    std::string path;
+    int watch = -1;
+    std::unordered_map<std::string, SoundInfo> sounds;
+  };
+
+  void scanFolder(size_t f, const std::unordered_map<std::string, SoundInfo>* saved);
+  void update(size_t f, const std::string& name);
+  void remove(size_t f, const std::string& name);
+  bool loadIndex(const std::string& path, std::vector<std::unordered_map<std::string, SoundInfo>>& out) const;
+  void watchFolders();
+  void run();
+  void fillCached(SoundInfo& info) const;
+
+  const SoundCache* cache_;
+  mutable std::mutex mutex_;
+  std::vector<Folder> folders_;
+  std::unordered_map<std::string, uint32_t> where_;   // name -> bit per folder
+
+  int inotify_ = -1;
+  int wakeFd_ = -1;
+  std::unordered_map<int, std::string> parentWatches_;   // for folders not created yet
+  std::thread thread_;
+  std::atomic<bool> quit_{false};
+
+  mutable std::atomic<uint64_t> lookups_{0};
+  std::atomic<uint64_t> probed_{0}, reused_{0}, events_{0};
+};
+
+}  // namespace oraclebox
+
+#endif
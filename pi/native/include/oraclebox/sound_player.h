@@ -0,0 +1,202 @@
+#ifndef ORACLEBOX_SOUND_PLAYER_H
+#define ORACLEBOX_SOUND_PLAYER_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include "oraclebox/sound_cache.h"
+#include "oraclebox/spsc_ring.h"
+
+namespace oraclebox {
+
+// Playback side of an ALSA PCM, S16 interleaved stereo. Device "null" (and
+// every device in a build without ALSA) is a sink of the same shape paced
+// by the clock, which is how the player is exercised off the Pi.
+class PcmOutput {
+public:
+  PcmOutput() = default;
+  ~PcmOutput();
+  PcmOutput(const PcmOutput&) = delete;
+  PcmOutput& operator=(const PcmOutput&) = delete;
+
+  bool open(const std::string& device, int rate, int periodFrames, int periods);
+  void close();
+  bool isOpen() const { return open_; }
+  const std::string& device() const { return device_; }
+  int rate() const { return rate_; }
+  int periodFrames() const { return periodFrames_; }
+  int bufferFrames() const { return bufferFrames_; }
+
+  // Blocks until the frames fit in the buffer; false if the device is gone.
+  bool write(const int16_t* samples, int frames);
+  // Frames queued that will play before the next write.
+  int64_t delayFrames();
+  // Drops up to `frames` of the newest queued frames (never below one
+  // period) so the next write plays sooner. Returns the frames dropped.
+  int64_t rewind(int64_t frames);
+  uint64_t underruns() const { return underruns_.load(); }
+
+private:
+  std::string device_;
+  bool open_ = false;
+  void* pcm_ = nullptr;          // snd_pcm_t*, null for the clock sink
+  int rate_ = 0;
+  int periodFrames_ = 0;
+  int bufferFrames_ = 0;
+  std::atomic<uint64_t> underruns_{0};
+  // Clock sink: frames written since startUs_, consumed at rate_
+  int64_t startUs_ = 0;
+  int64_t written_ = 0;
+};
+
+// The audio output: owns the device and mixes the live FX stream with up to
+// MAX_VOICES sounds from the cache.
+//
+// The FX stream is raw S16 stereo at the cache rate from a file descriptor
+// (the sox pipeline's stdout), read on its own thread into a ring. At most
+// STREAM_QUEUE_PERIODS stay queued, so a stalled period never turns into
+// lasting delay. Sounds overlay the stream instead of tearing it down.
+//
+// Each voice has its own gain and a duck level: while it plays, the stream
+// ramps down to the lowest duck level of the active voices (attack and
+// release set with setDuckTimes), and back up when they end.
+//
+// The output thread never locks or frees. play(), stopVoice() and
+// setVoiceGain() post commands through a lock-free ring, which it drains
+// once per period. Finished voices are reported back through a second
+// ring, and the control side frees their clips. With all voices busy, a new
+// sound takes over the oldest voice.
+//
+// A sound starts at the next period. When nothing audible is queued (no
+// stream, no voice playing), the queued silence is also rewound, so the
+// sound reaches the DAC within about two periods (5.3 ms each at the
+// default 256 frames and 48 kHz). The trigger-to-DAC latency of every sound
+// is measured from the device's own queue delay.
+class SoundPlayer {
+public:
+  static constexpr int DEFAULT_PERIOD_FRAMES = 256;
+  static constexpr int DEFAULT_PERIODS = 3;
+  static constexpr int MAX_VOICES = 8;
+  static constexpr int MAX_PERIOD_FRAMES = 4096;
+  static constexpr int STREAM_QUEUE_PERIODS = 4;
+  static constexpr float DEFAULT_DUCK_DB = -12.0f;
+
+  struct Stats {
+    uint64_t triggers = 0;         // play() calls
+    uint64_t started = 0;          // sounds that reached the device
+    uint64_t missing = 0;          // names not in the cache
+    uint64_t stolen = 0;           // voices taken over by a newer sound
+    uint64_t underruns = 0;
+    uint64_t streamUnderflows = 0; // periods the FX stream fell short
+    uint64_t streamDropped = 0;    // stream frames dropped to bound its delay
+    int voices = 0;                // playing now
+    bool streamAttached = false;
+    double periodMs = 0.0;
+    double lastLatencyMs = 0.0;
+    double meanLatencyMs = 0.0;
+    double maxLatencyMs = 0.0;
+  };
+
+  explicit SoundPlayer(SoundCache& cache) : cache_(cache) {}
+  ~SoundPlayer();
+  SoundPlayer(const SoundPlayer&) = delete;
+  SoundPlayer& operator=(const SoundPlayer&) = delete;
+
+  // Opens the device (switching if another one is held) and keeps it
+  // running. False if it cannot be opened, e.g. another player has it.
+  bool hold(const std::string& device, int periodFrames = DEFAULT_PERIOD_FRAMES);
+  // Closes the device so another process can use it.
+  void release();
+  bool holding() const { return holding_.load(); }
+  std::string device() const;
+
+  // Starts a cached sound; returns its voice id, or 0 if the name is not
+  // cached or no device is held. duckDb <= -96 does not duck.
+  uint64_t play(const std::string& name, float gain = 1.0f, float duckDb = DEFAULT_DUCK_DB);
+  void stopVoice(uint64_t id);   // short fade, no click
+  void stopAll();
+  void setVoiceGain(uint64_t id, float gain);
+  bool voiceActive(uint64_t id);
+  // Waits for a voice to finish; false on timeout.
+  bool waitVoice(uint64_t id, int timeoutMs);
+  bool playing();
+
+  // FX stream input. The fd is dup()ed; the stream ends at EOF or detach.
+  bool attachStream(int fd);
+  void detachStream();
+  void setStreamGain(float gain);
+  void setDuckTimes(int attackMs, int releaseMs);
+
+  Stats stats();
+
+private:
+  struct Command {
+    enum Type : uint8_t { Start, Stop, StopAll, Gain, StreamGain } type = Start;
+    int slot = 0;
+    uint64_t id = 0;
+    const PcmClip* clip = nullptr;
+    float gain = 1.0f;
+    float duck = 1.0f;             // stream gain while this voice plays
+    int64_t triggerUs = 0;
+  };
+
+  struct Voice {
+    uint64_t id = 0;               // 0 = free
+    const PcmClip* clip = nullptr;
+    size_t pos = 0;
+    float gain = 0.0f;             // now, ramped towards target per period
+    float target = 0.0f;
+    float duck = 1.0f;
+    bool stopping = false;
+  };
+
+  void run();
+  void readStream(int fd);
+  bool post(const Command& c);
+  void reap();                     // frees the clips of finished voices
+  void mixPeriod(float* mix, int frames);
+
+  SoundCache& cache_;
+  PcmOutput out_;
+  std::thread thread_;
+  std::atomic<bool> quit_{false};
+  std::atomic<bool> holding_{false};
+
+  // Control side (any thread, under controlMutex_)
+  std::mutex controlMutex_;
+  uint64_t nextId_ = 1;
+  uint64_t slotId_[MAX_VOICES] = {};
+  std::unordered_map<uint64_t, std::shared_ptr<const PcmClip>> live_;
+  SpscRing<Command, 64> commands_;
+  SpscRing<uint64_t, 64> finished_;
+
+  // Output thread only
+  Voice voices_[MAX_VOICES];
+  float streamGain_ = 1.0f;
+  float duckGain_ = 1.0f;
+  float duckAttack_ = 0.0f;        // per-period smoothing coefficients
+  float duckRelease_ = 0.0f;
+  std::atomic<int> attackMs_{20};
+  std::atomic<int> releaseMs_{400};
+
+  // FX stream: reader thread -> output thread
+  std::thread streamThread_;
+  std::atomic<bool> streamQuit_{false};
+  std::atomic<bool> streamAttached_{false};
+  SpscRing<int16_t, 32768> stream_;
+  bool streamFlowing_ = false;
+
+  std::atomic<uint64_t> triggers_{0}, started_{0}, missing_{0}, stolen_{0};
+  std::atomic<uint64_t> streamUnderflows_{0}, streamDropped_{0}, prevUnderruns_{0};
+  std::atomic<int64_t> latencySumUs_{0}, latencyMaxUs_{0}, latencyLastUs_{0};
+  std::atomic<int> activeVoices_{0};
+};
+
+}  // namespace oraclebox
+
+#endif
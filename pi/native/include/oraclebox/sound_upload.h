@@ -0,0 +1,71 @@
+#ifndef ORACLEBOX_SOUND_UPLOAD_H
+#define ORACLEBOX_SOUND_UPLOAD_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "oraclebox/sound_cache.h"
+
+namespace oraclebox {
+
+// CRC-32 as zlib computes it; pass the previous value to continue.
+uint32_t crc32Update(uint32_t crc, const void* data, size_t n);
+
+// One sound arriving from the app, handled as its chunks come in instead
+// of collected and written at the end.
+//
+// Chunks go to DIR/.NAME.upload through a 64 KB buffer, with a running
+// CRC-32, and through a PcmDecoder into the cache's playback format. At
+// finish() the file is synced and renamed into place and the decoded clip
+// goes straight into the cache, so the sound plays without a decode. A
+// file that cannot be decoded is still saved, as any upload was before.
+// An upload that is abandoned, short or fails its checksum leaves nothing
+// behind.
+class SoundUpload {
+public:
+  static constexpr size_t WRITE_BUFFER = 64 * 1024;
+
+  explicit SoundUpload(SoundCache& cache) : cache_(cache) {}
+  ~SoundUpload() { abort(); }
+  SoundUpload(const SoundUpload&) = delete;
+  SoundUpload& operator=(const SoundUpload&) = delete;
+
+  // Names are plain file names: no '/', no leading '.'.
+  bool begin(const std::string& dir, const std::string& name, uint64_t size);
+  // False once the file cannot be written (the upload will fail).
+  bool write(const void* data, size_t n);
+  // expectedCrc < 0 skips the check. False if the upload is short, fails the
+  // check or cannot be saved; the partial file is removed.
+  bool finish(int64_t expectedCrc = -1);
+  void abort();
+
+  bool active() const { return fd_ >= 0; }
+  uint64_t received() const { return received_; }
+  uint64_t size() const { return size_; }
+  uint32_t crc32() const { return crc_; }
+  bool decoded() const { return decoded_; }     // finish() added it to the cache
+  size_t framesDecoded() const { return decoder_ ? decoder_->framesDecoded() : 0; }
+  const std::string& path() const { return path_; }
+  const std::string& error() const { return error_; }
+
+private:
+  bool flush();
+  bool fail(const std::string& why);
+
+  SoundCache& cache_;
+  std::string name_, path_, partPath_, error_;
+  int fd_ = -1;
+  uint64_t size_ = 0;
+  uint64_t received_ = 0;
+  uint32_t crc_ = 0;
+  bool writeFailed_ = false;
+  bool decoded_ = false;
+  std::vector<uint8_t> buffer_;
+  std::unique_ptr<PcmDecoder> decoder_;
+};
+
+}  // namespace oraclebox
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef ORACLEBOX_SOURCE_LOCATOR_H
+#define ORACLEBOX_SOURCE_LOCATOR_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "oraclebox/json_line.h"
+#include "oraclebox/satellite_link.h"
+
+namespace oraclebox {
+
+// Where a REM pod sits, in metres on the floor plan. One JSON line each:
+//   {"id":"rempod_01","x":0.0,"y":2.5}
+struct PodPosition {
+  std::string id;
+  double x = 0.0;
+  double y = 0.0;
+};
+
+struct SourceEstimate {
+  double x = 0.0;
+  double y = 0.0;
+  double errorM = 0.0;        // standard error of (x, y)
+  double confidence = 0.0;    // 0..1
+  int pods = 0;               // pods heard within the last few time constants
+  int64_t timeUs = 0;         // hub time of the newest hit
+};
+
+// Live estimate of where a disturbance is, from em_trigger events of REM pods
+// at known positions.
+//
+// Each trigger adds its pod's position with weight = strength to a weighted
+// centroid. The running sums decay exponentially with time constant tau, so
+// recent hits dominate and the estimate follows a moving source. Decay is
+// applied lazily to the sums when the next event arrives, so an update is
+// a hash lookup and a handful of multiplies regardless of history.
+//
+// The error is the weighted spread of the hits over the square root of the
+// effective number of hits. Confidence combines how much recent weight there
+// is, that error compared to the size of the pod layout, and how many pods
+// contributed (one pod can only say "near me").
+class SourceLocator {
+public:
+  static constexpr double DEFAULT_TAU_S = 2.0;
+  static constexpr double REFERENCE_WEIGHT = 10.0;   // e.g. two strength-5 hits
+
+  // Pods file: one pod per line, blank lines and '#' comments ignored.
+  bool loadFile(const std::string& path);
+  bool addPod(const JsonLine& def, std::string* error);
+  size_t podCount() const { return pods_.size(); }
+  void setTimeConstant(double seconds) { tauUs_ = seconds * 1e6; }
+
+  // Feeds one event. Returns true if it was a trigger from a known pod.
+  bool update(const SatelliteConn& from, const JsonLine& msg, int64_t rxUs);
+
+  // Estimate as of nowUs (the sums decay in between updates).
+  SourceEstimate estimate(int64_t nowUs) const;
+
+  int64_t hits() const { return hits_; }
+
+private:
+  struct Pod {
+    PodPosition pos;
+    int64_t lastHitUs = 0;
+  };
+
+  std::vector<Pod> pods_;
+  std::unordered_map<std::string, int> podById_;
+  double podExtentM_ = 1.0;     // RMS radius of the pod layout
+  double tauUs_ = DEFAULT_TAU_S * 1e6;
+
+  // Decayed sums as of sumsUs_
+  double w_ = 0.0, ww_ = 0.0, wx_ = 0.0, wy_ = 0.0, wxx_ = 0.0, wyy_ = 0.0;
+  int64_t sumsUs_ = 0;
+  int64_t hits_ = 0;
+};
+
+}  // namespace oraclebox
+
+#endif
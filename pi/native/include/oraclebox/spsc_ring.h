@@ -0,0 +1,60 @@
+#ifndef ORACLEBOX_SPSC_RING_H
+#define ORACLEBOX_SPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+
+namespace oraclebox {
+
+// Bounded single-producer, single-consumer ring. Neither side ever blocks
+// or allocates, so it is safe on the audio thread: a full push or an empty
+// pop just moves fewer items. N must be a power of two.
+template <typename T, size_t N>
+class SpscRing {
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscRing size must be a power of two");
+
+public:
+  static constexpr size_t CAPACITY = N;
+
+  // Producer side
+  size_t push(const T* items, size_t n) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    size_t tail = tail_.load(std::memory_order_acquire);
+    if (n > N - (head - tail)) n = N - (head - tail);
+    for (size_t i = 0; i < n; i++) buf_[(head + i) & (N - 1)] = items[i];
+    head_.store(head + n, std::memory_order_release);
+    return n;
+  }
+  bool push(const T& item) { return push(&item, 1) == 1; }
+
+  // Consumer side
+  size_t pop(T* out, size_t n) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    size_t head = head_.load(std::memory_order_acquire);
+    if (n > head - tail) n = head - tail;
+    for (size_t i = 0; i < n; i++) out[i] = buf_[(tail + i) & (N - 1)];
+    tail_.store(tail + n, std::memory_order_release);
+    return n;
+  }
+  bool pop(T& out) { return pop(&out, 1) == 1; }
+  // Drops up to n of the oldest items.
+  size_t discard(size_t n) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    size_t head = head_.load(std::memory_order_acquire);
+    if (n > head - tail) n = head - tail;
+    tail_.store(tail + n, std::memory_order_release);
+    return n;
+  }
+
+  // Either side; exact only from the consumer.
+  size_t size() const { return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire); }
+
+private:
+  alignas(64) std::atomic<size_t> head_{0};
+  alignas(64) std::atomic<size_t> tail_{0};
+  alignas(64) T buf_[N];
+};
+
+}  // namespace oraclebox
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef ORACLEBOX_TIMELINE_QUERY_H
+#define ORACLEBOX_TIMELINE_QUERY_H
+
+#include <climits>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "oraclebox/event_store.h"
+
+namespace oraclebox {
+
+// Which stored events a query covers. Empty/negative fields match anything.
+struct TimelineFilter {
+  int64_t fromUs = INT64_MIN;   // inclusive
+  int64_t toUs = INT64_MAX;     // exclusive
+  std::vector<int> devices;     // device indexes
+  std::string location;         // every device at this location
+  int type = -1;                // event type index
+  int minStrength = INT_MIN;
+};
+
+struct TimelineHit {
+  uint32_t ref;                 // segment << 16 | offset, ordered like time
+  const EventRecord* rec;
+};
+
+enum class RollupGroup { None, Device, Location };
+
+struct RollupRow {
+  int64_t bucketUs;             // start of the bucket (wall clock)
+  std::string group;            // device id / location / "" for None
+  uint32_t count;
+  int32_t maxStrength;
+  float tempMin;                // NaN when no event in the bucket had a temperature
+  float tempMax;
+};
+
+// Query layer over an EventStore for session review ("all REM triggers above
+// strength 6 in the hallway between 2 and 3 am", "events per minute per room").
+//
+// For every (device, event type) pair it keeps a posting list of record refs,
+// so a query touches only the lists it names and binary-searches each one to
+// the time window. It also keeps per-minute rollups per pair (count, max
+// strength, temperature range), so rate queries read one row per minute
+// instead of every event. update() indexes records appended since the last
+// call, so a long-running process can follow a live store.
+class TimelineIndex {
+public:
+  static constexpr int64_t MINUTE_US = 60LL * 1000000;
+
+  explicit TimelineIndex(const EventStore& store) : store_(store) {}
+
+  // Indexes records appended since the last call. Returns how many.
+  size_t update();
+
+  // Devices selected by the filter (explicit list and/or location).
+  std::vector<int> selectDevices(const TimelineFilter& f) const;
+
+  // Matching events in time order.
+  std::vector<TimelineHit> events(const TimelineFilter& f) const;
+
+  // Aggregates per bucket of bucketMinutes. Served from the per-minute
+  // rollups unless minStrength is set, which needs the events themselves.
+  std::vector<RollupRow> rollup(const TimelineFilter& f, int bucketMinutes, RollupGroup group) const;
+
+  size_t indexedRecords() const { return indexed_; }
+
+private:
+  struct MinuteRollup {
+    int64_t minute;             // minutes since the epoch
+    uint32_t count;
+    int32_t maxStrength;
+    float tempMin;
+    float tempMax;
+  };
+  struct Postings {
+    std::vector<uint32_t> refs;
+    std::vector<MinuteRollup> minutes;
+  };
+
+  static uint32_t key(int device, int type) { return (uint32_t)device << 8 | (uint32_t)type; }
+  const EventRecord& at(uint32_t ref) const {
+    return store_.segmentRecords(ref >> 16)[ref & 0xFFFF];
+  }
+  void add(uint32_t ref, const EventRecord& r);
+  template <typename Fn>
+  void forEachList(const TimelineFilter& f, Fn&& fn) const;
+
+  const EventStore& store_;
+  std::unordered_map<uint32_t, Postings> lists_;
+  size_t segment_ = 0;          // resume point for update()
+  uint32_t offset_ = 0;
+  size_t indexed_ = 0;
+};
+
+}  // namespace oraclebox
+
+#endif
@@ -0,0 +1,245 @@
+// oraclebox_native: Python bindings for the native engines, so oraclebox.py
+// drives them in-process instead of through sockets or subprocesses.
+//
+//   import oraclebox_native as native
+//   sweep = native.SweepEngine()
+//   sweep.open_tuner(1)               # /dev/i2c-1, TEA5767 at 0x60
+//   sweep.start(); sweep.set_delay_ms(100); sweep.set_running(True)
+//   step = sweep.wait_step(seq, 500)  # (seq, mhz, time_us)
+//   cache = native.SoundCache(); cache.load_dir("sounds/RemPod")
+//   player = native.SoundPlayer(cache)
+//   player.hold("plughw:3,0"); player.play("chime.wav")
+//
+// Setters are a few atomics and return immediately, so SPEED/FM commands
+// cost microseconds. Anything that blocks (wait_step, EventBusReader.wait,
+// stop) releases the GIL, so Python threads keep running while it waits.
+//
+// FxEngine is deliberately not bound: it runs in the oraclebox_fx process
+// between arecord and aplay, where Python pauses cannot stall it, and its
+// live settings go over the /tmp/oraclebox_fx.control FIFO.
+
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+#include <cstring>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "oraclebox/event_bus.h"
+#include "oraclebox/fm_sweep.h"
+#include "oraclebox/sound_library.h"
+#include "oraclebox/sound_player.h"
+#include "oraclebox/sound_upload.h"
+
+namespace py = pybind11;
+using namespace oraclebox;
+
+namespace {
+
+std::string fieldString(const char* field, size_t n) { return std::string(field, strnlen(field, n)); }
+
+// Same field order as event_bus.BusEvent
+py::tuple recordTuple(const BusRecord& r) {
+  return py::make_tuple(r.seq, r.timeUs, fieldString(r.device, sizeof(r.device)),
+                        fieldString(r.location, sizeof(r.location)), fieldString(r.event, sizeof(r.event)),
+                        r.strength, r.temperature, r.pressure, r.value);
+}
+
+py::tuple stepTuple(const SweepEngine::Step& s) { return py::make_tuple(s.seq, s.mhz, s.timeUs); }
+
+}  // namespace
+
+PYBIND11_MODULE(oraclebox_native, m) {
+  m.doc() = "OracleBox native engines (FM sweep, satellite event bus, trigger sounds)";
+
+  // ==================== FM SWEEP ====================
+  py::class_<SweepEngine>(m, "SweepEngine")
+      .def(py::init<>())
+      .def("open_tuner", &SweepEngine::openTuner, py::arg("bus") = 1, py::arg("address") = 0x60)
+      .def("start", &SweepEngine::start)
+      .def("stop", &SweepEngine::stop, py::call_guard<py::gil_scoped_release>())
+      .def("set_running", &SweepEngine::setRunning)
+      .def("set_delay_ms", &SweepEngine::setDelayMs)
+      .def("set_direction", &SweepEngine::setDirection)
+      .def("set_mono", &SweepEngine::setMono)
+      .def("set_band", &SweepEngine::setBand, py::arg("low_tenths"), py::arg("high_tenths"),
+           py::arg("step_tenths") = 2)
+      .def("set_retune_pipe", &SweepEngine::setRetunePipe)
+      .def("tune", &SweepEngine::tune, py::call_guard<py::gil_scoped_release>())
+      .def_property_readonly("running", &SweepEngine::running)
+      .def_property_readonly("delay_ms", &SweepEngine::delayMs)
+      .def_property_readonly("direction", &SweepEngine::direction)
+      .def("wait_step",
+           [](SweepEngine& self, uint64_t afterSeq, int timeoutMs) {
+             SweepEngine::Step step;
+             {
+               py::gil_scoped_release release;
+               step = self.waitStep(afterSeq, timeoutMs);
+             }
+             return stepTuple(step);
+           },
+           py::arg("after_seq"), py::arg("timeout_ms") = 500)
+      .def("last_step", [](SweepEngine& self) { return stepTuple(self.lastStep()); })
+      .def("stats", [](SweepEngine& self) {
+        SweepEngine::Stats s = self.stats();
+        py::dict d;
+        d["steps"] = s.steps;
+        d["i2c_errors"] = s.i2cErrors;
+        d["late"] = s.late;
+        d["max_late_ms"] = s.maxLateMs;
+        d["mean_late_ms"] = s.meanLateMs;
+        return d;
+      });
+
+  // ==================== TRIGGER SOUNDS ====================
+  py::class_<SoundCache>(m, "SoundCache")
+      .def(py::init<int>(), py::arg("rate") = (int)SoundCache::DEFAULT_RATE)
+      .def("load_dir", &SoundCache::loadDirectory, py::call_guard<py::gil_scoped_release>())
+      .def("load_file", &SoundCache::loadFile, py::arg("path"), py::arg("name"),
+           py::call_guard<py::gil_scoped_release>())
+      .def("names", &SoundCache::names)
+      .def("__contains__", [](const SoundCache& self, const std::string& name) { return self.find(name) != nullptr; })
+      .def("__len__", &SoundCache::size)
+      .def_property_readonly("bytes", &SoundCache::bytes)
+      .def_property_readonly("rate", &SoundCache::rate);
+
+  py::class_<SoundPlayer>(m, "SoundPlayer")
+      .def(py::init<SoundCache&>(), py::keep_alive<1, 2>())
+      .def("hold", &SoundPlayer::hold, py::arg("device"),
+           py::arg("period_frames") = (int)SoundPlayer::DEFAULT_PERIOD_FRAMES,
+           py::call_guard<py::gil_scoped_release>())
+      .def("release", &SoundPlayer::release, py::call_guard<py::gil_scoped_release>())
+      .def_property_readonly("holding", &SoundPlayer::holding)
+      .def_property_readonly("device", &SoundPlayer::device)
+      .def("play", &SoundPlayer::play, py::arg("name"), py::arg("gain") = 1.0f,
+           py::arg("duck_db") = SoundPlayer::DEFAULT_DUCK_DB)
+      .def("stop_voice", &SoundPlayer::stopVoice)
+      .def("stop_all", &SoundPlayer::stopAll)
+      .def("set_voice_gain", &SoundPlayer::setVoiceGain)
+      .def("voice_active", &SoundPlayer::voiceActive)
+      .def("wait_voice", &SoundPlayer::waitVoice, py::arg("id"), py::arg("timeout_ms"),
+           py::call_guard<py::gil_scoped_release>())
+      .def_property_readonly("playing", &SoundPlayer::playing)
+      .def("attach_stream", &SoundPlayer::attachStream, py::arg("fd"), py::call_guard<py::gil_scoped_release>())
+      .def("detach_stream", &SoundPlayer::detachStream, py::call_guard<py::gil_scoped_release>())
+      .def("set_stream_gain", &SoundPlayer::setStreamGain)
+      .def("set_duck_times", &SoundPlayer::setDuckTimes, py::arg("attack_ms"), py::arg("release_ms"))
+      .def("stats", [](SoundPlayer& self) {
+        SoundPlayer::Stats s = self.stats();
+        py::dict d;
+        d["triggers"] = s.triggers;
+        d["started"] = s.started;
+        d["missing"] = s.missing;
+        d["stolen"] = s.stolen;
+        d["underruns"] = s.underruns;
+        d["stream_underflows"] = s.streamUnderflows;
+        d["stream_dropped"] = s.streamDropped;
+        d["voices"] = s.voices;
+        d["stream_attached"] = s.streamAttached;
+        d["period_ms"] = s.periodMs;
+        d["last_latency_ms"] = s.lastLatencyMs;
+        d["mean_latency_ms"] = s.meanLatencyMs;
+        d["max_latency_ms"] = s.maxLatencyMs;
+        return d;
+      });
+
+  // Sound folders indexed in memory and kept current by inotify; lookup()
+  // is a dict or None, without touching the SD card
+  py::class_<SoundLibrary>(m, "SoundLibrary")
+      .def(py::init<>())
+      .def(py::init<const SoundCache*>(), py::keep_alive<1, 2>())
+      .def("add_folder", &SoundLibrary::addFolder, py::arg("tag"), py::arg("path"))
+      .def("start", &SoundLibrary::start, py::arg("index_path") = std::string(),
+           py::call_guard<py::gil_scoped_release>())
+      .def("stop", &SoundLibrary::stop, py::call_guard<py::gil_scoped_release>())
+      .def("rescan", &SoundLibrary::rescan, py::call_guard<py::gil_scoped_release>())
+      .def("save", &SoundLibrary::save, py::arg("index_path"), py::call_guard<py::gil_scoped_release>())
+      .def("path", &SoundLibrary::pathOf)
+      .def("names", &SoundLibrary::names, py::arg("tag") = std::string())
+      .def("lookup",
+           [](const SoundLibrary& self, const std::string& name) -> py::object {
+             SoundInfo info;
+             if (!self.lookup(name, info)) return py::none();
+             static const char* formats[] = {"wav", "mp3", "ogg", "flac"};
+             py::dict d;
+             d["name"] = info.name;
+             d["folder"] = info.folder;
+             d["path"] = info.path;
+             d["format"] = formats[info.format];
+             d["bytes"] = info.bytes;
+             d["duration_ms"] = info.durationMs;
+             d["sample_rate"] = info.sampleRate;
+             d["channels"] = info.channels;
+             d["cached"] = info.cached;
+             return std::move(d);
+           })
+      .def("stats", [](const SoundLibrary& self) {
+        SoundLibrary::Stats s = self.stats();
+        py::dict d;
+        d["sounds"] = s.sounds;
+        d["probed"] = s.probed;
+        d["reused"] = s.reused;
+        d["events"] = s.events;
+        d["lookups"] = s.lookups;
+        return d;
+      });
+
+  // Chunks are written and decoded as they arrive; finish() puts the clip
+  // in the cache, so the sound plays as soon as the upload completes
+  py::class_<SoundUpload>(m, "SoundUpload")
+      .def(py::init<SoundCache&>(), py::keep_alive<1, 2>())
+      .def("begin", &SoundUpload::begin, py::arg("dir"), py::arg("name"), py::arg("size"))
+      .def("write",
+           [](SoundUpload& self, py::bytes data) {
+             char* p = nullptr;
+             Py_ssize_t n = 0;
+             PyBytes_AsStringAndSize(data.ptr(), &p, &n);
+             py::gil_scoped_release release;
+             return self.write(p, (size_t)n);
+           })
+      .def("finish", &SoundUpload::finish, py::arg("expected_crc") = -1, py::call_guard<py::gil_scoped_release>())
+      .def("abort", &SoundUpload::abort)
+      .def_property_readonly("received", &SoundUpload::received)
+      .def_property_readonly("crc32", &SoundUpload::crc32)
+      .def_property_readonly("decoded", &SoundUpload::decoded)
+      .def_property_readonly("frames_decoded", &SoundUpload::framesDecoded)
+      .def_property_readonly("path", &SoundUpload::path)
+      .def_property_readonly("error", &SoundUpload::error);
+
+  // ==================== EVENT BUS ====================
+  py::class_<EventBusReader>(m, "EventBusReader")
+      .def(py::init<>())
+      .def("attach", &EventBusReader::attach, py::arg("name") = std::string(EventBus::DEFAULT_NAME),
+           py::arg("from_start") = false)
+      .def("detach", &EventBusReader::detach)
+      .def("stale", &EventBusReader::stale)
+      .def_property_readonly("dropped", &EventBusReader::dropped)
+      .def_property_readonly("capacity", &EventBusReader::capacity)
+      .def("wait", &EventBusReader::wait, py::arg("timeout_ms"), py::call_guard<py::gil_scoped_release>())
+      // Up to max records as event_bus.BusEvent-ordered tuples
+      .def("read",
+           [](EventBusReader& self, size_t max) {
+             std::vector<BusRecord> batch;
+             batch.reserve(max < 256 ? max : 256);
+             BusRecord rec;
+             while (batch.size() < max) {
+               EventBusReader::Status st = self.next(rec);
+               if (st == EventBusReader::Status::Empty) break;
+               if (st == EventBusReader::Status::Ok) batch.push_back(rec);
+             }
+             py::list out;
+             for (const BusRecord& r : batch) out.append(recordTuple(r));
+             return out;
+           },
+           py::arg("max") = 64)
+      // Read-only memoryview over the mapped ring itself (capacity x 96
+      // bytes, struct "<Qq16s16s32siffi"): numpy.frombuffer() on it reads
+      // the shared memory directly. Slots are overwritten as the hub
+      // publishes, so check each record's seq like event_bus.py does.
+      .def("ring", [](EventBusReader& self) -> py::object {
+        if (!self.ring()) return py::none();
+        return py::memoryview::from_memory(static_cast<const void*>(self.ring()),
+                                           (py::ssize_t)self.capacity() * (py::ssize_t)sizeof(BusRecord));
+      });
+}
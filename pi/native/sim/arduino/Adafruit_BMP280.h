@@ -0,0 +1,36 @@
+#ifndef ORACLEBOX_SIM_ADAFRUIT_BMP280_H
+#define ORACLEBOX_SIM_ADAFRUIT_BMP280_H
+
+// BMP280 temperature / pressure sensor, read from the running device's
+// sensor model (synthetic or a recorded trace).
+
+#include "Adafruit_Sensor.h"
+#include "Wire.h"
+
+class Adafruit_BMP280 {
+public:
+  enum sensor_mode { MODE_SLEEP = 0, MODE_FORCED = 1, MODE_NORMAL = 3 };
+  enum sensor_sampling { SAMPLING_NONE, SAMPLING_X1, SAMPLING_X2, SAMPLING_X4, SAMPLING_X8, SAMPLING_X16 };
+  enum sensor_filter { FILTER_OFF, FILTER_X2, FILTER_X4, FILTER_X8, FILTER_X16 };
+  enum standby_duration {
+    STANDBY_MS_1, STANDBY_MS_63, STANDBY_MS_125, STANDBY_MS_250,
+    STANDBY_MS_500, STANDBY_MS_1000, STANDBY_MS_2000, STANDBY_MS_4000
+  };
+
+  Adafruit_BMP280(TwoWire* wire = &Wire) { (void)wire; }
+
+  bool begin(uint8_t address = 0x77, uint8_t chipId = 0x58);
+  void setSampling(sensor_mode mode = MODE_NORMAL, sensor_sampling tempSampling = SAMPLING_X16,
+                   sensor_sampling pressSampling = SAMPLING_X16, sensor_filter filter = FILTER_OFF,
+                   standby_duration duration = STANDBY_MS_1) {
+    (void)mode;
+    (void)tempSampling;
+    (void)pressSampling;
+    (void)filter;
+    (void)duration;
+  }
+  float readTemperature();   // C
+  float readPressure();      // Pa
+};
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef ORACLEBOX_SIM_ADAFRUIT_SENSOR_H
+#define ORACLEBOX_SIM_ADAFRUIT_SENSOR_H
+
+#include "Arduino.h"
+
+#endif
@@ -0,0 +1,165 @@
+#ifndef ORACLEBOX_SIM_ARDUINO_H
+#define ORACLEBOX_SIM_ARDUINO_H
+
+// Arduino-ESP32 core API for running satellite sketches inside fleet_sim.
+//
+// Only what the OracleBox sketches use. Every call acts on the virtual
+// device that is currently running (see virtual_fleet.h): time is that
+// device's virtual clock, pins read its sensor model, and delay() hands the
+// CPU to the fleet scheduler instead of sleeping.
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <string>
+
+using std::abs;
+using std::max;
+using std::min;
+
+#define ESP_ARDUINO_VERSION_MAJOR 2
+#define IRAM_ATTR
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+// ==================== TIME ====================
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+// ==================== GPIO / LEDC ====================
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t value);
+void analogWrite(uint8_t pin, int value);
+uint16_t analogRead(uint8_t pin);
+
+uint32_t ledcSetup(uint8_t channel, uint32_t freq, uint8_t resolutionBits);
+void ledcAttachPin(uint8_t pin, uint8_t channel);
+void ledcWrite(uint8_t channel, uint32_t duty);
+uint32_t ledcChangeFrequency(uint8_t channel, uint32_t freq, uint8_t resolutionBits);
+
+// ==================== MATH ====================
+long random(long howBig);
+long random(long howSmall, long howBig);
+void randomSeed(unsigned long seed);
+long map(long x, long inMin, long inMax, long outMin, long outMax);
+
+template <typename T, typename L, typename H>
+inline T constrain(T x, L low, H high) {
+  return x < (T)low ? (T)low : (x > (T)high ? (T)high : x);
+}
+
+// ==================== CRITICAL SECTIONS ====================
+// One virtual device runs at a time and timer callbacks only run from its
+// delay()/yield(), so critical sections have nothing to exclude.
+typedef struct {
+  int owner;
+} portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {0}
+#define portENTER_CRITICAL(mux) ((void)(mux))
+#define portEXIT_CRITICAL(mux) ((void)(mux))
+
+// ==================== STRING ====================
+class String {
+public:
+  String() = default;
+  String(const char* s) : s_(s ? s : "") {}
+  String(const std::string& s) : s_(s) {}
+  String(char c) : s_(1, c) {}
+  String(int v) : s_(std::to_string(v)) {}
+  String(unsigned v) : s_(std::to_string(v)) {}
+  String(long v) : s_(std::to_string(v)) {}
+  String(unsigned long v) : s_(std::to_string(v)) {}
+  String(float v, unsigned decimals = 2);
+  String(double v, unsigned decimals = 2);
+
+  unsigned length() const { return (unsigned)s_.size(); }
+  const char* c_str() const { return s_.c_str(); }
+  int toInt() const { return atoi(s_.c_str()); }
+  float toFloat() const { return (float)atof(s_.c_str()); }
+  int indexOf(const char* needle) const {
+    size_t at = s_.find(needle);
+    return at == std::string::npos ? -1 : (int)at;
+  }
+  char operator[](unsigned i) const { return i < s_.size() ? s_[i] : '\0'; }
+  bool equals(const String& o) const { return s_ == o.s_; }
+  bool operator==(const String& o) const { return s_ == o.s_; }
+  bool operator==(const char* o) const { return s_ == (o ? o : ""); }
+  bool operator!=(const String& o) const { return s_ != o.s_; }
+
+  String& operator+=(const String& o) { s_ += o.s_; return *this; }
+  String& operator+=(const char* o) { if (o) s_ += o; return *this; }
+  String& operator+=(char c) { s_ += c; return *this; }
+  String& operator+=(int v) { s_ += std::to_string(v); return *this; }
+
+  const std::string& str() const { return s_; }
+
+private:
+  std::string s_;
+};
+
+inline String operator+(const String& a, const String& b) { String s(a); s += b; return s; }
+inline String operator+(const String& a, const char* b) { String s(a); s += b; return s; }
+inline String operator+(const char* a, const String& b) { String s(a); s += b; return s; }
+inline String operator+(const String& a, char b) { String s(a); s += b; return s; }
+
+// ==================== SERIAL ====================
+class Printable;
+
+#define DEC 10
+#define HEX 16
+
+// Output goes to the fleet's serial echo when this device is being watched
+// (fleet_sim --serial ID) and is dropped otherwise.
+class HardwareSerial {
+public:
+  void begin(unsigned long baud);
+  void end();
+  void flush() {}
+  operator bool() const { return true; }
+
+  size_t print(const char* s);
+  size_t print(const String& s) { return print(s.c_str()); }
+  size_t print(char c);
+  size_t print(int v, int base = DEC) { return print((long)v, base); }
+  size_t print(unsigned v, int base = DEC) { return print((unsigned long)v, base); }
+  size_t print(long v, int base = DEC);
+  size_t print(unsigned long v, int base = DEC);
+  size_t print(double v, int digits = 2);
+  size_t print(const Printable& p);
+
+  size_t println() { return print("\n"); }
+  template <typename T>
+  size_t println(const T& v) { size_t n = print(v); return n + println(); }
+  template <typename T>
+  size_t println(const T& v, int format) { size_t n = print(v, format); return n + println(); }
+};
+
+extern HardwareSerial Serial;
+
+class Printable {
+public:
+  virtual ~Printable() = default;
+  virtual String toString() const = 0;
+};
+
+#endif
@@ -0,0 +1,172 @@
+#ifndef ORACLEBOX_SIM_ARDUINOJSON_H
+#define ORACLEBOX_SIM_ARDUINOJSON_H
+
+// The slice of the ArduinoJson 7 API the satellite sketches use: build a
+// document with doc["key"] = value, serializeJson() it, deserializeJson() a
+// command line and read it back with `doc["key"] | default`, is<T>(),
+// as<T>() and range-for over arrays. A plain tree on the heap; fleet_sim only needs the
+// same behaviour, not the same memory layout.
+
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "Arduino.h"
+
+struct JsonNode {
+  enum Type : uint8_t { Null, Bool, Int, Float, Str, Array, Object };
+
+  Type type = Null;
+  bool b = false;
+  int64_t i = 0;
+  double f = 0.0;
+  std::string s;
+  std::vector<std::string> keys;                  // Object
+  std::vector<std::unique_ptr<JsonNode>> items;   // Array elements / Object values
+
+  JsonNode* member(const char* key) const;
+  JsonNode* addMember(const char* key);
+  void clear();
+};
+
+// A reference into a document. A member that does not exist yet keeps its
+// parent and key, so assigning to it creates it; reading it gives null.
+class JsonVariant {
+public:
+  JsonVariant() = default;
+  explicit JsonVariant(JsonNode* node) : node_(node) {}
+  JsonVariant(JsonNode* parent, const char* key) : node_(parent->member(key)), parent_(parent), key_(key) {}
+
+  JsonVariant operator[](const char* key) const;
+  JsonVariant operator[](const String& key) const { return (*this)[key.c_str()]; }
+  JsonVariant operator[](int index) const;
+
+  bool isNull() const { return !node_ || node_->type == JsonNode::Null; }
+  bool isString() const { return node_ && node_->type == JsonNode::Str; }
+  bool isNumber() const { return node_ && (node_->type == JsonNode::Int || node_->type == JsonNode::Float); }
+  size_t size() const { return node_ ? node_->items.size() : 0; }
+
+  // is<double>() / is<int>() -> any number, is<const char*>() -> a string
+  template <typename T>
+  bool is() const {
+    if constexpr (std::is_arithmetic<T>::value) return isNumber();
+    else return isString();
+  }
+
+  template <typename T>
+  T as() const;
+
+  JsonVariant& operator=(const char* value);
+  JsonVariant& operator=(const String& value) { return *this = value.c_str(); }
+  JsonVariant& operator=(bool value);
+  template <typename T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value, int>::type = 0>
+  JsonVariant& operator=(T value) {
+    JsonNode* n = writable();
+    if (n) { n->clear(); n->type = JsonNode::Int; n->i = (int64_t)value; }
+    return *this;
+  }
+  template <typename T, typename std::enable_if<std::is_floating_point<T>::value, int>::type = 0>
+  JsonVariant& operator=(T value) {
+    JsonNode* n = writable();
+    if (n) { n->clear(); n->type = JsonNode::Float; n->f = (double)value; }
+    return *this;
+  }
+
+  // Arrays: for (JsonObject o : doc["rules"].as<JsonArray>())
+  class iterator {
+  public:
+    iterator(const JsonNode* node, size_t i) : node_(node), i_(i) {}
+    JsonVariant operator*() const { return JsonVariant(node_->items[i_].get()); }
+    iterator& operator++() { i_++; return *this; }
+    bool operator!=(const iterator& o) const { return i_ != o.i_; }
+
+  private:
+    const JsonNode* node_;
+    size_t i_;
+  };
+  iterator begin() const { return iterator(node_, 0); }
+  iterator end() const { return iterator(node_, node_ && node_->type == JsonNode::Array ? node_->items.size() : 0); }
+
+  JsonNode* node() const { return node_; }
+
+private:
+  JsonNode* writable();
+
+  JsonNode* node_ = nullptr;
+  JsonNode* parent_ = nullptr;
+  const char* key_ = nullptr;   // string literal / caller's buffer, used right away
+};
+
+using JsonArray = JsonVariant;
+using JsonObject = JsonVariant;
+
+template <>
+const char* JsonVariant::as<const char*>() const;
+template <>
+String JsonVariant::as<String>() const;
+template <>
+bool JsonVariant::as<bool>() const;
+template <>
+JsonVariant JsonVariant::as<JsonVariant>() const;
+
+template <typename T>
+T JsonVariant::as() const {
+  static_assert(std::is_arithmetic<T>::value, "unsupported JsonVariant::as<T>()");
+  if (!node_) return T();
+  if (node_->type == JsonNode::Int) return (T)node_->i;
+  if (node_->type == JsonNode::Float) return (T)node_->f;
+  if (node_->type == JsonNode::Bool) return (T)node_->b;
+  return T();
+}
+
+inline const char* operator|(const JsonVariant& v, const char* def) {
+  return v.isString() ? v.node()->s.c_str() : def;
+}
+
+template <typename T, typename std::enable_if<std::is_arithmetic<T>::value, int>::type = 0>
+T operator|(const JsonVariant& v, T def) {
+  return v.isNumber() ? v.as<T>() : def;
+}
+
+class JsonDocument {
+public:
+  JsonVariant operator[](const char* key) { return JsonVariant(&root_, key); }
+  JsonVariant operator[](const String& key) { return (*this)[key.c_str()]; }
+  template <typename T>
+  T as() { return JsonVariant(&root_).as<T>(); }
+  bool isNull() const { return root_.type == JsonNode::Null; }
+  void clear() { root_.clear(); }
+
+  JsonNode& root() { return root_; }
+  const JsonNode& root() const { return root_; }
+
+private:
+  JsonNode root_;
+};
+
+class DeserializationError {
+public:
+  enum Code { Ok, EmptyInput, IncompleteInput, InvalidInput, TooDeep };
+
+  DeserializationError(Code code = Ok) : code_(code) {}
+  explicit operator bool() const { return code_ != Ok; }
+  Code code() const { return code_; }
+  const char* c_str() const;
+
+private:
+  Code code_;
+};
+
+DeserializationError deserializeJson(JsonDocument& doc, const char* input, size_t len);
+inline DeserializationError deserializeJson(JsonDocument& doc, const String& input) {
+  return deserializeJson(doc, input.c_str(), input.length());
+}
+inline DeserializationError deserializeJson(JsonDocument& doc, const char* input) {
+  return deserializeJson(doc, input, strlen(input));
+}
+
+size_t serializeJson(const JsonDocument& doc, String& out);
+size_t serializeJson(const JsonDocument& doc, char* out, size_t size);
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef ORACLEBOX_SIM_PREFERENCES_H
+#define ORACLEBOX_SIM_PREFERENCES_H
+
+// NVS key/value store, kept per virtual device.
+
+#include "Arduino.h"
+
+class Preferences {
+public:
+  bool begin(const char* name, bool readOnly = false);
+  void end();
+
+  size_t getBytesLength(const char* key);
+  size_t getBytes(const char* key, void* buf, size_t maxLen);
+  size_t putBytes(const char* key, const void* value, size_t len);
+  uint8_t getUChar(const char* key, uint8_t defaultValue = 0);
+  size_t putUChar(const char* key, uint8_t value);
+
+private:
+  char name_[16] = {0};
+  bool open_ = false;
+  bool readOnly_ = true;
+};
+
+#endif
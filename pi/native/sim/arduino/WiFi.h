@@ -0,0 +1,60 @@
+#ifndef ORACLEBOX_SIM_WIFI_H
+#define ORACLEBOX_SIM_WIFI_H
+
+// WiFi and WiFiClient for fleet_sim. There is one access point and one
+// server, the virtual hub: every connect() reaches it over a link with the
+// fleet's latency model, whatever host and port the sketch names.
+
+#include "Arduino.h"
+
+#define WL_IDLE_STATUS 0
+#define WL_NO_SSID_AVAIL 1
+#define WL_CONNECTED 3
+#define WL_DISCONNECTED 6
+
+#define WIFI_STA 1
+
+class IPAddress : public Printable {
+public:
+  IPAddress() = default;
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : octets_{a, b, c, d} {}
+  String toString() const override;
+
+private:
+  uint8_t octets_[4] = {0, 0, 0, 0};
+};
+
+class WiFiClass {
+public:
+  void mode(int mode);
+  void begin(const char* ssid, const char* password);
+  int status();
+  IPAddress localIP();
+};
+
+extern WiFiClass WiFi;
+
+// Holds a connection number into the running device's connection table, so
+// it stays a plain value in the sketch's globals.
+class WiFiClient {
+public:
+  int connect(const char* host, uint16_t port);
+  int connect(const char* host, uint16_t port, int32_t timeoutMs);
+  void setNoDelay(bool on) { (void)on; }
+  uint8_t connected();
+  int available();
+  int read();
+  size_t write(const uint8_t* buf, size_t len);
+  size_t write(uint8_t b) { return write(&b, 1); }
+  size_t print(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+  size_t print(const String& s) { return write((const uint8_t*)s.c_str(), s.length()); }
+  size_t println(const String& s) { return print(s) + print("\n"); }
+  void flush() {}
+  void stop();
+  explicit operator bool() { return connected(); }
+
+private:
+  int conn_ = -1;
+};
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef ORACLEBOX_SIM_WIRE_H
+#define ORACLEBOX_SIM_WIRE_H
+
+#include "Arduino.h"
+
+// I2C bus; the only I2C device the sketches use (BMP280) is modelled
+// directly in Adafruit_BMP280.h.
+class TwoWire {
+public:
+  bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0) {
+    (void)sda;
+    (void)scl;
+    (void)frequency;
+    return true;
+  }
+};
+
+extern TwoWire Wire;
+
+#endif
@@ -0,0 +1,335 @@
+// The Arduino-ESP32 calls the satellite sketches make, acting on whichever
+// virtual device is running.
+
+#include <cstdio>
+#include <cstring>
+
+#include "Adafruit_BMP280.h"
+#include "Arduino.h"
+#include "Preferences.h"
+#include "WiFi.h"
+#include "Wire.h"
+#include "esp_timer.h"
+#include "virtual_fleet.h"
+
+using oraclebox::sim::VirtualDevice;
+
+namespace {
+
+constexpr int64_t YIELD_US = 100;                 // a trip through the FreeRTOS scheduler
+constexpr int32_t CONNECT_TIMEOUT_MS = 3000;      // WiFiClient default
+
+VirtualDevice& dev() { return VirtualDevice::running(); }
+
+}  // namespace
+
+// Identity of the running device, for DEVICE_ID / LOCATION in the sketches
+namespace oraclebox {
+namespace sim {
+
+const char* deviceId() { return dev().id.c_str(); }
+const char* deviceLocation() { return dev().location.c_str(); }
+
+}  // namespace sim
+}  // namespace oraclebox
+
+// ==================== TIME ====================
+
+unsigned long millis() { return (unsigned long)(dev().localUs() / 1000); }
+
+unsigned long micros() { return (unsigned long)dev().localUs(); }
+
+void delay(unsigned long ms) {
+  VirtualDevice& d = dev();
+  d.sleepUntil(d.nowUs + (int64_t)((double)ms * 1000.0 / d.rate));
+}
+
+void delayMicroseconds(unsigned int us) {
+  VirtualDevice& d = dev();
+  d.sleepUntil(d.nowUs + (int64_t)((double)us / d.rate));
+}
+
+void yield() {
+  VirtualDevice& d = dev();
+  d.sleepUntil(d.nowUs + YIELD_US);
+}
+
+// ==================== GPIO / LEDC ====================
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  (void)pin;
+  (void)mode;
+}
+
+int digitalRead(uint8_t pin) { return dev().readPin(pin) ? HIGH : LOW; }
+
+void digitalWrite(uint8_t pin, uint8_t value) { analogWrite(pin, value ? 255 : 0); }
+
+void analogWrite(uint8_t pin, int value) {
+  if (pin >= 40) return;
+  VirtualDevice& d = dev();
+  uint8_t level = (uint8_t)constrain(value, 0, 255);
+  if (d.pinOut[pin] == level) return;
+  d.pinOut[pin] = level;
+  d.updateLoad();
+}
+
+uint16_t analogRead(uint8_t pin) {
+  (void)pin;
+  return 0;
+}
+
+uint32_t ledcSetup(uint8_t channel, uint32_t freq, uint8_t resolutionBits) {
+  if (channel >= 16 || resolutionBits == 0 || resolutionBits > 20) return 0;
+  dev().ledcMax[channel] = (1u << resolutionBits) - 1;
+  return freq;
+}
+
+void ledcAttachPin(uint8_t pin, uint8_t channel) {
+  if (channel >= 16 || pin >= 40) return;
+  dev().ledcPin[channel] = (int8_t)pin;
+  dev().updateLoad();
+}
+
+void ledcWrite(uint8_t channel, uint32_t duty) {
+  if (channel >= 16) return;
+  VirtualDevice& d = dev();
+  uint32_t oldDuty = d.ledcDuty[channel];
+  if (oldDuty == duty) return;
+  d.ledcDuty[channel] = duty;
+  d.updateLoad();
+  d.onLedcWrite(channel, oldDuty);
+}
+
+uint32_t ledcChangeFrequency(uint8_t channel, uint32_t freq, uint8_t resolutionBits) {
+  return ledcSetup(channel, freq, resolutionBits);
+}
+
+// ==================== MATH ====================
+
+long random(long howBig) {
+  if (howBig <= 0) return 0;
+  return (long)(dev().rng() % (uint64_t)howBig);
+}
+
+long random(long howSmall, long howBig) {
+  if (howSmall >= howBig) return howSmall;
+  return howSmall + random(howBig - howSmall);
+}
+
+void randomSeed(unsigned long seed) {
+  if (seed != 0) dev().rng.seed(seed);
+}
+
+long map(long x, long inMin, long inMax, long outMin, long outMax) {
+  if (inMax == inMin) return outMin;
+  return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+// ==================== STRING / SERIAL ====================
+
+String::String(float v, unsigned decimals) : String((double)v, decimals) {}
+
+String::String(double v, unsigned decimals) {
+  char buf[64];
+  std::snprintf(buf, sizeof(buf), "%.*f", (int)decimals, v);
+  s_ = buf;
+}
+
+HardwareSerial Serial;
+
+void HardwareSerial::begin(unsigned long baud) {
+  (void)baud;
+  dev().serialOpen = true;
+}
+
+void HardwareSerial::end() { dev().serialOpen = false; }
+
+size_t HardwareSerial::print(const char* s) {
+  VirtualDevice& d = dev();
+  size_t len = std::strlen(s);
+  d.fleet->serialWrite(d, s, len);
+  return len;
+}
+
+size_t HardwareSerial::print(char c) {
+  char s[2] = {c, '\0'};
+  return print(s);
+}
+
+size_t HardwareSerial::print(long v, int base) {
+  char buf[40];
+  if (base == HEX) {
+    std::snprintf(buf, sizeof(buf), "%lX", (unsigned long)v);
+  } else {
+    std::snprintf(buf, sizeof(buf), "%ld", v);
+  }
+  return print(buf);
+}
+
+size_t HardwareSerial::print(unsigned long v, int base) {
+  char buf[40];
+  std::snprintf(buf, sizeof(buf), base == HEX ? "%lX" : "%lu", v);
+  return print(buf);
+}
+
+size_t HardwareSerial::print(double v, int digits) {
+  char buf[64];
+  std::snprintf(buf, sizeof(buf), "%.*f", digits, v);
+  return print(buf);
+}
+
+size_t HardwareSerial::print(const Printable& p) { return print(p.toString()); }
+
+// ==================== WIFI ====================
+
+WiFiClass WiFi;
+
+String IPAddress::toString() const {
+  char buf[16];
+  std::snprintf(buf, sizeof(buf), "%u.%u.%u.%u", octets_[0], octets_[1], octets_[2], octets_[3]);
+  return String(buf);
+}
+
+void WiFiClass::mode(int mode) { (void)mode; }
+
+void WiFiClass::begin(const char* ssid, const char* password) {
+  (void)ssid;
+  (void)password;
+  VirtualDevice& d = dev();
+  if (d.wifiBroken || d.wifiUpUs >= 0) return;
+  d.wifiUpUs = d.nowUs + (int64_t)((1.0 + d.uniform()) * 1000000.0);   // scan + auth + DHCP
+}
+
+int WiFiClass::status() {
+  VirtualDevice& d = dev();
+  if (d.wifiUp()) return WL_CONNECTED;
+  return d.wifiBroken ? WL_NO_SSID_AVAIL : WL_DISCONNECTED;
+}
+
+IPAddress WiFiClass::localIP() {
+  VirtualDevice& d = dev();
+  if (!d.wifiUp()) return IPAddress();
+  return IPAddress(10, 0, (uint8_t)((d.index + 2) / 256), (uint8_t)((d.index + 2) % 256));
+}
+
+int WiFiClient::connect(const char* host, uint16_t port) { return connect(host, port, CONNECT_TIMEOUT_MS); }
+
+int WiFiClient::connect(const char* host, uint16_t port, int32_t timeoutMs) {
+  (void)host;
+  (void)port;
+  stop();
+  conn_ = dev().connect(timeoutMs);
+  return conn_ >= 0 ? 1 : 0;
+}
+
+uint8_t WiFiClient::connected() { return dev().connected(conn_) ? 1 : 0; }
+
+int WiFiClient::available() { return dev().available(conn_); }
+
+int WiFiClient::read() { return dev().read(conn_); }
+
+size_t WiFiClient::write(const uint8_t* buf, size_t len) { return dev().send(conn_, buf, len); }
+
+void WiFiClient::stop() {
+  if (conn_ < 0) return;
+  dev().close(conn_);
+  conn_ = -1;
+}
+
+TwoWire Wire;
+
+// ==================== PREFERENCES (NVS) ====================
+
+bool Preferences::begin(const char* name, bool readOnly) {
+  std::snprintf(name_, sizeof(name_), "%s", name);
+  readOnly_ = readOnly;
+  open_ = true;
+  return true;
+}
+
+void Preferences::end() { open_ = false; }
+
+static std::vector<uint8_t>* nvsFind(const char* ns, const char* key) {
+  auto& nvs = dev().nvs;
+  auto it = nvs.find(std::string(ns) + "/" + key);
+  return it == nvs.end() ? nullptr : &it->second;
+}
+
+size_t Preferences::getBytesLength(const char* key) {
+  if (!open_) return 0;
+  std::vector<uint8_t>* v = nvsFind(name_, key);
+  return v ? v->size() : 0;
+}
+
+size_t Preferences::getBytes(const char* key, void* buf, size_t maxLen) {
+  if (!open_) return 0;
+  std::vector<uint8_t>* v = nvsFind(name_, key);
+  if (!v || v->size() > maxLen) return 0;
+  std::memcpy(buf, v->data(), v->size());
+  return v->size();
+}
+
+size_t Preferences::putBytes(const char* key, const void* value, size_t len) {
+  if (!open_ || readOnly_) return 0;
+  const uint8_t* p = (const uint8_t*)value;
+  dev().nvs[std::string(name_) + "/" + key].assign(p, p + len);
+  return len;
+}
+
+uint8_t Preferences::getUChar(const char* key, uint8_t defaultValue) {
+  if (!open_) return defaultValue;
+  std::vector<uint8_t>* v = nvsFind(name_, key);
+  return v && v->size() == 1 ? (*v)[0] : defaultValue;
+}
+
+size_t Preferences::putUChar(const char* key, uint8_t value) { return putBytes(key, &value, 1); }
+
+// ==================== BMP280 ====================
+
+bool Adafruit_BMP280::begin(uint8_t address, uint8_t chipId) {
+  (void)address;
+  (void)chipId;
+  return true;
+}
+
+float Adafruit_BMP280::readTemperature() { return dev().temperatureC(); }
+
+float Adafruit_BMP280::readPressure() { return dev().pressurePa(); }
+
+// ==================== ESP_TIMER ====================
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t* args, esp_timer_handle_t* out) {
+  if (!args || !args->callback || !out) return ESP_ERR_INVALID_ARG;
+  auto timer = std::make_unique<esp_timer>();
+  timer->callback = args->callback;
+  timer->arg = args->arg;
+  *out = timer.get();
+  dev().timers.push_back(std::move(timer));
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeoutUs) {
+  if (!timer) return ESP_ERR_INVALID_ARG;
+  if (timer->dueUs >= 0) return ESP_ERR_INVALID_STATE;
+  timer->dueUs = dev().localUs() + (int64_t)timeoutUs;
+  timer->periodUs = 0;
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t periodUs) {
+  if (!timer || periodUs == 0) return ESP_ERR_INVALID_ARG;
+  if (timer->dueUs >= 0) return ESP_ERR_INVALID_STATE;
+  timer->dueUs = dev().localUs() + (int64_t)periodUs;
+  timer->periodUs = (int64_t)periodUs;
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+  if (!timer) return ESP_ERR_INVALID_ARG;
+  if (timer->dueUs < 0) return ESP_ERR_INVALID_STATE;
+  timer->dueUs = -1;
+  return ESP_OK;
+}
+
+int64_t esp_timer_get_time() { return dev().localUs(); }
@@ -0,0 +1,355 @@
+#include "ArduinoJson.h"
+
+#include <cstdio>
+#include <cstring>
+
+// ==================== TREE ====================
+
+JsonNode* JsonNode::member(const char* key) const {
+  if (type != Object) return nullptr;
+  for (size_t i = 0; i < keys.size(); i++) {
+    if (keys[i] == key) return items[i].get();
+  }
+  return nullptr;
+}
+
+JsonNode* JsonNode::addMember(const char* key) {
+  if (type != Object) {
+    clear();
+    type = Object;
+  }
+  JsonNode* existing = member(key);
+  if (existing) return existing;
+  keys.emplace_back(key);
+  items.push_back(std::make_unique<JsonNode>());
+  return items.back().get();
+}
+
+void JsonNode::clear() {
+  type = Null;
+  s.clear();
+  keys.clear();
+  items.clear();
+}
+
+JsonVariant JsonVariant::operator[](const char* key) const {
+  if (!node_ || node_->type != JsonNode::Object) return JsonVariant();
+  return JsonVariant(node_->member(key));
+}
+
+JsonVariant JsonVariant::operator[](int index) const {
+  if (!node_ || node_->type != JsonNode::Array || index < 0 || (size_t)index >= node_->items.size()) {
+    return JsonVariant();
+  }
+  return JsonVariant(node_->items[index].get());
+}
+
+JsonNode* JsonVariant::writable() {
+  if (!node_ && parent_ && key_) node_ = parent_->addMember(key_);
+  return node_;
+}
+
+JsonVariant& JsonVariant::operator=(const char* value) {
+  JsonNode* n = writable();
+  if (n) {
+    n->clear();
+    n->type = value ? JsonNode::Str : JsonNode::Null;
+    if (value) n->s = value;
+  }
+  return *this;
+}
+
+JsonVariant& JsonVariant::operator=(bool value) {
+  JsonNode* n = writable();
+  if (n) {
+    n->clear();
+    n->type = JsonNode::Bool;
+    n->b = value;
+  }
+  return *this;
+}
+
+template <>
+const char* JsonVariant::as<const char*>() const {
+  return isString() ? node_->s.c_str() : nullptr;
+}
+
+template <>
+String JsonVariant::as<String>() const {
+  return isString() ? String(node_->s) : String();
+}
+
+template <>
+bool JsonVariant::as<bool>() const {
+  if (!node_) return false;
+  if (node_->type == JsonNode::Bool) return node_->b;
+  if (node_->type == JsonNode::Int) return node_->i != 0;
+  return false;
+}
+
+template <>
+JsonVariant JsonVariant::as<JsonVariant>() const {
+  return *this;
+}
+
+// ==================== SERIALIZE ====================
+
+namespace {
+
+void writeString(std::string& out, const std::string& s) {
+  out += '"';
+  for (char c : s) {
+    switch (c) {
+      case '"': out += "\\\""; break;
+      case '\\': out += "\\\\"; break;
+      case '\n': out += "\\n"; break;
+      case '\r': out += "\\r"; break;
+      case '\t': out += "\\t"; break;
+      default:
+        if ((unsigned char)c < 0x20) {
+          char buf[8];
+          std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+          out += buf;
+        } else {
+          out += c;
+        }
+    }
+  }
+  out += '"';
+}
+
+void writeNode(std::string& out, const JsonNode& n) {
+  char buf[32];
+  switch (n.type) {
+    case JsonNode::Null: out += "null"; break;
+    case JsonNode::Bool: out += n.b ? "true" : "false"; break;
+    case JsonNode::Int:
+      std::snprintf(buf, sizeof(buf), "%lld", (long long)n.i);
+      out += buf;
+      break;
+    case JsonNode::Float:
+      std::snprintf(buf, sizeof(buf), "%.9g", n.f);
+      out += buf;
+      break;
+    case JsonNode::Str: writeString(out, n.s); break;
+    case JsonNode::Array:
+      out += '[';
+      for (size_t i = 0; i < n.items.size(); i++) {
+        if (i) out += ',';
+        writeNode(out, *n.items[i]);
+      }
+      out += ']';
+      break;
+    case JsonNode::Object:
+      out += '{';
+      for (size_t i = 0; i < n.items.size(); i++) {
+        if (i) out += ',';
+        writeString(out, n.keys[i]);
+        out += ':';
+        writeNode(out, *n.items[i]);
+      }
+      out += '}';
+      break;
+  }
+}
+
+// ==================== PARSE ====================
+
+class Parser {
+public:
+  Parser(const char* p, size_t len) : p_(p), end_(p + len) {}
+
+  DeserializationError::Code parse(JsonNode& root) {
+    skipSpace();
+    if (p_ == end_) return DeserializationError::EmptyInput;
+    DeserializationError::Code code = value(root, 0);
+    if (code != DeserializationError::Ok) return code;
+    skipSpace();
+    return p_ == end_ ? DeserializationError::Ok : DeserializationError::InvalidInput;
+  }
+
+private:
+  static constexpr int MAX_DEPTH = 10;
+
+  void skipSpace() {
+    while (p_ < end_ && (*p_ == ' ' || *p_ == '\t' || *p_ == '\r' || *p_ == '\n')) p_++;
+  }
+
+  bool literal(const char* word) {
+    size_t n = std::strlen(word);
+    if ((size_t)(end_ - p_) < n || std::memcmp(p_, word, n) != 0) return false;
+    p_ += n;
+    return true;
+  }
+
+  DeserializationError::Code string(std::string& out) {
+    p_++;   // opening quote
+    while (p_ < end_ && *p_ != '"') {
+      char c = *p_++;
+      if (c != '\\') {
+        out += c;
+        continue;
+      }
+      if (p_ == end_) return DeserializationError::IncompleteInput;
+      char e = *p_++;
+      switch (e) {
+        case 'n': out += '\n'; break;
+        case 'r': out += '\r'; break;
+        case 't': out += '\t'; break;
+        case 'b': out += '\b'; break;
+        case 'f': out += '\f'; break;
+        case 'u': {
+          if (end_ - p_ < 4) return DeserializationError::IncompleteInput;
+          unsigned cp = (unsigned)std::strtoul(std::string(p_, 4).c_str(), nullptr, 16);
+          p_ += 4;
+          if (cp < 0x80) {
+            out += (char)cp;
+          } else if (cp < 0x800) {
+            out += (char)(0xC0 | (cp >> 6));
+            out += (char)(0x80 | (cp & 0x3F));
+          } else {
+            out += (char)(0xE0 | (cp >> 12));
+            out += (char)(0x80 | ((cp >> 6) & 0x3F));
+            out += (char)(0x80 | (cp & 0x3F));
+          }
+          break;
+        }
+        default: out += e; break;
+      }
+    }
+    if (p_ == end_) return DeserializationError::IncompleteInput;
+    p_++;   // closing quote
+    return DeserializationError::Ok;
+  }
+
+  DeserializationError::Code number(JsonNode& n) {
+    const char* start = p_;
+    bool isFloat = false;
+    if (p_ < end_ && (*p_ == '-' || *p_ == '+')) p_++;
+    while (p_ < end_) {
+      char c = *p_;
+      if (c >= '0' && c <= '9') {
+        p_++;
+      } else if (c == '.' || c == 'e' || c == 'E' || ((c == '-' || c == '+') && (p_[-1] == 'e' || p_[-1] == 'E'))) {
+        isFloat = true;
+        p_++;
+      } else {
+        break;
+      }
+    }
+    if (p_ == start) return DeserializationError::InvalidInput;
+    std::string text(start, p_ - start);
+    if (isFloat) {
+      n.type = JsonNode::Float;
+      n.f = std::strtod(text.c_str(), nullptr);
+    } else {
+      n.type = JsonNode::Int;
+      n.i = std::strtoll(text.c_str(), nullptr, 10);
+    }
+    return DeserializationError::Ok;
+  }
+
+  DeserializationError::Code value(JsonNode& n, int depth) {
+    if (depth > MAX_DEPTH) return DeserializationError::TooDeep;
+    skipSpace();
+    if (p_ == end_) return DeserializationError::IncompleteInput;
+    char c = *p_;
+    if (c == '{') {
+      p_++;
+      n.type = JsonNode::Object;
+      skipSpace();
+      if (p_ < end_ && *p_ == '}') {
+        p_++;
+        return DeserializationError::Ok;
+      }
+      while (true) {
+        skipSpace();
+        if (p_ == end_) return DeserializationError::IncompleteInput;
+        if (*p_ != '"') return DeserializationError::InvalidInput;
+        std::string key;
+        DeserializationError::Code code = string(key);
+        if (code != DeserializationError::Ok) return code;
+        skipSpace();
+        if (p_ == end_) return DeserializationError::IncompleteInput;
+        if (*p_++ != ':') return DeserializationError::InvalidInput;
+        n.keys.push_back(std::move(key));
+        n.items.push_back(std::make_unique<JsonNode>());
+        code = value(*n.items.back(), depth + 1);
+        if (code != DeserializationError::Ok) return code;
+        skipSpace();
+        if (p_ == end_) return DeserializationError::IncompleteInput;
+        if (*p_ == ',') { p_++; continue; }
+        if (*p_ == '}') { p_++; return DeserializationError::Ok; }
+        return DeserializationError::InvalidInput;
+      }
+    }
+    if (c == '[') {
+      p_++;
+      n.type = JsonNode::Array;
+      skipSpace();
+      if (p_ < end_ && *p_ == ']') {
+        p_++;
+        return DeserializationError::Ok;
+      }
+      while (true) {
+        n.items.push_back(std::make_unique<JsonNode>());
+        DeserializationError::Code code = value(*n.items.back(), depth + 1);
+        if (code != DeserializationError::Ok) return code;
+        skipSpace();
+        if (p_ == end_) return DeserializationError::IncompleteInput;
+        if (*p_ == ',') { p_++; continue; }
+        if (*p_ == ']') { p_++; return DeserializationError::Ok; }
+        return DeserializationError::InvalidInput;
+      }
+    }
+    if (c == '"') {
+      n.type = JsonNode::Str;
+      return string(n.s);
+    }
+    if (literal("true")) { n.type = JsonNode::Bool; n.b = true; return DeserializationError::Ok; }
+    if (literal("false")) { n.type = JsonNode::Bool; n.b = false; return DeserializationError::Ok; }
+    if (literal("null")) { n.type = JsonNode::Null; return DeserializationError::Ok; }
+    return number(n);
+  }
+
+  const char* p_;
+  const char* end_;
+};
+
+}  // namespace
+
+const char* DeserializationError::c_str() const {
+  switch (code_) {
+    case Ok: return "Ok";
+    case EmptyInput: return "EmptyInput";
+    case IncompleteInput: return "IncompleteInput";
+    case InvalidInput: return "InvalidInput";
+    case TooDeep: return "TooDeep";
+  }
+  return "Unknown";
+}
+
+DeserializationError deserializeJson(JsonDocument& doc, const char* input, size_t len) {
+  doc.clear();
+  Parser parser(input, len);
+  DeserializationError::Code code = parser.parse(doc.root());
+  if (code != DeserializationError::Ok) doc.clear();
+  return DeserializationError(code);
+}
+
+size_t serializeJson(const JsonDocument& doc, String& out) {
+  std::string text;
+  writeNode(text, doc.root());
+  out = String(text);
+  return text.size();
+}
+
+size_t serializeJson(const JsonDocument& doc, char* out, size_t size) {
+  std::string text;
+  writeNode(text, doc.root());
+  if (size == 0) return 0;
+  size_t n = text.size() < size - 1 ? text.size() : size - 1;
+  std::memcpy(out, text.data(), n);
+  out[n] = '\0';
+  return n;
+}
@@ -0,0 +1,38 @@
+// The music box sketch (firmware/esp32-rempod-arduino/esp32-musicbox-arduino.ino)
+// built for fleet_sim. Its globals are moved into section sim_musicbox_state
+// after compiling (see CMakeLists.txt) and swapped per virtual device.
+
+#include "Arduino.h"
+#include "ArduinoJson.h"
+#include "Preferences.h"
+#include "WiFi.h"
+#include "esp_timer.h"
+#include "oraclebox_events.h"
+#include "virtual_fleet.h"
+
+namespace oraclebox {
+namespace sim {
+const char* deviceId();
+const char* deviceLocation();
+}  // namespace sim
+}  // namespace oraclebox
+
+#define DEVICE_ID ::oraclebox::sim::deviceId()
+#define LOCATION ::oraclebox::sim::deviceLocation()
+
+namespace sim_musicbox {
+#include "esp32-musicbox-arduino.ino"
+}  // namespace sim_musicbox
+
+extern "C" char __start_sim_musicbox_state[];
+extern "C" char __stop_sim_musicbox_state[];
+
+oraclebox::sim::SketchImage oraclebox::sim::musicboxSketch() {
+  SketchImage image;
+  image.type = "musicbox";
+  image.setup = &sim_musicbox::setup;
+  image.loop = &sim_musicbox::loop;
+  image.stateBegin = __start_sim_musicbox_state;
+  image.stateEnd = __stop_sim_musicbox_state;
+  return image;
+}
@@ -0,0 +1,40 @@
+// The REM pod sketch (firmware/esp32-musicbox-arduino/esp32-rempod-arduino.ino)
+// built for fleet_sim. Its globals are moved into section sim_rempod_state
+// after compiling (see CMakeLists.txt) and swapped per virtual device.
+
+#include "Adafruit_BMP280.h"
+#include "Adafruit_Sensor.h"
+#include "Arduino.h"
+#include "ArduinoJson.h"
+#include "Preferences.h"
+#include "WiFi.h"
+#include "Wire.h"
+#include "oraclebox_events.h"
+#include "virtual_fleet.h"
+
+namespace oraclebox {
+namespace sim {
+const char* deviceId();
+const char* deviceLocation();
+}  // namespace sim
+}  // namespace oraclebox
+
+#define DEVICE_ID ::oraclebox::sim::deviceId()
+#define LOCATION ::oraclebox::sim::deviceLocation()
+
+namespace sim_rempod {
+#include "esp32-rempod-arduino.ino"
+}  // namespace sim_rempod
+
+extern "C" char __start_sim_rempod_state[];
+extern "C" char __stop_sim_rempod_state[];
+
+oraclebox::sim::SketchImage oraclebox::sim::rempodSketch() {
+  SketchImage image;
+  image.type = "rempod";
+  image.setup = &sim_rempod::setup;
+  image.loop = &sim_rempod::loop;
+  image.stateBegin = __start_sim_rempod_state;
+  image.stateEnd = __stop_sim_rempod_state;
+  return image;
+}
@@ -0,0 +1,829 @@
+// Devices swap stacks with _setjmp/_longjmp, which the fortified longjmp
+// would take for stack corruption.
+#undef _FORTIFY_SOURCE
+
+#include "virtual_fleet.h"
+
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include "oraclebox/event_schema.h"
+
+namespace oraclebox {
+namespace sim {
+
+namespace {
+
+VirtualDevice* runningDevice = nullptr;
+
+constexpr size_t STACK_BYTES = 64 * 1024;
+constexpr int64_t SECOND_US = 1000000;
+constexpr int64_t HOUR_US = 3600 * SECOND_US;
+constexpr int AT42_OR_PIR_PIN = 4;   // REM pod AT42 output / music box PIR (both GPIO4)
+constexpr int BUZZER_PIN = 27;       // both sketches
+
+// Rough current draw of an ESP32 dev board running these sketches from an
+// AA pack. Neither sketch sleeps, so the CPU term dominates.
+constexpr double BOARD_MA = 50.0;    // 240 MHz, regulator and USB-serial chip
+constexpr double WIFI_MA = 20.0;     // associated, modem sleep between beacons
+constexpr double LED_MA = 8.0;       // one LED channel at full duty
+constexpr double BUZZER_MA = 30.0;
+constexpr double TX_MAS = 0.25;      // one segment out: radio at ~250 mA for ~1 ms
+constexpr double RX_MAS = 0.1;
+
+const char* const ROOMS[] = {"hallway", "bedroom", "kitchen", "attic", "basement", "nursery", "stairs", "parlor"};
+constexpr int ROOM_COUNT = sizeof(ROOMS) / sizeof(ROOMS[0]);
+
+int64_t exponentialUs(VirtualDevice& dev, double perHour) {
+  if (perHour <= 0.0) return INT64_MAX / 4;
+  double u = std::max(1e-12, dev.uniform());
+  return (int64_t)(-std::log(u) / perHour * (double)HOUR_US);
+}
+
+double percentile(std::vector<double> v, double p) {
+  if (v.empty()) return 0.0;
+  std::sort(v.begin(), v.end());
+  size_t i = (size_t)(p / 100.0 * (double)(v.size() - 1) + 0.5);
+  return v[std::min(i, v.size() - 1)];
+}
+
+bool isProtocolEvent(std::string_view event) {
+  return event == "hello" || event == "time_synced" || event == "reflex_ack" || event == "rules_loaded" ||
+         event == "rules_rejected";
+}
+
+}  // namespace
+
+// ==================== TRACE ====================
+
+bool loadTrace(const std::string& path, std::vector<TraceEntry>& out) {
+  std::ifstream in(path);
+  if (!in) {
+    std::fprintf(stderr, "[SIM] Cannot open trace %s\n", path.c_str());
+    return false;
+  }
+  JsonLine msg;
+  std::string line;
+  int lineNo = 0;
+  while (std::getline(in, line)) {
+    lineNo++;
+    size_t start = line.find_first_not_of(" \t\r");
+    if (start == std::string::npos || line[start] == '#') continue;
+    if (!msg.parse(line)) {
+      std::fprintf(stderr, "[SIM] %s:%d: not a JSON object\n", path.c_str(), lineNo);
+      return false;
+    }
+    TraceEntry e;
+    e.atUs = (int64_t)(msg.num("at_ms") * 1000.0);
+    e.device = std::string(msg.str("device", "*"));
+    if (msg.has("pin")) {
+      e.pin = (int)msg.i64("pin");
+      e.value = (int)msg.i64("value");
+      if (e.pin < 0 || e.pin >= 40) {
+        std::fprintf(stderr, "[SIM] %s:%d: pin must be 0-39\n", path.c_str(), lineNo);
+        return false;
+      }
+    }
+    if (msg.has("temperature_c")) {
+      e.temperatureC = msg.num("temperature_c");
+      e.hasTemperature = true;
+    }
+    if (msg.has("pressure_pa")) {
+      e.pressurePa = msg.num("pressure_pa");
+      e.hasPressure = true;
+    }
+    out.push_back(std::move(e));
+  }
+  std::stable_sort(out.begin(), out.end(), [](const TraceEntry& a, const TraceEntry& b) { return a.atUs < b.atUs; });
+  return true;
+}
+
+// ==================== DEVICE ====================
+
+VirtualDevice& VirtualDevice::running() { return *runningDevice; }
+
+void VirtualDevice::sleepUntil(int64_t t) {
+  for (;;) {
+    esp_timer* next = nullptr;
+    for (auto& timer : timers) {
+      if (timer->dueUs >= 0 && (!next || timer->dueUs < next->dueUs)) next = timer.get();
+    }
+    int64_t timerUs = next ? trueAt(next->dueUs) : INT64_MAX;
+    int64_t stepUs = std::min(t, timerUs);
+    if (stepUs > fleet->horizonUs()) {
+      // Anything could arrive before then; wait for the others to catch up
+      wakeUs = stepUs;
+      fleet->yieldDevice(*this);
+      continue;
+    }
+    if (stepUs > nowUs) nowUs = stepUs;
+    if (!next || timerUs > t) return;
+
+    // Timer callbacks run as the esp_timer task would, between loop() steps
+    if (next->periodUs > 0) {
+      next->dueUs += next->periodUs;
+    } else {
+      next->dueUs = -1;
+    }
+    next->callback(next->arg);
+  }
+}
+
+int VirtualDevice::connect(int32_t timeoutMs) {
+  if (!wifiUp()) {
+    sleepUntil(nowUs + 1000);   // no route: lwIP fails right away
+    return -1;
+  }
+  size_t slot = 0;
+  while (slot < links.size() && links[slot].open) slot++;
+  if (slot == links.size()) links.emplace_back();
+  DeviceLink& link = links[slot];
+  link = DeviceLink();
+
+  // SYN reaches the hub, SYN-ACK comes back; connect() blocks for the round trip
+  int64_t upUs = fleet->upLatencyUs(*this);
+  int64_t downUs = fleet->downLatencyUs();
+  if (upUs + downUs > (int64_t)timeoutMs * 1000) {
+    sleepUntil(nowUs + (int64_t)timeoutMs * 1000);
+    return -1;
+  }
+  link.open = true;
+  link.lastUpUs = nowUs + upUs;
+  link.hubConn = fleet->hub().open(*this, (int)slot, link.lastUpUs);
+  addCharge(TX_MAS + RX_MAS);
+  sleepUntil(nowUs + upUs + downUs);
+  return (int)slot;
+}
+
+size_t VirtualDevice::send(int index, const uint8_t* data, size_t len) {
+  if (index < 0 || index >= (int)links.size() || !links[index].open) return 0;
+  DeviceLink& link = links[index];
+  int64_t atUs = std::max(link.lastUpUs, nowUs + fleet->upLatencyUs(*this));
+  link.lastUpUs = atUs;
+  fleet->hub().deliver(link.hubConn, std::string((const char*)data, len), atUs);
+  addCharge(TX_MAS);
+  return len;
+}
+
+int VirtualDevice::available(int index) {
+  if (index < 0 || index >= (int)links.size()) return 0;
+  DeviceLink& link = links[index];
+  size_t n = 0;
+  size_t skip = link.readPos;
+  for (const DeviceLink::Chunk& chunk : link.inbox) {
+    if (chunk.atUs > nowUs) break;
+    n += chunk.data.size() - skip;
+    skip = 0;
+  }
+  return (int)n;
+}
+
+int VirtualDevice::read(int index) {
+  if (index < 0 || index >= (int)links.size()) return -1;
+  DeviceLink& link = links[index];
+  if (link.inbox.empty() || link.inbox.front().atUs > nowUs) return -1;
+  DeviceLink::Chunk& chunk = link.inbox.front();
+  int c = (uint8_t)chunk.data[link.readPos++];
+  if (link.readPos >= chunk.data.size()) {
+    link.inbox.pop_front();
+    link.readPos = 0;
+  }
+  return c;
+}
+
+bool VirtualDevice::connected(int index) {
+  return index >= 0 && index < (int)links.size() && links[index].open;
+}
+
+void VirtualDevice::close(int index) {
+  if (!connected(index)) return;
+  DeviceLink& link = links[index];
+  fleet->hub().hangUp(link.hubConn, std::max(link.lastUpUs, nowUs + fleet->upLatencyUs(*this)));
+  link.open = false;
+  link.inbox.clear();
+  link.readPos = 0;
+}
+
+// ---- sensors ----
+
+void VirtualDevice::applyTrace() {
+  if (trace.empty()) return;
+  int64_t local = localUs();
+  for (;;) {
+    if (traceNext >= trace.size()) {
+      traceNext = 0;
+      traceLoopUs += tracePeriodUs;
+    }
+    const TraceEntry& e = *trace[traceNext];
+    if (traceLoopUs + e.atUs > local) return;
+    if (e.pin >= 0) tracePin[e.pin] = e.value ? 1 : 0;
+    if (e.hasTemperature) {
+      traceTemperatureC = e.temperatureC;
+      traceTemperature = true;
+    }
+    if (e.hasPressure) {
+      tracePressurePa = e.pressurePa;
+      tracePressure = true;
+    }
+    traceNext++;
+  }
+}
+
+int VirtualDevice::readPin(uint8_t pin) {
+  if (pin >= 40) return 0;
+  applyTrace();
+  if (tracePin[pin] >= 0) return tracePin[pin];
+  if (pin != AT42_OR_PIR_PIN) return pinOut[pin] ? 1 : 0;
+
+  // Synthetic activity: Poisson bursts of 0.5-6 s
+  while (nowUs >= burstEndUs) {
+    burstStartUs = burstEndUs + exponentialUs(*this, fleet->options().activityPerHour);
+    burstEndUs = burstStartUs + (int64_t)((0.5 + 5.5 * uniform()) * (double)SECOND_US);
+  }
+  if (nowUs < burstStartUs) return 0;
+  if (std::strcmp(image->type, "musicbox") == 0) return 1;   // PIR holds its output
+  return uniform() < 0.75 ? 1 : 0;                            // AT42 flickers with the field
+}
+
+float VirtualDevice::temperatureC() {
+  applyTrace();
+  if (traceTemperature) return (float)traceTemperatureC;
+
+  // Slow room drift plus the odd cold spot (a 20-90 s dip of up to 2.5 C)
+  while (nowUs >= coldEndUs) {
+    coldStartUs = coldEndUs + exponentialUs(*this, fleet->options().activityPerHour / 3.0);
+    coldEndUs = coldStartUs + (int64_t)((20.0 + 70.0 * uniform()) * (double)SECOND_US);
+  }
+  double hours = (double)nowUs / (double)HOUR_US;
+  double t = baseTemperatureC + 0.5 * std::sin(2.0 * M_PI * hours / 6.0 + phase);
+  if (nowUs >= coldStartUs) {
+    t -= 2.5 * std::sin(M_PI * (double)(nowUs - coldStartUs) / (double)(coldEndUs - coldStartUs));
+  }
+  return (float)(t + 0.03 * (uniform() - 0.5));
+}
+
+float VirtualDevice::pressurePa() {
+  applyTrace();
+  if (tracePressure) return (float)tracePressurePa;
+  double hours = (double)nowUs / (double)HOUR_US;
+  return (float)(basePressurePa + 150.0 * std::sin(2.0 * M_PI * hours / 12.0 + phase) + 4.0 * (uniform() - 0.5));
+}
+
+// ---- energy ----
+
+void VirtualDevice::settleCharge() {
+  if (nowUs <= chargeAtUs) return;
+  double seconds = (double)(nowUs - chargeAtUs) / (double)SECOND_US;
+  chargeMas += loadMa * seconds;
+  if (wifiUpUs >= 0 && nowUs > wifiUpUs) {
+    double wifiSeconds = (double)(nowUs - std::max(chargeAtUs, wifiUpUs)) / (double)SECOND_US;
+    chargeMas += WIFI_MA * wifiSeconds;
+  }
+  chargeAtUs = nowUs;
+}
+
+// Call after any output changes; charges the old load up to now first
+void VirtualDevice::updateLoad() {
+  settleCharge();
+  bool ledc[40] = {};
+  double ma = BOARD_MA;
+  for (int ch = 0; ch < 16; ch++) {
+    if (ledcPin[ch] < 0 || ledcMax[ch] == 0) continue;
+    ledc[(int)ledcPin[ch]] = true;
+    double duty = (double)ledcDuty[ch] / (double)ledcMax[ch];
+    // A square wave at 50% duty drives the piezo hardest
+    ma += ledcPin[ch] == BUZZER_PIN ? BUZZER_MA * std::min(1.0, 2.0 * duty) : LED_MA * duty;
+  }
+  for (int pin = 0; pin < 40; pin++) {
+    if (!pinOut[pin] || ledc[pin] || pin == AT42_OR_PIR_PIN) continue;
+    ma += (pin == BUZZER_PIN ? BUZZER_MA : LED_MA) * (double)pinOut[pin] / 255.0;
+  }
+  loadMa = ma;
+}
+
+// The first note of a playback round is when the buzzer goes from silent to
+// sounding - on the device's true clock, not its synced estimate
+void VirtualDevice::onLedcWrite(uint8_t channel, uint32_t oldDuty) {
+  if (onsetWatchUs < 0 || nowUs < onsetWatchUs || ledcPin[channel] != BUZZER_PIN) return;
+  if (oldDuty != 0 || ledcDuty[channel] == 0) return;
+  onsetTrueUs = nowUs;
+  onsetWatchUs = -1;
+}
+
+// ==================== HUB ====================
+
+VirtualHub::VirtualHub(Fleet& fleet) : fleet_(fleet) {}
+
+int VirtualHub::open(VirtualDevice& dev, int link, int64_t atUs) {
+  Conn c;
+  c.info.fd = (int)conns_.size();
+  c.info.peer = "10.0.0." + std::to_string(dev.index + 2) + ":" + std::to_string(49152 + link);
+  c.info.connectedUs = hubClock(atUs);
+  c.dev = &dev;
+  c.link = link;
+  c.open = true;
+  conns_.push_back(std::move(c));
+  opens_++;
+  return (int)conns_.size() - 1;
+}
+
+void VirtualHub::deliver(int conn, std::string data, int64_t atUs) {
+  bytesUp_ += (int64_t)data.size();
+  schedule(atUs, conn, 0, std::move(data));
+}
+
+void VirtualHub::hangUp(int conn, int64_t atUs) { schedule(atUs, conn, 1, std::string()); }
+
+void VirtualHub::schedule(int64_t atUs, int conn, int kind, std::string data) {
+  if (atUs < doneUs_) {
+    // Only with --quantum-ms: the sender ran past what the hub already did
+    lateUp_++;
+    atUs = doneUs_;
+  }
+  arrivals_.push(Arrival{atUs, seq_++, conn, kind, std::move(data)});
+}
+
+void VirtualHub::processUntil(int64_t t) {
+  while (!arrivals_.empty() && arrivals_.top().atUs < t) {
+    Arrival a = std::move(const_cast<Arrival&>(arrivals_.top()));
+    arrivals_.pop();
+    nowUs_ = a.atUs;
+
+    if (a.kind == 2) {
+      startRound(a.atUs);
+      continue;
+    }
+    Conn& c = conns_[a.conn];
+    if (a.kind == 1) {
+      c.open = false;
+      if (c.lines == 1) oneShots_++;
+      auto it = openById_.find(c.info.deviceId);
+      if (it != openById_.end()) {
+        std::vector<int>& ids = it->second;
+        ids.erase(std::remove(ids.begin(), ids.end(), a.conn), ids.end());
+      }
+      continue;
+    }
+
+    // Same line splitting as SatelliteLink::readConn()
+    std::string& rx = c.info.rx;
+    rx += a.data;
+    size_t start = 0;
+    for (size_t nl; (nl = rx.find('\n', start)) != std::string::npos; start = nl + 1) {
+      handleLine(c, std::string_view(rx).substr(start, nl - start), a.atUs);
+    }
+    rx.erase(0, start);
+  }
+  doneUs_ = std::max(doneUs_, t);
+}
+
+void VirtualHub::handleLine(Conn& c, std::string_view line, int64_t atUs) {
+  while (!line.empty() && (line.back() == '\r' || line.back() == ' ')) line.remove_suffix(1);
+  if (line.empty()) return;
+  c.lines++;
+  if (!msg_.parse(line)) {
+    malformed_++;
+    return;
+  }
+  int64_t rxUs = hubClock(atUs);
+  c.info.lastSeenUs = rxUs;
+
+  if (c.info.deviceId.empty()) {
+    std::string_view id = msg_.str("id");
+    if (!id.empty()) {
+      c.info.deviceId.assign(id.data(), id.size());
+      c.info.deviceType = std::string(msg_.str("device"));
+      c.info.location = std::string(msg_.str("location"));
+      openById_[c.info.deviceId].push_back(c.info.fd);
+    }
+  }
+
+  TypeStats& type = types_[c.info.deviceType.empty() ? "unknown" : c.info.deviceType];
+  type.lines++;
+  type.events[std::string(msg_.str("event"))]++;
+
+  if (msg_.str("event") == "time_sync") {
+    // Answered on arrival; the hub takes no time to reply
+    push(c, JsonWriter().add("cmd", "time_sync").add("t0", msg_.i64("t0")).add("t1", rxUs).add("t2", rxUs).line());
+    return;
+  }
+  onEvent(c, msg_, atUs);
+}
+
+void VirtualHub::onEvent(Conn& c, const JsonLine& msg, int64_t atUs) {
+  std::string_view event = msg.str("event");
+  int64_t rxUs = hubClock(atUs);
+  VirtualDevice& dev = *c.dev;
+
+  if (event == "hello") {
+    pushDeviceRules(c);
+  } else if (event == "time_synced") {
+    // The device's estimate against the offset it really has
+    int64_t localUs = dev.localAt(atUs);
+    syncErrorsUs.push_back((double)(msg.i64("offset_us") - (rxUs - localUs)));
+    syncRttUs.push_back((double)msg.i64("rtt_us"));
+  } else if (event == "reflex_ack") {
+    router_.onAck(msg, rxUs);
+  } else if (event == "rules_loaded") {
+    rulesLoaded_++;
+  } else if (event == "rules_rejected") {
+    rulesRejected_++;
+  } else if (event == "melody_onset") {
+    if (roundOpen_) round_.reported[&dev] = msg.i64("onset_hub_us");
+    return;
+  }
+  if (isProtocolEvent(event)) return;
+
+  SatelliteEvent ev;
+  bindSatelliteEvent(msg, ev);
+  if (ev.unknownKeys > 0) schemaUnknown_++;
+  if (ev.invalid != 0) schemaInvalid_++;
+  if (ev.has(EventField::Battery)) dev.firmwareBattery = ev.battery;
+  if (event == "low_battery" && dev.lowBatteryAtUs < 0) dev.lowBatteryAtUs = atUs;
+
+  router_.route(*this, c.info, msg, rxUs);
+}
+
+bool VirtualHub::push(Conn& c, std::string_view line) {
+  if (!c.open) return false;
+  VirtualDevice& dev = *c.dev;
+  DeviceLink& link = dev.links[c.link];
+  if (!link.open || link.hubConn != c.info.fd) return false;
+  int64_t atUs = nowUs_ + fleet_.downLatencyUs();
+  if (!link.inbox.empty()) atUs = std::max(atUs, link.inbox.back().atUs);
+  if (atUs < dev.nowUs) fleet_.countLateDown();
+  link.inbox.push_back(DeviceLink::Chunk{atUs, std::string(line)});
+  dev.addCharge(RX_MAS);
+  bytesDown_ += (int64_t)line.size();
+  return true;
+}
+
+bool VirtualHub::sendTo(std::string_view deviceId, std::string_view line) {
+  auto it = openById_.find(std::string(deviceId));
+  if (it == openById_.end() || it->second.empty()) return false;
+  return push(conns_[it->second.back()], line);
+}
+
+int VirtualHub::broadcast(std::string_view deviceType, std::string_view line) {
+  int sent = 0;
+  for (auto& kv : openById_) {
+    for (int id : kv.second) {
+      Conn& c = conns_[id];
+      if (!deviceType.empty() && c.info.deviceType != deviceType) continue;
+      if (push(c, line)) sent++;
+    }
+  }
+  return sent;
+}
+
+// Same as oraclebox_hubd --device-rules: DIR/<id>.json on hello
+void VirtualHub::pushDeviceRules(Conn& c) {
+  if (deviceRulesDir_.empty()) return;
+  std::ifstream in(deviceRulesDir_ + "/" + c.info.deviceId + ".json");
+  if (!in) return;
+  std::stringstream body;
+  body << in.rdbuf();
+  std::string rules = compactJson(body.str());
+  push(c, "{\"cmd\":\"set_rules\",\"rules\":" + rules + "}\n");
+}
+
+// ---- synchronized playback rounds (as hub_standin) ----
+
+void VirtualHub::startRound(int64_t atUs) {
+  if (roundOpen_) closeRound(atUs);
+  const FleetOptions& opt = fleet_.options();
+  round_ = Round();
+  round_.atUs = hubClock(atUs) + (int64_t)opt.leadMs * 1000;
+  // Watch from halfway through the lead time, so a box that starts early
+  // still counts but a melody from before the round does not
+  int64_t watchUs = atUs + (int64_t)opt.leadMs * 500;
+  for (Conn& c : conns_) {
+    if (!c.open || c.info.deviceType != "musicbox") continue;
+    if (std::find(round_.devices.begin(), round_.devices.end(), c.dev) != round_.devices.end()) continue;
+    c.dev->onsetWatchUs = watchUs;
+    c.dev->onsetTrueUs = -1;
+    round_.devices.push_back(c.dev);
+  }
+  round_.sent = broadcast("musicbox", JsonWriter()
+                                          .add("cmd", "play_at")
+                                          .add("melody", "twinkle_star")
+                                          .add("at", round_.atUs)
+                                          .line());
+  roundOpen_ = true;
+  schedule(atUs + (int64_t)(opt.playEveryS * (double)SECOND_US), -1, 2, std::string());
+}
+
+// A round the run ends before T of is dropped, not counted as missed
+void VirtualHub::closeRound(int64_t atUs) {
+  roundOpen_ = false;
+  for (VirtualDevice* dev : round_.devices) dev->onsetWatchUs = -1;
+  if (hubClock(atUs) <= round_.atUs) return;
+  rounds_++;
+  // Onsets in hub time from the true clocks; the boxes' own melody_onset
+  // reports are only checked against them
+  std::vector<int64_t> onsets;
+  for (VirtualDevice* dev : round_.devices) {
+    if (dev->onsetTrueUs < 0) {
+      missedOnsets_++;
+      continue;
+    }
+    int64_t onset = hubClock(dev->onsetTrueUs);
+    onsets.push_back(onset);
+    onsetErrorsMs.push_back(std::fabs((double)(onset - round_.atUs) / 1000.0));
+    auto it = round_.reported.find(dev);
+    if (it != round_.reported.end()) reportErrorsMs.push_back(std::fabs((double)(it->second - onset) / 1000.0));
+  }
+  if (onsets.size() < 2) return;
+  auto range = std::minmax_element(onsets.begin(), onsets.end());
+  spreadsMs.push_back((double)(*range.second - *range.first) / 1000.0);
+}
+
+void VirtualHub::printReport(double hours) const {
+  std::printf("\n=== HUB ===\n");
+  for (const auto& kv : types_) {
+    std::printf("%-10s %lld lines (%.1f/h):", kv.first.c_str(), (long long)kv.second.lines,
+                hours > 0 ? (double)kv.second.lines / hours : 0.0);
+    for (const auto& ev : kv.second.events) {
+      std::printf(" %s %lld", ev.first.empty() ? "(none)" : ev.first.c_str(), (long long)ev.second);
+    }
+    std::printf("\n");
+  }
+  std::printf("Connections:       %lld opened, %lld one-shot fallback(s)\n", (long long)opens_, (long long)oneShots_);
+  std::printf("Traffic:           %.1f KB up, %.1f KB down\n", bytesUp_ / 1024.0, bytesDown_ / 1024.0);
+  std::printf("Schema:            %lld line(s) with unknown keys, %lld with invalid values, %lld malformed\n",
+              (long long)schemaUnknown_, (long long)schemaInvalid_, (long long)malformed_);
+  if (rulesLoaded_ || rulesRejected_) {
+    std::printf("Local rules:       %lld loaded, %lld rejected\n", (long long)rulesLoaded_, (long long)rulesRejected_);
+  }
+  if (!syncErrorsUs.empty()) {
+    std::vector<double> absErr;
+    for (double e : syncErrorsUs) absErr.push_back(std::fabs(e));
+    std::printf("Clock sync:        %zu sync(s), |error| p50 %.0f / p99 %.0f / max %.0f us, RTT p50 %.0f us\n",
+                syncErrorsUs.size(), percentile(absErr, 50), percentile(absErr, 99), percentile(absErr, 100),
+                percentile(syncRttUs, 50));
+  }
+  if (rounds_ > 0) {
+    std::printf("Playback rounds:   %d, onset spread p50 %.3f / max %.3f ms, |error vs T| p50 %.3f / max %.3f ms\n",
+                rounds_, percentile(spreadsMs, 50), percentile(spreadsMs, 100), percentile(onsetErrorsMs, 50),
+                percentile(onsetErrorsMs, 100));
+    std::printf("                   %lld missed onset(s), melody_onset report |error| max %.3f ms\n",
+                (long long)missedOnsets_, percentile(reportErrorsMs, 100));
+  }
+  const ReflexStats& s = router_.stats();
+  if (router_.ruleCount() > 0) {
+    std::printf("Reflexes:          %lld evaluated, %lld fired, %lld suppressed by cooldown\n",
+                (long long)router_.evaluated(), (long long)router_.fired(), (long long)router_.suppressed());
+    if (s.count() > 0) {
+      std::printf("Reflex latency:    %lld acks, mean %.2f / p50 %.1f / p99 %.1f / max %.2f ms\n",
+                  (long long)s.count(), s.meanMs(), s.percentileMs(50), s.percentileMs(99), s.maxMs());
+    }
+  }
+}
+
+// ==================== FLEET ====================
+
+Fleet::Fleet(const FleetOptions& opt) : opt_(opt), hub_(*this), netRng_(opt.seed * 0x9E3779B97F4A7C15ULL + 1) {}
+
+Fleet::~Fleet() {
+  for (auto& dev : devices_) {
+    if (dev->stack) munmap(dev->stack, dev->stackSize);
+  }
+}
+
+bool Fleet::init() {
+  SketchImage sketches[] = {rempodSketch(), musicboxSketch()};
+  for (const SketchImage& sketch : sketches) {
+    auto image = std::make_unique<Image>();
+    image->sketch = sketch;
+    image->initial.assign(sketch.stateBegin, sketch.stateEnd);
+    images_.push_back(std::move(image));
+  }
+  if (!opt_.tracePath.empty() && !loadTrace(opt_.tracePath, trace_)) return false;
+  if (!opt_.rulesPath.empty() && !hub_.loadRules(opt_.rulesPath)) return false;
+  hub_.setDeviceRulesDir(opt_.deviceRulesDir);
+
+  endUs_ = (int64_t)(opt_.hours * (double)HOUR_US);
+  upMinUs_ = std::max<int64_t>(1, (int64_t)(opt_.latencyMs * 1000.0));
+  downMinUs_ = upMinUs_;
+  for (int i = 0; i < opt_.rempods; i++) addDevice(*images_[0], i + 1);
+  for (int i = 0; i < opt_.musicboxes; i++) addDevice(*images_[1], i + 1);
+  if (opt_.playEveryS > 0) hub_.schedule((int64_t)(opt_.playEveryS * (double)SECOND_US), -1, 2, std::string());
+  return true;
+}
+
+void Fleet::addDevice(Image& image, int number) {
+  auto dev = std::make_unique<VirtualDevice>();
+  VirtualDevice& d = *dev;
+  d.index = (int)devices_.size();
+  d.imageIndex = &image == images_[0].get() ? 0 : 1;
+  d.image = &image.sketch;
+  d.fleet = this;
+  char id[24];
+  std::snprintf(id, sizeof(id), "%s_%02d", image.sketch.type, number);
+  d.id = id;
+  d.location = ROOMS[d.index % ROOM_COUNT];
+  if (d.index >= ROOM_COUNT) d.location += "_" + std::to_string(d.index / ROOM_COUNT + 1);
+  d.state = image.initial;
+
+  d.rng.seed(opt_.seed * 1000003ULL + (uint64_t)d.index);
+  d.bootUs = (int64_t)(d.uniform() * 10.0 * (double)SECOND_US);   // staggered power-on
+  d.rate = 1.0 + (d.uniform() * 2.0 - 1.0) * opt_.driftPpm * 1e-6;
+  d.nowUs = d.bootUs;
+  d.wakeUs = d.bootUs;
+  d.chargeAtUs = d.bootUs;
+  d.loadMa = BOARD_MA;
+  d.wifiBroken = d.uniform() < opt_.wifiFail;
+  d.baseTemperatureC = 18.0 + 4.0 * d.uniform();
+  d.basePressurePa = 101325.0 + 600.0 * (d.uniform() - 0.5);
+  d.phase = 2.0 * M_PI * d.uniform();
+  d.burstEndUs = d.bootUs;
+  d.coldEndUs = d.bootUs;
+  std::fill(std::begin(d.ledcPin), std::end(d.ledcPin), -1);
+  std::fill(std::begin(d.tracePin), std::end(d.tracePin), -1);
+  for (const TraceEntry& e : trace_) {
+    if (e.device == "*" || e.device == d.id || e.device == image.sketch.type) d.trace.push_back(&e);
+  }
+  if (!d.trace.empty()) d.tracePeriodUs = d.trace.back()->atUs + SECOND_US;
+
+  d.stackSize = STACK_BYTES;
+  d.stack = mmap(nullptr, d.stackSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK,
+                 -1, 0);
+  if (d.stack == MAP_FAILED) {
+    std::fprintf(stderr, "[SIM] Out of memory for device stacks\n");
+    std::abort();
+  }
+  mprotect(d.stack, 4096, PROT_NONE);   // guard page: overflow faults instead of corrupting
+  getcontext(&d.entry);
+  d.entry.uc_stack.ss_sp = d.stack;
+  d.entry.uc_stack.ss_size = d.stackSize;
+  d.entry.uc_link = nullptr;
+  makecontext(&d.entry, &Fleet::deviceMain, 0);
+  devices_.push_back(std::move(dev));
+}
+
+VirtualDevice* Fleet::findDevice(std::string_view id) {
+  for (auto& dev : devices_) {
+    if (dev->id == id) return dev.get();
+  }
+  return nullptr;
+}
+
+int64_t Fleet::upLatencyUs(VirtualDevice& dev) {
+  (void)dev;
+  return upMinUs_ + (int64_t)(std::uniform_real_distribution<double>(0.0, opt_.jitterMs * 1000.0)(netRng_));
+}
+
+int64_t Fleet::downLatencyUs() {
+  return downMinUs_ + (int64_t)(std::uniform_real_distribution<double>(0.0, opt_.jitterMs * 1000.0)(netRng_));
+}
+
+// ---- coroutines ----
+
+void Fleet::deviceMain() {
+  VirtualDevice& dev = *runningDevice;
+  dev.image->setup();
+  for (;;) dev.image->loop();
+}
+
+void Fleet::yieldDevice(VirtualDevice& dev) {
+  if (!_setjmp(dev.resumeAt)) _longjmp(scheduler_, 1);
+}
+
+void Fleet::resume(VirtualDevice& dev) {
+  Image& image = *images_[dev.imageIndex];
+  if (image.owner != &dev) {
+    size_t size = (size_t)(image.sketch.stateEnd - image.sketch.stateBegin);
+    if (image.owner) std::memcpy(image.owner->state.data(), image.sketch.stateBegin, size);
+    std::memcpy(image.sketch.stateBegin, dev.state.data(), size);
+    image.owner = &dev;
+  }
+  runningDevice = &dev;
+  switches_++;
+  if (!_setjmp(scheduler_)) {
+    if (!dev.started) {
+      dev.started = true;
+      ucontext_t here;
+      swapcontext(&here, &dev.entry);   // never returns; the device comes back through scheduler_
+    } else {
+      _longjmp(dev.resumeAt, 1);
+    }
+  }
+  runningDevice = nullptr;
+}
+
+void Fleet::run() {
+  using Wake = std::pair<int64_t, int>;
+  std::priority_queue<Wake, std::vector<Wake>, std::greater<Wake>> ready;
+  for (auto& dev : devices_) ready.push({dev->wakeUs, dev->index});
+
+  int64_t quantumUs = (int64_t)(opt_.quantumMs * 1000.0);
+  int64_t nextProgressUs = HOUR_US;
+  auto wallStart = std::chrono::steady_clock::now();
+  while (!ready.empty()) {
+    Wake next = ready.top();
+    ready.pop();
+    if (next.first >= endUs_) continue;
+
+    if (!opt_.quiet && next.first >= nextProgressUs) {
+      double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+      std::printf("[SIM] %.0f h simulated in %.1f s\n", (double)nextProgressUs / (double)HOUR_US, wall);
+      std::fflush(stdout);
+      nextProgressUs += HOUR_US;
+    }
+
+    // Everything that reaches the hub before the slowest device could send
+    // again is known; nothing the hub sends from then on lands before the horizon
+    hub_.processUntil(next.first + upMinUs_);
+    horizonUs_ = std::min(endUs_, next.first + std::max(upMinUs_ + downMinUs_, quantumUs));
+
+    VirtualDevice& dev = *devices_[next.second];
+    resume(dev);
+    ready.push({dev.wakeUs, dev.index});
+  }
+  hub_.processUntil(endUs_);
+  if (hub_.roundOpen_) hub_.closeRound(endUs_);
+  for (auto& dev : devices_) {
+    dev->nowUs = endUs_;
+    dev->settleCharge();
+  }
+  wallSeconds_ = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+}
+
+void Fleet::serialWrite(VirtualDevice& dev, const char* s, size_t len) {
+  if (!dev.serialOpen || opt_.serialId.empty() || dev.id != opt_.serialId) return;
+  for (size_t i = 0; i < len; i++) {
+    if (dev.serialLineStart) {
+      int64_t ms = dev.nowUs / 1000;
+      std::printf("[SERIAL] %02lld:%02lld:%02lld.%03lld %s | ", (long long)(ms / 3600000), (long long)(ms / 60000 % 60),
+                  (long long)(ms / 1000 % 60), (long long)(ms % 1000), dev.id.c_str());
+      dev.serialLineStart = false;
+    }
+    std::putchar(s[i]);
+    if (s[i] == '\n') dev.serialLineStart = true;
+  }
+}
+
+void Fleet::printReport() const {
+  double deviceHours = 0.0;
+  for (const auto& dev : devices_) deviceHours += (double)(endUs_ - dev->bootUs) / (double)HOUR_US;
+  double simHours = (double)endUs_ / (double)HOUR_US;
+
+  std::printf("\n=== FLEET SIMULATION ===\n");
+  std::printf("Devices:           %d REM pod(s), %d music box(es), %.1f h each\n", opt_.rempods, opt_.musicboxes,
+              simHours);
+  std::printf("Network:           %.1f ms + up to %.1f ms one way%s\n", opt_.latencyMs, opt_.jitterMs,
+              opt_.quantumMs > 0 ? "" : ", exact ordering");
+  std::printf("Wall time:         %.1f s, %.0f device-hours/min, %llu context switches\n", wallSeconds_,
+              wallSeconds_ > 0 ? deviceHours / (wallSeconds_ / 60.0) : 0.0, (unsigned long long)switches_);
+  if (opt_.quantumMs > 0) {
+    std::printf("Quantum %.0f ms:     %llu line(s) reached the hub late, %llu reached a device late\n", opt_.quantumMs,
+                (unsigned long long)hub_.lateUp_, (unsigned long long)lateDown_);
+  }
+
+  hub_.printReport(simHours);
+
+  std::printf("\n=== ENERGY (model, %.0f mAh pack) ===\n", opt_.batteryMah);
+  for (const auto& image : images_) {
+    double sumMa = 0.0, maxMa = 0.0;
+    int n = 0, lowReported = 0, offline = 0;
+    double lowSum = 0.0;
+    int batteryMin = 101;
+    for (const auto& dev : devices_) {
+      if (dev->image != &image->sketch) continue;
+      double hours = (double)(endUs_ - dev->bootUs) / (double)HOUR_US;
+      if (hours <= 0) continue;
+      double ma = dev->chargeMas / 3600.0 / hours;
+      sumMa += ma;
+      maxMa = std::max(maxMa, ma);
+      n++;
+      if (dev->wifiBroken) offline++;
+      if (dev->firmwareBattery >= 0) batteryMin = std::min(batteryMin, dev->firmwareBattery);
+      if (dev->lowBatteryAtUs >= 0) {
+        lowReported++;
+        lowSum += (double)(dev->lowBatteryAtUs - dev->bootUs) / (double)HOUR_US;
+      }
+    }
+    if (n == 0) continue;
+    double meanMa = sumMa / n;
+    std::printf("%-10s mean %.1f mA (max %.1f), %.1f h on a charge", image->sketch.type, meanMa, maxMa,
+                meanMa > 0 ? opt_.batteryMah / meanMa : 0.0);
+    if (offline) std::printf(", %d never joined WiFi", offline);
+    std::printf("\n");
+    if (lowReported) {
+      std::printf("           firmware reported low_battery after %.1f h on average (%d device(s))\n",
+                  lowSum / lowReported, lowReported);
+    } else if (batteryMin <= 100) {
+      std::printf("           firmware battery lowest reported %d%%, no low_battery yet\n", batteryMin);
+    }
+  }
+}
+
+}  // namespace sim
+}  // namespace oraclebox
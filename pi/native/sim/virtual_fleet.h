@@ -0,0 +1,378 @@
+#ifndef ORACLEBOX_SIM_VIRTUAL_FLEET_H
+#define ORACLEBOX_SIM_VIRTUAL_FLEET_H
+
+// Digital twin of a satellite fleet for fleet_sim.
+//
+// The real REM pod and music box sketches are compiled for Linux against the
+// Arduino shim in sim/arduino and linked in once each. Their globals are
+// moved into one section per sketch (objcopy, see CMakeLists.txt), so any
+// number of virtual devices can share the code: each device keeps its own
+// copy of the section and the scheduler swaps it in before the device runs.
+//
+// Every device is a coroutine on its own small stack with its own virtual
+// clock (boot time and crystal drift). delay() and friends advance that
+// clock; a device only hands the CPU back when it gets past the point up to
+// which everything it could receive is already known (conservative
+// lookahead: nothing sent at or after the slowest device's time can reach
+// anyone sooner than one network round trip later), so event order, time
+// sync and latency come out as if every device ran in real time.
+
+#include <setjmp.h>
+#include <ucontext.h>
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <queue>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "esp_timer.h"
+#include "oraclebox/json_line.h"
+#include "oraclebox/reflex_router.h"
+#include "oraclebox/satellite_link.h"
+
+// esp_timer_handle_t points at one of these, owned by the device that made it
+struct esp_timer {
+  esp_timer_cb_t callback = nullptr;
+  void* arg = nullptr;
+  int64_t dueUs = -1;      // device clock, -1 = stopped
+  int64_t periodUs = 0;    // 0 = one-shot
+};
+
+namespace oraclebox {
+namespace sim {
+
+// One satellite sketch linked into fleet_sim (sim/*_sketch.cpp)
+struct SketchImage {
+  const char* type = "";
+  void (*setup)() = nullptr;
+  void (*loop)() = nullptr;
+  char* stateBegin = nullptr;   // the sketch's globals
+  char* stateEnd = nullptr;
+};
+
+SketchImage rempodSketch();
+SketchImage musicboxSketch();
+
+struct FleetOptions {
+  int rempods = 4;
+  int musicboxes = 4;
+  double hours = 1.0;             // simulated time
+  double latencyMs = 2.0;         // one way, minimum
+  double jitterMs = 1.0;          // plus uniform 0..jitter
+  double quantumMs = 0.0;         // > 0 lets devices run this far ahead (faster, approximate)
+  double wifiFail = 0.0;          // fraction of devices that never join the network
+  double activityPerHour = 4.0;   // synthetic activity bursts per device
+  double driftPpm = 20.0;         // crystal error, +/-
+  double batteryMah = 2500.0;
+  double playEveryS = 0.0;        // play_at rounds for the music boxes, 0 = none
+  int leadMs = 500;
+  uint64_t seed = 1;
+  std::string tracePath;
+  std::string rulesPath;
+  std::string deviceRulesDir;
+  std::string serialId;           // echo this device's Serial output
+  bool quiet = false;
+};
+
+// A recorded sensor trace line:
+//   {"at_ms":1500,"device":"rempod","pin":4,"value":1}
+//   {"at_ms":60000,"device":"rempod_02","temperature_c":17.5}
+// at_ms is device time since boot; device is an id, a type or "*". Each pin
+// or reading holds its value until the device's next entry for it, and the
+// trace repeats one second after its last entry.
+struct TraceEntry {
+  int64_t atUs = 0;
+  std::string device;
+  int pin = -1;
+  int value = 0;
+  double temperatureC = 0.0;
+  double pressurePa = 0.0;
+  bool hasTemperature = false;
+  bool hasPressure = false;
+};
+
+bool loadTrace(const std::string& path, std::vector<TraceEntry>& out);
+
+class Fleet;
+
+// ==================== DEVICE ====================
+
+// One WiFiClient connection as the device sees it
+struct DeviceLink {
+  struct Chunk {
+    int64_t atUs;          // arrival, true time
+    std::string data;
+  };
+
+  bool open = false;
+  int hubConn = -1;
+  int64_t lastUpUs = 0;    // arrival of the last byte sent (TCP keeps order)
+  std::deque<Chunk> inbox; // hub -> device
+  size_t readPos = 0;      // into inbox.front()
+};
+
+struct VirtualDevice {
+  // Which device is running (the one the Arduino shim acts on)
+  static VirtualDevice& running();
+
+  int index = 0;
+  int imageIndex = 0;
+  const SketchImage* image = nullptr;
+  Fleet* fleet = nullptr;
+  std::string id;
+  std::string location;
+  std::vector<char> state;   // the sketch's globals while another device owns the section
+
+  // Coroutine
+  void* stack = nullptr;
+  size_t stackSize = 0;
+  ucontext_t entry;
+  jmp_buf resumeAt;
+  bool started = false;
+
+  // Clock: local = (true - boot) * rate
+  int64_t bootUs = 0;
+  double rate = 1.0;
+  int64_t nowUs = 0;         // true time of the device's execution point
+  int64_t wakeUs = 0;
+  int64_t localAt(int64_t t) const { return (int64_t)((double)(t - bootUs) * rate); }
+  int64_t localUs() const { return localAt(nowUs); }
+  // First true time whose local reading has reached `local` (a timer due
+  // then must see itself due, or it re-arms forever)
+  int64_t trueAt(int64_t local) const {
+    int64_t t = bootUs + (int64_t)((double)local / rate);
+    while (localAt(t) < local) t++;
+    return t;
+  }
+
+  // Sleeps (runs timers) until true time t, handing the CPU back as needed
+  void sleepUntil(int64_t t);
+
+  // Hardware
+  uint8_t pinOut[40] = {};
+  int8_t ledcPin[16];
+  uint32_t ledcDuty[16] = {};
+  uint32_t ledcMax[16] = {};
+  std::vector<std::unique_ptr<esp_timer>> timers;
+  std::map<std::string, std::vector<uint8_t>> nvs;
+  bool serialOpen = false;
+  bool serialLineStart = true;
+
+  // Network
+  bool wifiBroken = false;   // never associates
+  int64_t wifiUpUs = -1;     // association time, -1 = WiFi.begin() not called
+  bool wifiUp() const { return wifiUpUs >= 0 && nowUs >= wifiUpUs; }
+  std::vector<DeviceLink> links;
+  int connect(int32_t timeoutMs);
+  size_t send(int link, const uint8_t* data, size_t len);
+  int available(int link);
+  int read(int link);
+  bool connected(int link);
+  void close(int link);
+
+  // Sensors
+  std::mt19937_64 rng;
+  double uniform() { return std::uniform_real_distribution<double>(0.0, 1.0)(rng); }
+  int readPin(uint8_t pin);
+  float temperatureC();
+  float pressurePa();
+  int64_t burstStartUs = 0;   // synthetic activity
+  int64_t burstEndUs = 0;
+  int64_t coldStartUs = 0;    // synthetic cold spot
+  int64_t coldEndUs = 0;
+  double baseTemperatureC = 20.0;
+  double basePressurePa = 101325.0;
+  double phase = 0.0;
+  std::vector<const TraceEntry*> trace;
+  size_t traceNext = 0;
+  int64_t traceLoopUs = 0;     // local time the current pass started
+  int64_t tracePeriodUs = 0;
+  int tracePin[40];
+  double traceTemperatureC = 0.0;
+  double tracePressurePa = 0.0;
+  bool traceTemperature = false;
+  bool tracePressure = false;
+  void applyTrace();
+
+  // Energy
+  double loadMa = 0.0;
+  double chargeMas = 0.0;      // mA*s drawn since boot
+  int64_t chargeAtUs = 0;
+  void updateLoad();
+  void addCharge(double mAs) { chargeMas += mAs; }
+  void settleCharge();
+
+  // Playback rounds: true time the buzzer first starts sounding at or after
+  // onsetWatchUs (both -1 when not watching / not heard yet)
+  int64_t onsetWatchUs = -1;
+  int64_t onsetTrueUs = -1;
+  void onLedcWrite(uint8_t channel, uint32_t oldDuty);
+
+  // Hub's view, for the report
+  int firmwareBattery = -1;
+  int64_t lowBatteryAtUs = -1;  // first low_battery event, true time
+};
+
+// ==================== HUB ====================
+
+// The hub end of the simulated network: what SatelliteLink and
+// oraclebox_hubd do with satellite lines, on the fleet's virtual time.
+// time_sync is answered like SatelliteLink does, reflexes go through the
+// real ReflexRouter, and sensor events are checked against the schema.
+class VirtualHub : public CommandSink {
+public:
+  static constexpr int64_t EPOCH_US = 3600LL * 1000000LL;   // hub clock at t = 0
+
+  explicit VirtualHub(Fleet& fleet);
+
+  bool loadRules(const std::string& path) { return router_.loadFile(path); }
+  void setDeviceRulesDir(const std::string& dir) { deviceRulesDir_ = dir; }
+
+  // Called by devices (true times)
+  int open(VirtualDevice& dev, int link, int64_t atUs);
+  void deliver(int conn, std::string data, int64_t atUs);
+  void hangUp(int conn, int64_t atUs);
+
+  // Handles everything that arrives before t
+  void processUntil(int64_t t);
+  int64_t hubClock(int64_t t) const { return t + EPOCH_US; }
+
+  // CommandSink
+  bool sendTo(std::string_view deviceId, std::string_view line) override;
+  int broadcast(std::string_view deviceType, std::string_view line) override;
+
+  void printReport(double hours) const;
+
+private:
+  struct Conn {
+    SatelliteConn info;
+    VirtualDevice* dev = nullptr;
+    int link = -1;
+    bool open = false;
+    int lines = 0;
+  };
+  struct Arrival {
+    int64_t atUs;
+    uint64_t seq;
+    int conn;         // -1 = hub timer
+    int kind;         // 0 data, 1 hang-up, 2 timer
+    std::string data;
+    bool operator>(const Arrival& o) const { return atUs != o.atUs ? atUs > o.atUs : seq > o.seq; }
+  };
+  struct Round {
+    int64_t atUs = 0;   // hub clock
+    int sent = 0;
+    std::vector<VirtualDevice*> devices;             // watched for the onset
+    std::map<VirtualDevice*, int64_t> reported;      // melody_onset's onset_hub_us
+  };
+  struct TypeStats {
+    int64_t lines = 0;
+    std::map<std::string, int64_t> events;
+  };
+
+  void schedule(int64_t atUs, int conn, int kind, std::string data);
+  void handleLine(Conn& c, std::string_view line, int64_t atUs);
+  void onEvent(Conn& c, const JsonLine& msg, int64_t atUs);
+  void startRound(int64_t atUs);
+  void closeRound(int64_t atUs);
+  bool push(Conn& c, std::string_view line);
+  void pushDeviceRules(Conn& c);
+
+  Fleet& fleet_;
+  std::vector<Conn> conns_;
+  std::unordered_map<std::string, std::vector<int>> openById_;   // newest last
+  std::priority_queue<Arrival, std::vector<Arrival>, std::greater<Arrival>> arrivals_;
+  uint64_t seq_ = 0;
+  int64_t doneUs_ = 0;
+  int64_t nowUs_ = 0;          // true time of the line being handled
+  JsonLine msg_;
+  ReflexRouter router_;
+  std::string deviceRulesDir_;
+
+  std::map<std::string, TypeStats> types_;
+  int64_t opens_ = 0;
+  int64_t oneShots_ = 0;
+  int64_t bytesUp_ = 0;
+  int64_t bytesDown_ = 0;
+  int64_t lateUp_ = 0;
+  int64_t schemaUnknown_ = 0;
+  int64_t schemaInvalid_ = 0;
+  int64_t malformed_ = 0;
+  int64_t rulesLoaded_ = 0;
+  int64_t rulesRejected_ = 0;
+  std::vector<double> syncErrorsUs;   // reported offset - true offset
+  std::vector<double> syncRttUs;
+  std::vector<double> spreadsMs;
+  std::vector<double> onsetErrorsMs;      // true onset vs T
+  std::vector<double> reportErrorsMs;     // reported onset vs true onset
+  int64_t missedOnsets_ = 0;
+  Round round_;
+  bool roundOpen_ = false;
+  int rounds_ = 0;
+
+  friend class Fleet;
+};
+
+// ==================== FLEET ====================
+
+class Fleet {
+public:
+  explicit Fleet(const FleetOptions& opt);
+  ~Fleet();
+
+  bool init();
+  // Runs until every device reaches the end time
+  void run();
+  void printReport() const;
+
+  const FleetOptions& options() const { return opt_; }
+  VirtualHub& hub() { return hub_; }
+  std::vector<std::unique_ptr<VirtualDevice>>& devices() { return devices_; }
+  VirtualDevice* findDevice(std::string_view id);
+
+  // Network model, true times
+  int64_t upLatencyUs(VirtualDevice& dev);
+  int64_t downLatencyUs();
+  int64_t horizonUs() const { return horizonUs_; }
+  void countLateDown() { lateDown_++; }
+
+  // Hands the CPU from the running device back to the scheduler
+  void yieldDevice(VirtualDevice& dev);
+  void serialWrite(VirtualDevice& dev, const char* s, size_t len);
+
+private:
+  struct Image {
+    SketchImage sketch;
+    std::vector<char> initial;   // globals after static initialization
+    VirtualDevice* owner = nullptr;
+  };
+
+  void addDevice(Image& image, int number);
+  void resume(VirtualDevice& dev);
+  static void deviceMain();
+
+  FleetOptions opt_;
+  VirtualHub hub_;
+  std::vector<std::unique_ptr<Image>> images_;
+  std::vector<std::unique_ptr<VirtualDevice>> devices_;
+  std::vector<TraceEntry> trace_;
+  std::mt19937_64 netRng_;
+  jmp_buf scheduler_;
+  int64_t endUs_ = 0;
+  int64_t horizonUs_ = 0;
+  int64_t upMinUs_ = 0;
+  int64_t downMinUs_ = 0;
+  uint64_t switches_ = 0;
+  uint64_t lateDown_ = 0;
+  double wallSeconds_ = 0.0;
+};
+
+}  // namespace sim
+}  // namespace oraclebox
+
+#endif
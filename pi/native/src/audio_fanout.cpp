@@ -0,0 +1,237 @@
+#include "oraclebox/audio_fanout.h"
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
+#include "oraclebox/hub_clock.h"
+
+namespace oraclebox {
+
+// ==================== BLOCK POOL ====================
+
+BlockPool::BlockPool(size_t blocks, size_t maxFrames)
+    : count_(blocks), maxFrames_(maxFrames), storage_(blocks * maxFrames * 2), blocks_(new AudioBlock[blocks]) {
+  for (size_t i = 0; i < blocks; i++) blocks_[i].samples = storage_.data() + i * maxFrames * 2;
+}
+
+AudioBlock* BlockPool::acquire() {
+  // Round robin from the last one taken: the oldest blocks are the likeliest
+  // to have been released
+  for (size_t k = 0; k < count_; k++) {
+    size_t i = (next_ + k) % count_;
+    AudioBlock& b = blocks_[i];
+    // Acquire pairs with the last holder's release, so its reads are done
+    // before the block is written again
+    if (b.refs.load(std::memory_order_acquire) != 0) continue;
+    b.refs.store(1, std::memory_order_relaxed);
+    b.frames = 0;
+    next_ = i + 1;
+    return &b;
+  }
+  return nullptr;
+}
+
+size_t BlockPool::inUse() const {
+  size_t n = 0;
+  for (size_t i = 0; i < count_; i++)
+    if (blocks_[i].refs.load(std::memory_order_relaxed) != 0) n++;
+  return n;
+}
+
+// ==================== SINKS ====================
+
+bool FdSink::write(const int16_t* samples, size_t frames) {
+  const char* p = reinterpret_cast<const char*>(samples);
+  size_t n = frames * 4;
+  while (n > 0) {
+    ssize_t w = ::write(fd_, p, n);
+    if (w < 0 && errno == EINTR) continue;
+    if (w <= 0) return false;
+    p += w;
+    n -= (size_t)w;
+  }
+  return true;
+}
+
+PipeSink::PipeSink(const std::string& command) : FdSink(-1), pipe_(popen(command.c_str(), "we")) {
+  if (!pipe_) std::fprintf(stderr, "[FX] sink %s: %s\n", command.c_str(), std::strerror(errno));
+  else fd_ = fileno(pipe_);
+}
+
+PipeSink::~PipeSink() {
+  if (pipe_) pclose(pipe_);
+}
+
+bool PcmSink::open(const std::string& device, int rate) {
+  // 10 ms periods, as the blocks arrive
+  return out_.open(device, rate, rate / 100, 4);
+}
+
+bool PcmSink::write(const int16_t* samples, size_t frames) { return out_.write(samples, (int)frames); }
+
+namespace {
+
+void putLe32(uint8_t* p, uint32_t v) {
+  for (int i = 0; i < 4; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+void putLe16(uint8_t* p, uint16_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+
+}  // namespace
+
+WavRecorder::~WavRecorder() { close(); }
+
+bool WavRecorder::open(const std::string& path, int rate) {
+  close();
+  f_ = std::fopen(path.c_str(), "wb");
+  if (!f_) {
+    std::fprintf(stderr, "[FX] record %s: %s\n", path.c_str(), std::strerror(errno));
+    return false;
+  }
+  rate_ = rate;
+  dataBytes_ = sinceHeader_ = 0;
+  updateHeader();
+  return true;
+}
+
+void WavRecorder::updateHeader() {
+  // 44-byte PCM header; the sizes cap at 4 GB, as the format does
+  uint32_t data = dataBytes_ > 0xFFFFFFFFull - 36 ? 0xFFFFFFFFu - 36 : (uint32_t)dataBytes_;
+  uint8_t h[44];
+  std::memcpy(h, "RIFF", 4);
+  putLe32(h + 4, 36 + data);
+  std::memcpy(h + 8, "WAVEfmt ", 8);
+  putLe32(h + 16, 16);
+  putLe16(h + 20, 1);                        // PCM
+  putLe16(h + 22, 2);
+  putLe32(h + 24, (uint32_t)rate_);
+  putLe32(h + 28, (uint32_t)rate_ * 4);      // byte rate
+  putLe16(h + 32, 4);                        // block align
+  putLe16(h + 34, 16);
+  std::memcpy(h + 36, "data", 4);
+  putLe32(h + 40, data);
+  long end = std::ftell(f_);
+  std::fseek(f_, 0, SEEK_SET);
+  std::fwrite(h, 1, sizeof(h), f_);
+  if (end > (long)sizeof(h)) std::fseek(f_, end, SEEK_SET);
+  std::fflush(f_);
+  sinceHeader_ = 0;
+}
+
+bool WavRecorder::write(const int16_t* samples, size_t frames) {
+  if (!f_) return false;
+  // S16 LE on disk, as in memory on the Pi
+  if (std::fwrite(samples, 4, frames, f_) != frames) {
+    std::fprintf(stderr, "[FX] record: %s\n", std::strerror(errno));
+    return false;
+  }
+  dataBytes_ += frames * 4;
+  sinceHeader_ += frames;
+  if (sinceHeader_ >= (uint64_t)rate_) updateHeader();
+  return true;
+}
+
+void WavRecorder::close() {
+  if (!f_) return;
+  updateHeader();
+  std::fclose(f_);
+  f_ = nullptr;
+}
+
+// ==================== FAN-OUT ====================
+
+AudioFanout::~AudioFanout() { stop(); }
+
+size_t AudioFanout::add(std::string name, std::unique_ptr<AudioSink> sink) {
+  auto s = std::make_unique<Sink>();
+  s->name = std::move(name);
+  s->out = std::move(sink);
+  s->wakeFd = eventfd(0, EFD_CLOEXEC);
+  if (s->wakeFd < 0) std::fprintf(stderr, "[FX] sink %s: eventfd: %s\n", s->name.c_str(), std::strerror(errno));
+  sinks_.push_back(std::move(s));
+  return sinks_.size() - 1;
+}
+
+void AudioFanout::start() {
+  if (started_) return;
+  started_ = true;
+  quit_.store(false);
+  for (auto& s : sinks_) s->thread = std::thread(&AudioFanout::run, this, std::ref(*s));
+}
+
+void AudioFanout::stop() {
+  if (!started_) return;
+  quit_.store(true);
+  uint64_t one = 1;
+  for (auto& s : sinks_) {
+    if (s->wakeFd >= 0 && ::write(s->wakeFd, &one, sizeof(one)) < 0) {
+    }
+  }
+  for (auto& s : sinks_) {
+    if (s->thread.joinable()) s->thread.join();
+    if (s->wakeFd >= 0) ::close(s->wakeFd);
+    s->wakeFd = -1;
+  }
+  started_ = false;
+}
+
+void AudioFanout::publish(AudioBlock* b) {
+  b->timeUs = hubNowUs();
+  uint64_t one = 1;
+  for (auto& s : sinks_) {
+    BlockPool::retain(b);
+    if (!s->queue.push(b)) {
+      BlockPool::release(b);
+      s->dropped.fetch_add(1, std::memory_order_relaxed);
+      continue;
+    }
+    if (::write(s->wakeFd, &one, sizeof(one)) < 0) {
+    }
+  }
+  BlockPool::release(b);
+}
+
+void AudioFanout::run(Sink& s) {
+  for (;;) {
+    // Everything queued first, so stop() lets the sink finish
+    AudioBlock* b;
+    while (s.queue.pop(b)) {
+      if (!s.failed.load(std::memory_order_relaxed) && !s.out->write(b->samples, b->frames)) {
+        std::fprintf(stderr, "[FX] sink %s failed; its blocks are dropped from now on\n", s.name.c_str());
+        s.failed.store(true, std::memory_order_relaxed);
+      }
+      if (s.failed.load(std::memory_order_relaxed)) s.dropped.fetch_add(1, std::memory_order_relaxed);
+      else s.written.fetch_add(1, std::memory_order_relaxed);
+      BlockPool::release(b);
+    }
+    if (quit_.load()) break;
+    // Rung after every push, so a block pushed after the loop above is
+    // never slept through. Without the eventfd, poll the queue.
+    uint64_t n;
+    if (::read(s.wakeFd, &n, sizeof(n)) < 0 && errno != EINTR)
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+}
+
+std::vector<AudioFanout::SinkStats> AudioFanout::stats() const {
+  std::vector<SinkStats> out;
+  for (const auto& s : sinks_) {
+    SinkStats st;
+    st.name = s->name;
+    st.written = s->written.load(std::memory_order_relaxed);
+    st.dropped = s->dropped.load(std::memory_order_relaxed);
+    st.queued = s->queue.size();
+    st.failed = s->failed.load(std::memory_order_relaxed);
+    out.push_back(std::move(st));
+  }
+  return out;
+}
+
+}  // namespace oraclebox
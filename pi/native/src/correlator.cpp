@@ -0,0 +1,193 @@
+#include "oraclebox/correlator.h"
+
+#include <cstdio>
+#include <fstream>
+
+namespace oraclebox {
+
+// ==================== PATTERNS ====================
+
+bool Correlator::loadFile(const std::string& path) {
+  std::ifstream in(path);
+  if (!in) {
+    std::fprintf(stderr, "[CORR] Cannot open patterns file %s\n", path.c_str());
+    return false;
+  }
+  JsonLine def;
+  std::string line;
+  int lineNo = 0;
+  bool ok = true;
+  while (std::getline(in, line)) {
+    lineNo++;
+    size_t start = line.find_first_not_of(" \t\r");
+    if (start == std::string::npos || line[start] == '#') continue;
+    std::string error;
+    if (!def.parse(line) || !addPattern(def, &error)) {
+      std::fprintf(stderr, "[CORR] %s:%d: %s\n", path.c_str(), lineNo,
+                   error.empty() ? "malformed pattern" : error.c_str());
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+bool Correlator::parseStep(std::string_view raw, PatternStep& step, std::string* error) {
+  JsonLine def;
+  if (raw.empty() || !def.parse(raw)) {
+    if (error) *error = "\"first\" and \"then\" must be JSON objects";
+    return false;
+  }
+  step.source = std::string(def.str("source", "*"));
+  step.event = std::string(def.str("event"));
+  step.field = std::string(def.str("field"));
+  step.value = def.num("value");
+  if (step.event.empty()) {
+    if (error) *error = "each step needs an \"event\"";
+    return false;
+  }
+  if (!parseRuleOp(def.str("op"), step.op)) {
+    if (error) *error = "unknown op \"" + std::string(def.str("op")) + "\"";
+    return false;
+  }
+  if (step.op != ReflexRule::Op::Any && step.field.empty()) {
+    if (error) *error = "condition needs a \"field\"";
+    return false;
+  }
+  return true;
+}
+
+bool Correlator::addPattern(const JsonLine& def, std::string* error) {
+  CorrelationPattern p;
+  p.name = std::string(def.str("name"));
+  p.withinMs = (int)def.i64("within_ms");
+  p.cooldownMs = (int)def.i64("cooldown_ms");
+  if (!parseStep(def.str("first"), p.first, error) || !parseStep(def.str("then"), p.then, error)) return false;
+  if (p.withinMs <= 0) {
+    if (error) *error = "pattern needs \"within_ms\" > 0";
+    return false;
+  }
+  std::string_view distinct = def.str("distinct", "device");
+  if (distinct == "device") p.distinct = CorrelationPattern::Distinct::Device;
+  else if (distinct == "location") p.distinct = CorrelationPattern::Distinct::Location;
+  else if (distinct == "none") p.distinct = CorrelationPattern::Distinct::None;
+  else {
+    if (error) *error = "\"distinct\" must be device, location or none";
+    return false;
+  }
+  if (p.name.empty()) p.name = p.first.event + "->" + p.then.event;
+
+  uint32_t index = (uint32_t)patterns_.size();
+  byEvent_[hash(p.first.event)].push_back(StepRef{index, false});
+  byEvent_[hash(p.then.event)].push_back(StepRef{index, true});
+  patterns_.push_back(std::move(p));
+  windows_.emplace_back();
+  return true;
+}
+
+uint64_t Correlator::hash(std::string_view event) {
+  // FNV-1a, as for the reflex table
+  uint64_t h = 1469598103934665603ULL;
+  for (char c : event) h = (h ^ (uint8_t)c) * 1099511628211ULL;
+  return h;
+}
+
+bool Correlator::stepMatches(const PatternStep& step, const SatelliteConn& from, const JsonLine& msg) {
+  if (step.source != "*" && step.source != from.deviceId && step.source != from.deviceType) return false;
+  if (step.op == ReflexRule::Op::Any) return true;
+  if (!msg.has(step.field)) return false;
+  return evalRuleOp(step.op, msg.num(step.field, 0.0), step.value);
+}
+
+int Correlator::internDevice(const SatelliteConn& from) {
+  if (from.deviceId.empty()) return -1;
+  auto it = deviceByName_.find(from.deviceId);
+  if (it != deviceByName_.end()) {
+    devices_[it->second].location = from.location;   // satellites can be moved
+    return it->second;
+  }
+  if (devices_.size() > UINT16_MAX) return -1;
+  int index = (int)devices_.size();
+  devices_.push_back(Device{from.deviceId, from.location});
+  deviceByName_.emplace(from.deviceId, index);
+  return index;
+}
+
+// ==================== MATCHING ====================
+
+int Correlator::process(const SatelliteConn& from, const JsonLine& msg, int64_t rxUs) {
+  if (byEvent_.empty()) return 0;
+  std::string_view event = msg.str("event");
+  if (event.empty()) return 0;
+  auto it = byEvent_.find(hash(event));
+  if (it == byEvent_.end()) return 0;
+  evaluated_++;
+  if (rxUs > latestUs_) latestUs_ = rxUs;
+
+  int device = -1;
+  int raised = 0;
+  // Then steps before first steps, so an event that matches both steps of a
+  // pattern pairs with an earlier event and not with itself
+  for (int pass = 0; pass < 2; pass++) {
+    bool thenPass = pass == 0;
+    for (const StepRef& ref : it->second) {
+      if (ref.isThen != thenPass) continue;
+      const CorrelationPattern& p = patterns_[ref.pattern];
+      const PatternStep& step = ref.isThen ? p.then : p.first;
+      // Hash collisions are possible, so confirm the name
+      if (step.event != event || !stepMatches(step, from, msg)) continue;
+      if (device < 0) device = internDevice(from);
+      if (device < 0) return raised;
+      double value = msg.num(step.field.empty() ? std::string_view("strength") : std::string_view(step.field));
+
+      if (ref.isThen) {
+        raised += pair(ref.pattern, device, value, rxUs) ? 1 : 0;
+        continue;
+      }
+      Window& w = windows_[ref.pattern];
+      if (w.size == WINDOW_CAPACITY) {
+        w.head = (w.head + 1) % WINDOW_CAPACITY;
+        w.size--;
+      }
+      w.ring[(w.head + w.size) % WINDOW_CAPACITY] = Candidate{rxUs, value, (uint16_t)device, false};
+      w.size++;
+    }
+  }
+  return raised;
+}
+
+bool Correlator::pair(uint32_t p, int device, double value, int64_t rxUs) {
+  const CorrelationPattern& pat = patterns_[p];
+  Window& w = windows_[p];
+
+  // Expire from the front against the newest time seen, so a late event
+  // cannot hold the ring back; each candidate is dropped once
+  int64_t withinUs = (int64_t)pat.withinMs * 1000;
+  while (w.size && w.ring[w.head].timeUs < latestUs_ - withinUs) {
+    w.head = (w.head + 1) % WINDOW_CAPACITY;
+    w.size--;
+  }
+
+  // Newest candidate first; out-of-order arrivals leave candidates that are
+  // later than this event, or too old for it, in the ring
+  for (uint32_t i = w.size; i-- > 0;) {
+    Candidate& c = w.ring[(w.head + i) % WINDOW_CAPACITY];
+    if (c.used || c.timeUs > rxUs || c.timeUs < rxUs - withinUs) continue;
+    if (pat.distinct == CorrelationPattern::Distinct::Device && c.device == device) continue;
+    if (pat.distinct == CorrelationPattern::Distinct::Location &&
+        devices_[c.device].location == devices_[device].location) {
+      continue;
+    }
+    c.used = true;
+    if (pat.cooldownMs > 0 && w.lastIncidentUs != 0 && rxUs - w.lastIncidentUs < (int64_t)pat.cooldownMs * 1000) {
+      suppressed_++;
+      return false;
+    }
+    w.lastIncidentUs = rxUs;
+    incidents_++;
+    if (incidentHandler_) incidentHandler_(Incident{p, c.device, device, c.timeUs, rxUs, c.value, value});
+    return true;
+  }
+  return false;
+}
+
+}  // namespace oraclebox
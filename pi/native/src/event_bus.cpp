@@ -0,0 +1,228 @@
+#include "oraclebox/event_bus.h"
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <climits>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <thread>
+
+namespace oraclebox {
+
+namespace {
+
+constexpr char BUS_MAGIC[8] = {'O', 'B', 'B', 'U', 'S', '0', '0', '1'};
+constexpr uint32_t BUS_VERSION = 1;
+constexpr size_t BUS_HEADER_BYTES = 256;
+constexpr uint32_t STATE_LIVE = 1;
+constexpr uint32_t STATE_CLOSED = 2;
+
+static_assert(sizeof(BusHeader) <= BUS_HEADER_BYTES, "bus header overlaps the ring");
+static_assert(offsetof(BusHeader, writeSeq) == 64 && offsetof(BusHeader, doorbell) == 128,
+              "offsets are shared with pi/event_bus.py");
+
+long futex(uint32_t* addr, int op, uint32_t val, const timespec* timeout) {
+  // Not FUTEX_PRIVATE_FLAG: waiters are in other processes
+  return syscall(SYS_futex, addr, op, val, timeout, nullptr, 0);
+}
+
+}  // namespace
+
+// ==================== PRODUCER ====================
+
+EventBus::EventBus(std::string name) : name_(std::move(name)) {}
+
+EventBus::~EventBus() { close(); }
+
+bool EventBus::create(uint32_t capacity) {
+  if (capacity < 2 || (capacity & (capacity - 1))) {
+    std::fprintf(stderr, "[BUS] Capacity %u is not a power of two\n", capacity);
+    return false;
+  }
+  // A fresh segment, so readers of an old one notice the inode change
+  shm_unlink(name_.c_str());
+  int fd = shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+  if (fd < 0) {
+    std::fprintf(stderr, "[BUS] shm_open %s: %s\n", name_.c_str(), std::strerror(errno));
+    return false;
+  }
+  size_t bytes = BUS_HEADER_BYTES + (size_t)capacity * sizeof(BusRecord);
+  if (ftruncate(fd, (off_t)bytes) != 0) {
+    std::fprintf(stderr, "[BUS] ftruncate %s: %s\n", name_.c_str(), std::strerror(errno));
+    ::close(fd);
+    shm_unlink(name_.c_str());
+    return false;
+  }
+  void* map = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (map == MAP_FAILED) {
+    std::fprintf(stderr, "[BUS] mmap %s: %s\n", name_.c_str(), std::strerror(errno));
+    shm_unlink(name_.c_str());
+    return false;
+  }
+
+  header_ = (BusHeader*)map;
+  ring_ = (BusRecord*)((uint8_t*)map + BUS_HEADER_BYTES);
+  mapBytes_ = bytes;
+  mask_ = capacity - 1;
+  seq_ = 0;
+  notifiedSeq_ = 0;
+
+  header_->version = BUS_VERSION;
+  header_->recordSize = sizeof(BusRecord);
+  header_->capacity = capacity;
+  header_->state = STATE_LIVE;
+  // Readers check the magic, so it goes in last
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  std::memcpy(header_->magic, BUS_MAGIC, sizeof(BUS_MAGIC));
+  return true;
+}
+
+void EventBus::close() {
+  if (!header_) return;
+  __atomic_store_n(&header_->state, STATE_CLOSED, __ATOMIC_RELEASE);
+  __atomic_add_fetch(&header_->doorbell, 1, __ATOMIC_RELEASE);
+  futex(&header_->doorbell, FUTEX_WAKE, INT_MAX, nullptr);
+  munmap(header_, mapBytes_);
+  shm_unlink(name_.c_str());
+  header_ = nullptr;
+  ring_ = nullptr;
+}
+
+void EventBus::publish(BusRecord rec) {
+  if (!header_) return;
+  uint64_t seq = claim(1);
+  write(seq, rec);
+  commit(seq, 1);
+}
+
+uint64_t EventBus::claim(uint32_t n) { return __atomic_add_fetch(&seq_, n, __ATOMIC_RELAXED) - n + 1; }
+
+void EventBus::write(uint64_t seq, BusRecord rec) {
+  if (!header_) return;
+  BusRecord& slot = ring_[(seq - 1) & mask_];
+
+  // Invalidate the slot, fill it, then publish its sequence number
+  __atomic_store_n(&slot.seq, 0, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  rec.seq = 0;
+  std::memcpy(&slot, &rec, sizeof(rec));
+  __atomic_store_n(&slot.seq, seq, __ATOMIC_RELEASE);
+}
+
+void EventBus::commit(uint64_t first, uint32_t n) {
+  if (!header_ || n == 0) return;
+  // Readers trust every slot up to writeSeq, so it moves in claim order
+  while (__atomic_load_n(&header_->writeSeq, __ATOMIC_ACQUIRE) != first - 1) std::this_thread::yield();
+  __atomic_store_n(&header_->writeSeq, first + n - 1, __ATOMIC_RELEASE);
+}
+
+void EventBus::notify() {
+  if (!header_) return;
+  uint64_t seq = __atomic_load_n(&header_->writeSeq, __ATOMIC_ACQUIRE);
+  if (__atomic_exchange_n(&notifiedSeq_, seq, __ATOMIC_ACQ_REL) == seq) return;
+  __atomic_add_fetch(&header_->doorbell, 1, __ATOMIC_RELEASE);
+  futex(&header_->doorbell, FUTEX_WAKE, INT_MAX, nullptr);
+}
+
+// ==================== READER ====================
+
+EventBusReader::~EventBusReader() { detach(); }
+
+bool EventBusReader::attach(const std::string& name, bool fromStart) {
+  detach();
+  int fd = shm_open(name.c_str(), O_RDONLY, 0);
+  if (fd < 0) return false;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < BUS_HEADER_BYTES) {
+    ::close(fd);
+    return false;
+  }
+  void* map = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (map == MAP_FAILED) return false;
+
+  const BusHeader* h = (const BusHeader*)map;
+  size_t expected = BUS_HEADER_BYTES + (size_t)h->capacity * sizeof(BusRecord);
+  if (std::memcmp(h->magic, BUS_MAGIC, sizeof(BUS_MAGIC)) != 0 || h->version != BUS_VERSION ||
+      h->recordSize != sizeof(BusRecord) || (size_t)st.st_size < expected) {
+    munmap(map, (size_t)st.st_size);
+    return false;
+  }
+
+  name_ = name;
+  header_ = h;
+  ring_ = (const BusRecord*)((const uint8_t*)map + BUS_HEADER_BYTES);
+  mapBytes_ = (size_t)st.st_size;
+  mask_ = h->capacity - 1;
+  inode_ = (uint64_t)st.st_ino;
+  dropped_ = 0;
+
+  uint64_t head = __atomic_load_n(&h->writeSeq, __ATOMIC_ACQUIRE);
+  next_ = head + 1;
+  if (fromStart) next_ = head >= h->capacity ? head - h->capacity + 1 : 1;
+  return true;
+}
+
+void EventBusReader::detach() {
+  if (!header_) return;
+  munmap((void*)header_, mapBytes_);
+  header_ = nullptr;
+  ring_ = nullptr;
+}
+
+EventBusReader::Status EventBusReader::next(BusRecord& out) {
+  if (!header_) return Status::Empty;
+  uint64_t head = __atomic_load_n(&header_->writeSeq, __ATOMIC_ACQUIRE);
+  if (next_ > head) return Status::Empty;
+
+  uint64_t oldest = head > mask_ ? head - mask_ : 1;
+  if (next_ < oldest) {
+    dropped_ += oldest - next_;
+    next_ = oldest;
+    return Status::Overrun;
+  }
+
+  const BusRecord& slot = ring_[(next_ - 1) & mask_];
+  uint64_t before = __atomic_load_n(&slot.seq, __ATOMIC_ACQUIRE);
+  std::memcpy(&out, &slot, sizeof(out));
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  uint64_t after = __atomic_load_n(&slot.seq, __ATOMIC_RELAXED);
+  if (before != next_ || after != next_) {
+    // Overwritten while we read it: the producer is a lap ahead
+    uint64_t now = __atomic_load_n(&header_->writeSeq, __ATOMIC_ACQUIRE);
+    uint64_t skipTo = now > mask_ ? now - mask_ + 1 : 1;
+    dropped_ += skipTo > next_ ? skipTo - next_ : 1;
+    next_ = skipTo > next_ ? skipTo : next_ + 1;
+    return Status::Overrun;
+  }
+  out.seq = next_++;
+  return Status::Ok;
+}
+
+void EventBusReader::wait(int timeoutMs) {
+  if (!header_) return;
+  uint32_t bell = __atomic_load_n(&header_->doorbell, __ATOMIC_ACQUIRE);
+  if (next_ <= __atomic_load_n(&header_->writeSeq, __ATOMIC_ACQUIRE)) return;
+  if (__atomic_load_n(&header_->state, __ATOMIC_ACQUIRE) != STATE_LIVE) return;
+  timespec ts{timeoutMs / 1000, (long)(timeoutMs % 1000) * 1000000};
+  futex((uint32_t*)&header_->doorbell, FUTEX_WAIT, bell, &ts);
+}
+
+bool EventBusReader::stale() const {
+  if (!header_) return true;
+  if (__atomic_load_n(&header_->state, __ATOMIC_ACQUIRE) != STATE_LIVE) return true;
+  std::string path = "/dev/shm" + name_;
+  struct stat st;
+  return stat(path.c_str(), &st) != 0 || (uint64_t)st.st_ino != inode_;
+}
+
+}  // namespace oraclebox
@@ -0,0 +1,473 @@
+#include "oraclebox/event_store.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+#include "oraclebox/json_line.h"
+
+namespace oraclebox {
+
+namespace {
+
+constexpr char SEGMENT_MAGIC[8] = {'O', 'B', 'E', 'V', 'S', 'E', 'G', '1'};
+constexpr uint32_t SEGMENT_VERSION = 1;
+
+std::string segmentName(uint32_t number) {
+  char name[32];
+  std::snprintf(name, sizeof(name), "events-%06u.seg", number);
+  return name;
+}
+
+bool parseSegmentName(const char* name, uint32_t& number) {
+  unsigned n = 0;
+  char tail[8] = {0};
+  if (std::sscanf(name, "events-%6u.%4s", &n, tail) != 2 || std::strcmp(tail, "seg") != 0) return false;
+  number = n;
+  return true;
+}
+
+}  // namespace
+
+static_assert(sizeof(EventStore::SegmentHeader) <= 4096, "segment header must fit its page");
+
+EventStore::EventStore(std::string dir) : dir_(std::move(dir)) {}
+
+EventStore::~EventStore() {
+  close();
+}
+
+// ==================== OPEN / CLOSE ====================
+
+bool EventStore::open(bool readOnly) {
+  close();
+  readOnly_ = readOnly;
+
+  if (!readOnly_ && mkdir(dir_.c_str(), 0755) < 0 && errno != EEXIST) {
+    std::fprintf(stderr, "[STORE] Cannot create %s: %s\n", dir_.c_str(), std::strerror(errno));
+    return false;
+  }
+  if (!loadCatalog()) return false;
+  if (!refresh()) return false;
+
+  if (!readOnly_ && !segments_.empty()) {
+    // Only the newest segment can have a torn tail or take appends
+    Segment& tail = *segments_.back();
+    unmapSegment(tail);
+    if (!mapSegment(tail.path, tail.number, true, tail)) return false;
+    recoverTail(tail);
+    uint32_t n = tail.count();
+    if (n > 0) lastAppendUs_ = tail.records()[n - 1].timeUs;
+    dirtyFrom_ = n;
+    reserved_ = n;
+  }
+  return true;
+}
+
+void EventStore::close() {
+  if (!readOnly_ && !segments_.empty()) flush(true);
+  for (auto& seg : segments_) unmapSegment(*seg);
+  segments_.clear();
+  if (catalogFd_ >= 0) ::close(catalogFd_);
+  catalogFd_ = -1;
+  devices_.clear();
+  types_.clear();
+  deviceByName_.clear();
+  typeByName_.clear();
+  lastAppendUs_ = INT64_MIN;
+  reserved_ = 0;
+  dirty_ = false;
+}
+
+bool EventStore::refresh() {
+  DIR* d = opendir(dir_.c_str());
+  if (!d) {
+    std::fprintf(stderr, "[STORE] Cannot open %s: %s\n", dir_.c_str(), std::strerror(errno));
+    return false;
+  }
+  std::vector<uint32_t> numbers;
+  while (dirent* e = readdir(d)) {
+    uint32_t n;
+    if (parseSegmentName(e->d_name, n)) numbers.push_back(n);
+  }
+  closedir(d);
+  std::sort(numbers.begin(), numbers.end());
+
+  uint32_t known = segments_.empty() ? 0 : segments_.back()->number;
+  for (uint32_t n : numbers) {
+    if (!segments_.empty() && n <= known) continue;
+    auto seg = std::make_unique<Segment>();
+    if (!mapSegment(dir_ + "/" + segmentName(n), n, false, *seg)) continue;
+    segments_.push_back(std::move(seg));
+  }
+  if (readOnly_) {
+    // Pick up names the writer interned since we loaded the catalog
+    loadCatalog();
+  }
+  return true;
+}
+
+// ==================== CATALOG ====================
+
+bool EventStore::loadCatalog() {
+  std::string path = dir_ + "/catalog.jsonl";
+  FILE* f = std::fopen(path.c_str(), "r");
+  devices_.clear();
+  types_.clear();
+  deviceByName_.clear();
+  typeByName_.clear();
+  if (f) {
+    JsonLine entry;
+    char line[512];
+    while (std::fgets(line, sizeof(line), f)) {
+      if (!entry.parse(line)) continue;
+      std::string_view kind = entry.str("kind");
+      size_t index = (size_t)entry.i64("index", -1);
+      if (kind == "device" && index == devices_.size()) {
+        devices_.push_back({std::string(entry.str("id")), std::string(entry.str("device")),
+                            std::string(entry.str("location"))});
+        deviceByName_[devices_.back().id] = (int)index;
+      } else if (kind == "event" && index == types_.size()) {
+        types_.emplace_back(entry.str("name"));
+        typeByName_[types_.back()] = (int)index;
+      }
+    }
+    std::fclose(f);
+  }
+  if (readOnly_) return true;
+
+  if (catalogFd_ < 0) catalogFd_ = ::open(path.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+  if (catalogFd_ < 0) {
+    std::fprintf(stderr, "[STORE] Cannot open %s: %s\n", path.c_str(), std::strerror(errno));
+    return false;
+  }
+  return true;
+}
+
+bool EventStore::appendCatalog(const std::string& line) {
+  // Rare (first sighting of a device or event name), so sync right away
+  if (catalogFd_ < 0) return false;
+  if (::write(catalogFd_, line.data(), line.size()) != (ssize_t)line.size()) {
+    std::fprintf(stderr, "[STORE] Catalog write failed: %s\n", std::strerror(errno));
+    return false;
+  }
+  fdatasync(catalogFd_);
+  return true;
+}
+
+int EventStore::deviceIndex(std::string_view id, std::string_view kind, std::string_view location) {
+  auto it = deviceByName_.find(std::string(id));
+  if (it != deviceByName_.end()) return it->second;
+  if (readOnly_ || devices_.size() >= 65535) return -1;
+
+  int index = (int)devices_.size();
+  JsonWriter w;
+  w.add("kind", "device").add("index", index).add("id", id).add("device", kind).add("location", location);
+  if (!appendCatalog(w.line())) return -1;
+  devices_.push_back({std::string(id), std::string(kind), std::string(location)});
+  deviceByName_[devices_.back().id] = index;
+  return index;
+}
+
+int EventStore::typeIndex(std::string_view name) {
+  auto it = typeByName_.find(std::string(name));
+  if (it != typeByName_.end()) return it->second;
+  if (readOnly_ || types_.size() >= 255) return -1;
+
+  int index = (int)types_.size();
+  JsonWriter w;
+  w.add("kind", "event").add("index", index).add("name", name);
+  if (!appendCatalog(w.line())) return -1;
+  types_.emplace_back(name);
+  typeByName_[types_.back()] = index;
+  return index;
+}
+
+int EventStore::findDevice(std::string_view id) const {
+  auto it = deviceByName_.find(std::string(id));
+  return it == deviceByName_.end() ? -1 : it->second;
+}
+
+int EventStore::findType(std::string_view name) const {
+  auto it = typeByName_.find(std::string(name));
+  return it == typeByName_.end() ? -1 : it->second;
+}
+
+// ==================== SEGMENTS ====================
+
+bool EventStore::mapSegment(const std::string& path, uint32_t number, bool writable, Segment& seg) {
+  int fd = ::open(path.c_str(), (writable ? O_RDWR : O_RDONLY) | O_CLOEXEC);
+  if (fd < 0) {
+    std::fprintf(stderr, "[STORE] Cannot open %s: %s\n", path.c_str(), std::strerror(errno));
+    return false;
+  }
+  size_t bytes = HEADER_BYTES + (size_t)SEGMENT_CAPACITY * sizeof(EventRecord);
+  struct stat st;
+  if (fstat(fd, &st) < 0 || (size_t)st.st_size < bytes) {
+    std::fprintf(stderr, "[STORE] %s is truncated, skipping\n", path.c_str());
+    ::close(fd);
+    return false;
+  }
+  void* map = mmap(nullptr, bytes, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+  if (map == MAP_FAILED) {
+    std::fprintf(stderr, "[STORE] mmap %s failed: %s\n", path.c_str(), std::strerror(errno));
+    ::close(fd);
+    return false;
+  }
+  const SegmentHeader* h = (const SegmentHeader*)map;
+  if (std::memcmp(h->magic, SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC)) != 0 || h->version != SEGMENT_VERSION ||
+      h->recordSize != sizeof(EventRecord) || h->capacity != SEGMENT_CAPACITY) {
+    std::fprintf(stderr, "[STORE] %s has an unknown format, skipping\n", path.c_str());
+    munmap(map, bytes);
+    ::close(fd);
+    return false;
+  }
+  // Scans read the header before the records it describes
+  madvise(map, bytes, MADV_RANDOM);
+
+  seg.path = path;
+  seg.number = number;
+  seg.fd = fd;
+  seg.map = (uint8_t*)map;
+  seg.mapBytes = bytes;
+  seg.writable = writable;
+  return true;
+}
+
+void EventStore::unmapSegment(Segment& seg) {
+  if (seg.map) munmap(seg.map, seg.mapBytes);
+  if (seg.fd >= 0) ::close(seg.fd);
+  seg.map = nullptr;
+  seg.fd = -1;
+}
+
+bool EventStore::createSegment(uint32_t number) {
+  std::string path = dir_ + "/" + segmentName(number);
+  std::string tmp = path + ".tmp";
+  int fd = ::open(tmp.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    std::fprintf(stderr, "[STORE] Cannot create %s: %s\n", tmp.c_str(), std::strerror(errno));
+    return false;
+  }
+  // Allocate the whole segment up front: contiguous on the card, and
+  // appends never extend the file (no metadata writes per flush)
+  size_t bytes = HEADER_BYTES + (size_t)SEGMENT_CAPACITY * sizeof(EventRecord);
+  int err = posix_fallocate(fd, 0, (off_t)bytes);
+  if (err != 0 && ftruncate(fd, (off_t)bytes) < 0) {
+    std::fprintf(stderr, "[STORE] Cannot size %s: %s\n", tmp.c_str(), std::strerror(errno));
+    ::close(fd);
+    unlink(tmp.c_str());
+    return false;
+  }
+  SegmentHeader h;
+  std::memset(&h, 0, sizeof(h));
+  std::memcpy(h.magic, SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC));
+  h.version = SEGMENT_VERSION;
+  h.recordSize = sizeof(EventRecord);
+  h.capacity = SEGMENT_CAPACITY;
+  h.indexStride = INDEX_STRIDE;
+  h.firstTimeUs = INT64_MAX;
+  h.lastTimeUs = INT64_MIN;
+  if (pwrite(fd, &h, sizeof(h), 0) != (ssize_t)sizeof(h) || fdatasync(fd) < 0) {
+    std::fprintf(stderr, "[STORE] Cannot write %s: %s\n", tmp.c_str(), std::strerror(errno));
+    ::close(fd);
+    unlink(tmp.c_str());
+    return false;
+  }
+  ::close(fd);
+  // Readers only ever see complete, formatted segments
+  if (rename(tmp.c_str(), path.c_str()) < 0) {
+    std::fprintf(stderr, "[STORE] Cannot rename %s: %s\n", tmp.c_str(), std::strerror(errno));
+    return false;
+  }
+
+  auto seg = std::make_unique<Segment>();
+  if (!mapSegment(path, number, true, *seg)) return false;
+  segments_.push_back(std::move(seg));
+  dirtyFrom_ = 0;
+  reserved_ = 0;
+  return true;
+}
+
+void EventStore::recoverTail(Segment& seg) {
+  // The header count may lag the records (crash between msyncs). Records
+  // carry their own commit word, so walk forward until the first incomplete one.
+  SegmentHeader* h = seg.header();
+  EventRecord* recs = seg.records();
+  uint32_t n = std::min(h->count, SEGMENT_CAPACITY);
+  while (n > 0 && recs[n - 1].commit != RECORD_COMMIT) n--;
+  uint32_t recovered = n;
+  while (n < SEGMENT_CAPACITY && recs[n].commit == RECORD_COMMIT) {
+    const EventRecord& r = recs[n];
+    if (n % INDEX_STRIDE == 0) h->index[n / INDEX_STRIDE] = r.timeUs;
+    if (r.device < MAX_DEVICES) h->deviceMask[r.device / 64] |= 1ULL << (r.device % 64);
+    h->firstTimeUs = std::min(h->firstTimeUs, r.timeUs);
+    h->lastTimeUs = std::max(h->lastTimeUs, r.timeUs);
+    n++;
+  }
+  if (n != h->count) {
+    std::fprintf(stderr, "[STORE] %s: recovered %u records (header said %u)\n", seg.path.c_str(), n, h->count);
+  }
+  // Zero a torn record so it never reads as complete later
+  if (n < SEGMENT_CAPACITY && recs[n].timeUs != 0) std::memset(&recs[n], 0, sizeof(EventRecord));
+  __atomic_store_n(&h->count, n, __ATOMIC_RELEASE);
+  if (n != recovered) dirty_ = true;
+}
+
+// ==================== APPEND ====================
+
+bool EventStore::append(EventRecord rec) {
+  Reservation r = reserve(&rec, 1);
+  if (r.count == 0) return false;
+  fill(r, &rec);
+  return true;
+}
+
+EventStore::Reservation EventStore::reserve(const EventRecord* recs, uint32_t n) {
+  Reservation r;
+  if (readOnly_ || n == 0) return r;
+  if (segments_.empty() || reserved_ >= SEGMENT_CAPACITY) {
+    if (!segments_.empty()) {
+      // Seal the full segment: everything to the card, then make it
+      // read-only in place. The address stays what indexes already hold.
+      // Fills still copying into it finish first.
+      Segment& full = *segments_.back();
+      while (full.count() != reserved_) std::this_thread::yield();
+      flush(true);
+      if (mprotect(full.map, full.mapBytes, PROT_READ) < 0) {
+        std::fprintf(stderr, "[STORE] Cannot seal %s, left writable: %s\n", full.path.c_str(), std::strerror(errno));
+      } else {
+        full.writable = false;
+      }
+    }
+    uint32_t next = segments_.empty() ? 1 : segments_.back()->number + 1;
+    if (!createSegment(next)) return r;
+  }
+
+  r.segment = segments_.back().get();
+  r.first = reserved_;
+  r.count = std::min(n, SEGMENT_CAPACITY - reserved_);
+  // Records are kept in time order across reservations too: the next one
+  // starts no earlier than the newest record of this one
+  r.floorUs = lastAppendUs_;
+  for (uint32_t i = 0; i < r.count; i++) lastAppendUs_ = std::max(lastAppendUs_, recs[i].timeUs);
+  reserved_ += r.count;
+  dirty_ = true;
+  return r;
+}
+
+void EventStore::fill(const Reservation& r, const EventRecord* recs) {
+  if (r.count == 0) return;
+  Segment& seg = *r.segment;
+  SegmentHeader* h = seg.header();
+  int64_t floorUs = r.floorUs;
+  for (uint32_t i = 0; i < r.count; i++) {
+    EventRecord rec = recs[i];
+    if (rec.timeUs < floorUs) rec.timeUs = floorUs;
+    floorUs = rec.timeUs;
+
+    uint32_t n = r.first + i;
+    EventRecord* slot = &seg.records()[n];
+    rec.commit = 0;
+    *slot = rec;
+    // Commit word last, so recovery never takes a half-written record
+    __atomic_store_n(&slot->commit, RECORD_COMMIT, __ATOMIC_RELEASE);
+
+    if (n % INDEX_STRIDE == 0) h->index[n / INDEX_STRIDE] = rec.timeUs;
+    if (rec.device < MAX_DEVICES) {
+      __atomic_fetch_or(&h->deviceMask[rec.device / 64], 1ULL << (rec.device % 64), __ATOMIC_RELAXED);
+    }
+    if (n == 0) h->firstTimeUs = rec.timeUs;
+  }
+
+  // Publish: the count readers scan up to moves in reservation order, so
+  // it never covers a slot another writer is still filling
+  while (__atomic_load_n(&h->count, __ATOMIC_ACQUIRE) != r.first) std::this_thread::yield();
+  h->lastTimeUs = floorUs;
+  __atomic_store_n(&h->count, r.first + r.count, __ATOMIC_RELEASE);
+}
+
+// ==================== FLUSH ====================
+
+void EventStore::maybeFlush(int64_t nowUs) {
+  if (!dirty_ || nowUs - lastFlushUs_ < flushIntervalUs_) return;
+  lastFlushUs_ = nowUs;
+  flush(false);
+}
+
+void EventStore::flush(bool sync) {
+  if (readOnly_ || segments_.empty() || !dirty_) return;
+  Segment& seg = *segments_.back();
+  if (!seg.writable) return;
+
+  // Only the pages holding records appended since the last flush, plus the
+  // header page with the count and index
+  long page = sysconf(_SC_PAGESIZE);
+  size_t from = HEADER_BYTES + dirtyFrom_ * sizeof(EventRecord);
+  size_t to = HEADER_BYTES + (size_t)seg.count() * sizeof(EventRecord);
+  from -= from % page;
+  int flags = sync ? MS_SYNC : MS_ASYNC;
+  if (to > from && msync(seg.map + from, to - from, flags) < 0) {
+    std::fprintf(stderr, "[STORE] msync failed: %s\n", std::strerror(errno));
+  }
+  msync(seg.map, HEADER_BYTES, flags);
+  dirtyFrom_ = seg.count();
+  // Records still being filled go out with the next flush
+  dirty_ = dirtyFrom_ != reserved_;
+}
+
+// ==================== QUERY ====================
+
+uint32_t EventStore::lowerBound(const Segment& seg, int64_t timeUs) {
+  const SegmentHeader* h = seg.header();
+  uint32_t n = __atomic_load_n(&h->count, __ATOMIC_ACQUIRE);
+  if (n == 0 || timeUs <= h->firstTimeUs) return 0;
+
+  // Sparse index: last stride whose first record is before timeUs
+  uint32_t strides = (n + INDEX_STRIDE - 1) / INDEX_STRIDE;
+  uint32_t lo = 0, hi = strides;
+  while (hi - lo > 1) {
+    uint32_t mid = (lo + hi) / 2;
+    if (h->index[mid] < timeUs) lo = mid;
+    else hi = mid;
+  }
+  // Then a binary search inside that stride
+  const EventRecord* recs = seg.records();
+  uint32_t first = lo * INDEX_STRIDE;
+  uint32_t last = std::min(n, first + INDEX_STRIDE);
+  while (first < last) {
+    uint32_t mid = (first + last) / 2;
+    if (recs[mid].timeUs < timeUs) first = mid + 1;
+    else last = mid;
+  }
+  return first;
+}
+
+uint64_t EventStore::recordCount() const {
+  uint64_t total = 0;
+  for (const auto& seg : segments_) total += seg->count();
+  return total;
+}
+
+int64_t EventStore::firstTimeUs() const {
+  for (const auto& seg : segments_) {
+    if (seg->count() > 0) return seg->header()->firstTimeUs;
+  }
+  return 0;
+}
+
+int64_t EventStore::lastTimeUs() const {
+  for (auto it = segments_.rbegin(); it != segments_.rend(); ++it) {
+    if ((*it)->count() > 0) return (*it)->header()->lastTimeUs;
+  }
+  return 0;
+}
+
+}  // namespace oraclebox
@@ -0,0 +1,74 @@
+#include "oraclebox/fft.h"
+
+#include <cmath>
+#include <utility>
+
+namespace oraclebox {
+
+void Fft::setup(size_t n) {
+  n_ = n;
+  swaps_.clear();
+  int bits = 0;
+  while (((size_t)1 << bits) < n) bits++;
+  for (size_t i = 0; i < n; i++) {
+    size_t r = 0;
+    for (int b = 0; b < bits; b++) r |= ((i >> b) & 1) << (bits - 1 - b);
+    if (i < r) {
+      swaps_.push_back(i);
+      swaps_.push_back(r);
+    }
+  }
+  twRe_.clear();
+  twIm_.clear();
+  for (size_t len = 2; len <= n; len <<= 1) {
+    for (size_t j = 0; j < len / 2; j++) {
+      double a = -2.0 * M_PI * (double)j / (double)len;
+      twRe_.push_back((float)std::cos(a));
+      twIm_.push_back((float)std::sin(a));
+    }
+  }
+}
+
+void Fft::permute(float* re, float* im) const {
+  for (size_t i = 0; i < swaps_.size(); i += 2) {
+    std::swap(re[swaps_[i]], re[swaps_[i + 1]]);
+    std::swap(im[swaps_[i]], im[swaps_[i + 1]]);
+  }
+}
+
+void Fft::forward(float* re, float* im) const {
+  permute(re, im);
+  const float* wr = twRe_.data();
+  const float* wi = twIm_.data();
+  for (size_t len = 2; len <= n_; len <<= 1) {
+    size_t half = len / 2;
+    for (size_t base = 0; base < n_; base += len) {
+      float* ar = re + base;
+      float* ai = im + base;
+      float* br = ar + half;
+      float* bi = ai + half;
+      for (size_t j = 0; j < half; j++) {
+        float tr = br[j] * wr[j] - bi[j] * wi[j];
+        float ti = br[j] * wi[j] + bi[j] * wr[j];
+        br[j] = ar[j] - tr;
+        bi[j] = ai[j] - ti;
+        ar[j] += tr;
+        ai[j] += ti;
+      }
+    }
+    wr += half;
+    wi += half;
+  }
+}
+
+void Fft::inverse(float* re, float* im) const {
+  // ifft(x) = conj(fft(conj(x))) / n, with the conjugates as swaps of re/im
+  forward(im, re);
+  float scale = 1.0f / (float)n_;
+  for (size_t i = 0; i < n_; i++) {
+    re[i] *= scale;
+    im[i] *= scale;
+  }
+}
+
+}  // namespace oraclebox
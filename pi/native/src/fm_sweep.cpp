@@ -0,0 +1,234 @@
+#include "oraclebox/fm_sweep.h"
+
+#include <fcntl.h>
+#include <linux/i2c-dev.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#include "oraclebox/hub_clock.h"
+
+namespace oraclebox {
+
+// ==================== TEA5767 ====================
+
+Tea5767::~Tea5767() { close(); }
+
+bool Tea5767::open(int bus, uint8_t address) {
+  close();
+  char path[32];
+  std::snprintf(path, sizeof(path), "/dev/i2c-%d", bus);
+  int fd = ::open(path, O_RDWR | O_CLOEXEC);
+  if (fd < 0) {
+    std::fprintf(stderr, "[FM] %s: %s\n", path, std::strerror(errno));
+    return false;
+  }
+  if (ioctl(fd, I2C_SLAVE, address) < 0) {
+    std::fprintf(stderr, "[FM] TEA5767 at 0x%02X: %s\n", address, std::strerror(errno));
+    ::close(fd);
+    return false;
+  }
+  fd_ = fd;
+  return true;
+}
+
+void Tea5767::close() {
+  if (fd_ >= 0) ::close(fd_);
+  fd_ = -1;
+}
+
+bool Tea5767::tune(double mhz, bool mono) {
+  if (fd_ < 0) return false;
+  if (mhz < 76.0) mhz = 76.0;
+  if (mhz > 108.0) mhz = 108.0;
+  // High-side injection: PLL = 4 * (f + 225 kHz) / 32768
+  unsigned pll = (unsigned)(4.0 * (mhz * 1e6 + 225000.0) / 32768.0);
+  uint8_t data[5] = {
+      (uint8_t)((pll >> 8) & 0x3F),   // PLL13..8, mute/search = 0
+      (uint8_t)(pll & 0xFF),          // PLL7..0
+      (uint8_t)(mono ? 0x18 : 0x10),  // high side, forced mono / stereo
+      0x1E,                           // XTAL = 32.768 kHz, SMUTE/HCC/SNC
+      0x00,                           // PLLREF = 0
+  };
+  return ::write(fd_, data, sizeof(data)) == (ssize_t)sizeof(data);
+}
+
+bool Tea5767::readStatus(uint8_t status[5]) {
+  if (fd_ < 0) return false;
+  return ::read(fd_, status, 5) == 5;
+}
+
+// ==================== SWEEP ENGINE ====================
+
+SweepEngine::~SweepEngine() { stop(); }
+
+bool SweepEngine::openTuner(int bus, uint8_t address) {
+  std::lock_guard<std::mutex> lock(tunerMutex_);
+  return tuner_.open(bus, address);
+}
+
+void SweepEngine::start() {
+  if (thread_.joinable()) return;
+  quit_.store(false);
+  thread_ = std::thread(&SweepEngine::run, this);
+}
+
+void SweepEngine::stop() {
+  quit_.store(true);
+  stepCv_.notify_all();
+  if (thread_.joinable()) thread_.join();
+}
+
+void SweepEngine::setRunning(bool running) {
+  running_.store(running);
+  stepCv_.notify_all();
+}
+
+void SweepEngine::setDelayMs(int ms) {
+  if (ms < 5) ms = 5;
+  if (ms > 5000) ms = 5000;
+  delayMs_.store(ms);
+}
+
+void SweepEngine::setDirection(int direction) { direction_.store(direction < 0 ? -1 : 1); }
+
+void SweepEngine::setBand(int lowTenths, int highTenths, int stepTenths) {
+  if (lowTenths < 760) lowTenths = 760;
+  if (highTenths > 1080) highTenths = 1080;
+  if (stepTenths < 1) stepTenths = 1;
+  if (highTenths <= lowTenths) return;
+  lowTenths_.store(lowTenths);
+  highTenths_.store(highTenths);
+  stepTenths_.store(stepTenths);
+}
+
+void SweepEngine::setRetunePipe(const std::string& path) {
+  std::lock_guard<std::mutex> lock(pipeMutex_);
+  retunePipe_ = path;
+}
+
+void SweepEngine::announce(double mhz, int64_t atUs) {
+  std::string path;
+  {
+    std::lock_guard<std::mutex> lock(pipeMutex_);
+    path = retunePipe_;
+  }
+  if (path.empty()) return;
+  // Opened per line, as oraclebox.py's native_fx_control() does: it fails
+  // at once (ENXIO) while no oraclebox_fx reads it, and a restarted one
+  // picks up the next line. The hub process ignores SIGPIPE (Python does).
+  int fd = ::open(path.c_str(), O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+  if (fd < 0) return;
+  char line[64];
+  int n = std::snprintf(line, sizeof(line), "RETUNE %.1f %lld\n", mhz, (long long)atUs);
+  ssize_t w = ::write(fd, line, (size_t)n);   // pipe full or reader gone: this retune goes unmuted
+  (void)w;
+  ::close(fd);
+}
+
+bool SweepEngine::tune(double mhz) {
+  announce(mhz, hubNowUs());
+  std::lock_guard<std::mutex> lock(tunerMutex_);
+  return tuner_.tune(mhz, mono_.load());
+}
+
+SweepEngine::Step SweepEngine::waitStep(uint64_t afterSeq, int timeoutMs) {
+  std::unique_lock<std::mutex> lock(stepMutex_);
+  stepCv_.wait_for(lock, std::chrono::milliseconds(timeoutMs),
+                   [&] { return last_.seq > afterSeq || quit_.load(); });
+  return last_;
+}
+
+SweepEngine::Step SweepEngine::lastStep() {
+  std::lock_guard<std::mutex> lock(stepMutex_);
+  return last_;
+}
+
+SweepEngine::Stats SweepEngine::stats() {
+  std::lock_guard<std::mutex> lock(stepMutex_);
+  Stats s = stats_;
+  s.meanLateMs = s.steps ? lateSumMs_ / (double)s.steps : 0.0;
+  return s;
+}
+
+namespace {
+
+// steady_clock is CLOCK_MONOTONIC, the hub clock
+int64_t toHubUs(std::chrono::steady_clock::time_point t) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(t.time_since_epoch()).count();
+}
+
+}  // namespace
+
+void SweepEngine::run() {
+  using Clock = std::chrono::steady_clock;
+  int tenths = -1;   // the next step's, fixed when it is announced
+  Clock::time_point deadline = Clock::now();
+  bool wasRunning = false;
+
+  // Next frequency, wrapping at the band edges like the Python sweep
+  auto advance = [this](int from) {
+    int low = lowTenths_.load(), high = highTenths_.load(), step = stepTenths_.load();
+    int dir = direction_.load();
+    if (from < 0) return dir > 0 ? low : high;
+    int next = from + dir * step;
+    if (next > high) next = low;
+    if (next < low) next = high;
+    return next;
+  };
+
+  while (!quit_.load()) {
+    if (!running_.load()) {
+      wasRunning = false;
+      std::unique_lock<std::mutex> lock(stepMutex_);
+      stepCv_.wait_for(lock, std::chrono::milliseconds(200), [&] { return running_.load() || quit_.load(); });
+      continue;
+    }
+    if (!wasRunning) {
+      // (Re)starting: step now and schedule from here, not from whenever
+      // the sweep was last paused. A step announced before the pause is
+      // the one taken now.
+      wasRunning = true;
+      deadline = Clock::now();
+      if (tenths < 0) tenths = advance(tenths);
+      announce(tenths / 10.0, toHubUs(deadline));
+    }
+    double mhz = tenths / 10.0;
+
+    bool ok = true;
+    {
+      std::lock_guard<std::mutex> lock(tunerMutex_);
+      if (tuner_.isOpen()) ok = tuner_.tune(mhz, mono_.load());
+    }
+    Clock::time_point written = Clock::now();
+    double lateMs = std::chrono::duration<double, std::milli>(written - deadline).count();
+    {
+      std::lock_guard<std::mutex> lock(stepMutex_);
+      last_.seq++;
+      last_.mhz = mhz;
+      last_.timeUs = hubNowUs();
+      stats_.steps++;
+      if (!ok) stats_.i2cErrors++;
+      if (lateMs > 1.0) stats_.late++;
+      if (lateMs > stats_.maxLateMs) stats_.maxLateMs = lateMs;
+      lateSumMs_ += lateMs;
+    }
+    stepCv_.notify_all();
+
+    // Absolute deadlines: a slow write or a late wake-up shortens the next
+    // wait instead of stretching the sweep. After a long stall (debugger,
+    // suspend) resynchronize rather than firing a burst of catch-up steps.
+    deadline += std::chrono::milliseconds(delayMs_.load());
+    if (written - deadline > std::chrono::seconds(1)) deadline = written;
+    tenths = advance(tenths);
+    announce(tenths / 10.0, toHubUs(deadline));
+    std::unique_lock<std::mutex> lock(stepMutex_);
+    stepCv_.wait_until(lock, deadline, [&] { return quit_.load() || !running_.load(); });
+  }
+}
+
+}  // namespace oraclebox
@@ -0,0 +1,702 @@
+#include "oraclebox/fx_engine.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+
+#include "oraclebox/hub_clock.h"
+#include "oraclebox/json_line.h"
+
+namespace oraclebox {
+
+namespace {
+
+float dbToGain(double db) { return (float)std::pow(10.0, db / 20.0); }
+
+}  // namespace
+
+// ==================== STAGES ====================
+
+void Biquad::design(double hz, double rate, bool high) {
+  double w0 = 2.0 * M_PI * std::min(hz, rate * 0.45) / rate;
+  double c = std::cos(w0);
+  double alpha = std::sin(w0) / (2.0 * 0.7071);
+  double a0 = 1.0 + alpha;
+  double b0 = high ? (1.0 + c) / 2.0 : (1.0 - c) / 2.0;
+  double b1 = high ? -(1.0 + c) : 1.0 - c;
+  b0_ = (float)(b0 / a0);
+  b1_ = (float)(b1 / a0);
+  b2_ = b0_;
+  a1_ = (float)(-2.0 * c / a0);
+  a2_ = (float)((1.0 - alpha) / a0);
+}
+
+void Biquad::process(float* x, size_t n) {
+  float z1 = z1_, z2 = z2_;
+  for (size_t i = 0; i < n; i++) {
+    float in = x[i];
+    float out = b0_ * in + z1;
+    z1 = b1_ * in - a1_ * out + z2;
+    z2 = b2_ * in - a2_ * out;
+    x[i] = out;
+  }
+  z1_ = z1;
+  z2_ = z2;
+}
+
+std::vector<float> FirFilter::designBandpass(double lowHz, double highHz, double rate) {
+  // Kaiser estimate for 70 dB with a 300 Hz transition: the taps grow with
+  // the rate for the same band edges
+  const double attenuation = 70.0, transitionHz = 300.0;
+  int n = (int)std::ceil((attenuation - 8.0) / (2.285 * 2.0 * M_PI * transitionHz / rate)) + 1;
+  n |= 1;   // odd, so the delay is a whole sample
+  highHz = std::min(highHz, rate * 0.5 - transitionHz);
+  lowHz = std::min(lowHz, highHz - transitionHz);
+  std::vector<float> high = designLowpass(n, highHz, rate, attenuation);
+  std::vector<float> low = designLowpass(n, lowHz, rate, attenuation);
+  for (int i = 0; i < n; i++) high[(size_t)i] -= low[(size_t)i];
+  return high;
+}
+
+void FirFilter::setTaps(std::vector<float> taps) {
+  bool resized = taps.size() != taps_.size();
+  taps_ = std::move(taps);
+  fadeLeft_ = 0;
+  if (resized) reset();
+}
+
+void FirFilter::switchTaps(const std::vector<float>& taps, size_t fadeLen) {
+  if (taps.size() != taps_.size()) {
+    setTaps(taps);
+    return;
+  }
+  // fromTaps_ is sized on the first switch only
+  fromTaps_.resize(taps_.size());
+  std::copy(taps_.begin(), taps_.end(), fromTaps_.begin());
+  std::copy(taps.begin(), taps.end(), taps_.begin());
+  fadeLen_ = fadeLeft_ = fadeLen;
+}
+
+void FirFilter::reset() {
+  history_.assign(taps_.size() * 2, 0.0f);
+  head_ = 0;
+}
+
+void FirFilter::process(float* x, size_t n) {
+  const size_t N = taps_.size();
+  if (N == 0) return;
+  const size_t half = N / 2;
+  const float* t = taps_.data();
+  for (size_t i = 0; i < n; i++) {
+    history_[head_] = history_[head_ + N] = x[i];
+    head_ = head_ + 1 == N ? 0 : head_ + 1;
+    const float* w = history_.data() + head_;
+    // Symmetric taps: one multiply per pair
+    float acc = t[half] * w[half];
+    for (size_t j = 0; j < half; j++) acc += t[j] * (w[j] + w[N - 1 - j]);
+    if (fadeLeft_ > 0) {
+      // Crossfading from the previous taps: both run on the same history
+      const float* f = fromTaps_.data();
+      float old = f[half] * w[half];
+      for (size_t j = 0; j < half; j++) old += f[j] * (w[j] + w[N - 1 - j]);
+      float a = (float)fadeLeft_-- / (float)fadeLen_;
+      acc += a * (old - acc);
+    }
+    x[i] = acc;
+  }
+}
+
+void NoiseSuppressor::setup(int amount, double rate) {
+  amount = std::max(0, std::min(100, amount));
+  floor_ = amount > 0 ? dbToGain(-24.0 * amount / 100.0) : 1.0f;
+  // Largest power of two that is at most 16 ms
+  size_t n = 16;
+  while (n * 2 <= (size_t)(rate * 0.016)) n *= 2;
+  bandLow_ = (size_t)std::ceil(300.0 * n / rate);
+  bandHigh_ = std::min(n / 2, (size_t)(3400.0 * n / rate));
+  if (n == frame_.size()) return;
+  fft_.setup(n);
+  hop_ = n / 2;
+  window_.resize(n);
+  for (size_t i = 0; i < n; i++) window_[i] = (float)std::sqrt(0.5 - 0.5 * std::cos(2.0 * M_PI * (double)i / (double)n));
+  frame_.assign(n, 0.0f);
+  re_.assign(n, 0.0f);
+  im_.assign(n, 0.0f);
+  noise_.assign(n / 2 + 1, 0.0f);
+  lastClean_.assign(n / 2 + 1, 0.0f);
+  reset();
+}
+
+void NoiseSuppressor::reset() {
+  std::fill(frame_.begin(), frame_.end(), 0.0f);
+  ola_.assign(frame_.size(), 0.0f);
+  out_.assign(hop_, 0.0f);
+  std::fill(lastClean_.begin(), lastClean_.end(), 0.0f);
+  fill_ = 0;
+  learned_ = false;
+}
+
+void NoiseSuppressor::process(float* x, size_t n) {
+  if (!enabled()) return;
+  const size_t keep = frame_.size() - hop_;
+  for (size_t i = 0; i < n; i++) {
+    frame_[keep + fill_] = x[i];
+    x[i] = out_[fill_];
+    if (++fill_ == hop_) {
+      processFrame();
+      fill_ = 0;
+    }
+  }
+}
+
+void NoiseSuppressor::processFrame() {
+  const size_t n = frame_.size();
+  const size_t bins = n / 2 + 1;
+  for (size_t i = 0; i < n; i++) {
+    re_[i] = frame_[i] * window_[i];
+    im_[i] = 0.0f;
+  }
+  fft_.forward(re_.data(), im_.data());
+
+  // Flatness over the voice band: static is flat, voices and music are not
+  double logSum = 0.0, sum = 0.0;
+  for (size_t k = bandLow_; k < bandHigh_; k++) {
+    double p = (double)re_[k] * re_[k] + (double)im_[k] * im_[k] + 1e-12;
+    logSum += std::log(p);
+    sum += p;
+  }
+  double count = (double)(bandHigh_ - bandLow_);
+  bool flat = std::exp(logSum / count) / (sum / count) > 0.45;
+
+  for (size_t k = 0; k < bins; k++) {
+    float p = re_[k] * re_[k] + im_[k] * im_[k];
+    float& noise = noise_[k];
+    if (!learned_) noise = p;
+    else if (flat) noise = 0.9f * noise + 0.1f * p;
+    else if (p < noise) noise = 0.95f * noise + 0.05f * p;
+
+    // Decision-directed a-priori SNR, then the Wiener gain
+    float nk = noise + 1e-12f;
+    float post = p / nk;
+    float prior = 0.98f * lastClean_[k] / nk + 0.02f * std::max(post - 1.0f, 0.0f);
+    float gain = std::max(prior / (1.0f + prior), floor_);
+    lastClean_[k] = gain * gain * p;
+    re_[k] *= gain;
+    im_[k] *= gain;
+    // Mirror for the real signal's negative frequencies
+    if (k > 0 && k < n / 2) {
+      re_[n - k] = re_[k];
+      im_[n - k] = -im_[k];
+    }
+  }
+  learned_ = true;
+  fft_.inverse(re_.data(), im_.data());
+
+  for (size_t i = 0; i < n; i++) ola_[i] += re_[i] * window_[i];
+  std::copy(ola_.begin(), ola_.begin() + (long)hop_, out_.begin());
+  std::copy(ola_.begin() + (long)hop_, ola_.end(), ola_.begin());
+  std::fill(ola_.end() - (long)hop_, ola_.end(), 0.0f);
+  std::copy(frame_.begin() + (long)hop_, frame_.end(), frame_.begin());
+}
+
+void Agc::setup(double rate) {
+  powerCoef_ = (float)(1.0 - std::exp(-1.0 / (0.3 * rate)));
+  slowCoef_ = (float)(1.0 - std::exp(-(double)STEP / (3.0 * rate)));
+  downDb_ = (float)(30.0 * STEP / rate);
+  upDb_ = (float)(8.0 * STEP / rate);
+  steadyUpDb_ = (float)(2.0 * STEP / rate);
+}
+
+void Agc::reset() {
+  power_ = 0.0f;
+  slowDb_ = -100.0f;
+  gainDb_ = 0.0f;
+  gain_ = 1.0f;
+}
+
+void Agc::process(float* x, size_t n) {
+  const float target = targetDb_.load(std::memory_order_relaxed);
+  for (size_t at = 0; at < n; at += STEP) {
+    size_t m = std::min(STEP, n - at);
+    for (size_t i = 0; i < m; i++) power_ += powerCoef_ * (x[at + i] * x[at + i] - power_);
+
+    float levelDb = 10.0f * std::log10(power_ + 1e-12f);
+    slowDb_ += slowCoef_ * (levelDb - slowDb_);
+    float want = std::max(-12.0f, std::min(16.0f, target - levelDb));
+    if (want < gainDb_) {
+      gainDb_ = std::max(want, gainDb_ - downDb_);
+    } else if (levelDb > -50.0f) {
+      // Steady program (the 3 s average close to the 300 ms level): slower
+      bool steady = std::fabs(levelDb - slowDb_) < 3.0f;
+      gainDb_ = std::min(want, gainDb_ + (steady ? steadyUpDb_ : upDb_));
+    }
+
+    // Ramp to the new gain across the step, so it has no zipper noise
+    float next = std::pow(10.0f, gainDb_ / 20.0f);
+    float inc = (next - gain_) / (float)m;
+    for (size_t i = 0; i < m; i++) {
+      gain_ += inc;
+      x[at + i] *= gain_;
+    }
+    gain_ = next;
+  }
+}
+
+void LookaheadLimiter::setup(int lookaheadMs, double rate) {
+  size_t len = (size_t)std::max(1.0, std::round(std::max(1, std::min(20, lookaheadMs)) * rate / 1000.0));
+  attack_ = (float)(1.0 - std::exp(-3.0 / (double)len));   // ~95% of the way in len samples
+  release_ = (float)(1.0 - std::exp(-1.0 / (0.1 * rate)));
+  if (len == delay_.size()) return;
+  delay_.assign(len, 0.0f);
+  size_t cap = 2;
+  while (cap < len + 2) cap *= 2;
+  deque_.assign(cap, Peak{0, 0.0f});
+  reset();
+}
+
+void LookaheadLimiter::reset() {
+  std::fill(delay_.begin(), delay_.end(), 0.0f);
+  pos_ = count_ = 0;
+  front_ = back_ = 0;
+  gain_ = 1.0f;
+}
+
+void LookaheadLimiter::process(float* x, size_t n) {
+  const size_t len = delay_.size();
+  const size_t mask = deque_.size() - 1;
+  for (size_t i = 0; i < n; i++) {
+    // Sliding max over the newest len + 1 samples: drop the smaller ones
+    // from the back (they can never be the max again), the expired one
+    // from the front
+    float v = std::fabs(x[i]);
+    while (back_ != front_ && deque_[(back_ - 1) & mask].value <= v) back_--;
+    deque_[back_++ & mask] = Peak{count_, v};
+    if (deque_[front_ & mask].index + len < count_) front_++;
+    count_++;
+    float peak = deque_[front_ & mask].value;
+
+    float target = peak > CEILING ? CEILING / peak : 1.0f;
+    gain_ += (target < gain_ ? attack_ : release_) * (target - gain_);
+
+    float delayed = delay_[pos_];
+    delay_[pos_] = x[i];
+    if (++pos_ == len) pos_ = 0;
+    x[i] = std::max(-CEILING, std::min(CEILING, delayed * gain_));
+  }
+}
+
+size_t FdnReverb::lineLength(int k, double rate) {
+  // Mutually prime lengths at 48 kHz, 30-58 ms
+  static const int LENGTHS[LINES] = {1433, 1601, 1867, 2053, 2251, 2399, 2617, 2797};
+  return (size_t)std::max(1.0, std::round(LENGTHS[k] * rate / 48000.0));
+}
+
+FdnReverb::Settings FdnReverb::design(const FxParams& p, double rate) {
+  Settings s;
+  double rt60 = 0.25 + 2.25 * p.reverbRoom / 100.0;
+  for (int k = 0; k < LINES; k++) {
+    // -60 dB after rt60 seconds, in passes of the line's length
+    double g = std::pow(10.0, -3.0 * (double)lineLength(k, rate) / (rate * rt60));
+    s.feedback[k] = (int32_t)std::lrint(g / std::sqrt((double)LINES) * 32768.0);
+  }
+  s.damp = (int32_t)std::lrint((1.0 - 0.7 * p.reverbDamping / 100.0) * 32768.0);
+  s.wet = 0.6f * (float)p.reverbWet / 100.0f;
+  s.dry = (float)p.reverbDry / 100.0f;
+  return s;
+}
+
+void FdnReverb::setup(const FxParams& p, double rate) {
+  for (int k = 0; k < LINES; k++) {
+    size_t len = lineLength(k, rate);
+    if (lines_[k].size() != len) {
+      lines_[k].assign(len, 0);
+      pos_[k] = 0;
+    }
+  }
+  settings_ = design(p, rate);
+  wet_ = settings_.wet;
+  dry_ = settings_.dry;
+  fadeLeft_ = 0;
+}
+
+void FdnReverb::switchSettings(const Settings& s, size_t fadeLen) {
+  settings_ = s;
+  fadeLeft_ = std::max((size_t)1, fadeLen);
+  wetStep_ = (s.wet - wet_) / (float)fadeLeft_;
+  dryStep_ = (s.dry - dry_) / (float)fadeLeft_;
+}
+
+void FdnReverb::reset() {
+  for (int k = 0; k < LINES; k++) {
+    std::fill(lines_[k].begin(), lines_[k].end(), (int16_t)0);
+    pos_[k] = 0;
+    state_[k] = 0;
+  }
+}
+
+void FdnReverb::process(float* x, size_t n) {
+  while (n > 0) {
+    // Up to the first line's wrap, so every line is one straight run
+    size_t run = n;
+    for (int k = 0; k < LINES; k++) run = std::min(run, lines_[k].size() - pos_[k]);
+    processRun(x, run);
+    x += run;
+    n -= run;
+  }
+}
+
+void FdnReverb::processRun(float* x, size_t n) {
+  static const int32_t IN_SIGN[LINES] = {1, 1, -1, -1, 1, 1, -1, -1};
+  static const int32_t OUT_SIGN[LINES] = {1, -1, 1, -1, 1, -1, 1, -1};
+
+  // Each sample is read where it was written len samples ago, and the new
+  // one is written in its place
+  int16_t* line[LINES];
+  int32_t s[LINES];
+  for (int k = 0; k < LINES; k++) {
+    line[k] = lines_[k].data() + pos_[k];
+    s[k] = state_[k];
+  }
+  const int32_t* feedback = settings_.feedback;
+  const int32_t damp = settings_.damp;
+  for (size_t i = 0; i < n; i++) {
+    int32_t in = (int32_t)(std::max(-1.0f, std::min(1.0f, x[i])) * 16384.0f);
+    int32_t v[LINES];
+    int32_t out = 0;
+    for (int k = 0; k < LINES; k++) {
+      s[k] += ((line[k][i] - s[k]) * damp + 16384) >> 15;
+      out += OUT_SIGN[k] * s[k];
+      // The line's decay first, so the matrix sums stay well inside 32 bits
+      v[k] = (s[k] * feedback[k] + 16384) >> 15;
+    }
+    // Hadamard: three butterfly stages, adds only
+    int32_t a0 = v[0] + v[1], a1 = v[0] - v[1], a2 = v[2] + v[3], a3 = v[2] - v[3];
+    int32_t a4 = v[4] + v[5], a5 = v[4] - v[5], a6 = v[6] + v[7], a7 = v[6] - v[7];
+    int32_t b0 = a0 + a2, b1 = a1 + a3, b2 = a0 - a2, b3 = a1 - a3;
+    int32_t b4 = a4 + a6, b5 = a5 + a7, b6 = a4 - a6, b7 = a5 - a7;
+    v[0] = b0 + b4, v[1] = b1 + b5, v[2] = b2 + b6, v[3] = b3 + b7;
+    v[4] = b0 - b4, v[5] = b1 - b5, v[6] = b2 - b6, v[7] = b3 - b7;
+    for (int k = 0; k < LINES; k++) line[k][i] = (int16_t)std::max(-32768, std::min(32767, v[k] + IN_SIGN[k] * in));
+    if (fadeLeft_ > 0) {
+      wet_ += wetStep_;
+      dry_ += dryStep_;
+      if (--fadeLeft_ == 0) {
+        wet_ = settings_.wet;
+        dry_ = settings_.dry;
+      }
+    }
+    x[i] = x[i] * dry_ + (float)out * (wet_ / 32768.0f);
+  }
+  for (int k = 0; k < LINES; k++) {
+    state_[k] = s[k];
+    pos_[k] = pos_[k] + n == lines_[k].size() ? 0 : pos_[k] + n;
+  }
+}
+
+// ==================== PRESETS ====================
+
+void CompiledFx::compile(CompiledFx& out, const std::string& name, const FxParams& p, int rate) {
+  out.name = name;
+  out.params = p;
+  out.rate = rate;
+  out.bandpass = FirFilter::designBandpass(p.bpLow, p.bpHigh, rate);
+  out.reverb = FdnReverb::design(p, rate);
+  out.preGain = dbToGain((float)p.preGainDb);
+  out.postGain = dbToGain((float)p.postGainDb);
+  out.contrast = (float)p.contrastAmount / 750.0f;
+}
+
+const CompiledFx* FxPresetCache::define(const std::string& name, const FxParams& p) {
+  // Compiled outside the lock: find() is never held up by the design
+  auto fx = std::make_unique<CompiledFx>();
+  CompiledFx::compile(*fx, name, p, rate_);
+  std::lock_guard<std::mutex> lock(mutex_);
+  const CompiledFx* ptr = fx.get();
+  all_.push_back(std::move(fx));
+  byName_[name] = ptr;
+  return ptr;
+}
+
+const CompiledFx* FxPresetCache::defineJson(std::string_view line) {
+  JsonLine j;
+  if (!j.parse(line) || !j.has("name")) return nullptr;
+  FxParams p;
+  auto num = [&](const char* key, int& field) {
+    if (j.has(key)) field = (int)j.num(key);
+  };
+  num("bp_low", p.bpLow);
+  num("bp_high", p.bpHigh);
+  num("reverb_room", p.reverbRoom);
+  num("reverb_damping", p.reverbDamping);
+  num("reverb_wet", p.reverbWet);
+  num("reverb_dry", p.reverbDry);
+  num("contrast_amount", p.contrastAmount);
+  num("pre_gain_db", p.preGainDb);
+  num("post_gain_db", p.postGainDb);
+  return define(std::string(j.str("name")), p);
+}
+
+int FxPresetCache::load(const std::string& path) {
+  std::ifstream f(path);
+  if (!f) {
+    std::fprintf(stderr, "[FX] presets %s: cannot open\n", path.c_str());
+    return 0;
+  }
+  int n = 0;
+  std::string line;
+  while (std::getline(f, line)) {
+    if (line.empty()) continue;
+    if (defineJson(line)) n++;
+    else std::fprintf(stderr, "[FX] presets %s: bad line: %s\n", path.c_str(), line.c_str());
+  }
+  return n;
+}
+
+const CompiledFx* FxPresetCache::find(const std::string& name) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = byName_.find(name);
+  return it == byName_.end() ? nullptr : it->second;
+}
+
+size_t FxPresetCache::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return byName_.size();
+}
+
+// ==================== RETUNES ====================
+
+void StreamClock::onRead(int64_t nowUs, uint64_t framesEnd) {
+  double estimate = (double)nowUs - (double)framesEnd * 1e6 / rate_;
+  if (!valid_ || estimate < offsetUs_) offsetUs_ = estimate;
+  else offsetUs_ += (estimate - offsetUs_) * DRIFT;
+  valid_ = true;
+}
+
+int64_t StreamClock::frameAt(int64_t us) const {
+  return (int64_t)std::llround(((double)us - offsetUs_) * rate_ / 1e6);
+}
+
+int64_t StreamClock::timeOf(int64_t frame) const {
+  return (int64_t)std::llround(offsetUs_ + (double)frame * 1e6 / rate_);
+}
+
+void RetuneGate::setup(int muteMs, double rate) {
+  mute_ = (int64_t)std::lround(std::max(0, muteMs) * rate / 1000.0);
+  size_t fade = (size_t)std::lround(FADE_MS * rate / 1000.0);
+  ramp_.resize(fade);
+  for (size_t i = 0; i < fade; i++) ramp_[i] = 0.5f - 0.5f * (float)std::cos(M_PI * (double)i / (double)fade);
+}
+
+void RetuneGate::schedule(int64_t frame) {
+  if (mute_ == 0) return;
+  if (count_ == MAX_PENDING) {
+    // Steps far faster than the windows: the oldest has long passed
+    std::copy(frames_ + 1, frames_ + count_, frames_);
+    count_--;
+  }
+  frames_[count_++] = frame;
+}
+
+float RetuneGate::gainAt(int64_t d) const {
+  const int64_t fade = (int64_t)ramp_.size();
+  if (d <= -fade || d >= mute_ + fade) return 1.0f;
+  if (d < 0) return ramp_[(size_t)-d];   // fading out, zero at the retune
+  if (d < mute_) return 0.0f;
+  return ramp_[(size_t)(d - mute_)];
+}
+
+void RetuneGate::process(float* x, size_t n, int64_t first) const {
+  const int64_t fade = (int64_t)ramp_.size();
+  for (size_t k = 0; k < count_; k++) {
+    // Only the part of the block inside this retune's window
+    int64_t from = std::max(first, frames_[k] - fade + 1);
+    int64_t to = std::min(first + (int64_t)n, frames_[k] + mute_ + fade);
+    for (int64_t f = from; f < to; f++) x[f - first] *= gainAt(f - frames_[k]);
+  }
+}
+
+void RetuneGate::retire(int64_t end) {
+  const int64_t fade = (int64_t)ramp_.size();
+  size_t kept = 0;
+  for (size_t k = 0; k < count_; k++)
+    if (frames_[k] + mute_ + fade > end) frames_[kept++] = frames_[k];
+  count_ = kept;
+}
+
+// ==================== ENGINE ====================
+
+FxEngine::FxEngine(int internalRate, Mode mode, int ioRate)
+    : internalRate_(mode == Mode::Stereo ? ioRate : internalRate), ioRate_(ioRate), mode_(mode) {
+  down_.setup(ioRate_, internalRate_);
+  up_.setup(internalRate_, ioRate_);
+  configure(params_);
+}
+
+void FxEngine::configure(const FxParams& p) {
+  params_ = p;
+  double rate = internalRate_;
+  for (Chain& c : chains_) {
+    c.highpass.highpass(HIGHPASS_HZ, rate);
+    c.lowpass.lowpass(LOWPASS_HZ, rate);
+    c.denoise.setup(p.noiseReduce, rate);
+    c.agc.setup(rate);
+    c.agc.setTargetDb((float)p.agcTargetDb);
+    c.bandpass.bandpass(p.bpLow, p.bpHigh, rate);
+    c.reverb.setup(p, rate);
+    c.limiter.setup(p.lookaheadMs, rate);
+  }
+  retunes_.setup(p.retuneMuteMs, ioRate_);
+  setPreGainDb((float)p.preGainDb);
+  setPostGainDb((float)p.postGainDb);
+  contrast_ = (float)p.contrastAmount / 750.0f;
+  now_ = {preGain_.load(std::memory_order_relaxed), postGain_.load(std::memory_order_relaxed), contrast_};
+  pending_.store(nullptr, std::memory_order_relaxed);
+}
+
+void FxEngine::setPreGainDb(float db) { preGain_.store(dbToGain(db), std::memory_order_relaxed); }
+
+void FxEngine::setPostGainDb(float db) { postGain_.store(dbToGain(db), std::memory_order_relaxed); }
+
+void FxEngine::setAgcTargetDb(float db) {
+  for (Chain& c : chains_) c.agc.setTargetDb(db);
+}
+
+bool FxEngine::select(const CompiledFx* fx) {
+  if (!fx) return false;
+  if (fx->rate != internalRate_) {
+    std::fprintf(stderr, "[FX] preset %s is for %d Hz, the engine runs at %d\n", fx->name.c_str(), fx->rate,
+                 internalRate_);
+    return false;
+  }
+  pendingSinceUs_.store(hubNowUs(), std::memory_order_relaxed);
+  pending_.store(fx, std::memory_order_release);
+  return true;
+}
+
+bool FxEngine::retuneAt(int64_t frame) {
+  retunes_.schedule(frame);
+  return frame >= framesIn_;
+}
+
+FxEngine::SwitchStats FxEngine::switchStats() const {
+  SwitchStats s;
+  s.switches = switches_.load(std::memory_order_relaxed);
+  s.lastUs = (double)lastSwitchUs_.load(std::memory_order_relaxed);
+  s.maxUs = (double)maxSwitchUs_.load(std::memory_order_relaxed);
+  return s;
+}
+
+void FxEngine::applyPending() {
+  const CompiledFx* fx = pending_.exchange(nullptr, std::memory_order_acquire);
+  if (!fx) return;
+  size_t fadeLen = (size_t)(FADE_MS * internalRate_ / 1000);
+  for (Chain& c : chains_) {
+    c.bandpass.switchTaps(fx->bandpass, fadeLen);
+    c.reverb.switchSettings(fx->reverb, fadeLen);
+  }
+  preGain_.store(fx->preGain, std::memory_order_relaxed);
+  postGain_.store(fx->postGain, std::memory_order_relaxed);
+  contrast_ = fx->contrast;
+  // What apply_preset() changes; the rest is left as configured
+  params_.bpLow = fx->params.bpLow;
+  params_.bpHigh = fx->params.bpHigh;
+  params_.reverbRoom = fx->params.reverbRoom;
+  params_.reverbDamping = fx->params.reverbDamping;
+  params_.reverbWet = fx->params.reverbWet;
+  params_.reverbDry = fx->params.reverbDry;
+  params_.contrastAmount = fx->params.contrastAmount;
+  params_.preGainDb = fx->params.preGainDb;
+  params_.postGainDb = fx->params.postGainDb;
+
+  int64_t us = hubNowUs() - pendingSinceUs_.load(std::memory_order_relaxed);
+  switches_.fetch_add(1, std::memory_order_relaxed);
+  lastSwitchUs_.store(us, std::memory_order_relaxed);
+  if (us > maxSwitchUs_.load(std::memory_order_relaxed)) maxSwitchUs_.store(us, std::memory_order_relaxed);
+}
+
+namespace {
+
+// Gain from `from` at the block's start to `to` at its end
+inline void rampGain(float* x, size_t n, float from, float to) {
+  if (from == to) {
+    for (size_t i = 0; i < n; i++) x[i] *= to;
+    return;
+  }
+  float step = (to - from) / (float)n;
+  for (size_t i = 0; i < n; i++) x[i] *= from + step * (float)(i + 1);
+}
+
+}  // namespace
+
+void FxEngine::runChain(Chain& c, float* x, size_t n, const Levels& from, const Levels& to) {
+  c.highpass.process(x, n);
+  c.lowpass.process(x, n);
+  c.denoise.process(x, n);
+  c.agc.process(x, n);
+  rampGain(x, n, from.pre, to.pre);
+  c.bandpass.process(x, n);
+  if (from.contrast > 0.0f || to.contrast > 0.0f) {
+    // sox `contrast`: sin(d + k sin 4d) over the quarter wave
+    float step = (to.contrast - from.contrast) / (float)n;
+    for (size_t i = 0; i < n; i++) {
+      float k = from.contrast + step * (float)(i + 1);
+      float d = std::max(-1.0f, std::min(1.0f, x[i])) * (float)M_PI_2;
+      x[i] = std::sin(d + k * std::sin(d * 4.0f));
+    }
+  }
+  c.reverb.process(x, n);
+  rampGain(x, n, from.post, to.post);
+  c.limiter.process(x, n);
+}
+
+namespace {
+
+inline int16_t toS16(float v) {
+  v *= 32768.0f;
+  return (int16_t)std::lrint(std::max(-32768.0f, std::min(32767.0f, v)));
+}
+
+}  // namespace
+
+size_t FxEngine::process(const int16_t* in, size_t frames, int16_t* out) {
+  const float scale = 1.0f / 32768.0f;
+  applyPending();
+  // Gain changes, live or from a preset, ramp across the block
+  const Levels from = now_;
+  const Levels to = {preGain_.load(std::memory_order_relaxed), postGain_.load(std::memory_order_relaxed), contrast_};
+  now_ = to;
+  if (in_.size() < frames) in_.resize(frames);
+  const int64_t first = framesIn_;
+  framesIn_ += (int64_t)frames;
+
+  if (mode_ == Mode::Stereo) {
+    if (right_.size() < frames) right_.resize(frames);
+    for (size_t i = 0; i < frames; i++) {
+      in_[i] = (float)in[2 * i] * scale;
+      right_[i] = (float)in[2 * i + 1] * scale;
+    }
+    retunes_.process(in_.data(), frames, first);
+    retunes_.process(right_.data(), frames, first);
+    retunes_.retire(framesIn_);
+    runChain(chains_[0], in_.data(), frames, from, to);
+    runChain(chains_[1], right_.data(), frames, from, to);
+    for (size_t i = 0; i < frames; i++) out[2 * i] = out[2 * i + 1] = toS16((in_[i] + right_[i]) * 0.5f);
+    return frames;
+  }
+
+  for (size_t i = 0; i < frames; i++) in_[i] = ((float)in[2 * i] + (float)in[2 * i + 1]) * 0.5f * scale;
+  retunes_.process(in_.data(), frames, first);
+  retunes_.retire(framesIn_);
+  size_t internal = down_.maxOutput(frames);
+  if (work_.size() < internal) work_.resize(internal);
+  internal = down_.process(in_.data(), frames, work_.data());
+  runChain(chains_[0], work_.data(), internal, from, to);
+  size_t produced = up_.maxOutput(internal);
+  if (out_.size() < produced) out_.resize(produced);
+  produced = up_.process(work_.data(), internal, out_.data());
+  for (size_t i = 0; i < produced; i++) out[2 * i] = out[2 * i + 1] = toS16(out_[i]);
+  return produced;
+}
+
+}  // namespace oraclebox
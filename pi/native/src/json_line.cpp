@@ -0,0 +1,262 @@
+#include "oraclebox/json_line.h"
+
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+
+namespace oraclebox {
+
+namespace {
+
+void skipSpace(const std::string& s, size_t& i) {
+  while (i < s.size() && (s[i] == ' ' || s[i] == '\t' || s[i] == '\r' || s[i] == '\n')) i++;
+}
+
+// Unescapes a JSON string in place starting after the opening quote.
+// Returns the unescaped length, advances i past the closing quote.
+bool readString(std::string& s, size_t& i, size_t& start, size_t& len) {
+  start = i;
+  size_t out = i;
+  while (i < s.size()) {
+    char c = s[i++];
+    if (c == '"') {
+      len = out - start;
+      return true;
+    }
+    if (c == '\\') {
+      if (i >= s.size()) return false;
+      char e = s[i++];
+      switch (e) {
+        case 'n': c = '\n'; break;
+        case 't': c = '\t'; break;
+        case 'r': c = '\r'; break;
+        case 'b': c = '\b'; break;
+        case 'f': c = '\f'; break;
+        case 'u':
+          // Satellites never send \u escapes; keep a placeholder
+          if (i + 4 > s.size()) return false;
+          i += 4;
+          c = '?';
+          break;
+        default: c = e; break;
+      }
+    }
+    s[out++] = c;
+  }
+  return false;
+}
+
+// Skips a nested object/array, returning its raw extent.
+bool skipNested(const std::string& s, size_t& i) {
+  int depth = 0;
+  bool inString = false;
+  while (i < s.size()) {
+    char c = s[i++];
+    if (inString) {
+      if (c == '\\') i++;
+      else if (c == '"') inString = false;
+      continue;
+    }
+    if (c == '"') inString = true;
+    else if (c == '{' || c == '[') depth++;
+    else if (c == '}' || c == ']') {
+      if (--depth == 0) return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+bool JsonLine::parse(std::string_view line) {
+  buf_.assign(line.data(), line.size());
+  count_ = 0;
+
+  size_t i = 0;
+  skipSpace(buf_, i);
+  if (i >= buf_.size() || buf_[i] != '{') return false;
+  i++;
+
+  for (;;) {
+    skipSpace(buf_, i);
+    if (i >= buf_.size()) return false;
+    if (buf_[i] == '}') return true;
+    if (buf_[i] == ',') {
+      i++;
+      continue;
+    }
+    if (buf_[i] != '"') return false;
+    i++;
+
+    size_t keyStart, keyLen;
+    if (!readString(buf_, i, keyStart, keyLen)) return false;
+    skipSpace(buf_, i);
+    if (i >= buf_.size() || buf_[i] != ':') return false;
+    i++;
+    skipSpace(buf_, i);
+    if (i >= buf_.size()) return false;
+
+    Field f;
+    f.isString = false;
+    if (buf_[i] == '"') {
+      i++;
+      size_t valStart, valLen;
+      if (!readString(buf_, i, valStart, valLen)) return false;
+      f.value = std::string_view(buf_.data() + valStart, valLen);
+      f.isString = true;
+    } else if (buf_[i] == '{' || buf_[i] == '[') {
+      size_t valStart = i;
+      if (!skipNested(buf_, i)) return false;
+      f.value = std::string_view(buf_.data() + valStart, i - valStart);
+    } else {
+      size_t valStart = i;
+      while (i < buf_.size() && buf_[i] != ',' && buf_[i] != '}' && buf_[i] != ' ') i++;
+      f.value = std::string_view(buf_.data() + valStart, i - valStart);
+    }
+    f.key = std::string_view(buf_.data() + keyStart, keyLen);
+
+    if (count_ < MAX_FIELDS) fields_[count_++] = f;
+  }
+}
+
+const JsonLine::Field* JsonLine::find(std::string_view key) const {
+  for (int i = 0; i < count_; i++) {
+    if (fields_[i].key == key) return &fields_[i];
+  }
+  return nullptr;
+}
+
+bool JsonLine::has(std::string_view key) const {
+  return find(key) != nullptr;
+}
+
+std::string_view JsonLine::str(std::string_view key, std::string_view def) const {
+  const Field* f = find(key);
+  return f ? f->value : def;
+}
+
+double JsonLine::num(std::string_view key, double def) const {
+  const Field* f = find(key);
+  if (!f || f->isString || f->value.empty()) return def;
+  char tmp[64];
+  size_t n = f->value.size() < sizeof(tmp) - 1 ? f->value.size() : sizeof(tmp) - 1;
+  f->value.copy(tmp, n);
+  tmp[n] = '\0';
+  char* end = nullptr;
+  double v = std::strtod(tmp, &end);
+  return end == tmp ? def : v;
+}
+
+int64_t JsonLine::i64(std::string_view key, int64_t def) const {
+  const Field* f = find(key);
+  if (!f || f->isString || f->value.empty()) return def;
+  int64_t v = 0;
+  auto res = std::from_chars(f->value.data(), f->value.data() + f->value.size(), v);
+  if (res.ec != std::errc()) return def;
+  if (res.ptr != f->value.data() + f->value.size()) {
+    // Fractional value (e.g. "12.5") - round via double
+    return (int64_t)num(key, (double)def);
+  }
+  return v;
+}
+
+bool JsonLine::boolean(std::string_view key, bool def) const {
+  const Field* f = find(key);
+  if (!f || f->isString) return def;
+  if (f->value == "true") return true;
+  if (f->value == "false") return false;
+  return def;
+}
+
+// ==================== WRITER ====================
+
+void JsonWriter::key(std::string_view k) {
+  if (!body_.empty()) body_ += ',';
+  body_ += '"';
+  body_.append(k.data(), k.size());
+  body_ += "\":";
+}
+
+JsonWriter& JsonWriter::add(std::string_view k, std::string_view value) {
+  key(k);
+  body_ += '"';
+  for (char c : value) {
+    switch (c) {
+      case '"': body_ += "\\\""; break;
+      case '\\': body_ += "\\\\"; break;
+      case '\n': body_ += "\\n"; break;
+      case '\r': body_ += "\\r"; break;
+      case '\t': body_ += "\\t"; break;
+      default: body_ += c; break;
+    }
+  }
+  body_ += '"';
+  return *this;
+}
+
+JsonWriter& JsonWriter::add(std::string_view k, const char* value) {
+  return add(k, std::string_view(value ? value : ""));
+}
+
+JsonWriter& JsonWriter::add(std::string_view k, int64_t value) {
+  key(k);
+  char tmp[24];
+  auto res = std::to_chars(tmp, tmp + sizeof(tmp), value);
+  body_.append(tmp, res.ptr - tmp);
+  return *this;
+}
+
+JsonWriter& JsonWriter::add(std::string_view k, int value) {
+  return add(k, (int64_t)value);
+}
+
+JsonWriter& JsonWriter::add(std::string_view k, double value) {
+  key(k);
+  char tmp[32];
+  int n = std::snprintf(tmp, sizeof(tmp), "%.6g", value);
+  body_.append(tmp, n > 0 ? (size_t)n : 0);
+  return *this;
+}
+
+JsonWriter& JsonWriter::add(std::string_view k, bool value) {
+  key(k);
+  body_ += value ? "true" : "false";
+  return *this;
+}
+
+JsonWriter& JsonWriter::raw(std::string_view fields) {
+  if (fields.empty()) return *this;
+  if (!body_.empty()) body_ += ',';
+  body_.append(fields.data(), fields.size());
+  return *this;
+}
+
+std::string JsonWriter::line() const {
+  std::string out;
+  out.reserve(body_.size() + 3);
+  out += '{';
+  out += body_;
+  out += "}\n";
+  return out;
+}
+
+std::string compactJson(std::string_view text) {
+  std::string out;
+  out.reserve(text.size());
+  bool inString = false, escaped = false;
+  for (char c : text) {
+    if (inString) {
+      if (escaped) escaped = false;
+      else if (c == '\\') escaped = true;
+      else if (c == '"') inString = false;
+    } else if (c == '"') {
+      inString = true;
+    } else if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+      continue;
+    }
+    out += c;
+  }
+  return out;
+}
+
+}  // namespace oraclebox
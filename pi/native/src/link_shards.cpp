@@ -0,0 +1,171 @@
+#include "oraclebox/link_shards.h"
+
+#include <cstdio>
+
+namespace oraclebox {
+
+namespace {
+
+// Which shard the calling thread runs, so commands for local devices skip
+// the mailbox
+thread_local const LinkShards* tlsOwner = nullptr;
+thread_local int tlsShard = -1;
+
+}  // namespace
+
+LinkShards::LinkShards(int shards) {
+  if (shards < 1) shards = 1;
+  for (int i = 0; i < shards; i++) {
+    shards_.push_back(std::make_unique<Shard>());
+    shards_.back()->link.setReusePort(shards > 1);
+  }
+}
+
+LinkShards::~LinkShards() { stop(); }
+
+void LinkShards::setRateLimit(double linesPerSec, double burst) {
+  // One limiter for every shard: a device's budget follows it across shards
+  auto limiter = linesPerSec > 0 ? std::make_shared<RateLimiter>(linesPerSec, burst) : nullptr;
+  for (auto& s : shards_) s->link.setRateLimiter(limiter);
+}
+
+bool LinkShards::listen(uint16_t port) {
+  for (size_t i = 0; i < shards_.size(); i++) {
+    SatelliteLink& link = shards_[i]->link;
+    if (!link.listen(port)) {
+      for (auto& s : shards_) s->link.close();
+      return false;
+    }
+
+    int index = (int)i;
+    link.onLine([this](SatelliteConn& conn, const JsonLine& msg, int64_t rxUs) {
+      if (lineHandler_) lineHandler_(conn, msg, rxUs);
+    });
+    link.onIdentify([this, index](SatelliteConn& conn) {
+      std::lock_guard<std::mutex> lock(directoryMutex_);
+      directory_[conn.deviceId] = DeviceRoute{index, conn.deviceType};
+    });
+    link.onDisconnect([this, index, &link](SatelliteConn& conn) {
+      if (disconnectHandler_) disconnectHandler_(conn);
+      if (conn.deviceId.empty()) return;
+      // A reconnect may already have registered the device again
+      bool stillHere = false;
+      link.forEach([&](SatelliteConn& other) {
+        if (&other != &conn && other.deviceId == conn.deviceId) stillHere = true;
+      });
+      if (stillHere) return;
+      std::lock_guard<std::mutex> lock(directoryMutex_);
+      auto it = directory_.find(conn.deviceId);
+      if (it != directory_.end() && it->second.shard == index) directory_.erase(it);
+    });
+  }
+  return true;
+}
+
+void LinkShards::start() {
+  if (running_.exchange(true)) return;
+  for (size_t i = 0; i < shards_.size(); i++) {
+    shards_[i]->thread = std::thread(&LinkShards::run, this, (int)i);
+  }
+}
+
+void LinkShards::stop() {
+  if (running_.exchange(false)) {
+    for (auto& s : shards_) s->link.post([](SatelliteLink&) {});   // wake poll()
+    for (auto& s : shards_) {
+      if (s->thread.joinable()) s->thread.join();
+    }
+  }
+  for (auto& s : shards_) {
+    s->link.close();
+    s->conns.store(0, std::memory_order_relaxed);
+  }
+}
+
+void LinkShards::run(int index) {
+  tlsOwner = this;
+  tlsShard = index;
+  Shard& shard = *shards_[index];
+  while (running_.load(std::memory_order_acquire)) {
+    int n = shard.link.poll(200);
+    if (n < 0) {
+      std::fprintf(stderr, "[LINK] Shard %d stopped\n", index);
+      break;
+    }
+    shard.conns.store(shard.link.connectionCount(), std::memory_order_relaxed);
+    shard.throttled.store(shard.link.throttleCount(), std::memory_order_relaxed);
+    if (n > 0) {
+      shard.lines.fetch_add((uint64_t)n, std::memory_order_relaxed);
+      if (batchHandler_) batchHandler_();
+    }
+  }
+  tlsOwner = nullptr;
+  tlsShard = -1;
+}
+
+int LinkShards::currentShard() const { return tlsOwner == this ? tlsShard : -1; }
+
+int LinkShards::shardOf(std::string_view deviceId) {
+  std::lock_guard<std::mutex> lock(directoryMutex_);
+  auto it = directory_.find(std::string(deviceId));
+  return it == directory_.end() ? -1 : it->second.shard;
+}
+
+// ==================== COMMANDS ====================
+
+bool LinkShards::sendTo(std::string_view deviceId, std::string_view line) {
+  int target = shardOf(deviceId);
+  if (target < 0) return false;
+  if (target == currentShard()) return shards_[target]->link.sendTo(deviceId, line);
+  shards_[target]->link.post([id = std::string(deviceId), text = std::string(line)](SatelliteLink& link) {
+    link.sendTo(id, text);
+  });
+  return true;
+}
+
+int LinkShards::broadcast(std::string_view deviceType, std::string_view line) {
+  int self = currentShard();
+  int sent = 0;
+  std::vector<bool> targets(shards_.size(), false);
+  {
+    std::lock_guard<std::mutex> lock(directoryMutex_);
+    for (auto& kv : directory_) {
+      if (kv.second.shard == self) continue;   // counted by the direct call
+      if (!deviceType.empty() && kv.second.type != deviceType) continue;
+      targets[kv.second.shard] = true;
+      sent++;
+    }
+  }
+  for (size_t i = 0; i < shards_.size(); i++) {
+    if ((int)i == self) {
+      sent += shards_[i]->link.broadcast(deviceType, line);
+    } else if (targets[i]) {
+      shards_[i]->link.post([type = std::string(deviceType), text = std::string(line)](SatelliteLink& link) {
+        link.broadcast(type, text);
+      });
+    }
+  }
+  return sent;
+}
+
+// ==================== STATS ====================
+
+size_t LinkShards::connectionCount() const {
+  size_t n = 0;
+  for (auto& s : shards_) n += s->conns.load(std::memory_order_relaxed);
+  return n;
+}
+
+uint64_t LinkShards::linesDispatched() const {
+  uint64_t n = 0;
+  for (auto& s : shards_) n += s->lines.load(std::memory_order_relaxed);
+  return n;
+}
+
+uint64_t LinkShards::throttleCount() const {
+  uint64_t n = 0;
+  for (auto& s : shards_) n += s->throttled.load(std::memory_order_relaxed);
+  return n;
+}
+
+}  // namespace oraclebox
@@ -0,0 +1,255 @@
+#include "oraclebox/reflex_router.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+#include "oraclebox/hub_clock.h"
+
+namespace oraclebox {
+
+namespace {
+
+// A send waits this long for its reflex_ack; the cap bounds a burst
+constexpr int64_t ACK_TIMEOUT_US = 5000000;
+constexpr size_t MAX_PENDING_ACKS = 1024;
+
+}  // namespace
+
+// ==================== CONDITIONS ====================
+
+bool parseRuleOp(std::string_view s, ReflexRule::Op& op) {
+  if (s.empty()) op = ReflexRule::Op::Any;
+  else if (s == "==" || s == "=") op = ReflexRule::Op::Eq;
+  else if (s == "!=") op = ReflexRule::Op::Ne;
+  else if (s == "<") op = ReflexRule::Op::Lt;
+  else if (s == "<=") op = ReflexRule::Op::Le;
+  else if (s == ">") op = ReflexRule::Op::Gt;
+  else if (s == ">=") op = ReflexRule::Op::Ge;
+  else return false;
+  return true;
+}
+
+bool evalRuleOp(ReflexRule::Op op, double v, double value) {
+  switch (op) {
+    case ReflexRule::Op::Eq: return v == value;
+    case ReflexRule::Op::Ne: return v != value;
+    case ReflexRule::Op::Lt: return v < value;
+    case ReflexRule::Op::Le: return v <= value;
+    case ReflexRule::Op::Gt: return v > value;
+    case ReflexRule::Op::Ge: return v >= value;
+    default: return true;
+  }
+}
+
+// ==================== STATS ====================
+
+void ReflexStats::add(int64_t us) {
+  if (us < 0) us = 0;
+  int b = (int)std::min<int64_t>(us / BUCKET_US, BUCKETS - 1);
+  buckets_[b]++;
+  count_++;
+  sumUs_ += us;
+  maxUs_ = std::max(maxUs_, us);
+}
+
+double ReflexStats::percentileMs(double p) const {
+  if (!count_) return 0.0;
+  int64_t rank = (int64_t)(p / 100.0 * (count_ - 1)) + 1;
+  int64_t seen = 0;
+  for (int b = 0; b < BUCKETS; b++) {
+    seen += buckets_[b];
+    if (seen >= rank) return std::min((b + 1) * BUCKET_US / 1000.0, maxMs());  // bucket upper edge
+  }
+  return maxMs();
+}
+
+// ==================== RULES ====================
+
+bool ReflexRouter::loadFile(const std::string& path) {
+  std::ifstream in(path);
+  if (!in) {
+    std::fprintf(stderr, "[REFLEX] Cannot open rules file %s\n", path.c_str());
+    return false;
+  }
+  JsonLine def;
+  std::string line;
+  int lineNo = 0;
+  bool ok = true;
+  while (std::getline(in, line)) {
+    lineNo++;
+    size_t start = line.find_first_not_of(" \t\r");
+    if (start == std::string::npos || line[start] == '#') continue;
+    std::string error;
+    if (!def.parse(line) || !addRule(def, &error)) {
+      std::fprintf(stderr, "[REFLEX] %s:%d: %s\n", path.c_str(), lineNo,
+                   error.empty() ? "malformed rule" : error.c_str());
+      ok = false;
+    }
+  }
+  compile();
+  return ok;
+}
+
+bool ReflexRouter::addRule(const JsonLine& def, std::string* error) {
+  ReflexRule r;
+  r.name = std::string(def.str("name"));
+  r.source = std::string(def.str("source", "*"));
+  r.event = std::string(def.str("event"));
+  r.field = std::string(def.str("field"));
+  r.value = def.num("value");
+  r.target = std::string(def.str("target"));
+  r.command = std::string(def.str("send"));
+  r.cooldownMs = (int)def.i64("cooldown_ms");
+
+  if (r.event.empty() || r.target.empty()) {
+    if (error) *error = "rule needs \"event\" and \"target\"";
+    return false;
+  }
+  if (!parseRuleOp(def.str("op"), r.op)) {
+    if (error) *error = "unknown op \"" + std::string(def.str("op")) + "\"";
+    return false;
+  }
+  if (r.op != ReflexRule::Op::Any && r.field.empty()) {
+    if (error) *error = "condition needs a \"field\"";
+    return false;
+  }
+  // Commands are sent with route_us, route_id and the rule name added, so only the
+  // fields are kept
+  if (r.command.size() < 2 || r.command.front() != '{' || r.command.back() != '}') {
+    if (error) *error = "\"send\" must be a JSON object";
+    return false;
+  }
+  size_t first = r.command.find_first_not_of(" \t", 1);
+  size_t last = r.command.find_last_not_of(" \t", r.command.size() - 2);
+  r.command = first <= last && last != std::string::npos ? r.command.substr(first, last - first + 1) : "";
+  if (r.name.empty()) r.name = r.source + ":" + r.event + "->" + r.target;
+
+  rules_.push_back(std::move(r));
+  return true;
+}
+
+uint64_t ReflexRouter::key(std::string_view source, std::string_view event) {
+  // FNV-1a over "source\0event"
+  uint64_t h = 1469598103934665603ULL;
+  for (char c : source) h = (h ^ (uint8_t)c) * 1099511628211ULL;
+  h = (h ^ 0) * 1099511628211ULL;
+  for (char c : event) h = (h ^ (uint8_t)c) * 1099511628211ULL;
+  return h;
+}
+
+void ReflexRouter::compile() {
+  // Group rules by (source, event) into contiguous runs of one flat array,
+  // keeping file order within a group
+  std::vector<uint32_t> order(rules_.size());
+  for (uint32_t i = 0; i < order.size(); i++) order[i] = i;
+  std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+    return key(rules_[a].source, rules_[a].event) < key(rules_[b].source, rules_[b].event);
+  });
+
+  compiled_.clear();
+  table_.clear();
+  for (uint32_t idx : order) {
+    const ReflexRule& r = rules_[idx];
+    uint64_t k = key(r.source, r.event);
+    auto it = table_.find(k);
+    if (it == table_.end()) table_[k] = Span{(uint32_t)compiled_.size(), 1};
+    else it->second.count++;
+    compiled_.push_back(Compiled{idx, 0});
+  }
+}
+
+bool ReflexRouter::matches(const ReflexRule& rule, const JsonLine& msg) {
+  if (rule.op == ReflexRule::Op::Any) return true;
+  if (!msg.has(rule.field)) return false;
+  return evalRuleOp(rule.op, msg.num(rule.field, 0.0), rule.value);
+}
+
+// ==================== ROUTING ====================
+
+int ReflexRouter::route(CommandSink& link, const SatelliteConn& from, const JsonLine& msg, int64_t rxUs) {
+  if (table_.empty()) return 0;
+  std::string_view event = msg.str("event");
+  if (event.empty()) return 0;
+  evaluated_++;
+
+  const std::string_view sources[3] = {from.deviceId, from.deviceType, "*"};
+  int sent = 0;
+  for (int s = 0; s < 3; s++) {
+    if (sources[s].empty()) continue;
+    auto it = table_.find(key(sources[s], event));
+    if (it == table_.end()) continue;
+    for (uint32_t i = 0; i < it->second.count; i++) {
+      Compiled& c = compiled_[it->second.first + i];
+      const ReflexRule& r = rules_[c.rule];
+      // Hash collisions are possible, so confirm the strings
+      if (r.source != sources[s] || r.event != event) continue;
+      if (!matches(r, msg)) continue;
+      sent += fire(link, c, from, rxUs);
+    }
+  }
+  return sent;
+}
+
+int ReflexRouter::fire(CommandSink& link, Compiled& c, const SatelliteConn& from, int64_t rxUs) {
+  const ReflexRule& r = rules_[c.rule];
+  if (r.cooldownMs > 0 && c.lastFiredUs != 0 && rxUs - c.lastFiredUs < (int64_t)r.cooldownMs * 1000) {
+    suppressed_++;
+    return 0;
+  }
+  c.lastFiredUs = rxUs;
+
+  int64_t routeId = nextRouteId_++;
+  std::string out =
+      JsonWriter().raw(r.command).add("route_us", rxUs).add("route_id", routeId).add("rule", r.name).line();
+
+  // Target by device id first, then by type
+  int sent = 0;
+  if (link.sendTo(r.target, out)) sent = 1;
+  else sent = link.broadcast(r.target, out);
+
+  if (sent == 0) {
+    std::fprintf(stderr, "[REFLEX] %s: target %s not connected\n", r.name.c_str(), r.target.c_str());
+    return 0;
+  }
+  fired_++;
+
+  int64_t now = hubNowUs();
+  expireAcks(now);
+  pendingSendUs_.emplace(routeId, now);
+  pendingOrder_.push_back(routeId);
+  std::printf("[REFLEX] %s: %s/%s -> %s (dispatch %lld us)\n", r.name.c_str(), from.deviceId.c_str(),
+              r.event.c_str(), r.target.c_str(), (long long)(now - rxUs));
+  return sent;
+}
+
+// Sends are appended in time order, so the expired ones are at the front
+void ReflexRouter::expireAcks(int64_t now) {
+  while (!pendingOrder_.empty()) {
+    auto it = pendingSendUs_.find(pendingOrder_.front());
+    if (pendingOrder_.size() < MAX_PENDING_ACKS && now - it->second <= ACK_TIMEOUT_US) break;
+    pendingSendUs_.erase(it);
+    pendingOrder_.pop_front();
+  }
+}
+
+bool ReflexRouter::onAck(const JsonLine& msg, int64_t rxUs) {
+  if (msg.str("event") != "reflex_ack") return false;
+  expireAcks(hubNowUs());
+  int64_t routeUs = msg.i64("route_us");
+  auto it = pendingSendUs_.find(msg.i64("route_id"));
+  // Kept until it ages out: a rule targeting a device type gets one ack per box.
+  // Firmware that does not echo route_id falls back to the dispatch-free estimate.
+  int64_t sendUs = it != pendingSendUs_.end() ? it->second : routeUs;
+
+  int64_t latencyUs;
+  if (msg.has("action_hub_us")) {
+    latencyUs = msg.i64("action_hub_us") - routeUs;
+  } else {
+    latencyUs = (sendUs - routeUs) + (rxUs - sendUs) / 2;
+  }
+  stats_.add(latencyUs);
+  return true;
+}
+
+}  // namespace oraclebox
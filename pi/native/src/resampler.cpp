@@ -0,0 +1,95 @@
+#include "oraclebox/resampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace oraclebox {
+
+namespace {
+
+double besselI0(double x) {
+  double sum = 1.0, term = 1.0;
+  for (int k = 1; k < 50; k++) {
+    term *= (x / (2.0 * k)) * (x / (2.0 * k));
+    sum += term;
+    if (term < sum * 1e-12) break;
+  }
+  return sum;
+}
+
+}  // namespace
+
+std::vector<float> designLowpass(int taps, double cutoffHz, double rate, double attenuationDb) {
+  double beta = attenuationDb > 50.0   ? 0.1102 * (attenuationDb - 8.7)
+                : attenuationDb > 21.0 ? 0.5842 * std::pow(attenuationDb - 21.0, 0.4) + 0.07886 * (attenuationDb - 21.0)
+                                       : 0.0;
+  double fc = cutoffHz / rate;
+  double mid = (taps - 1) / 2.0;
+  double norm = besselI0(beta);
+  std::vector<double> h((size_t)taps);
+  double sum = 0.0;
+  for (int i = 0; i < taps; i++) {
+    double t = i - mid;
+    double sinc = t == 0.0 ? 2.0 * fc : std::sin(2.0 * M_PI * fc * t) / (M_PI * t);
+    double r = mid > 0 ? t / mid : 0.0;
+    h[(size_t)i] = sinc * besselI0(beta * std::sqrt(std::max(0.0, 1.0 - r * r))) / norm;
+    sum += h[(size_t)i];
+  }
+  std::vector<float> out((size_t)taps);
+  for (int i = 0; i < taps; i++) out[(size_t)i] = (float)(h[(size_t)i] / sum);
+  return out;
+}
+
+// ==================== POLYPHASE ====================
+
+void PolyphaseResampler::setup(int inRate, int outRate) {
+  inRate_ = inRate;
+  outRate_ = outRate;
+  int g = std::gcd(inRate, outRate);
+  up_ = outRate / g;
+  down_ = inRate / g;
+
+  const int T = TAPS_PER_PHASE;
+  double low = std::min(inRate, outRate);
+  std::vector<float> proto = designLowpass(up_ * T, 0.5 * low, (double)inRate * up_, 70.0);
+  phases_.assign((size_t)up_ * T, 0.0f);
+  for (int p = 0; p < up_; p++) {
+    // Reversed, so the dot product runs over the history oldest first;
+    // x L restores the level the zero-stuffing took away
+    for (int j = 0; j < T; j++) phases_[(size_t)p * T + (T - 1 - j)] = proto[(size_t)(p + j * up_)] * (float)up_;
+  }
+  reset();
+}
+
+void PolyphaseResampler::reset() {
+  history_.assign((size_t)TAPS_PER_PHASE * 2, 0.0f);
+  head_ = 0;
+  phase_ = 0;
+}
+
+size_t PolyphaseResampler::process(const float* in, size_t n, float* out) {
+  const size_t T = TAPS_PER_PHASE;
+  if (passthrough()) {
+    std::copy(in, in + n, out);
+    return n;
+  }
+  size_t produced = 0;
+  for (size_t i = 0; i < n; i++) {
+    // Written twice, so the newest T samples are always contiguous
+    history_[head_] = history_[head_ + T] = in[i];
+    head_ = head_ + 1 == T ? 0 : head_ + 1;
+    const float* window = history_.data() + head_;
+    while (phase_ < up_) {
+      const float* c = phases_.data() + (size_t)phase_ * T;
+      float acc = 0.0f;
+      for (size_t j = 0; j < T; j++) acc += c[j] * window[j];
+      out[produced++] = acc;
+      phase_ += down_;
+    }
+    phase_ -= up_;
+  }
+  return produced;
+}
+
+}  // namespace oraclebox
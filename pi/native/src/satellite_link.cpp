@@ -0,0 +1,490 @@
+#include "oraclebox/satellite_link.h"
+
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <vector>
+
+#include "oraclebox/hub_clock.h"
+
+namespace oraclebox {
+
+namespace {
+
+constexpr size_t MAX_LINE_BYTES = 4096;      // satellites send < 300 bytes per line
+constexpr size_t MAX_TX_BACKLOG = 64 * 1024; // drop a satellite that stops reading
+constexpr int MAX_EVENTS = 64;
+
+bool setNonBlocking(int fd) {
+  int flags = fcntl(fd, F_GETFL, 0);
+  return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+}  // namespace
+
+SatelliteLink::SatelliteLink() = default;
+
+SatelliteLink::~SatelliteLink() {
+  close();
+}
+
+void SatelliteLink::setRateLimit(double linesPerSec, double burst) {
+  limiter_ = linesPerSec > 0 ? std::make_shared<RateLimiter>(linesPerSec, burst) : nullptr;
+}
+
+bool SatelliteLink::listen(uint16_t port) {
+  close();
+
+  listenFd_ = socket(AF_INET, SOCK_STREAM, 0);
+  if (listenFd_ < 0) {
+    std::fprintf(stderr, "[LINK] socket() failed: %s\n", std::strerror(errno));
+    return false;
+  }
+  int one = 1;
+  setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  if (reusePort_ && setsockopt(listenFd_, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) < 0) {
+    std::fprintf(stderr, "[LINK] SO_REUSEPORT failed: %s\n", std::strerror(errno));
+    close();
+    return false;
+  }
+
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons(port);
+  if (bind(listenFd_, (sockaddr*)&addr, sizeof(addr)) < 0 || ::listen(listenFd_, 32) < 0) {
+    std::fprintf(stderr, "[LINK] bind/listen on port %u failed: %s\n", port, std::strerror(errno));
+    close();
+    return false;
+  }
+  setNonBlocking(listenFd_);
+
+  epollFd_ = epoll_create1(EPOLL_CLOEXEC);
+  if (epollFd_ < 0) {
+    std::fprintf(stderr, "[LINK] epoll_create1 failed: %s\n", std::strerror(errno));
+    close();
+    return false;
+  }
+  epoll_event ev{};
+  ev.events = EPOLLIN;
+  ev.data.fd = listenFd_;
+  epoll_ctl(epollFd_, EPOLL_CTL_ADD, listenFd_, &ev);
+
+  wakeFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (wakeFd_ < 0) {
+    std::fprintf(stderr, "[LINK] eventfd failed: %s\n", std::strerror(errno));
+    close();
+    return false;
+  }
+  ev.data.fd = wakeFd_;
+  epoll_ctl(epollFd_, EPOLL_CTL_ADD, wakeFd_, &ev);
+  return true;
+}
+
+void SatelliteLink::close() {
+  for (auto& kv : conns_) ::close(kv.first);
+  conns_.clear();
+  if (epollFd_ >= 0) ::close(epollFd_);
+  if (listenFd_ >= 0) ::close(listenFd_);
+  if (wakeFd_ >= 0) ::close(wakeFd_);
+  epollFd_ = -1;
+  listenFd_ = -1;
+  wakeFd_ = -1;
+  throttledConns_ = 0;
+}
+
+void SatelliteLink::post(std::function<void(SatelliteLink&)> fn) {
+  {
+    std::lock_guard<std::mutex> lock(postMutex_);
+    posted_.push_back(std::move(fn));
+  }
+  uint64_t one = 1;
+  if (wakeFd_ >= 0 && ::write(wakeFd_, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+    std::fprintf(stderr, "[LINK] wake failed: %s\n", std::strerror(errno));
+  }
+}
+
+void SatelliteLink::runPosted() {
+  uint64_t count;
+  while (::read(wakeFd_, &count, sizeof(count)) > 0) {
+  }
+  std::vector<std::function<void(SatelliteLink&)>> batch;
+  {
+    std::lock_guard<std::mutex> lock(postMutex_);
+    batch.swap(posted_);
+  }
+  for (auto& fn : batch) fn(*this);
+}
+
+int SatelliteLink::poll(int timeoutMs) {
+  if (epollFd_ < 0) return -1;
+
+  int dispatched = 0;
+  if (throttledConns_ > 0) {
+    // Wake up in time for the first throttled satellite to have a token
+    int untilMs = serviceThrottled(hubNowUs(), dispatched);
+    if (dispatched > 0) timeoutMs = 0;
+    else if (timeoutMs < 0 || untilMs < timeoutMs) timeoutMs = untilMs;
+  }
+
+  epoll_event events[MAX_EVENTS];
+  int n = epoll_wait(epollFd_, events, MAX_EVENTS, timeoutMs);
+  if (n < 0) {
+    if (errno == EINTR) return dispatched;
+    std::fprintf(stderr, "[LINK] epoll_wait failed: %s\n", std::strerror(errno));
+    return -1;
+  }
+
+  for (int i = 0; i < n; i++) {
+    int fd = events[i].data.fd;
+    if (fd == listenFd_) {
+      acceptAll();
+      continue;
+    }
+    if (fd == wakeFd_) {
+      runPosted();
+      continue;
+    }
+    auto it = conns_.find(fd);
+    if (it == conns_.end()) continue;
+    SatelliteConn& conn = *it->second;
+
+    if (conn.throttled) {
+      // Only HUP/ERR arrive while EPOLLIN is off; hand over what was
+      // buffered and let the connection go
+      if (events[i].events & (EPOLLHUP | EPOLLERR)) {
+        drainRx(conn, hubNowUs(), dispatched, false);
+        conn.closing = true;
+      }
+    } else if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+      readConn(conn, hubNowUs(), dispatched);
+    }
+    if ((events[i].events & EPOLLOUT) && !conn.closing) {
+      if (!flushConn(conn)) conn.closing = true;
+    }
+  }
+  reapClosing();
+  return dispatched;
+}
+
+void SatelliteLink::acceptAll() {
+  for (;;) {
+    sockaddr_in addr{};
+    socklen_t len = sizeof(addr);
+    int fd = accept4(listenFd_, (sockaddr*)&addr, &len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+        std::fprintf(stderr, "[LINK] accept failed: %s\n", std::strerror(errno));
+      }
+      return;
+    }
+    // Commands and time_sync replies are tiny and latency-sensitive
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    auto conn = std::make_unique<SatelliteConn>();
+    conn->fd = fd;
+    char ip[INET_ADDRSTRLEN] = {0};
+    inet_ntop(AF_INET, &addr.sin_addr, ip, sizeof(ip));
+    conn->address = ip;
+    conn->peer = conn->address + ":" + std::to_string(ntohs(addr.sin_port));
+    conn->connectedUs = hubNowUs();
+    conn->lastSeenUs = conn->connectedUs;
+
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &ev);
+    conns_[fd] = std::move(conn);
+  }
+}
+
+void SatelliteLink::readConn(SatelliteConn& conn, int64_t rxUs, int& dispatched) {
+  char buf[2048];
+  for (;;) {
+    ssize_t n = ::read(conn.fd, buf, sizeof(buf));
+    if (n > 0) {
+      conn.lastSeenUs = rxUs;
+      size_t start = 0;
+      for (ssize_t i = 0; i < n; i++) {
+        if (buf[i] != '\n') continue;
+        bool partial = !conn.rx.empty();
+        if (partial) conn.rx.append(buf + start, i - start);
+        std::string_view line = partial ? std::string_view(conn.rx) : std::string_view(buf + start, i - start);
+        if (!takeToken(conn, line, rxUs)) {
+          // Over budget: keep this line and the rest for serviceThrottled()
+          // and stop reading
+          if (partial) conn.rx.append(buf + i, n - i);
+          else conn.rx.append(buf + start, n - start);
+          setThrottled(conn, true);
+          return;
+        }
+        handleLine(conn, line, rxUs);
+        conn.rx.clear();
+        dispatched++;
+        start = i + 1;
+      }
+      conn.rx.append(buf + start, n - start);
+      if (conn.rx.size() > MAX_LINE_BYTES) {
+        std::fprintf(stderr, "[LINK] %s sent an oversized line, dropping\n", conn.peer.c_str());
+        conn.closing = true;
+        return;
+      }
+      continue;
+    }
+    if (n == 0) {
+      // Peer closed; a final line without '\n' still counts
+      if (!conn.rx.empty()) {
+        handleLine(conn, conn.rx, rxUs);
+        conn.rx.clear();
+        dispatched++;
+      }
+      conn.closing = true;
+      return;
+    }
+    if (errno == EINTR) continue;
+    if (errno != EAGAIN && errno != EWOULDBLOCK) conn.closing = true;
+    return;
+  }
+}
+
+// ==================== RATE LIMIT ====================
+
+RateLimiter::RateLimiter(double linesPerSec, double burst)
+    : ratePerUs_(linesPerSec > 0 ? linesPerSec / 1e6 : 0.0), burst_(std::max(1.0, burst)) {}
+
+int64_t RateLimiter::take(std::string_view key, int64_t nowUs) {
+  if (ratePerUs_ <= 0.0) return 0;
+  Stripe& stripe = stripes_[std::hash<std::string_view>()(key) % STRIPES];
+  std::lock_guard<std::mutex> lock(stripe.mutex);
+
+  auto it = stripe.buckets.find(std::string(key));
+  if (it == stripe.buckets.end()) {
+    if (stripe.buckets.size() >= stripe.pruneAt) {
+      // A bucket idle long enough to be full again is the same as no bucket
+      int64_t fullUs = (int64_t)(burst_ / ratePerUs_);
+      for (auto b = stripe.buckets.begin(); b != stripe.buckets.end();) {
+        if (nowUs - b->second.refillUs >= fullUs) b = stripe.buckets.erase(b);
+        else ++b;
+      }
+      stripe.pruneAt = std::max<size_t>(64, stripe.buckets.size() * 2);
+    }
+    it = stripe.buckets.emplace(std::string(key), Bucket{burst_, nowUs}).first;
+  }
+
+  Bucket& b = it->second;
+  if (nowUs > b.refillUs) {
+    b.tokens = std::min(burst_, b.tokens + (nowUs - b.refillUs) * ratePerUs_);
+    b.refillUs = nowUs;
+  }
+  if (b.tokens >= 1.0) {
+    b.tokens -= 1.0;
+    return 0;
+  }
+  return (int64_t)((1.0 - b.tokens) / ratePerUs_) + 1;
+}
+
+// Whose budget a line comes out of. An unidentified connection's line is
+// parsed here for its id (handleLine parses it again; this is once per
+// connection), so a satellite that reconnects for every line is still
+// charged as itself.
+std::string_view SatelliteLink::rateKey(const SatelliteConn& conn, std::string_view line) {
+  if (!conn.deviceId.empty()) return conn.deviceId;
+  while (!line.empty() && (line.back() == '\r' || line.back() == ' ')) line.remove_suffix(1);
+  if (!line.empty() && msg_.parse(line)) {
+    std::string_view id = msg_.str("id");
+    if (!id.empty()) return id;
+  }
+  return conn.address;
+}
+
+bool SatelliteLink::takeToken(SatelliteConn& conn, std::string_view line, int64_t nowUs) {
+  if (!limiter_) return true;
+  int64_t waitUs = limiter_->take(rateKey(conn, line), nowUs);
+  if (waitUs == 0) return true;
+  conn.retryUs = nowUs + waitUs;
+  return false;
+}
+
+void SatelliteLink::setThrottled(SatelliteConn& conn, bool throttled) {
+  if (conn.throttled == throttled) return;
+  conn.throttled = throttled;
+  throttledConns_ += throttled ? 1 : -1;
+  if (throttled) throttleCount_++;
+  updateEvents(conn);
+}
+
+void SatelliteLink::updateEvents(SatelliteConn& conn) {
+  epoll_event ev{};
+  ev.events = (conn.throttled ? 0u : (uint32_t)EPOLLIN) | (conn.wantWrite ? (uint32_t)EPOLLOUT : 0u);
+  ev.data.fd = conn.fd;
+  epoll_ctl(epollFd_, EPOLL_CTL_MOD, conn.fd, &ev);
+}
+
+// Dispatches complete lines buffered in rx while tokens last (all of them
+// when not limited). Returns true once no complete line is left.
+bool SatelliteLink::drainRx(SatelliteConn& conn, int64_t nowUs, int& dispatched, bool limited) {
+  size_t start = 0;
+  bool drained = true;
+  for (;;) {
+    size_t nl = conn.rx.find('\n', start);
+    if (nl == std::string::npos) break;
+    std::string_view line = std::string_view(conn.rx).substr(start, nl - start);
+    if (limited && !takeToken(conn, line, nowUs)) {
+      drained = false;
+      break;
+    }
+    handleLine(conn, line, nowUs);
+    dispatched++;
+    start = nl + 1;
+  }
+  conn.rx.erase(0, start);
+  return drained;
+}
+
+// Resumes throttled connections that have tokens again. Returns how long
+// until the next one will, in ms.
+int SatelliteLink::serviceThrottled(int64_t nowUs, int& dispatched) {
+  int64_t soonestUs = 1000000000;
+  for (auto& kv : conns_) {
+    SatelliteConn& conn = *kv.second;
+    if (!conn.throttled || conn.closing) continue;
+    if (conn.retryUs <= nowUs && drainRx(conn, nowUs, dispatched)) {
+      setThrottled(conn, false);
+      continue;
+    }
+    soonestUs = std::min(soonestUs, std::max<int64_t>(conn.retryUs - nowUs, 0));
+  }
+  return (int)(soonestUs / 1000) + 1;
+}
+
+void SatelliteLink::handleLine(SatelliteConn& conn, std::string_view line, int64_t rxUs) {
+  while (!line.empty() && (line.back() == '\r' || line.back() == ' ')) line.remove_suffix(1);
+  if (line.empty()) return;
+
+  if (!msg_.parse(line)) {
+    std::fprintf(stderr, "[LINK] %s: malformed line: %.*s\n", conn.peer.c_str(), (int)line.size(), line.data());
+    return;
+  }
+
+  // Learn identity from whatever the satellite sends first
+  if (conn.deviceId.empty()) {
+    std::string_view id = msg_.str("id");
+    if (!id.empty()) {
+      conn.deviceId.assign(id.data(), id.size());
+      conn.deviceType = std::string(msg_.str("device"));
+      conn.location = std::string(msg_.str("location"));
+      if (identifyHandler_) identifyHandler_(conn);
+    }
+  }
+
+  if (msg_.str("event") == "time_sync") {
+    // NTP-style exchange: t1 = receive time, t2 = reply time
+    JsonWriter reply;
+    reply.add("cmd", "time_sync")
+        .add("t0", msg_.i64("t0"))
+        .add("t1", rxUs)
+        .add("t2", hubNowUs());
+    queueSend(conn, reply.line());
+    return;
+  }
+
+  if (lineHandler_) lineHandler_(conn, msg_, rxUs);
+}
+
+bool SatelliteLink::queueSend(SatelliteConn& conn, std::string_view line) {
+  if (conn.closing) return false;
+  if (conn.tx.size() + line.size() > MAX_TX_BACKLOG) {
+    std::fprintf(stderr, "[LINK] %s not reading, dropping\n", conn.peer.c_str());
+    conn.closing = true;
+    return false;
+  }
+  bool wasEmpty = conn.tx.empty();
+  conn.tx.append(line.data(), line.size());
+  if (!wasEmpty) return true;  // EPOLLOUT already armed
+  if (!flushConn(conn)) {
+    conn.closing = true;
+    return false;
+  }
+  return true;
+}
+
+bool SatelliteLink::flushConn(SatelliteConn& conn) {
+  while (!conn.tx.empty()) {
+    ssize_t n = ::send(conn.fd, conn.tx.data(), conn.tx.size(), MSG_NOSIGNAL);
+    if (n > 0) {
+      conn.tx.erase(0, (size_t)n);
+      continue;
+    }
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      if (!conn.wantWrite) {
+        conn.wantWrite = true;
+        updateEvents(conn);
+      }
+      return true;
+    }
+    return false;
+  }
+  if (conn.wantWrite) {
+    conn.wantWrite = false;
+    updateEvents(conn);
+  }
+  return true;
+}
+
+bool SatelliteLink::sendTo(std::string_view deviceId, std::string_view line) {
+  SatelliteConn* conn = findDevice(deviceId);
+  return conn && queueSend(*conn, line);
+}
+
+int SatelliteLink::broadcast(std::string_view deviceType, std::string_view line) {
+  int sent = 0;
+  for (auto& kv : conns_) {
+    SatelliteConn& conn = *kv.second;
+    if (conn.deviceId.empty()) continue;
+    if (!deviceType.empty() && conn.deviceType != deviceType) continue;
+    if (queueSend(conn, line)) sent++;
+  }
+  return sent;
+}
+
+SatelliteConn* SatelliteLink::findDevice(std::string_view deviceId) {
+  // Newest connection wins if a satellite reconnected before the old socket died
+  SatelliteConn* best = nullptr;
+  for (auto& kv : conns_) {
+    SatelliteConn& conn = *kv.second;
+    if (conn.closing || conn.deviceId != deviceId) continue;
+    if (!best || conn.connectedUs > best->connectedUs) best = &conn;
+  }
+  return best;
+}
+
+void SatelliteLink::reapClosing() {
+  std::vector<int> dead;
+  for (auto& kv : conns_) {
+    if (kv.second->closing) dead.push_back(kv.first);
+  }
+  for (int fd : dead) dropConn(fd);
+}
+
+void SatelliteLink::dropConn(int fd) {
+  auto it = conns_.find(fd);
+  if (it == conns_.end()) return;
+  if (disconnectHandler_) disconnectHandler_(*it->second);
+  if (it->second->throttled) throttledConns_--;
+  epoll_ctl(epollFd_, EPOLL_CTL_DEL, fd, nullptr);
+  ::close(fd);
+  conns_.erase(it);
+}
+
+}  // namespace oraclebox
@@ -0,0 +1,406 @@
+#include "oraclebox/sound_cache.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+extern char** environ;
+
+namespace oraclebox {
+
+namespace {
+
+uint16_t le16(const uint8_t* p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+uint32_t le32(const uint8_t* p) { return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24); }
+
+std::string extensionOf(const std::string& name) {
+  size_t dot = name.rfind('.');
+  std::string ext = dot == std::string::npos ? "" : name.substr(dot + 1);
+  for (char& c : ext) c = (char)std::tolower((unsigned char)c);
+  return ext;
+}
+
+int16_t toS16(float v) {
+  float s = std::round(v * 32767.0f);
+  return (int16_t)std::max(-32768.0f, std::min(32767.0f, s));
+}
+
+constexpr size_t MAX_WAV_HEADER = 1 << 20;   // chunks before "data"
+
+}  // namespace
+
+// ==================== DECODER ====================
+
+bool PcmDecoder::formatOf(const std::string& name, Format& format) {
+  std::string ext = extensionOf(name);
+  if (ext == "wav") format = Format::Wav;
+  else if (ext == "mp3") format = Format::Mp3;
+  else return false;
+  return true;
+}
+
+PcmDecoder::PcmDecoder(Format format, int rate, const std::string& label)
+    : format_(format), rate_(rate), label_(label) {
+  if (format_ == Format::Mp3 && !startMp3()) failed_ = true;
+}
+
+PcmDecoder::~PcmDecoder() {
+  // Not finished: abandon the decode rather than wait for it
+  if (pid_ >= 0) failed_ = true;
+  stopMp3();
+}
+
+size_t PcmDecoder::framesDecoded() const {
+  std::lock_guard<std::mutex> lock(outMutex_);
+  return out_.size() / 2;
+}
+
+bool PcmDecoder::feed(const uint8_t* data, size_t n) {
+  if (failed_) return false;
+  if (format_ == Format::Mp3) {
+    // mpg123 may stop reading early (bad stream); send() then fails instead
+    // of raising SIGPIPE
+    while (n > 0) {
+      ssize_t w = ::send(inFd_, data, n, MSG_NOSIGNAL);
+      if (w < 0 && errno == EINTR) continue;
+      if (w <= 0) {
+        std::fprintf(stderr, "[SOUND] %s: mpg123 stopped reading\n", label_.c_str());
+        failed_ = true;
+        return false;
+      }
+      data += w;
+      n -= (size_t)w;
+    }
+    return true;
+  }
+
+  if (inData_) {
+    feedWavData(data, n);
+    return true;
+  }
+  header_.insert(header_.end(), data, data + n);
+  if (!parseWavHeader()) failed_ = true;
+  return !failed_;
+}
+
+// Walks the chunks collected so far. Returns false on a file that cannot
+// be a usable WAV; true while it is still waiting for the data chunk.
+bool PcmDecoder::parseWavHeader() {
+  if (header_.size() < 12) return true;
+  if (std::memcmp(header_.data(), "RIFF", 4) != 0 || std::memcmp(header_.data() + 8, "WAVE", 4) != 0) {
+    std::fprintf(stderr, "[SOUND] %s: not a RIFF/WAVE file\n", label_.c_str());
+    return false;
+  }
+  while (headerPos_ + 8 <= header_.size()) {
+    const uint8_t* chunk = header_.data() + headerPos_;
+    uint32_t size = le32(chunk + 4);
+    if (!std::memcmp(chunk, "data", 4)) {
+      bool pcm = wavFormat_ == 1 && (bits_ == 8 || bits_ == 16 || bits_ == 24 || bits_ == 32);
+      bool flt = wavFormat_ == 3 && bits_ == 32;
+      if (channels_ < 1 || srcRate_ <= 0 || (!pcm && !flt)) {
+        std::fprintf(stderr, "[SOUND] %s: unsupported WAV (format %d, %d bit, %d ch)\n", label_.c_str(), wavFormat_,
+                     bits_, channels_);
+        return false;
+      }
+      // Streamed WAVs leave the size at 0 or ~0: data runs to the end
+      inData_ = true;
+      dataLeft_ = size == 0 || size == 0xFFFFFFFFu ? UINT64_MAX : size;
+      std::vector<uint8_t> rest(header_.begin() + (long)headerPos_ + 8, header_.end());
+      header_.clear();
+      header_.shrink_to_fit();
+      feedWavData(rest.data(), rest.size());
+      return true;
+    }
+    size_t next = headerPos_ + 8 + size + (size & 1);
+    if (next > header_.size()) break;   // wait for the whole chunk
+    if (!std::memcmp(chunk, "fmt ", 4) && size >= 16) {
+      wavFormat_ = le16(chunk + 8);
+      channels_ = le16(chunk + 10);
+      srcRate_ = (int)le32(chunk + 12);
+      bits_ = le16(chunk + 22);
+      if (wavFormat_ == 0xFFFE && size >= 26) wavFormat_ = le16(chunk + 32);   // WAVE_FORMAT_EXTENSIBLE sub-format
+    }
+    headerPos_ = next;
+  }
+  if (header_.size() > MAX_WAV_HEADER) {
+    std::fprintf(stderr, "[SOUND] %s: no data chunk\n", label_.c_str());
+    return false;
+  }
+  return true;
+}
+
+void PcmDecoder::feedWavData(const uint8_t* data, size_t n) {
+  if ((uint64_t)n > dataLeft_) n = (size_t)dataLeft_;   // chunks after the data are not samples
+  dataLeft_ -= n;
+
+  int bytes = bits_ / 8;
+  size_t frameBytes = (size_t)bytes * channels_;
+  bool flt = wavFormat_ == 3;
+  auto sample = [&](const uint8_t* p) -> float {
+    if (flt) {
+      float f;
+      std::memcpy(&f, p, 4);
+      return f;
+    }
+    switch (bytes) {
+      case 1: return ((int)p[0] - 128) / 128.0f;
+      case 2: return (int16_t)le16(p) / 32768.0f;
+      case 3: return (int32_t)((uint32_t)p[0] << 8 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 24) / 2147483648.0f;
+      default: return (int32_t)le32(p) / 2147483648.0f;
+    }
+  };
+  auto frame = [&](const uint8_t* f) {
+    float l = sample(f);
+    pending_.push_back(l);
+    pending_.push_back(channels_ > 1 ? sample(f + bytes) : l);   // mono to both sides; extra channels dropped
+  };
+
+  // Finish a frame split across chunks, then whole frames in place
+  if (!partial_.empty()) {
+    size_t take = std::min(n, frameBytes - partial_.size());
+    partial_.insert(partial_.end(), data, data + take);
+    data += take;
+    n -= take;
+    if (partial_.size() < frameBytes) return;
+    frame(partial_.data());
+    partial_.clear();
+  }
+  size_t frames = n / frameBytes;
+  pending_.reserve(pending_.size() + frames * 2);
+  for (size_t i = 0; i < frames; i++) frame(data + i * frameBytes);
+  partial_.assign(data + frames * frameBytes, data + n);
+  resample(false);
+}
+
+// Stereo float frames at srcRate_ to S16 at rate_. Linear interpolation:
+// the clips are alerts and chimes, and this runs once per file. Output
+// frame i sits at input frame i * srcRate_ / rate_; without `last` it stops
+// where the next input frame is still needed.
+void PcmDecoder::resample(bool last) {
+  uint64_t total = base_ + pending_.size() / 2;
+  std::lock_guard<std::mutex> lock(outMutex_);
+  if (srcRate_ == rate_) {
+    out_.reserve(out_.size() + pending_.size());
+    for (float v : pending_) out_.push_back(toS16(v));
+    pending_.clear();
+    base_ = total;
+    return;
+  }
+  double step = (double)srcRate_ / rate_;
+  uint64_t limit = last ? (uint64_t)((double)total * rate_ / srcRate_) : UINT64_MAX;
+  for (; outIndex_ < limit; outIndex_++) {
+    double pos = outIndex_ * step;
+    uint64_t a = (uint64_t)pos;
+    if (!last && a + 1 >= total) break;
+    uint64_t b = std::min(a + 1, total - 1);
+    float t = (float)(pos - a);
+    const float* fa = pending_.data() + (a - base_) * 2;
+    const float* fb = pending_.data() + (b - base_) * 2;
+    out_.push_back(toS16(fa[0] + (fb[0] - fa[0]) * t));
+    out_.push_back(toS16(fa[1] + (fb[1] - fa[1]) * t));
+  }
+  uint64_t keep = std::min<uint64_t>((uint64_t)(outIndex_ * step), total);
+  pending_.erase(pending_.begin(), pending_.begin() + (long)((keep - base_) * 2));
+  base_ = keep;
+}
+
+// mpg123 decodes straight to S16 stereo at the cache rate, reading the
+// file from stdin as it is fed and writing to a pipe drained by reader_.
+bool PcmDecoder::startMp3() {
+  int in[2], out[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, in) != 0) return false;
+  if (pipe2(out, O_CLOEXEC) != 0) {
+    ::close(in[0]);
+    ::close(in[1]);
+    return false;
+  }
+  std::string rateArg = std::to_string(rate_);
+  const char* argv[] = {"mpg123", "-q", "-s", "-e", "s16", "--stereo", "-r", rateArg.c_str(), "-", nullptr};
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_adddup2(&actions, in[1], STDIN_FILENO);
+  posix_spawn_file_actions_adddup2(&actions, out[1], STDOUT_FILENO);
+  pid_t pid;
+  int err = posix_spawnp(&pid, "mpg123", &actions, nullptr, const_cast<char* const*>(argv), environ);
+  posix_spawn_file_actions_destroy(&actions);
+  ::close(in[1]);
+  ::close(out[1]);
+  if (err != 0) {
+    ::close(in[0]);
+    ::close(out[0]);
+    std::fprintf(stderr, "[SOUND] %s: cannot run mpg123: %s\n", label_.c_str(), std::strerror(err));
+    return false;
+  }
+  pid_ = pid;
+  inFd_ = in[0];
+  outFd_ = out[0];
+  reader_ = std::thread(&PcmDecoder::readMp3, this);
+  return true;
+}
+
+void PcmDecoder::readMp3() {
+  uint8_t buf[65536];
+  size_t have = 0;
+  for (;;) {
+    ssize_t n = ::read(outFd_, buf + have, sizeof(buf) - have);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) break;
+    have += (size_t)n;
+    size_t samples = have / 2;
+    {
+      std::lock_guard<std::mutex> lock(outMutex_);
+      size_t at = out_.size();
+      out_.resize(at + samples);
+      std::memcpy(out_.data() + at, buf, samples * 2);
+    }
+    std::memmove(buf, buf + samples * 2, have - samples * 2);
+    have -= samples * 2;
+  }
+}
+
+// Ends mpg123's input and waits for it; a failed exit marks the stream bad.
+void PcmDecoder::stopMp3() {
+  if (pid_ < 0) return;
+  if (inFd_ >= 0) {
+    ::close(inFd_);
+    inFd_ = -1;
+  }
+  if (failed_) kill(pid_, SIGTERM);
+  if (reader_.joinable()) reader_.join();
+  ::close(outFd_);
+  outFd_ = -1;
+  int status = 0;
+  waitpid(pid_, &status, 0);
+  pid_ = -1;
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) failed_ = true;
+}
+
+bool PcmDecoder::finish(std::vector<int16_t>& out) {
+  if (format_ == Format::Mp3) {
+    stopMp3();
+    std::lock_guard<std::mutex> lock(outMutex_);
+    if (failed_ || out_.empty()) {
+      std::fprintf(stderr, "[SOUND] %s: mpg123 failed\n", label_.c_str());
+      return false;
+    }
+    out_.resize(out_.size() & ~(size_t)1);
+    out = std::move(out_);
+    out_.clear();
+    return true;
+  }
+
+  if (failed_) return false;
+  if (!inData_) {
+    if (header_.size() < 12) std::fprintf(stderr, "[SOUND] %s: not a RIFF/WAVE file\n", label_.c_str());
+    else std::fprintf(stderr, "[SOUND] %s: no data chunk\n", label_.c_str());
+    return false;
+  }
+  resample(true);
+  std::lock_guard<std::mutex> lock(outMutex_);
+  out = std::move(out_);
+  out_.clear();
+  return true;
+}
+
+bool decodeSoundFile(const std::string& path, int rate, std::vector<int16_t>& out) {
+  PcmDecoder::Format format;
+  if (!PcmDecoder::formatOf(path, format)) {
+    std::fprintf(stderr, "[SOUND] %s: unsupported format\n", path.c_str());
+    return false;
+  }
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    std::fprintf(stderr, "[SOUND] %s: %s\n", path.c_str(), std::strerror(errno));
+    return false;
+  }
+  PcmDecoder decoder(format, rate, path);
+  uint8_t buf[65536];
+  for (;;) {
+    ssize_t n = ::read(fd, buf, sizeof(buf));
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0 || !decoder.feed(buf, (size_t)n)) break;
+  }
+  ::close(fd);
+  return decoder.finish(out);
+}
+
+// ==================== CACHE ====================
+
+int SoundCache::loadDirectory(const std::string& dir) {
+  DIR* d = opendir(dir.c_str());
+  if (!d) return 0;
+  std::vector<std::string> files;
+  while (dirent* e = readdir(d)) {
+    std::string name = e->d_name;
+    std::string ext = extensionOf(name);
+    if (name[0] != '.' && (ext == "wav" || ext == "mp3")) files.push_back(name);
+  }
+  closedir(d);
+  std::sort(files.begin(), files.end());
+
+  int added = 0;
+  for (const std::string& name : files) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (clips_.count(name)) continue;
+    }
+    if (loadFile(dir + "/" + name, name)) added++;
+  }
+  return added;
+}
+
+bool SoundCache::loadFile(const std::string& path, const std::string& name) {
+  auto clip = std::make_shared<PcmClip>();
+  clip->name = name;
+  clip->path = path;
+  if (!decodeSoundFile(path, rate_, clip->samples)) return false;
+  std::lock_guard<std::mutex> lock(mutex_);
+  clips_[name] = std::move(clip);
+  return true;
+}
+
+void SoundCache::add(std::shared_ptr<const PcmClip> clip) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::string name = clip->name;
+  clips_[name] = std::move(clip);
+}
+
+std::shared_ptr<const PcmClip> SoundCache::find(const std::string& name) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = clips_.find(name);
+  return it == clips_.end() ? nullptr : it->second;
+}
+
+std::vector<std::string> SoundCache::names() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<std::string> out;
+  out.reserve(clips_.size());
+  for (const auto& kv : clips_) out.push_back(kv.first);
+  std::sort(out.begin(), out.end());
+  return out;
+}
+
+size_t SoundCache::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return clips_.size();
+}
+
+size_t SoundCache::bytes() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  size_t total = 0;
+  for (const auto& kv : clips_) total += kv.second->samples.size() * sizeof(int16_t);
+  return total;
+}
+
+}  // namespace oraclebox
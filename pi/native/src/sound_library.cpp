@@ -0,0 +1,528 @@
+#include "oraclebox/sound_library.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+
+namespace oraclebox {
+
+namespace {
+
+uint16_t le16(const uint8_t* p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+uint32_t le32(const uint8_t* p) { return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24); }
+uint32_t be32(const uint8_t* p) { return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3]; }
+
+bool formatOf(const std::string& name, SoundInfo::Format& format) {
+  size_t dot = name.rfind('.');
+  if (dot == std::string::npos) return false;
+  std::string ext = name.substr(dot + 1);
+  for (char& c : ext) c = (char)std::tolower((unsigned char)c);
+  if (ext == "wav") format = SoundInfo::Wav;
+  else if (ext == "mp3") format = SoundInfo::Mp3;
+  else if (ext == "ogg") format = SoundInfo::Ogg;
+  else if (ext == "flac") format = SoundInfo::Flac;
+  else return false;
+  return true;
+}
+
+// Reads up to n bytes at offset.
+size_t readAt(int fd, uint64_t offset, uint8_t* buf, size_t n) {
+  size_t got = 0;
+  while (got < n) {
+    ssize_t r = ::pread(fd, buf + got, n - got, (off_t)(offset + got));
+    if (r < 0 && errno == EINTR) continue;
+    if (r <= 0) break;
+    got += (size_t)r;
+  }
+  return got;
+}
+
+void probeWav(const uint8_t* h, size_t n, uint64_t fileBytes, SoundInfo& info) {
+  if (n < 12 || std::memcmp(h, "RIFF", 4) != 0 || std::memcmp(h + 8, "WAVE", 4) != 0) return;
+  uint32_t blockAlign = 0;
+  for (size_t pos = 12; pos + 8 <= n;) {
+    const uint8_t* chunk = h + pos;
+    uint32_t size = le32(chunk + 4);
+    if (!std::memcmp(chunk, "fmt ", 4) && pos + 24 <= n) {
+      info.channels = (uint8_t)le16(chunk + 10);
+      info.sampleRate = le32(chunk + 12);
+      blockAlign = le16(chunk + 20);
+    } else if (!std::memcmp(chunk, "data", 4)) {
+      uint64_t avail = fileBytes - (pos + 8);
+      uint64_t data = size == 0 || size == 0xFFFFFFFFu ? avail : std::min<uint64_t>(size, avail);
+      if (blockAlign && info.sampleRate) info.durationMs = (uint32_t)(data / blockAlign * 1000 / info.sampleRate);
+      return;
+    }
+    pos += 8 + (size_t)size + (size & 1);
+  }
+}
+
+// kbps by [MPEG1?][layer 1..3][index]
+const uint16_t MP3_BITRATES[2][3][16] = {
+    {{0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256, 0},
+     {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0},
+     {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0}},
+    {{0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448, 0},
+     {0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384, 0},
+     {0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 0}},
+};
+const uint32_t MP3_RATES[3] = {44100, 48000, 32000};
+
+void probeMp3(int fd, uint64_t fileBytes, SoundInfo& info) {
+  uint8_t h[4096];
+  size_t n = readAt(fd, 0, h, 10);
+  uint64_t start = 0;
+  if (n == 10 && !std::memcmp(h, "ID3", 3)) {
+    start = 10 + (((uint64_t)h[6] & 0x7F) << 21 | ((uint64_t)h[7] & 0x7F) << 14 | ((uint64_t)h[8] & 0x7F) << 7 |
+                  ((uint64_t)h[9] & 0x7F));
+    if (h[5] & 0x10) start += 10;   // footer
+  }
+  n = readAt(fd, start, h, sizeof(h));
+  for (size_t i = 0; i + 4 <= n; i++) {
+    if (h[i] != 0xFF || (h[i + 1] & 0xE0) != 0xE0) continue;
+    int version = (h[i + 1] >> 3) & 3;   // 3 = MPEG1, 2 = MPEG2, 0 = MPEG2.5
+    int layer = 4 - ((h[i + 1] >> 1) & 3);
+    int bitrateIndex = h[i + 2] >> 4;
+    int rateIndex = (h[i + 2] >> 2) & 3;
+    if (version == 1 || layer == 4 || bitrateIndex == 0 || bitrateIndex == 15 || rateIndex == 3) continue;
+    bool mpeg1 = version == 3;
+    bool mono = (h[i + 3] >> 6) == 3;
+    uint32_t rate = MP3_RATES[rateIndex] >> (mpeg1 ? 0 : version == 2 ? 1 : 2);
+    uint32_t kbps = MP3_BITRATES[mpeg1][layer - 1][bitrateIndex];
+    uint32_t samplesPerFrame = layer == 1 ? 384 : layer == 2 || mpeg1 ? 1152 : 576;
+    info.sampleRate = rate;
+    info.channels = mono ? 1 : 2;
+
+    // A Xing/Info (or VBRI) frame gives the frame count; otherwise the
+    // bitrate of the first frame is taken as constant
+    size_t side = mpeg1 ? (mono ? 17 : 32) : (mono ? 9 : 17);
+    const uint8_t* x = h + i + 4 + side;
+    uint64_t frames = 0;
+    if (i + 4 + side + 12 <= n && (!std::memcmp(x, "Xing", 4) || !std::memcmp(x, "Info", 4)) && (be32(x + 4) & 1)) {
+      frames = be32(x + 8);
+    } else if (i + 36 + 18 <= n && !std::memcmp(h + i + 36, "VBRI", 4)) {
+      frames = be32(h + i + 36 + 14);
+    }
+    if (frames) info.durationMs = (uint32_t)(frames * samplesPerFrame * 1000 / rate);
+    else info.durationMs = (uint32_t)((fileBytes - start - i) * 8 / kbps);
+    return;
+  }
+}
+
+void put16(std::string& out, uint16_t v) { out.append(reinterpret_cast<const char*>(&v), 2); }
+void put32(std::string& out, uint32_t v) { out.append(reinterpret_cast<const char*>(&v), 4); }
+void put64(std::string& out, uint64_t v) { out.append(reinterpret_cast<const char*>(&v), 8); }
+
+// Bounds-checked reader over the index file
+struct Reader {
+  const std::string& data;
+  size_t pos = 0;
+  bool ok = true;
+  bool take(void* out, size_t n) {
+    if (!ok || pos + n > data.size()) return ok = false;
+    std::memcpy(out, data.data() + pos, n);
+    pos += n;
+    return true;
+  }
+  std::string str(size_t n) {
+    if (!ok || pos + n > data.size()) {
+      ok = false;
+      return std::string();
+    }
+    pos += n;
+    return data.substr(pos - n, n);
+  }
+};
+
+}  // namespace
+
+bool probeSoundFile(const std::string& path, SoundInfo& info) {
+  size_t slash = path.rfind('/');
+  std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+  if (!formatOf(name, info.format)) return false;
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return false;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+    ::close(fd);
+    return false;
+  }
+  info.name = name;
+  info.path = path;
+  info.bytes = (uint64_t)st.st_size;
+  info.mtimeNs = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+  info.durationMs = 0;
+  info.sampleRate = 0;
+  info.channels = 0;
+  if (info.format == SoundInfo::Wav) {
+    uint8_t h[4096];
+    size_t n = readAt(fd, 0, h, sizeof(h));
+    probeWav(h, n, info.bytes, info);
+  } else if (info.format == SoundInfo::Mp3) {
+    probeMp3(fd, info.bytes, info);
+  }
+  ::close(fd);
+  return true;
+}
+
+// ==================== INDEX ====================
+
+SoundLibrary::~SoundLibrary() { stop(); }
+
+void SoundLibrary::addFolder(const std::string& tag, const std::string& path) {
+  Folder f;
+  f.tag = tag;
+  f.path = path;
+  while (f.path.size() > 1 && f.path.back() == '/') f.path.pop_back();
+  folders_.push_back(std::move(f));
+}
+
+bool SoundLibrary::start(const std::string& indexPath) {
+  stop();
+  std::vector<std::unordered_map<std::string, SoundInfo>> saved;
+  if (!indexPath.empty()) loadIndex(indexPath, saved);
+  for (size_t f = 0; f < folders_.size(); f++) scanFolder(f, f < saved.size() ? &saved[f] : nullptr);
+
+  inotify_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  wakeFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (inotify_ < 0 || wakeFd_ < 0) {
+    std::fprintf(stderr, "[SOUND] inotify: %s; the sound index will not follow changes\n", std::strerror(errno));
+    stop();
+    return false;
+  }
+  watchFolders();
+  quit_.store(false);
+  thread_ = std::thread(&SoundLibrary::run, this);
+  return true;
+}
+
+void SoundLibrary::stop() {
+  quit_.store(true);
+  if (wakeFd_ >= 0) {
+    uint64_t one = 1;
+    if (::write(wakeFd_, &one, sizeof(one)) < 0) {
+    }
+  }
+  if (thread_.joinable()) thread_.join();
+  if (inotify_ >= 0) ::close(inotify_);
+  if (wakeFd_ >= 0) ::close(wakeFd_);
+  inotify_ = wakeFd_ = -1;
+  for (Folder& f : folders_) f.watch = -1;
+  parentWatches_.clear();
+}
+
+void SoundLibrary::rescan() {
+  for (size_t f = 0; f < folders_.size(); f++) {
+    std::unordered_map<std::string, SoundInfo> current;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      current = folders_[f].sounds;
+    }
+    scanFolder(f, &current);
+  }
+}
+
+void SoundLibrary::scanFolder(size_t f, const std::unordered_map<std::string, SoundInfo>* saved) {
+  const std::string& dir = folders_[f].path;
+  std::unordered_map<std::string, SoundInfo> found;
+  if (DIR* d = opendir(dir.c_str())) {
+    while (dirent* e = readdir(d)) {
+      std::string name = e->d_name;
+      SoundInfo::Format format;
+      if (name[0] == '.' || !formatOf(name, format)) continue;
+      std::string path = dir + "/" + name;
+      struct stat st;
+      if (fstatat(dirfd(d), e->d_name, &st, 0) != 0 || !S_ISREG(st.st_mode)) continue;
+      int64_t mtimeNs = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+
+      SoundInfo info;
+      const SoundInfo* known = nullptr;
+      if (saved) {
+        auto it = saved->find(name);
+        if (it != saved->end()) known = &it->second;
+      }
+      if (known && known->bytes == (uint64_t)st.st_size && known->mtimeNs == mtimeNs) {
+        info = *known;
+        reused_.fetch_add(1);
+      } else if (probeSoundFile(path, info)) {
+        probed_.fetch_add(1);
+      } else {
+        continue;
+      }
+      info.name = name;
+      info.folder = folders_[f].tag;
+      info.path = path;
+      found[name] = std::move(info);
+    }
+    closedir(d);
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  uint32_t bit = 1u << f;
+  for (const auto& kv : folders_[f].sounds) {
+    auto w = where_.find(kv.first);
+    if (w != where_.end() && !(w->second &= ~bit)) where_.erase(w);
+  }
+  for (const auto& kv : found) where_[kv.first] |= bit;
+  folders_[f].sounds = std::move(found);
+}
+
+void SoundLibrary::update(size_t f, const std::string& name) {
+  SoundInfo info;
+  if (!probeSoundFile(folders_[f].path + "/" + name, info)) {
+    remove(f, name);
+    return;
+  }
+  probed_.fetch_add(1);
+  info.folder = folders_[f].tag;
+  std::lock_guard<std::mutex> lock(mutex_);
+  folders_[f].sounds[name] = std::move(info);
+  where_[name] |= 1u << f;
+}
+
+void SoundLibrary::remove(size_t f, const std::string& name) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!folders_[f].sounds.erase(name)) return;
+  auto w = where_.find(name);
+  if (w != where_.end() && !(w->second &= ~(1u << f))) where_.erase(w);
+}
+
+void SoundLibrary::fillCached(SoundInfo& info) const {
+  if (!cache_) return;
+  std::shared_ptr<const PcmClip> clip = cache_->find(info.name);
+  info.cached = clip && clip->path == info.path;
+}
+
+bool SoundLibrary::lookup(const std::string& name, SoundInfo& out) const {
+  lookups_.fetch_add(1);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto w = where_.find(name);
+    if (w == where_.end()) return false;
+    size_t f = (size_t)__builtin_ctz(w->second);   // first folder in search order
+    out = folders_[f].sounds.at(name);
+  }
+  fillCached(out);
+  return true;
+}
+
+std::string SoundLibrary::pathOf(const std::string& name) const {
+  SoundInfo info;
+  return lookup(name, info) ? info.path : std::string();
+}
+
+std::vector<std::string> SoundLibrary::names(const std::string& tag) const {
+  std::vector<std::string> out;
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (tag.empty()) {
+    out.reserve(where_.size());
+    for (const auto& kv : where_) out.push_back(kv.first);
+  } else {
+    for (const Folder& f : folders_) {
+      if (f.tag != tag) continue;
+      out.reserve(f.sounds.size());
+      for (const auto& kv : f.sounds) out.push_back(kv.first);
+    }
+  }
+  std::sort(out.begin(), out.end());
+  return out;
+}
+
+SoundLibrary::Stats SoundLibrary::stats() const {
+  Stats s;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    s.sounds = where_.size();
+  }
+  s.probed = probed_.load();
+  s.reused = reused_.load();
+  s.events = events_.load();
+  s.lookups = lookups_.load();
+  return s;
+}
+
+// ---- serialized index ----
+
+bool SoundLibrary::save(const std::string& indexPath) const {
+  std::string out;
+  put32(out, INDEX_MAGIC);
+  put32(out, INDEX_VERSION);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    put32(out, (uint32_t)folders_.size());
+    for (const Folder& f : folders_) {
+      put16(out, (uint16_t)f.path.size());
+      out += f.path;
+      put32(out, (uint32_t)f.sounds.size());
+      for (const auto& kv : f.sounds) {
+        const SoundInfo& s = kv.second;
+        put16(out, (uint16_t)s.name.size());
+        out += s.name;
+        out += (char)s.format;
+        put64(out, s.bytes);
+        put64(out, (uint64_t)s.mtimeNs);
+        put32(out, s.durationMs);
+        put32(out, s.sampleRate);
+        out += (char)s.channels;
+      }
+    }
+  }
+
+  std::string tmp = indexPath + ".tmp";
+  {
+    std::ofstream file(tmp, std::ios::binary | std::ios::trunc);
+    if (!file.write(out.data(), (std::streamsize)out.size())) {
+      std::fprintf(stderr, "[SOUND] %s: cannot write index\n", tmp.c_str());
+      return false;
+    }
+  }
+  if (::rename(tmp.c_str(), indexPath.c_str()) != 0) {
+    std::fprintf(stderr, "[SOUND] %s: %s\n", indexPath.c_str(), std::strerror(errno));
+    return false;
+  }
+  return true;
+}
+
+// Entries for this library's folders, matched by path. A missing, stale or
+// damaged index just means every file is probed again.
+bool SoundLibrary::loadIndex(const std::string& path,
+                             std::vector<std::unordered_map<std::string, SoundInfo>>& out) const {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) return false;
+  std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  Reader r{data};
+  uint32_t magic = 0, version = 0, folders = 0;
+  r.take(&magic, 4);
+  r.take(&version, 4);
+  r.take(&folders, 4);
+  if (!r.ok || magic != INDEX_MAGIC || version != INDEX_VERSION) return false;
+
+  out.assign(folders_.size(), {});
+  for (uint32_t i = 0; i < folders && r.ok; i++) {
+    uint16_t len = 0;
+    r.take(&len, 2);
+    std::string dir = r.str(len);
+    uint32_t count = 0;
+    r.take(&count, 4);
+    std::unordered_map<std::string, SoundInfo>* into = nullptr;
+    for (size_t f = 0; f < folders_.size(); f++) {
+      if (folders_[f].path == dir) into = &out[f];
+    }
+    for (uint32_t k = 0; k < count && r.ok; k++) {
+      SoundInfo s;
+      uint16_t nameLen = 0;
+      uint64_t mtime = 0;
+      r.take(&nameLen, 2);
+      s.name = r.str(nameLen);
+      r.take(&s.format, 1);
+      r.take(&s.bytes, 8);
+      r.take(&mtime, 8);
+      r.take(&s.durationMs, 4);
+      r.take(&s.sampleRate, 4);
+      r.take(&s.channels, 1);
+      s.mtimeNs = (int64_t)mtime;
+      if (r.ok && into) (*into)[s.name] = std::move(s);
+    }
+  }
+  if (!r.ok) out.clear();
+  return r.ok;
+}
+
+// ---- inotify ----
+
+namespace {
+
+constexpr uint32_t FOLDER_EVENTS =
+    IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR | IN_MASK_ADD;
+constexpr uint32_t PARENT_EVENTS = IN_CREATE | IN_MOVED_TO | IN_ONLYDIR | IN_MASK_ADD;
+
+std::string parentOf(const std::string& path) {
+  size_t slash = path.rfind('/');
+  return slash == std::string::npos || slash == 0 ? "/" : path.substr(0, slash);
+}
+
+}  // namespace
+
+// Watches each folder, or the parent of a folder that does not exist yet.
+// Watches on one directory share a descriptor, so masks are added, not set.
+void SoundLibrary::watchFolders() {
+  for (Folder& f : folders_) {
+    if (f.watch >= 0) continue;
+    f.watch = inotify_add_watch(inotify_, f.path.c_str(), FOLDER_EVENTS);
+    if (f.watch >= 0) continue;
+    std::string parent = parentOf(f.path);
+    int wd = inotify_add_watch(inotify_, parent.c_str(), PARENT_EVENTS);
+    if (wd >= 0) parentWatches_[wd] = parent;
+  }
+}
+
+void SoundLibrary::run() {
+  alignas(inotify_event) char buf[8192];
+  while (!quit_.load()) {
+    pollfd fds[2] = {{inotify_, POLLIN, 0}, {wakeFd_, POLLIN, 0}};
+    if (::poll(fds, 2, -1) < 0 && errno != EINTR) break;
+    if (quit_.load()) break;
+    ssize_t n = ::read(inotify_, buf, sizeof(buf));
+    if (n <= 0) continue;
+
+    bool rewatch = false, overflow = false;
+    for (char* p = buf; p < buf + n;) {
+      const inotify_event* ev = reinterpret_cast<const inotify_event*>(p);
+      p += sizeof(inotify_event) + ev->len;
+      if (ev->mask & IN_Q_OVERFLOW) {
+        overflow = true;
+        continue;
+      }
+      std::string name = ev->len ? ev->name : "";
+      events_.fetch_add(1);
+
+      for (size_t f = 0; f < folders_.size(); f++) {
+        Folder& folder = folders_[f];
+        if (folder.watch != ev->wd) continue;
+        if (ev->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) {
+          // The folder itself went away: empty it and wait for it to return
+          inotify_rm_watch(inotify_, folder.watch);
+          folder.watch = -1;
+          scanFolder(f, nullptr);
+          rewatch = true;
+          continue;
+        }
+        SoundInfo::Format format;
+        if (name.empty() || name[0] == '.' || (ev->mask & IN_ISDIR) || !formatOf(name, format)) continue;
+        if (ev->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) update(f, name);
+        else if (ev->mask & (IN_DELETE | IN_MOVED_FROM)) remove(f, name);
+      }
+
+      auto parent = parentWatches_.find(ev->wd);
+      if (parent != parentWatches_.end() && (ev->mask & IN_ISDIR) && (ev->mask & (IN_CREATE | IN_MOVED_TO))) {
+        std::string created = parent->second + "/" + name;
+        for (size_t f = 0; f < folders_.size(); f++) {
+          Folder& folder = folders_[f];
+          if (folder.watch >= 0 || folder.path != created) continue;
+          folder.watch = inotify_add_watch(inotify_, folder.path.c_str(), FOLDER_EVENTS);
+          scanFolder(f, nullptr);   // files copied in before the watch
+        }
+      }
+    }
+    if (rewatch) watchFolders();
+    if (overflow) {
+      watchFolders();
+      rescan();
+    }
+  }
+}
+
+}  // namespace oraclebox
@@ -0,0 +1,523 @@
+#include "oraclebox/sound_player.h"
+
+#ifdef ORACLEBOX_HAVE_ALSA
+#include <alsa/asoundlib.h>
+#endif
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "oraclebox/hub_clock.h"
+
+namespace oraclebox {
+
+// ==================== PCM OUTPUT ====================
+
+PcmOutput::~PcmOutput() { close(); }
+
+bool PcmOutput::open(const std::string& device, int rate, int periodFrames, int periods) {
+  close();
+  rate_ = rate;
+  periodFrames_ = periodFrames;
+  bufferFrames_ = periodFrames * periods;
+  underruns_.store(0);
+#ifdef ORACLEBOX_HAVE_ALSA
+  if (device != "null") {
+    snd_pcm_t* pcm = nullptr;
+    int err = snd_pcm_open(&pcm, device.c_str(), SND_PCM_STREAM_PLAYBACK, 0);
+    if (err < 0) {
+      std::fprintf(stderr, "[SOUND] %s: %s\n", device.c_str(), snd_strerror(err));
+      return false;
+    }
+    unsigned latencyUs = (unsigned)((int64_t)bufferFrames_ * 1000000 / rate);
+    err = snd_pcm_set_params(pcm, SND_PCM_FORMAT_S16_LE, SND_PCM_ACCESS_RW_INTERLEAVED, 2, (unsigned)rate, 1,
+                             latencyUs);
+    snd_pcm_uframes_t buffer = 0, period = 0;
+    if (err >= 0) err = snd_pcm_get_params(pcm, &buffer, &period);
+    if (err < 0) {
+      std::fprintf(stderr, "[SOUND] %s: %s\n", device.c_str(), snd_strerror(err));
+      snd_pcm_close(pcm);
+      return false;
+    }
+    pcm_ = pcm;
+    periodFrames_ = (int)period;
+    bufferFrames_ = (int)buffer;
+  }
+#else
+  if (device != "null") std::fprintf(stderr, "[SOUND] Built without ALSA; %s is a clock-paced sink\n", device.c_str());
+#endif
+  device_ = device;
+  startUs_ = hubNowUs();
+  written_ = 0;
+  open_ = true;
+  return true;
+}
+
+void PcmOutput::close() {
+#ifdef ORACLEBOX_HAVE_ALSA
+  if (pcm_) {
+    snd_pcm_t* pcm = static_cast<snd_pcm_t*>(pcm_);
+    snd_pcm_drop(pcm);
+    snd_pcm_close(pcm);
+  }
+#endif
+  pcm_ = nullptr;
+  open_ = false;
+}
+
+bool PcmOutput::write(const int16_t* samples, int frames) {
+  if (!open_) return false;
+#ifdef ORACLEBOX_HAVE_ALSA
+  if (pcm_) {
+    snd_pcm_t* pcm = static_cast<snd_pcm_t*>(pcm_);
+    while (frames > 0) {
+      snd_pcm_sframes_t n = snd_pcm_writei(pcm, samples, (snd_pcm_uframes_t)frames);
+      if (n == -EAGAIN) continue;
+      if (n < 0) {
+        if (n == -EPIPE) underruns_++;
+        n = snd_pcm_recover(pcm, (int)n, 1);
+        if (n < 0) {
+          std::fprintf(stderr, "[SOUND] %s: %s\n", device_.c_str(), snd_strerror((int)n));
+          return false;
+        }
+        continue;
+      }
+      samples += n * 2;
+      frames -= (int)n;
+    }
+    return true;
+  }
+#endif
+  (void)samples;
+  // Clock sink: the "device" consumes rate_ frames a second from startUs_,
+  // starting with the first write like an ALSA stream does
+  if (written_ == 0) startUs_ = hubNowUs();
+  int64_t consumed = (hubNowUs() - startUs_) * rate_ / 1000000;
+  if (consumed > written_) {
+    underruns_++;
+    startUs_ = hubNowUs() - written_ * 1000000 / rate_;   // restart from an empty buffer, as ALSA recovers
+    consumed = written_;
+  }
+  int64_t over = written_ + frames - consumed - bufferFrames_;
+  if (over > 0) std::this_thread::sleep_for(std::chrono::microseconds(over * 1000000 / rate_));
+  written_ += frames;
+  return true;
+}
+
+int64_t PcmOutput::delayFrames() {
+  if (!open_) return 0;
+#ifdef ORACLEBOX_HAVE_ALSA
+  if (pcm_) {
+    snd_pcm_sframes_t delay = 0;
+    if (snd_pcm_delay(static_cast<snd_pcm_t*>(pcm_), &delay) < 0) return 0;
+    return std::max<int64_t>(0, delay);
+  }
+#endif
+  int64_t consumed = (hubNowUs() - startUs_) * rate_ / 1000000;
+  return std::max<int64_t>(0, written_ - consumed);
+}
+
+int64_t PcmOutput::rewind(int64_t frames) {
+  if (!open_) return 0;
+  frames = std::min(frames, delayFrames() - periodFrames_);
+  if (frames <= 0) return 0;
+#ifdef ORACLEBOX_HAVE_ALSA
+  if (pcm_) {
+    snd_pcm_t* pcm = static_cast<snd_pcm_t*>(pcm_);
+    snd_pcm_sframes_t can = snd_pcm_rewindable(pcm);
+    if (can <= 0) return 0;
+    snd_pcm_sframes_t done = snd_pcm_rewind(pcm, (snd_pcm_uframes_t)std::min<int64_t>(frames, can));
+    return done > 0 ? done : 0;
+  }
+#endif
+  written_ -= frames;
+  return frames;
+}
+
+// ==================== SOUND PLAYER ====================
+
+namespace {
+
+float dbToGain(float db) { return db <= -96.0f ? 1.0f : std::pow(10.0f, db / 20.0f); }
+
+// One-pole smoothing per period for a time constant
+float periodCoefficient(int ms, int periodFrames, int rate) {
+  if (ms <= 0) return 1.0f;
+  return 1.0f - std::exp(-(float)periodFrames * 1000.0f / ((float)ms * (float)rate));
+}
+
+}  // namespace
+
+SoundPlayer::~SoundPlayer() { release(); }
+
+bool SoundPlayer::hold(const std::string& device, int periodFrames) {
+  if (holding_.load() && out_.device() == device) return true;
+  release();
+  periodFrames = std::max(32, std::min(periodFrames, MAX_PERIOD_FRAMES));
+  if (!out_.open(device, cache_.rate(), periodFrames, DEFAULT_PERIODS)) return false;
+  if (out_.periodFrames() > MAX_PERIOD_FRAMES) {
+    std::fprintf(stderr, "[SOUND] %s: period of %d frames is too long\n", device.c_str(), out_.periodFrames());
+    out_.close();
+    return false;
+  }
+  stream_.discard(stream_.size());
+  streamFlowing_ = false;
+  duckGain_ = 1.0f;
+  quit_.store(false);
+  holding_.store(true);
+  thread_ = std::thread(&SoundPlayer::run, this);
+  return true;
+}
+
+void SoundPlayer::release() {
+  detachStream();
+  quit_.store(true);
+  if (thread_.joinable()) thread_.join();
+  prevUnderruns_.fetch_add(out_.underruns());
+  out_.close();
+  holding_.store(false);
+
+  // Nothing is playing any more: every voice is finished
+  std::lock_guard<std::mutex> lock(controlMutex_);
+  Command c;
+  while (commands_.pop(c)) {
+  }
+  uint64_t id;
+  while (finished_.pop(id)) {
+  }
+  for (Voice& v : voices_) v = Voice();
+  for (uint64_t& slot : slotId_) slot = 0;
+  live_.clear();
+  activeVoices_.store(0);
+}
+
+std::string SoundPlayer::device() const { return holding_.load() ? out_.device() : std::string(); }
+
+bool SoundPlayer::post(const Command& c) {
+  // Commands are few and the output thread drains them every period; a full
+  // ring means the thread is gone
+  return commands_.push(c);
+}
+
+void SoundPlayer::reap() {
+  uint64_t id;
+  while (finished_.pop(id)) {
+    live_.erase(id);
+    for (uint64_t& slot : slotId_) {
+      if (slot == id) slot = 0;
+    }
+  }
+}
+
+uint64_t SoundPlayer::play(const std::string& name, float gain, float duckDb) {
+  triggers_.fetch_add(1);
+  std::shared_ptr<const PcmClip> clip = cache_.find(name);
+  if (!clip) {
+    missing_.fetch_add(1);
+    return 0;
+  }
+  if (!holding_.load()) return 0;
+
+  std::lock_guard<std::mutex> lock(controlMutex_);
+  reap();
+  int slot = -1;
+  for (int i = 0; i < MAX_VOICES; i++) {
+    if (!slotId_[i]) {
+      slot = i;
+      break;
+    }
+  }
+  if (slot < 0) {
+    // Oldest voice: the output thread reports it finished when it takes over
+    slot = 0;
+    for (int i = 1; i < MAX_VOICES; i++) {
+      if (slotId_[i] < slotId_[slot]) slot = i;
+    }
+  }
+
+  Command c;
+  c.type = Command::Start;
+  c.slot = slot;
+  c.id = nextId_++;
+  c.clip = clip.get();
+  c.gain = std::max(0.0f, gain);
+  c.duck = dbToGain(duckDb);
+  c.triggerUs = hubNowUs();
+  if (!post(c)) return 0;
+  slotId_[slot] = c.id;
+  live_[c.id] = std::move(clip);
+  return c.id;
+}
+
+void SoundPlayer::stopVoice(uint64_t id) {
+  std::lock_guard<std::mutex> lock(controlMutex_);
+  reap();
+  for (int i = 0; i < MAX_VOICES; i++) {
+    if (slotId_[i] == id) {
+      Command c;
+      c.type = Command::Stop;
+      c.slot = i;
+      c.id = id;
+      post(c);
+    }
+  }
+}
+
+void SoundPlayer::stopAll() {
+  std::lock_guard<std::mutex> lock(controlMutex_);
+  Command c;
+  c.type = Command::StopAll;
+  post(c);
+}
+
+void SoundPlayer::setVoiceGain(uint64_t id, float gain) {
+  std::lock_guard<std::mutex> lock(controlMutex_);
+  reap();
+  for (int i = 0; i < MAX_VOICES; i++) {
+    if (slotId_[i] == id) {
+      Command c;
+      c.type = Command::Gain;
+      c.slot = i;
+      c.id = id;
+      c.gain = std::max(0.0f, gain);
+      post(c);
+    }
+  }
+}
+
+bool SoundPlayer::voiceActive(uint64_t id) {
+  std::lock_guard<std::mutex> lock(controlMutex_);
+  reap();
+  return live_.count(id) != 0;
+}
+
+bool SoundPlayer::waitVoice(uint64_t id, int timeoutMs) {
+  int64_t deadline = hubNowUs() + (int64_t)timeoutMs * 1000;
+  while (voiceActive(id)) {
+    if (hubNowUs() >= deadline) return false;
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  return true;
+}
+
+bool SoundPlayer::playing() {
+  std::lock_guard<std::mutex> lock(controlMutex_);
+  reap();
+  return !live_.empty();
+}
+
+void SoundPlayer::setStreamGain(float gain) {
+  std::lock_guard<std::mutex> lock(controlMutex_);
+  Command c;
+  c.type = Command::StreamGain;
+  c.gain = std::max(0.0f, gain);
+  post(c);
+}
+
+void SoundPlayer::setDuckTimes(int attackMs, int releaseMs) {
+  attackMs_.store(std::max(0, attackMs));
+  releaseMs_.store(std::max(0, releaseMs));
+}
+
+// ---- FX stream ----
+
+bool SoundPlayer::attachStream(int fd) {
+  detachStream();
+  int own = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+  if (own < 0) {
+    std::fprintf(stderr, "[SOUND] Stream fd %d: %s\n", fd, std::strerror(errno));
+    return false;
+  }
+  streamQuit_.store(false);
+  streamAttached_.store(true);
+  streamThread_ = std::thread(&SoundPlayer::readStream, this, own);
+  return true;
+}
+
+void SoundPlayer::detachStream() {
+  streamQuit_.store(true);
+  if (streamThread_.joinable()) streamThread_.join();
+  streamAttached_.store(false);
+}
+
+void SoundPlayer::readStream(int fd) {
+  // Raw S16 stereo; a read can end mid-frame, so carry the odd bytes over
+  uint8_t buf[16384];
+  size_t have = 0;
+  while (!streamQuit_.load()) {
+    pollfd p = {fd, POLLIN, 0};
+    int r = ::poll(&p, 1, 100);
+    if (r < 0 && errno != EINTR) break;
+    if (r <= 0) continue;
+    ssize_t n = ::read(fd, buf + have, sizeof(buf) - have);
+    if (n < 0 && (errno == EINTR || errno == EAGAIN)) continue;
+    if (n <= 0) break;   // the pipeline exited
+    have += (size_t)n;
+    size_t samples = have / 4 * 2;
+    const int16_t* s = reinterpret_cast<const int16_t*>(buf);
+    size_t pushed = stream_.push(s, samples);
+    if (pushed < samples) streamDropped_.fetch_add((samples - pushed) / 2);
+    size_t used = samples * 2;
+    std::memmove(buf, buf + used, have - used);
+    have -= used;
+  }
+  ::close(fd);
+  streamAttached_.store(false);
+}
+
+SoundPlayer::Stats SoundPlayer::stats() {
+  Stats s;
+  s.triggers = triggers_.load();
+  s.started = started_.load();
+  s.missing = missing_.load();
+  s.stolen = stolen_.load();
+  s.underruns = prevUnderruns_.load() + (holding_.load() ? out_.underruns() : 0);
+  s.streamUnderflows = streamUnderflows_.load();
+  s.streamDropped = streamDropped_.load();
+  s.voices = activeVoices_.load();
+  s.streamAttached = streamAttached_.load();
+  s.periodMs = holding_.load() ? out_.periodFrames() * 1000.0 / out_.rate() : 0.0;
+  s.lastLatencyMs = latencyLastUs_.load() / 1000.0;
+  s.maxLatencyMs = latencyMaxUs_.load() / 1000.0;
+  s.meanLatencyMs = s.started ? latencySumUs_.load() / 1000.0 / (double)s.started : 0.0;
+  return s;
+}
+
+// ---- output thread ----
+
+void SoundPlayer::mixPeriod(float* mix, int frames) {
+  // Stream, at most STREAM_QUEUE_PERIODS behind
+  int16_t in[MAX_PERIOD_FRAMES * 2];
+  size_t queued = stream_.size() / 2;
+  size_t limit = (size_t)frames * STREAM_QUEUE_PERIODS;
+  if (queued > limit) streamDropped_.fetch_add(stream_.discard((queued - limit) * 2) / 2);
+  size_t got = stream_.pop(in, (size_t)frames * 2) / 2;
+  if (got > 0) {
+    streamFlowing_ = true;
+  } else if (!streamAttached_.load()) {
+    streamFlowing_ = false;
+  }
+  if (streamFlowing_ && got < (size_t)frames) streamUnderflows_.fetch_add(1);
+
+  // Duck towards the lowest level any playing voice asks for
+  float duckTarget = 1.0f;
+  for (const Voice& v : voices_) {
+    if (v.id && !v.stopping) duckTarget = std::min(duckTarget, v.duck);
+  }
+  float from = streamGain_ * duckGain_;
+  duckGain_ += (duckTarget - duckGain_) * (duckTarget < duckGain_ ? duckAttack_ : duckRelease_);
+  float to = streamGain_ * duckGain_;
+  float step = (to - from) / (float)frames;
+  for (size_t i = 0; i < got; i++) {
+    float g = from + step * (float)i;
+    mix[i * 2] = in[i * 2] * g;
+    mix[i * 2 + 1] = in[i * 2 + 1] * g;
+  }
+  std::fill(mix + got * 2, mix + (size_t)frames * 2, 0.0f);
+
+  // Voices, each gain ramped across the period so changes do not click
+  int active = 0;
+  for (Voice& v : voices_) {
+    if (!v.id) continue;
+    float target = v.stopping ? 0.0f : v.target;
+    float g = v.gain;
+    float dg = (target - g) / (float)frames;
+    size_t n = std::min((size_t)frames, v.clip->frames() - v.pos);
+    const int16_t* src = v.clip->samples.data() + v.pos * 2;
+    for (size_t i = 0; i < n; i++) {
+      mix[i * 2] += src[i * 2] * g;
+      mix[i * 2 + 1] += src[i * 2 + 1] * g;
+      g += dg;
+    }
+    v.gain = target;
+    v.pos += n;
+    if (v.pos >= v.clip->frames() || (v.stopping && target == 0.0f)) {
+      finished_.push(v.id);
+      v = Voice();
+    } else {
+      active++;
+    }
+  }
+  activeVoices_.store(active);
+}
+
+void SoundPlayer::run() {
+  const int period = out_.periodFrames();
+  const int rate = out_.rate();
+  float mix[MAX_PERIOD_FRAMES * 2];
+  std::vector<int16_t> buf((size_t)period * 2);
+  int attackMs = -1, releaseMs = -1;
+
+  while (!quit_.load()) {
+    if (attackMs != attackMs_.load() || releaseMs != releaseMs_.load()) {
+      attackMs = attackMs_.load();
+      releaseMs = releaseMs_.load();
+      duckAttack_ = periodCoefficient(attackMs, period, rate);
+      duckRelease_ = periodCoefficient(releaseMs, period, rate);
+    }
+
+    Command c;
+    while (commands_.pop(c)) {
+      Voice& v = voices_[c.slot];
+      switch (c.type) {
+        case Command::Start: {
+          bool audible = streamFlowing_;
+          for (const Voice& other : voices_) audible = audible || other.id != 0;
+          if (v.id) {
+            finished_.push(v.id);
+            stolen_.fetch_add(1);
+          }
+          v = Voice();
+          v.id = c.id;
+          v.clip = c.clip;
+          v.target = c.gain;
+          v.gain = c.gain;
+          v.duck = c.duck;
+
+          // Only silence is queued: drop it so the sound starts right behind
+          // one period of margin
+          if (!audible) out_.rewind(out_.bufferFrames());
+          int64_t us = hubNowUs() + out_.delayFrames() * 1000000 / rate - c.triggerUs;
+          started_.fetch_add(1);
+          latencyLastUs_.store(us);
+          latencySumUs_.fetch_add(us);
+          if (us > latencyMaxUs_.load()) latencyMaxUs_.store(us);
+          break;
+        }
+        case Command::Stop:
+          if (v.id == c.id) v.stopping = true;
+          break;
+        case Command::StopAll:
+          for (Voice& each : voices_) each.stopping = each.id != 0;
+          break;
+        case Command::Gain:
+          if (v.id == c.id) v.target = c.gain;
+          break;
+        case Command::StreamGain:
+          streamGain_ = c.gain;
+          break;
+      }
+    }
+
+    mixPeriod(mix, period);
+    for (size_t i = 0; i < buf.size(); i++) {
+      float x = std::round(mix[i]);
+      buf[i] = (int16_t)std::max(-32768.0f, std::min(32767.0f, x));
+    }
+    if (!out_.write(buf.data(), period)) {
+      holding_.store(false);
+      return;
+    }
+  }
+}
+
+}  // namespace oraclebox
@@ -0,0 +1,132 @@
+#include "oraclebox/sound_upload.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+namespace oraclebox {
+
+namespace {
+
+struct Crc32Table {
+  uint32_t entries[256];
+  Crc32Table() {
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t c = i;
+      for (int k = 0; k < 8; k++) c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+      entries[i] = c;
+    }
+  }
+};
+
+}  // namespace
+
+uint32_t crc32Update(uint32_t crc, const void* data, size_t n) {
+  static const Crc32Table table;
+  const uint8_t* p = static_cast<const uint8_t*>(data);
+  crc = ~crc;
+  for (size_t i = 0; i < n; i++) crc = table.entries[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+  return ~crc;
+}
+
+// ==================== UPLOAD ====================
+
+bool SoundUpload::begin(const std::string& dir, const std::string& name, uint64_t size) {
+  abort();
+  error_.clear();
+  decoded_ = false;
+  name_ = name;
+  path_.clear();
+  if (name.empty() || name[0] == '.' || name.find('/') != std::string::npos) return fail("invalid name");
+
+  path_ = dir + "/" + name;
+  partPath_ = dir + "/." + name + ".upload";
+  fd_ = ::open(partPath_.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd_ < 0) return fail(std::strerror(errno));
+  size_ = size;
+  received_ = 0;
+  crc_ = 0;
+  writeFailed_ = false;
+  buffer_.clear();
+  buffer_.reserve(WRITE_BUFFER);
+
+  PcmDecoder::Format format;
+  if (PcmDecoder::formatOf(name, format)) decoder_.reset(new PcmDecoder(format, cache_.rate(), path_));
+  return true;
+}
+
+bool SoundUpload::write(const void* data, size_t n) {
+  if (fd_ < 0) return false;
+  if ((uint64_t)n > size_ - received_) n = (size_t)(size_ - received_);
+  const uint8_t* p = static_cast<const uint8_t*>(data);
+  received_ += n;
+  crc_ = crc32Update(crc_, p, n);
+
+  // A sound that will not decode is still saved; the decoder just stops
+  if (decoder_ && !decoder_->feed(p, n)) decoder_.reset();
+
+  if (writeFailed_) return false;
+  buffer_.insert(buffer_.end(), p, p + n);
+  if (buffer_.size() >= WRITE_BUFFER && !flush()) writeFailed_ = true;
+  return !writeFailed_;
+}
+
+bool SoundUpload::flush() {
+  const uint8_t* p = buffer_.data();
+  size_t left = buffer_.size();
+  while (left > 0) {
+    ssize_t w = ::write(fd_, p, left);
+    if (w < 0 && errno == EINTR) continue;
+    if (w <= 0) {
+      error_ = std::strerror(errno);
+      return false;
+    }
+    p += w;
+    left -= (size_t)w;
+  }
+  buffer_.clear();
+  return true;
+}
+
+bool SoundUpload::finish(int64_t expectedCrc) {
+  if (fd_ < 0) return fail("no upload");
+  if (received_ < size_) return fail("incomplete upload");
+  if (expectedCrc >= 0 && (uint32_t)expectedCrc != crc_) return fail("checksum mismatch");
+  if (writeFailed_ || !flush()) return fail(error_.empty() ? "write failed" : error_);
+  if (::fsync(fd_) != 0) return fail(std::strerror(errno));
+  ::close(fd_);
+  fd_ = -1;
+  if (::rename(partPath_.c_str(), path_.c_str()) != 0) return fail(std::strerror(errno));
+
+  if (decoder_) {
+    auto clip = std::make_shared<PcmClip>();
+    clip->name = name_;
+    clip->path = path_;
+    if (decoder_->finish(clip->samples)) {
+      cache_.add(std::move(clip));
+      decoded_ = true;
+    }
+    decoder_.reset();
+  }
+  return true;
+}
+
+bool SoundUpload::fail(const std::string& why) {
+  error_ = why;
+  std::fprintf(stderr, "[UPLOAD_SOUND] %s: %s\n", (path_.empty() ? name_ : path_).c_str(), why.c_str());
+  abort();
+  return false;
+}
+
+void SoundUpload::abort() {
+  decoder_.reset();
+  if (fd_ < 0) return;
+  ::close(fd_);
+  fd_ = -1;
+  ::unlink(partPath_.c_str());
+}
+
+}  // namespace oraclebox
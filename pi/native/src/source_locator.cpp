@@ -0,0 +1,125 @@
+#include "oraclebox/source_locator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+
+namespace oraclebox {
+
+// ==================== PODS ====================
+
+bool SourceLocator::loadFile(const std::string& path) {
+  std::ifstream in(path);
+  if (!in) {
+    std::fprintf(stderr, "[LOCATE] Cannot open pods file %s\n", path.c_str());
+    return false;
+  }
+  JsonLine def;
+  std::string line;
+  int lineNo = 0;
+  bool ok = true;
+  while (std::getline(in, line)) {
+    lineNo++;
+    size_t start = line.find_first_not_of(" \t\r");
+    if (start == std::string::npos || line[start] == '#') continue;
+    std::string error;
+    if (!def.parse(line) || !addPod(def, &error)) {
+      std::fprintf(stderr, "[LOCATE] %s:%d: %s\n", path.c_str(), lineNo,
+                   error.empty() ? "malformed pod" : error.c_str());
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+bool SourceLocator::addPod(const JsonLine& def, std::string* error) {
+  Pod pod;
+  pod.pos.id = std::string(def.str("id"));
+  if (pod.pos.id.empty() || !def.has("x") || !def.has("y")) {
+    if (error) *error = "pod needs \"id\", \"x\" and \"y\"";
+    return false;
+  }
+  if (podById_.count(pod.pos.id)) {
+    if (error) *error = "duplicate pod \"" + pod.pos.id + "\"";
+    return false;
+  }
+  pod.pos.x = def.num("x");
+  pod.pos.y = def.num("y");
+  podById_.emplace(pod.pos.id, (int)pods_.size());
+  pods_.push_back(pod);
+
+  // Layout size, the yardstick for the error
+  double cx = 0.0, cy = 0.0;
+  for (const Pod& p : pods_) {
+    cx += p.pos.x;
+    cy += p.pos.y;
+  }
+  cx /= pods_.size();
+  cy /= pods_.size();
+  double ss = 0.0;
+  for (const Pod& p : pods_) ss += (p.pos.x - cx) * (p.pos.x - cx) + (p.pos.y - cy) * (p.pos.y - cy);
+  podExtentM_ = std::max(1.0, std::sqrt(ss / pods_.size()));
+  return true;
+}
+
+// ==================== ESTIMATION ====================
+
+bool SourceLocator::update(const SatelliteConn& from, const JsonLine& msg, int64_t rxUs) {
+  if (pods_.empty() || msg.str("event") != "em_trigger") return false;
+  auto it = podById_.find(from.deviceId);
+  if (it == podById_.end()) return false;
+  double weight = msg.num("strength", 0.0);
+  if (weight <= 0.0) return false;
+
+  if (sumsUs_ != 0 && rxUs > sumsUs_) {
+    double f = std::exp(-(double)(rxUs - sumsUs_) / tauUs_);
+    w_ *= f;
+    ww_ *= f * f;
+    wx_ *= f;
+    wy_ *= f;
+    wxx_ *= f;
+    wyy_ *= f;
+  }
+  sumsUs_ = std::max(sumsUs_, rxUs);
+
+  Pod& pod = pods_[it->second];
+  pod.lastHitUs = rxUs;
+  w_ += weight;
+  ww_ += weight * weight;
+  wx_ += weight * pod.pos.x;
+  wy_ += weight * pod.pos.y;
+  wxx_ += weight * pod.pos.x * pod.pos.x;
+  wyy_ += weight * pod.pos.y * pod.pos.y;
+  hits_++;
+  return true;
+}
+
+SourceEstimate SourceLocator::estimate(int64_t nowUs) const {
+  SourceEstimate e;
+  e.timeUs = sumsUs_;
+  if (w_ <= 0.0) return e;
+
+  e.x = wx_ / w_;
+  e.y = wy_ / w_;
+  double var = wxx_ / w_ - e.x * e.x + wyy_ / w_ - e.y * e.y;
+  double nEff = w_ * w_ / ww_;
+  e.errorM = std::sqrt(std::max(0.0, var) / nEff);
+
+  // Pods heard recently enough to still carry weight
+  int64_t recentUs = nowUs - (int64_t)(3.0 * tauUs_);
+  for (const Pod& p : pods_) {
+    if (p.lastHitUs != 0 && p.lastHitUs >= recentUs) e.pods++;
+  }
+
+  double age = nowUs > sumsUs_ ? (double)(nowUs - sumsUs_) : 0.0;
+  double weight = w_ * std::exp(-age / tauUs_);
+  double mass = 1.0 - std::exp(-weight / REFERENCE_WEIGHT);
+  double r = e.errorM / podExtentM_;
+  double precision = 1.0 / (1.0 + r * r);
+  double coverage = e.pods >= 3 ? 1.0 : e.pods == 2 ? 0.6 : 0.3;
+  e.confidence = mass * precision * coverage;
+  return e;
+}
+
+}  // namespace oraclebox
@@ -0,0 +1,146 @@
+#include "oraclebox/timeline_query.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+
+namespace oraclebox {
+
+// ==================== INDEXING ====================
+
+size_t TimelineIndex::update() {
+  size_t added = 0;
+  while (segment_ < store_.segmentCount()) {
+    uint32_t count = store_.segmentRecordCount(segment_);
+    const EventRecord* recs = store_.segmentRecords(segment_);
+    for (; offset_ < count; offset_++) {
+      add((uint32_t)segment_ << 16 | offset_, recs[offset_]);
+      added++;
+    }
+    if (count < EventStore::SEGMENT_CAPACITY) break;  // still being appended to
+    segment_++;
+    offset_ = 0;
+  }
+  indexed_ += added;
+  return added;
+}
+
+void TimelineIndex::add(uint32_t ref, const EventRecord& r) {
+  Postings& p = lists_[key(r.device, r.type)];
+  p.refs.push_back(ref);
+
+  int64_t minute = r.timeUs / MINUTE_US;
+  if (p.minutes.empty() || p.minutes.back().minute != minute) {
+    p.minutes.push_back(MinuteRollup{minute, 0, INT32_MIN, NAN, NAN});
+  }
+  MinuteRollup& m = p.minutes.back();
+  m.count++;
+  m.maxStrength = std::max(m.maxStrength, r.strength);
+  // fmin/fmax ignore NaN, both a fresh minute's and a record without a reading
+  m.tempMin = std::fmin(m.tempMin, r.temperature);
+  m.tempMax = std::fmax(m.tempMax, r.temperature);
+}
+
+// ==================== SELECTION ====================
+
+std::vector<int> TimelineIndex::selectDevices(const TimelineFilter& f) const {
+  const auto& devices = store_.devices();
+  std::vector<int> out;
+  if (f.devices.empty() && f.location.empty()) {
+    for (int d = 0; d < (int)devices.size(); d++) out.push_back(d);
+    return out;
+  }
+  out = f.devices;
+  if (!f.location.empty()) {
+    for (int d = 0; d < (int)devices.size(); d++) {
+      if (devices[d].location == f.location) out.push_back(d);
+    }
+  }
+  std::sort(out.begin(), out.end());
+  out.erase(std::unique(out.begin(), out.end()), out.end());
+  return out;
+}
+
+template <typename Fn>
+void TimelineIndex::forEachList(const TimelineFilter& f, Fn&& fn) const {
+  int typeCount = (int)store_.types().size();
+  for (int d : selectDevices(f)) {
+    for (int t = 0; t < typeCount; t++) {
+      if (f.type >= 0 && t != f.type) continue;
+      auto it = lists_.find(key(d, t));
+      if (it != lists_.end()) fn(d, it->second);
+    }
+  }
+}
+
+// ==================== QUERIES ====================
+
+std::vector<TimelineHit> TimelineIndex::events(const TimelineFilter& f) const {
+  std::vector<uint32_t> refs;
+  forEachList(f, [&](int, const Postings& p) {
+    auto it = std::lower_bound(p.refs.begin(), p.refs.end(), f.fromUs,
+                               [&](uint32_t ref, int64_t t) { return at(ref).timeUs < t; });
+    for (; it != p.refs.end(); ++it) {
+      const EventRecord& r = at(*it);
+      if (r.timeUs >= f.toUs) break;
+      if (r.strength < f.minStrength) continue;
+      refs.push_back(*it);
+    }
+  });
+
+  // Refs follow store order, which is time order
+  std::sort(refs.begin(), refs.end());
+  std::vector<TimelineHit> hits;
+  hits.reserve(refs.size());
+  for (uint32_t ref : refs) hits.push_back(TimelineHit{ref, &at(ref)});
+  return hits;
+}
+
+std::vector<RollupRow> TimelineIndex::rollup(const TimelineFilter& f, int bucketMinutes, RollupGroup group) const {
+  if (bucketMinutes < 1) bucketMinutes = 1;
+  const auto& devices = store_.devices();
+  std::map<std::pair<int64_t, std::string>, RollupRow> rows;
+
+  auto accumulate = [&](int device, int64_t minute, uint32_t count, int32_t maxStrength, float tMin, float tMax) {
+    int64_t bucket = minute - minute % bucketMinutes;
+    std::string name = group == RollupGroup::Device ? devices[device].id
+                       : group == RollupGroup::Location ? devices[device].location
+                       : std::string();
+    auto it = rows.find({bucket, name});
+    if (it == rows.end()) {
+      it = rows.emplace(std::make_pair(bucket, name),
+                        RollupRow{bucket * MINUTE_US, name, 0, INT32_MIN, NAN, NAN}).first;
+    }
+    RollupRow& row = it->second;
+    row.count += count;
+    row.maxStrength = std::max(row.maxStrength, maxStrength);
+    row.tempMin = std::fmin(row.tempMin, tMin);
+    row.tempMax = std::fmax(row.tempMax, tMax);
+  };
+
+  if (f.minStrength != INT_MIN) {
+    // Rollups cover every strength, so filtered rates come from the events
+    for (const TimelineHit& h : events(f)) {
+      float t = h.rec->temperature;
+      accumulate(h.rec->device, h.rec->timeUs / MINUTE_US, 1, h.rec->strength, t, t);
+    }
+  } else {
+    // Minutes whose start lies in [from, to)
+    int64_t fromMinute = f.fromUs == INT64_MIN ? INT64_MIN : (f.fromUs + MINUTE_US - 1) / MINUTE_US;
+    int64_t toMinute = f.toUs == INT64_MAX ? INT64_MAX : (f.toUs + MINUTE_US - 1) / MINUTE_US;
+    forEachList(f, [&](int device, const Postings& p) {
+      auto it = std::lower_bound(p.minutes.begin(), p.minutes.end(), fromMinute,
+                                 [](const MinuteRollup& m, int64_t v) { return m.minute < v; });
+      for (; it != p.minutes.end() && it->minute < toMinute; ++it) {
+        accumulate(device, it->minute, it->count, it->maxStrength, it->tempMin, it->tempMax);
+      }
+    });
+  }
+
+  std::vector<RollupRow> out;
+  out.reserve(rows.size());
+  for (auto& kv : rows) out.push_back(kv.second);
+  return out;
+}
+
+}  // namespace oraclebox
@@ -0,0 +1,136 @@
+// Event schema benchmark: encode and decode throughput of the generated
+// satellite event code against the generic JsonWriter / JsonLine paths.
+//
+//   event_schema_bench [--iterations 2000000]
+//
+// Encode runs the same encoder the firmware compiles (on the host, so only
+// the ratios carry over to an ESP32). Decode compares one zero-copy pass over
+// the raw line, and binding an already-parsed JsonLine, with JsonLine key
+// lookups of the same fields.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "oraclebox/event_schema.h"
+#include "oraclebox/json_line.h"
+
+using namespace oraclebox;
+
+namespace {
+
+volatile uint64_t sink;
+
+// Touches every field a rempod event carries, the way the hub's store, bus
+// and correlator do between them
+uint64_t readAll(const SatelliteEvent& ev) {
+  return ev.device.size() + ev.id.size() + ev.location.size() + ev.event.size() + (uint64_t)ev.strength +
+         (uint64_t)ev.temperature + (uint64_t)ev.pressure + (uint64_t)ev.battery + (uint64_t)ev.timestamp;
+}
+
+uint64_t readAll(const JsonLine& msg) {
+  return msg.str("device").size() + msg.str("id").size() + msg.str("location").size() + msg.str("event").size() +
+         (uint64_t)msg.i64("strength") + (uint64_t)msg.num("temperature") + (uint64_t)msg.num("pressure") +
+         (uint64_t)msg.i64("battery") + (uint64_t)msg.i64("timestamp");
+}
+
+template <typename Fn>
+double nsPerOp(long iterations, Fn&& fn) {
+  auto t0 = std::chrono::steady_clock::now();
+  for (long i = 0; i < iterations; i++) fn(i);
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / iterations;
+}
+
+RempodEvent sampleEvent(long i) {
+  RempodEvent ev;
+  ev.id = "rempod_01";
+  ev.location = "hallway";
+  ev.event = "em_trigger";
+  ev.strength = (int32_t)(i % 10 + 1);
+  ev.temperature = 68.9f + (float)(i % 100) / 25.0f;   // deg F, as the pod sends it
+  ev.pressure = 1013.25f;
+  ev.battery = 87;
+  ev.timestamp = (int32_t)(i / 1000);
+  return ev;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  long iterations = 2000000;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!std::strcmp(argv[i], "--iterations")) iterations = std::atol(argv[i + 1]);
+  }
+
+  // ==================== ENCODE ====================
+  char line[REMPOD_EVENT_MAX_BYTES];
+  double generated = nsPerOp(iterations, [&](long i) {
+    sink += encodeRempodEvent(line, sampleEvent(i));
+  });
+  double writer = nsPerOp(iterations, [&](long i) {
+    RempodEvent ev = sampleEvent(i);
+    std::string s = JsonWriter()
+                        .add("device", "rempod")
+                        .add("id", ev.id)
+                        .add("location", ev.location)
+                        .add("event", ev.event)
+                        .add("strength", (int)ev.strength)
+                        .add("temperature", (double)ev.temperature)
+                        .add("pressure", (double)ev.pressure)
+                        .add("battery", (int)ev.battery)
+                        .add("timestamp", (int)ev.timestamp)
+                        .line();
+    sink += s.size();
+  });
+  double printf = nsPerOp(iterations, [&](long i) {
+    RempodEvent ev = sampleEvent(i);
+    char buf[256];
+    sink += (uint64_t)std::snprintf(
+        buf, sizeof(buf),
+        "{\"device\":\"rempod\",\"id\":\"%s\",\"location\":\"%s\",\"event\":\"%s\",\"strength\":%d,"
+        "\"temperature\":%.2f,\"pressure\":%.2f,\"battery\":%d,\"timestamp\":%d}\n",
+        ev.id, ev.location, ev.event, (int)ev.strength, ev.temperature, ev.pressure, (int)ev.battery,
+        (int)ev.timestamp);
+  });
+  size_t len = encodeRempodEvent(line, sampleEvent(7));
+  std::printf("encode (%zu-byte line, max %zu): %s", len, REMPOD_EVENT_MAX_BYTES, line);
+  std::printf("  generated encoder  %7.1f ns/event\n", generated);
+  std::printf("  JsonWriter         %7.1f ns/event\n", writer);
+  std::printf("  snprintf           %7.1f ns/event\n", printf);
+
+  // ==================== DECODE ====================
+  std::string text(line, len);
+  SatelliteEvent ev;
+  double raw = nsPerOp(iterations, [&](long) {
+    decodeSatelliteEvent(text, ev);
+    sink += readAll(ev);
+  });
+  JsonLine msg;
+  double parsed = nsPerOp(iterations, [&](long) {
+    msg.parse(text);
+    sink += readAll(msg);
+  });
+  msg.parse(text);
+  double bound = nsPerOp(iterations, [&](long) {
+    bindSatelliteEvent(msg, ev);
+    sink += readAll(ev);
+  });
+  double lookups = nsPerOp(iterations, [&](long) {
+    sink += readAll(msg);
+  });
+  std::printf("decode\n");
+  std::printf("  raw line, generated decoder    %7.1f ns/event\n", raw);
+  std::printf("  raw line, JsonLine + lookups   %7.1f ns/event\n", parsed);
+  std::printf("  parsed line, bind              %7.1f ns/event\n", bound);
+  std::printf("  parsed line, key lookups       %7.1f ns/event\n", lookups);
+
+  decodeSatelliteEvent(text, ev);
+  if (ev.unknownKeys || ev.invalid || !ev.has(EventField::Timestamp) ||
+      eventField<EventField::Strength>(ev) != 8) {
+    std::fprintf(stderr, "round trip mismatch\n");
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,733 @@
+// Event schema generator: turns schema/satellite_events.jsonl into the
+// firmware encoders and the hub decoder, so both ends of a satellite event
+// line come from one definition.
+//
+//   event_schema_gen --schema schema/satellite_events.jsonl
+//                    [--hub DIR]               DIR/oraclebox/event_schema.h + DIR/event_schema.cpp
+//                    [--firmware HEADER ...]   oraclebox_events.h for each sketch
+//                    [--check]                 compare instead of writing; exit 1 if stale
+//
+// The CMake build runs --hub into the build tree and --check against the
+// checked-in firmware headers; the firmware_event_headers target rewrites them.
+
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "oraclebox/json_line.h"
+
+using namespace oraclebox;
+
+namespace {
+
+enum class Type { String, Int, Float };
+
+struct Field {
+  std::string name;
+  Type type = Type::Int;
+  int maxLen = 0;
+  double min = 0.0;
+  double max = 0.0;
+  int decimals = 0;
+  std::vector<std::string> tags;
+};
+
+struct Message {
+  std::string name;
+  std::string device;
+  std::vector<int> fields;
+};
+
+struct Schema {
+  std::string path;
+  std::vector<Field> fields;
+  std::vector<Message> messages;
+  std::vector<std::string> tags;
+};
+
+std::vector<std::string> words(std::string_view s) {
+  std::vector<std::string> out;
+  std::istringstream in{std::string(s)};
+  for (std::string w; in >> w;) out.push_back(w);
+  return out;
+}
+
+int findField(const Schema& schema, const std::string& name) {
+  for (size_t i = 0; i < schema.fields.size(); i++) {
+    if (schema.fields[i].name == name) return (int)i;
+  }
+  return -1;
+}
+
+bool loadSchema(const std::string& path, Schema& schema) {
+  std::ifstream in(path);
+  if (!in) {
+    std::fprintf(stderr, "[SCHEMA] Cannot open %s\n", path.c_str());
+    return false;
+  }
+  schema.path = path;
+  JsonLine msg;
+  std::string line;
+  int lineNo = 0;
+  bool ok = true;
+  while (std::getline(in, line)) {
+    lineNo++;
+    size_t start = line.find_first_not_of(" \t\r");
+    if (start == std::string::npos || line[start] == '#') continue;
+    if (!msg.parse(line)) {
+      std::fprintf(stderr, "[SCHEMA] %s:%d: not a JSON object\n", path.c_str(), lineNo);
+      ok = false;
+      continue;
+    }
+
+    if (msg.has("field")) {
+      Field f;
+      f.name = std::string(msg.str("field"));
+      std::string_view type = msg.str("type");
+      if (type == "string") f.type = Type::String;
+      else if (type == "int") f.type = Type::Int;
+      else if (type == "float") f.type = Type::Float;
+      else {
+        std::fprintf(stderr, "[SCHEMA] %s:%d: unknown type '%.*s'\n", path.c_str(), lineNo, (int)type.size(),
+                     type.data());
+        ok = false;
+        continue;
+      }
+      f.maxLen = (int)msg.i64("max_len");
+      f.min = msg.num("min");
+      f.max = msg.num("max");
+      f.decimals = (int)msg.i64("decimals");
+      f.tags = words(msg.str("tags"));
+
+      const char* problem = nullptr;
+      if (findField(schema, f.name) >= 0) problem = "duplicate field";
+      else if (f.type == Type::String && f.maxLen <= 0) problem = "string needs max_len";
+      else if (f.type != Type::String && f.min > f.max) problem = "min is above max";
+      else if (f.type == Type::Int && (f.min < INT32_MIN || f.max > INT32_MAX)) problem = "range exceeds int32";
+      else if (f.type == Type::Float &&
+               (f.decimals < 0 || f.decimals > 6 ||
+                std::max(std::fabs(f.min), std::fabs(f.max)) * std::pow(10.0, f.decimals) >= 2147483647.0)) {
+        problem = "range * 10^decimals exceeds int32";
+      }
+      if (problem) {
+        std::fprintf(stderr, "[SCHEMA] %s:%d: %s: %s\n", path.c_str(), lineNo, f.name.c_str(), problem);
+        ok = false;
+        continue;
+      }
+      for (const std::string& t : f.tags) {
+        bool known = false;
+        for (const std::string& k : schema.tags) known |= k == t;
+        if (!known) schema.tags.push_back(t);
+      }
+      schema.fields.push_back(f);
+    } else if (msg.has("message")) {
+      Message m;
+      m.name = std::string(msg.str("message"));
+      m.device = std::string(msg.str("device"));
+      for (const std::string& name : words(msg.str("fields"))) {
+        int f = findField(schema, name);
+        if (f < 0 || name == "device") {
+          std::fprintf(stderr, "[SCHEMA] %s:%d: %s: unknown field '%s'\n", path.c_str(), lineNo, m.name.c_str(),
+                       name.c_str());
+          ok = false;
+          continue;
+        }
+        m.fields.push_back(f);
+      }
+      if (m.fields.empty() || m.device.empty()) {
+        std::fprintf(stderr, "[SCHEMA] %s:%d: message needs a device and fields\n", path.c_str(), lineNo);
+        ok = false;
+        continue;
+      }
+      schema.messages.push_back(m);
+    } else {
+      std::fprintf(stderr, "[SCHEMA] %s:%d: expected \"field\" or \"message\"\n", path.c_str(), lineNo);
+      ok = false;
+    }
+  }
+  if (schema.fields.size() > 32) {
+    std::fprintf(stderr, "[SCHEMA] %zu fields; the decoder's bitmasks hold 32\n", schema.fields.size());
+    ok = false;
+  }
+  if (findField(schema, "device") < 0) {
+    std::fprintf(stderr, "[SCHEMA] A \"device\" string field is required\n");
+    ok = false;
+  }
+  return ok;
+}
+
+// ==================== NAMING ====================
+
+// "rempod_event" -> "RempodEvent"
+std::string camel(const std::string& s) {
+  std::string out;
+  bool up = true;
+  for (char c : s) {
+    if (c == '_') {
+      up = true;
+      continue;
+    }
+    out += up ? (char)std::toupper((unsigned char)c) : c;
+    up = false;
+  }
+  return out;
+}
+
+// "rempod_event" -> "REMPOD_EVENT"
+std::string upper(const std::string& s) {
+  std::string out;
+  for (char c : s) out += (char)std::toupper((unsigned char)c);
+  return out;
+}
+
+// "sensor_value" -> "sensorValue"
+std::string member(const std::string& s) {
+  std::string c = camel(s);
+  c[0] = (char)std::tolower((unsigned char)c[0]);
+  return c;
+}
+
+std::string literal(const std::string& s) {
+  std::string out = "\"";
+  for (char c : s) {
+    if (c == '\n') {
+      out += "\\n";
+      continue;
+    }
+    if (c == '"' || c == '\\') out += '\\';
+    out += c;
+  }
+  return out + "\"";
+}
+
+std::string number(double v) {
+  char buf[32];
+  if (v == std::floor(v) && std::fabs(v) < 1e15) std::snprintf(buf, sizeof(buf), "%.0f", v);
+  else std::snprintf(buf, sizeof(buf), "%g", v);
+  return buf;
+}
+
+std::string floatLiteral(double v) {
+  std::string s = number(v);
+  if (s.find('.') == std::string::npos && s.find('e') == std::string::npos) s += ".0";
+  return s + "f";
+}
+
+const char* firmwareType(const Field& f) {
+  return f.type == Type::String ? "const char*" : f.type == Type::Int ? "int32_t" : "float";
+}
+
+const char* hubType(const Field& f) {
+  return f.type == Type::String ? "std::string_view" : f.type == Type::Int ? "int32_t" : "float";
+}
+
+// Widest text the encoder can write for a field's value
+size_t maxValueBytes(const Field& f) {
+  if (f.type == Type::String) return (size_t)f.maxLen * 2;   // every byte escaped
+  char lo[48], hi[48];
+  std::snprintf(lo, sizeof(lo), "%.*f", f.type == Type::Float ? f.decimals : 0, f.min);
+  std::snprintf(hi, sizeof(hi), "%.*f", f.type == Type::Float ? f.decimals : 0, f.max);
+  return std::max(std::strlen(lo), std::strlen(hi));
+}
+
+std::string tagMask(const Field& f) {
+  std::string out;
+  for (const std::string& t : f.tags) {
+    if (!out.empty()) out += " | ";
+    out += "EVENT_TAG_" + upper(t);
+  }
+  return out.empty() ? "0" : out;
+}
+
+// ==================== ENCODERS ====================
+
+// Shared by the firmware header and the hub header, so the hub's tools and
+// benchmarks encode exactly what a satellite does. Plain C++11.
+void emitEncoders(std::ostringstream& o, const Schema& schema) {
+  o << R"(// ==================== ENCODERS ====================
+
+namespace wire {
+
+// Copies a string literal; its length is a compile-time constant.
+template <size_t N>
+inline char* putLiteral(char* p, const char (&s)[N]) {
+  memcpy(p, s, N - 1);
+  return p + N - 1;
+}
+
+// At most maxLen bytes of s, escaping quotes and backslashes and dropping
+// control characters.
+inline char* putString(char* p, const char* s, size_t maxLen) {
+  if (!s) return p;
+  for (size_t n = 0; n < maxLen && s[n]; n++) {
+    char c = s[n];
+    if ((unsigned char)c < 0x20) continue;
+    if (c == '"' || c == '\\') *p++ = '\\';
+    *p++ = c;
+  }
+  return p;
+}
+
+inline char* putInt(char* p, int32_t v, int32_t lo, int32_t hi) {
+  if (v < lo) v = lo;
+  if (v > hi) v = hi;
+  uint32_t u = (uint32_t)v;
+  if (v < 0) {
+    *p++ = '-';
+    u = 0u - u;
+  }
+  char digits[10];
+  int n = 0;
+  do {
+    digits[n++] = (char)('0' + u % 10);
+    u /= 10;
+  } while (u);
+  while (n) *p++ = digits[--n];
+  return p;
+}
+
+// Fixed point with `scale` = 10^decimals; no printf, single-precision math.
+inline char* putFixed(char* p, float v, float lo, float hi, int32_t scale) {
+  if (!(v >= lo)) v = lo;   // also catches NaN
+  if (v > hi) v = hi;
+  float scaled = v * (float)scale;
+  int32_t q = (int32_t)(scaled < 0 ? scaled - 0.5f : scaled + 0.5f);
+  if (q < 0) {
+    *p++ = '-';
+    q = -q;
+  }
+  p = putInt(p, q / scale, 0, INT32_MAX);
+  if (scale > 1) {
+    *p++ = '.';
+    int32_t frac = q % scale;
+    for (int32_t d = scale / 10; d > 0; d /= 10) *p++ = (char)('0' + frac / d % 10);
+  }
+  return p;
+}
+
+}  // namespace wire
+)";
+
+  for (const Message& m : schema.messages) {
+    std::string type = camel(m.name);
+    std::string constName = upper(m.name) + "_MAX_BYTES";
+
+    // Literal runs between values: the key, and the quotes around strings
+    std::vector<std::string> runs;
+    std::string run = "{\"device\":\"" + m.device + "\"";
+    size_t bytes = 0;
+    for (int fi : m.fields) {
+      const Field& f = schema.fields[fi];
+      run += ",\"" + f.name + "\":";
+      if (f.type == Type::String) run += "\"";
+      runs.push_back(run);
+      bytes += run.size() + maxValueBytes(f);
+      run = f.type == Type::String ? "\"" : "";
+    }
+    run += "}\n";
+    runs.push_back(run);
+    bytes += run.size() + 1;
+
+    o << "\n// {\"device\":\"" << m.device << "\"";
+    for (int fi : m.fields) o << ",\"" << schema.fields[fi].name << "\":...";
+    o << "}\n";
+    o << "struct " << type << " {\n";
+    for (int fi : m.fields) {
+      const Field& f = schema.fields[fi];
+      o << "  " << firmwareType(f) << " " << member(f.name) << ";\n";
+    }
+    o << "};\n\n";
+    o << "// Longest line encode" << type << "() writes, with '\\n' and the NUL\n";
+    o << "constexpr size_t " << constName << " = " << bytes << ";\n\n";
+    o << "// Writes one protocol line (\"{...}\\n\", NUL-terminated) and returns its\n"
+      << "// length. Values are clamped to the schema's ranges.\n";
+    o << "inline size_t encode" << type << "(char (&out)[" << constName << "], const " << type << "& e) {\n";
+    o << "  char* p = out;\n";
+    for (size_t i = 0; i < m.fields.size(); i++) {
+      const Field& f = schema.fields[m.fields[i]];
+      std::string v = "e." + member(f.name);
+      o << "  p = wire::putLiteral(p, " << literal(runs[i]) << ");\n";
+      if (f.type == Type::String) {
+        o << "  p = wire::putString(p, " << v << ", " << f.maxLen << ");\n";
+      } else if (f.type == Type::Int) {
+        o << "  p = wire::putInt(p, " << v << ", " << number(f.min) << ", " << number(f.max) << ");\n";
+      } else {
+        o << "  p = wire::putFixed(p, " << v << ", " << floatLiteral(f.min) << ", " << floatLiteral(f.max) << ", "
+          << number(std::pow(10.0, f.decimals)) << ");\n";
+      }
+    }
+    o << "  p = wire::putLiteral(p, " << literal(runs.back()) << ");\n";
+    o << "  *p = '\\0';\n";
+    o << "  return (size_t)(p - out);\n";
+    o << "}\n";
+  }
+}
+
+std::string banner() {
+  return "// Generated by event_schema_gen from pi/native/schema/satellite_events.jsonl.\n"
+         "// Do not edit; change the schema and rebuild.\n\n";
+}
+
+std::string firmwareHeader(const Schema& schema) {
+  std::ostringstream o;
+  o << banner();
+  o << "#ifndef ORACLEBOX_EVENTS_H\n#define ORACLEBOX_EVENTS_H\n\n";
+  o << "#include <stddef.h>\n#include <stdint.h>\n#include <string.h>\n\n";
+  o << "namespace oraclebox {\n\n";
+  emitEncoders(o, schema);
+  o << "\n}  // namespace oraclebox\n\n#endif\n";
+  return o.str();
+}
+
+// ==================== HUB DECODER ====================
+
+std::string hubHeader(const Schema& schema) {
+  std::ostringstream o;
+  o << banner();
+  o << "#ifndef ORACLEBOX_EVENT_SCHEMA_H\n#define ORACLEBOX_EVENT_SCHEMA_H\n\n";
+  o << "#include <cstddef>\n#include <cstdint>\n#include <cstring>\n#include <string_view>\n\n";
+  o << "#include \"oraclebox/json_line.h\"\n\n";
+  o << "namespace oraclebox {\n\n";
+  emitEncoders(o, schema);
+
+  o << "\n// ==================== DECODER ====================\n\n";
+  o << "enum EventTag : uint32_t {\n";
+  for (size_t i = 0; i < schema.tags.size(); i++) {
+    o << "  EVENT_TAG_" << upper(schema.tags[i]) << " = 1u << " << i << ",\n";
+  }
+  o << "};\n\n";
+
+  o << "enum class EventField : uint8_t {\n";
+  for (const Field& f : schema.fields) o << "  " << camel(f.name) << ",\n";
+  o << "  Count\n};\n\n";
+
+  o << R"(// One decoded satellite event. Fields sit at fixed offsets, so reading one
+// is a load, not a key lookup. String fields are views into the decoded
+// line; numeric fields are 0 when absent.
+struct SatelliteEvent {
+)";
+  for (const Field& f : schema.fields) {
+    o << "  " << hubType(f) << " " << member(f.name);
+    o << (f.type == Type::String ? ";\n" : f.type == Type::Int ? " = 0;\n" : " = 0.0f;\n");
+  }
+  o << R"(
+  uint32_t present = 0;     // bit per EventField
+  uint32_t invalid = 0;     // present but not a number, too long or out of range
+  uint32_t escaped = 0;     // string still holds JSON escapes (raw decode only)
+  int unknownKeys = 0;      // keys the schema does not know - drift
+  std::string_view firstUnknownKey;
+
+  bool has(EventField f) const { return present & (1u << (unsigned)f); }
+};
+
+template <EventField F>
+struct EventFieldTraits;
+)";
+  for (const Field& f : schema.fields) {
+    o << "\ntemplate <>\nstruct EventFieldTraits<EventField::" << camel(f.name) << "> {\n";
+    o << "  using type = " << hubType(f) << ";\n";
+    o << "  static constexpr const char* key = " << literal(f.name) << ";\n";
+    o << "  static constexpr size_t offset = offsetof(SatelliteEvent, " << member(f.name) << ");\n";
+    o << "  static constexpr uint32_t tags = " << tagMask(f) << ";\n";
+    if (f.type == Type::String) {
+      o << "  static constexpr size_t maxLen = " << f.maxLen << ";\n";
+    } else {
+      o << "  static constexpr double min = " << number(f.min) << ";\n";
+      o << "  static constexpr double max = " << number(f.max) << ";\n";
+    }
+    o << "};\n";
+  }
+  o << R"(
+// Reads field F through its compile-time offset, for code generic over fields.
+template <EventField F>
+inline const typename EventFieldTraits<F>::type& eventField(const SatelliteEvent& ev) {
+  using Traits = EventFieldTraits<F>;
+  return *reinterpret_cast<const typename Traits::type*>(reinterpret_cast<const char*>(&ev) + Traits::offset);
+}
+
+const char* eventFieldKey(EventField f);
+
+// Decodes a raw line in one pass without copying it; ev's strings view into
+// line, which must outlive them. False if the line is not a JSON object.
+bool decodeSatelliteEvent(std::string_view line, SatelliteEvent& ev);
+
+// Fills ev from a line the link already parsed; ev's strings view into msg.
+void bindSatelliteEvent(const JsonLine& msg, SatelliteEvent& ev);
+
+}  // namespace oraclebox
+
+#endif
+)";
+  return o.str();
+}
+
+std::string hubSource(const Schema& schema) {
+  std::ostringstream o;
+  o << banner();
+  o << "#include \"oraclebox/event_schema.h\"\n\n#include <charconv>\n\n";
+  o << "namespace oraclebox {\n\nnamespace {\n\n";
+
+  // Key dispatch: switch on length, then compare
+  o << "int fieldIndex(std::string_view key) {\n  switch (key.size()) {\n";
+  std::set<size_t> lengths;
+  for (const Field& f : schema.fields) lengths.insert(f.name.size());
+  for (size_t len : lengths) {
+    o << "    case " << len << ":\n";
+    for (size_t i = 0; i < schema.fields.size(); i++) {
+      const Field& f = schema.fields[i];
+      if (f.name.size() != len) continue;
+      o << "      if (std::memcmp(key.data(), " << literal(f.name) << ", " << len << ") == 0) return " << i
+        << ";\n";
+    }
+    o << "      break;\n";
+  }
+  o << "  }\n  return -1;\n}\n\n";
+
+  o << R"(bool parseInt(std::string_view s, int64_t& v) {
+  auto res = std::from_chars(s.data(), s.data() + s.size(), v);
+  if (res.ec != std::errc()) return false;
+  if (res.ptr == s.data() + s.size()) return true;
+  // Fractional value (e.g. "12.5")
+  double d;
+  auto fres = std::from_chars(s.data(), s.data() + s.size(), d);
+  if (fres.ec != std::errc() || fres.ptr != s.data() + s.size()) return false;
+  v = (int64_t)d;
+  return true;
+}
+
+// Satellites send fixed point ("21.37"); read that directly and leave
+// exponents and long mantissas to from_chars.
+bool parseFloat(std::string_view s, float& v) {
+  static const double POW10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9};
+  const char* p = s.data();
+  const char* end = p + s.size();
+  bool negative = p < end && *p == '-';
+  if (negative) p++;
+  int64_t q = 0;
+  int digits = 0;
+  int decimals = -1;
+  for (; p < end && digits < 15; p++) {
+    if (*p >= '0' && *p <= '9') {
+      q = q * 10 + (*p - '0');
+      digits++;
+      if (decimals >= 0) decimals++;
+    } else if (*p == '.' && decimals < 0) {
+      decimals = 0;
+    } else {
+      break;
+    }
+  }
+  if (p == end && digits > 0 && decimals <= 9) {
+    double d = decimals > 0 ? (double)q / POW10[decimals] : (double)q;
+    v = (float)(negative ? -d : d);
+    return true;
+  }
+  auto res = std::from_chars(s.data(), end, v);
+  return res.ec == std::errc() && res.ptr == end;
+}
+
+void unknownKey(SatelliteEvent& ev, std::string_view key) {
+  if (ev.unknownKeys++ == 0) ev.firstUnknownKey = key;
+}
+
+void assign(SatelliteEvent& ev, int field, std::string_view value, bool escaped) {
+  uint32_t bit = 1u << field;
+  ev.present |= bit;
+  switch (field) {
+)";
+  for (size_t i = 0; i < schema.fields.size(); i++) {
+    const Field& f = schema.fields[i];
+    std::string m = "ev." + member(f.name);
+    o << "    case " << i << ": {   // " << f.name << "\n";
+    if (f.type == Type::String) {
+      o << "      " << m << " = value;\n";
+      o << "      if (value.size() > " << f.maxLen << ") ev.invalid |= bit;\n";
+      o << "      if (escaped) ev.escaped |= bit;\n";
+    } else if (f.type == Type::Int) {
+      o << "      int64_t v;\n";
+      o << "      if (!parseInt(value, v)) {\n        ev.invalid |= bit;\n        break;\n      }\n";
+      o << "      if (v < " << number(f.min) << " || v > " << number(f.max) << ") ev.invalid |= bit;\n";
+      o << "      " << m << " = (int32_t)v;\n";
+    } else {
+      o << "      float v;\n";
+      o << "      if (!parseFloat(value, v)) {\n        ev.invalid |= bit;\n        break;\n      }\n";
+      o << "      if (!(v >= " << floatLiteral(f.min) << " && v <= " << floatLiteral(f.max)
+        << ")) ev.invalid |= bit;\n";
+      o << "      " << m << " = v;\n";
+    }
+    o << "      break;\n    }\n";
+  }
+  o << "  }\n}\n\n";
+
+  o << R"(bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+
+}  // namespace
+
+const char* eventFieldKey(EventField f) {
+  static const char* const KEYS[] = {)";
+  for (size_t i = 0; i < schema.fields.size(); i++) o << (i ? ", " : "") << literal(schema.fields[i].name);
+  o << R"(};
+  return f < EventField::Count ? KEYS[(unsigned)f] : "";
+}
+
+bool decodeSatelliteEvent(std::string_view line, SatelliteEvent& ev) {
+  ev = SatelliteEvent{};
+  const char* p = line.data();
+  const char* end = p + line.size();
+  while (p < end && isSpace(*p)) p++;
+  if (p >= end || *p != '{') return false;
+  p++;
+
+  for (;;) {
+    while (p < end && (isSpace(*p) || *p == ',')) p++;
+    if (p >= end) return false;
+    if (*p == '}') return true;
+    if (*p != '"') return false;
+
+    const char* key = ++p;
+    while (p < end && *p != '"') p += *p == '\\' ? 2 : 1;
+    if (p >= end) return false;
+    std::string_view k(key, (size_t)(p - key));
+    p++;
+    while (p < end && isSpace(*p)) p++;
+    if (p >= end || *p != ':') return false;
+    p++;
+    while (p < end && isSpace(*p)) p++;
+    if (p >= end) return false;
+
+    std::string_view value;
+    bool escaped = false;
+    if (*p == '"') {
+      const char* v = ++p;
+      while (p < end && *p != '"') {
+        if (*p == '\\') {
+          escaped = true;
+          p++;
+        }
+        p++;
+      }
+      if (p >= end) return false;
+      value = std::string_view(v, (size_t)(p - v));
+      p++;
+    } else if (*p == '{' || *p == '[') {
+      // Nested value (not in the schema); skip it whole
+      const char* v = p;
+      int depth = 0;
+      bool inString = false;
+      for (; p < end; p++) {
+        if (inString) {
+          if (*p == '\\') p++;
+          else if (*p == '"') inString = false;
+        } else if (*p == '"') {
+          inString = true;
+        } else if (*p == '{' || *p == '[') {
+          depth++;
+        } else if ((*p == '}' || *p == ']') && --depth == 0) {
+          p++;
+          break;
+        }
+      }
+      if (depth != 0) return false;
+      value = std::string_view(v, (size_t)(p - v));
+    } else {
+      const char* v = p;
+      while (p < end && *p != ',' && *p != '}' && !isSpace(*p)) p++;
+      value = std::string_view(v, (size_t)(p - v));
+    }
+
+    int field = fieldIndex(k);
+    if (field < 0) unknownKey(ev, k);
+    else assign(ev, field, value, escaped);
+  }
+}
+
+void bindSatelliteEvent(const JsonLine& msg, SatelliteEvent& ev) {
+  ev = SatelliteEvent{};
+  for (int i = 0; i < msg.fieldCount(); i++) {
+    int field = fieldIndex(msg.keyAt(i));
+    if (field < 0) unknownKey(ev, msg.keyAt(i));
+    else assign(ev, field, msg.valueAt(i), false);
+  }
+}
+
+}  // namespace oraclebox
+)";
+  return o.str();
+}
+
+// ==================== OUTPUT ====================
+
+bool readFile(const std::string& path, std::string& out) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) return false;
+  std::stringstream s;
+  s << in.rdbuf();
+  out = s.str();
+  return true;
+}
+
+// Writes only on change, so the build does not recompile needlessly
+bool emit(const std::string& path, const std::string& text, bool check) {
+  std::string current;
+  bool same = readFile(path, current) && current == text;
+  if (check) {
+    if (!same) std::fprintf(stderr, "[SCHEMA] %s is out of date; build the firmware_event_headers target\n", path.c_str());
+    return same;
+  }
+  if (same) return true;
+  std::error_code ec;
+  std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  if (!out) {
+    std::fprintf(stderr, "[SCHEMA] Cannot write %s\n", path.c_str());
+    return false;
+  }
+  out << text;
+  std::printf("[SCHEMA] Wrote %s\n", path.c_str());
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::string schemaPath;
+  std::string hubDir;
+  std::vector<std::string> firmware;
+  bool check = false;
+  for (int i = 1; i < argc; i++) {
+    if (!std::strcmp(argv[i], "--schema") && i + 1 < argc) schemaPath = argv[++i];
+    else if (!std::strcmp(argv[i], "--hub") && i + 1 < argc) hubDir = argv[++i];
+    else if (!std::strcmp(argv[i], "--check")) check = true;
+    else if (!std::strcmp(argv[i], "--firmware")) {
+      while (i + 1 < argc && std::strncmp(argv[i + 1], "--", 2) != 0) firmware.push_back(argv[++i]);
+    } else {
+      std::fprintf(stderr, "Usage: %s --schema PATH [--hub DIR] [--firmware HEADER ...] [--check]\n", argv[0]);
+      return 2;
+    }
+  }
+  if (schemaPath.empty()) {
+    std::fprintf(stderr, "[SCHEMA] --schema is required\n");
+    return 2;
+  }
+
+  Schema schema;
+  if (!loadSchema(schemaPath, schema)) return 1;
+
+  bool ok = true;
+  if (!hubDir.empty()) {
+    ok &= emit(hubDir + "/oraclebox/event_schema.h", hubHeader(schema), check);
+    ok &= emit(hubDir + "/event_schema.cpp", hubSource(schema), check);
+  }
+  std::string fw = firmwareHeader(schema);
+  for (const std::string& path : firmware) ok &= emit(path, fw, check);
+  return ok ? 0 : 1;
+}
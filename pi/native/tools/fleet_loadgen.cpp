@@ -0,0 +1,301 @@
+// Fleet load generator: simulates many satellites against a running hub to
+// measure ingestion throughput and per-satellite fairness.
+//
+//   fleet_loadgen --devices 200 --threads 4 --seconds 10 [--rate 50] [--chatty 2]
+//                 [--host 127.0.0.1] [--port 8888]
+//
+// Each simulated satellite says hello and then sends em_trigger lines,
+// --rate per second each (0 = as fast as the socket takes them). The first
+// --chatty satellites always send flat out, like a REM pod with a stuck
+// sensor. Every satellite also sends a time_sync probe every 100 ms; the
+// probe's round trip shows how long its lines queue at the hub.
+//
+// At the end every satellite sends a last time_sync and the run waits for the
+// replies: the hub answers a line only after reading every line before it, so
+// lines sent / time to the last reply is what the hub actually ingested.
+//
+// Run the hub with --quiet. For raw throughput turn the hub's rate limit off
+// (--rate-limit 0); with the limit on, compare the normal and chatty probe
+// latencies.
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "oraclebox/hub_clock.h"
+
+using namespace oraclebox;
+
+namespace {
+
+constexpr int64_t PROBE_INTERVAL_US = 100000;
+constexpr size_t CHATTY_TX_BYTES = 64 * 1024;
+constexpr int64_t FINAL_T0 = -1;   // marks the closing time_sync
+
+struct Options {
+  const char* host = "127.0.0.1";
+  int port = 8888;
+  int devices = 100;
+  int threads = 4;
+  double seconds = 10.0;
+  double rate = 0.0;          // lines/s per device, 0 = flat out
+  int chatty = 0;
+  double drainSeconds = 10.0;
+};
+
+struct Device {
+  int fd = -1;
+  std::string id;
+  bool chatty = false;
+  std::string tx;
+  size_t txOff = 0;
+  std::string rx;
+  int64_t nextEventUs = 0;
+  int64_t nextProbeUs = 0;
+  uint64_t seq = 0;
+  uint64_t lines = 0;
+  bool finalSent = false;
+  bool finalDone = false;
+  bool failed = false;
+};
+
+struct ThreadResult {
+  uint64_t lines = 0;
+  int finished = 0;
+  int failed = 0;
+  int64_t lastFinalUs = 0;
+  std::vector<double> normalRttMs;
+  std::vector<double> chattyRttMs;
+};
+
+int connectTo(const Options& opt) {
+  int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) return -1;
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons((uint16_t)opt.port);
+  inet_pton(AF_INET, opt.host, &addr.sin_addr);
+  if (connect(fd, (sockaddr*)&addr, sizeof(addr)) != 0) {
+    ::close(fd);
+    return -1;
+  }
+  int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  return fd;
+}
+
+void appendEvent(Device& d) {
+  d.tx += "{\"event\":\"em_trigger\",\"id\":\"" + d.id + "\",\"strength\":" + std::to_string(d.seq % 5 + 1) +
+          ",\"seq\":" + std::to_string(d.seq) + "}\n";
+  d.seq++;
+  d.lines++;
+}
+
+void appendProbe(Device& d, int64_t t0) {
+  d.tx += "{\"event\":\"time_sync\",\"id\":\"" + d.id + "\",\"t0\":" + std::to_string(t0) + "}\n";
+  d.lines++;
+}
+
+// Returns false if the connection broke
+bool flush(Device& d) {
+  while (d.txOff < d.tx.size()) {
+    ssize_t n = send(d.fd, d.tx.data() + d.txOff, d.tx.size() - d.txOff, MSG_NOSIGNAL);
+    if (n > 0) {
+      d.txOff += (size_t)n;
+      continue;
+    }
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+    return false;
+  }
+  if (d.txOff == d.tx.size()) {
+    d.tx.clear();
+    d.txOff = 0;
+  } else if (d.txOff > CHATTY_TX_BYTES) {
+    d.tx.erase(0, d.txOff);
+    d.txOff = 0;
+  }
+  return true;
+}
+
+int64_t parseT0(const std::string& line) {
+  size_t at = line.find("\"t0\":");
+  return at == std::string::npos ? 0 : std::strtoll(line.c_str() + at + 5, nullptr, 10);
+}
+
+// Returns false if the connection broke
+bool receive(Device& d, ThreadResult& result) {
+  char buf[4096];
+  for (;;) {
+    ssize_t n = ::read(d.fd, buf, sizeof(buf));
+    if (n > 0) {
+      d.rx.append(buf, (size_t)n);
+      continue;
+    }
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+    return false;
+  }
+  size_t start = 0;
+  for (size_t nl; (nl = d.rx.find('\n', start)) != std::string::npos; start = nl + 1) {
+    std::string line = d.rx.substr(start, nl - start);
+    if (line.find("time_sync") == std::string::npos) continue;
+    int64_t t0 = parseT0(line);
+    int64_t now = hubNowUs();
+    if (t0 == FINAL_T0) {
+      d.finalDone = true;
+      result.finished++;
+      result.lastFinalUs = std::max(result.lastFinalUs, now);
+    } else if (t0 > 0) {
+      (d.chatty ? result.chattyRttMs : result.normalRttMs).push_back((now - t0) / 1000.0);
+    }
+  }
+  d.rx.erase(0, start);
+  return true;
+}
+
+void runDevices(const Options& opt, int first, int count, int64_t endUs, ThreadResult& result) {
+  std::vector<Device> devices(count);
+  int64_t now = hubNowUs();
+  for (int i = 0; i < count; i++) {
+    Device& d = devices[i];
+    char id[24];
+    std::snprintf(id, sizeof(id), "sim_%04d", first + i);
+    d.id = id;
+    d.chatty = first + i < opt.chatty;
+    d.fd = connectTo(opt);
+    if (d.fd < 0) {
+      std::fprintf(stderr, "[LOADGEN] %s cannot connect to %s:%d\n", id, opt.host, opt.port);
+      d.failed = true;
+      result.failed++;
+      continue;
+    }
+    d.tx = "{\"event\":\"hello\",\"id\":\"" + d.id + "\",\"device\":\"rempod\",\"location\":\"room_" +
+           std::to_string((first + i) % 8) + "\"}\n";
+    d.lines = 1;
+    // Spread the probes so they do not all land in the same millisecond
+    d.nextEventUs = now;
+    d.nextProbeUs = now + (first + i) * 997 % PROBE_INTERVAL_US;
+  }
+
+  int64_t drainEndUs = endUs + (int64_t)(opt.drainSeconds * 1e6);
+  double intervalUs = opt.rate > 0 ? 1e6 / opt.rate : 0.0;
+  std::vector<pollfd> fds(count);
+  for (;;) {
+    now = hubNowUs();
+    bool sending = now < endUs;
+    int open = 0;
+    for (int i = 0; i < count; i++) {
+      Device& d = devices[i];
+      fds[i] = pollfd{-1, 0, 0};
+      if (d.failed || d.finalDone) continue;
+      open++;
+      if (sending) {
+        if (d.chatty || intervalUs == 0.0) {
+          while (d.tx.size() - d.txOff < CHATTY_TX_BYTES / 4) appendEvent(d);
+        } else {
+          for (; d.nextEventUs <= now; d.nextEventUs += (int64_t)intervalUs) appendEvent(d);
+        }
+        if (d.nextProbeUs <= now) {
+          appendProbe(d, now);
+          d.nextProbeUs += PROBE_INTERVAL_US;
+        }
+      } else if (!d.finalSent) {
+        appendProbe(d, FINAL_T0);
+        d.finalSent = true;
+      }
+      if (!flush(d) || !receive(d, result)) {
+        std::fprintf(stderr, "[LOADGEN] %s lost its connection\n", d.id.c_str());
+        d.failed = true;
+        result.failed++;
+        continue;
+      }
+      fds[i] = pollfd{d.fd, (short)(POLLIN | (d.tx.size() > d.txOff ? POLLOUT : 0)), 0};
+    }
+    if (open == 0 || now >= drainEndUs) break;
+    ::poll(fds.data(), fds.size(), 1);
+  }
+
+  for (Device& d : devices) {
+    result.lines += d.lines;
+    if (d.fd >= 0) ::close(d.fd);
+  }
+}
+
+double percentile(std::vector<double>& v, double p) {
+  if (v.empty()) return 0.0;
+  size_t k = std::min(v.size() - 1, (size_t)(p / 100.0 * v.size()));
+  std::nth_element(v.begin(), v.begin() + k, v.end());
+  return v[k];
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options opt;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!std::strcmp(argv[i], "--host")) opt.host = argv[i + 1];
+    else if (!std::strcmp(argv[i], "--port")) opt.port = std::atoi(argv[i + 1]);
+    else if (!std::strcmp(argv[i], "--devices")) opt.devices = std::atoi(argv[i + 1]);
+    else if (!std::strcmp(argv[i], "--threads")) opt.threads = std::atoi(argv[i + 1]);
+    else if (!std::strcmp(argv[i], "--seconds")) opt.seconds = std::atof(argv[i + 1]);
+    else if (!std::strcmp(argv[i], "--rate")) opt.rate = std::atof(argv[i + 1]);
+    else if (!std::strcmp(argv[i], "--chatty")) opt.chatty = std::atoi(argv[i + 1]);
+    else if (!std::strcmp(argv[i], "--drain")) opt.drainSeconds = std::atof(argv[i + 1]);
+  }
+  opt.threads = std::max(1, std::min(opt.threads, opt.devices));
+
+  int64_t startUs = hubNowUs();
+  int64_t endUs = startUs + (int64_t)(opt.seconds * 1e6);
+  std::vector<ThreadResult> results(opt.threads);
+  std::vector<std::thread> threads;
+  for (int t = 0, first = 0; t < opt.threads; t++) {
+    int count = opt.devices / opt.threads + (t < opt.devices % opt.threads ? 1 : 0);
+    threads.emplace_back(runDevices, std::cref(opt), first, count, endUs, std::ref(results[t]));
+    first += count;
+  }
+  for (auto& t : threads) t.join();
+
+  ThreadResult total;
+  for (ThreadResult& r : results) {
+    total.lines += r.lines;
+    total.finished += r.finished;
+    total.failed += r.failed;
+    total.lastFinalUs = std::max(total.lastFinalUs, r.lastFinalUs);
+    total.normalRttMs.insert(total.normalRttMs.end(), r.normalRttMs.begin(), r.normalRttMs.end());
+    total.chattyRttMs.insert(total.chattyRttMs.end(), r.chattyRttMs.begin(), r.chattyRttMs.end());
+  }
+
+  std::printf("%d device(s) (%d chatty) on %d thread(s), %.1f s\n", opt.devices, std::min(opt.chatty, opt.devices),
+              opt.threads, opt.seconds);
+  if (total.finished == opt.devices && total.lastFinalUs > startUs) {
+    double elapsed = (total.lastFinalUs - startUs) / 1e6;
+    std::printf("  ingested %llu lines in %.2f s: %.0f lines/s\n", (unsigned long long)total.lines, elapsed,
+                total.lines / elapsed);
+  } else {
+    std::printf("  sent %llu lines; %d device(s) still backlogged, %d failed (throughput not measured)\n",
+                (unsigned long long)total.lines, opt.devices - total.finished - total.failed, total.failed);
+  }
+  std::printf("  time_sync round trip, normal: %zu probes, p50 %.2f / p99 %.2f ms\n", total.normalRttMs.size(),
+              percentile(total.normalRttMs, 50), percentile(total.normalRttMs, 99));
+  if (opt.chatty > 0) {
+    std::printf("  time_sync round trip, chatty: %zu probes, p50 %.2f / p99 %.2f ms\n", total.chattyRttMs.size(),
+                percentile(total.chattyRttMs, 50), percentile(total.chattyRttMs, 99));
+  }
+  return total.failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,78 @@
+// FM sweep timing check: runs the native sweep engine and reports how far
+// each step landed from its schedule.
+//
+//   fm_sweep_bench [--bus 1] [--delay 50] [--seconds 10] [--down] [--mono]
+//                  [--retune-pipe /tmp/oraclebox_fx.control]
+//
+// Without --bus no tuner is opened and only the scheduling is measured.
+// --retune-pipe announces the steps to a running oraclebox_fx, as the hub
+// does.
+// Compare with the Python sweep, whose step period is the SPEED delay plus
+// the I2C write, the LED pulse and whatever the GIL adds.
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "oraclebox/fm_sweep.h"
+#include "oraclebox/hub_clock.h"
+
+using namespace oraclebox;
+
+int main(int argc, char** argv) {
+  int bus = -1;
+  int delayMs = 50;
+  int seconds = 10;
+  bool down = false;
+  bool mono = false;
+  const char* retunePipe = nullptr;
+  for (int i = 1; i < argc; i++) {
+    if (!std::strcmp(argv[i], "--bus") && i + 1 < argc) bus = std::atoi(argv[++i]);
+    else if (!std::strcmp(argv[i], "--delay") && i + 1 < argc) delayMs = std::atoi(argv[++i]);
+    else if (!std::strcmp(argv[i], "--seconds") && i + 1 < argc) seconds = std::atoi(argv[++i]);
+    else if (!std::strcmp(argv[i], "--down")) down = true;
+    else if (!std::strcmp(argv[i], "--mono")) mono = true;
+    else if (!std::strcmp(argv[i], "--retune-pipe") && i + 1 < argc) retunePipe = argv[++i];
+  }
+
+  SweepEngine sweep;
+  if (bus >= 0 && !sweep.openTuner(bus)) return 1;
+  sweep.setDelayMs(delayMs);
+  sweep.setDirection(down ? -1 : 1);
+  sweep.setMono(mono);
+  if (retunePipe) {
+    std::signal(SIGPIPE, SIG_IGN);   // as in the hub: oraclebox_fx may go away
+    sweep.setRetunePipe(retunePipe);
+  }
+  sweep.start();
+  sweep.setRunning(true);
+
+  // Step-to-step periods as seen by a consumer (the LED thread's view)
+  int64_t endUs = hubNowUs() + (int64_t)seconds * 1000000;
+  SweepEngine::Step prev = sweep.waitStep(0, 1000);
+  double minMs = 1e9, maxMs = 0.0, sumMs = 0.0;
+  long periods = 0;
+  while (hubNowUs() < endUs) {
+    SweepEngine::Step step = sweep.waitStep(prev.seq, 1000);
+    if (step.seq == prev.seq) continue;
+    double ms = (double)(step.timeUs - prev.timeUs) / 1000.0 / (double)(step.seq - prev.seq);
+    if (ms < minMs) minMs = ms;
+    if (ms > maxMs) maxMs = ms;
+    sumMs += ms;
+    periods++;
+    prev = step;
+  }
+  sweep.stop();
+
+  SweepEngine::Stats s = sweep.stats();
+  std::printf("%llu steps at %d ms (%s, %.1f MHz last)\n", (unsigned long long)s.steps, delayMs,
+              bus >= 0 ? "TEA5767" : "no tuner", prev.mhz);
+  if (periods > 0) {
+    std::printf("  period      min %.3f  mean %.3f  max %.3f ms\n", minMs, sumMs / (double)periods, maxMs);
+  }
+  std::printf("  lateness    mean %.3f  max %.3f ms, %llu step(s) over 1 ms\n", s.meanLateMs, s.maxLateMs,
+              (unsigned long long)s.late);
+  if (s.i2cErrors) std::printf("  i2c errors  %llu\n", (unsigned long long)s.i2cErrors);
+  return 0;
+}
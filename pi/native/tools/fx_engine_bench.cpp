@@ -0,0 +1,507 @@
+// FX engine cost check: runs the ghost-box chain over synthetic radio audio
+// (a wandering tone, a voice-band buzz and noise) the way sox ran it (both
+// channels at 48 kHz) and mono at the lower internal rates, and reports the
+// CPU each takes per second of audio.
+//
+//   fx_engine_bench [--seconds 20] [--block 480] [--sox]
+//
+// The noise suppressor is run alone at 16 kHz on alternating static and
+// tone-in-static (a sweep landing between stations and on one). The bench
+// reports how far the static drops, how much the tone changes, the
+// suppressor's delay, and its CPU.
+//
+// Levels: stations from -40 to -6 dBFS, 4 s each, through the whole mono
+// engine, reporting the spread of the output level (AGC) and its highest
+// peak (limiter).
+//
+// Retunes: a station with a 3 ms click at each 100 ms sweep step, landing
+// anywhere in a block. Each click starts up to 1 ms after its step's
+// deadline, as a late I2C write would. The mono engine is told the
+// deadline's frame in advance, as oraclebox_fx is told by the sweep, with the retune mute off
+// and at its default. The bench reports how much click energy reaches the
+// output, relative to the station. That is the difference from the same run
+// without the clicks.
+//
+// Fan-out: 10 ms blocks published at the real-time pace to three sinks, as
+// oraclebox_fx does. One sink keeps up, one writes to a file, and one
+// stalls for 500 ms of every second, longer than its 320 ms queue. The bench reports the producer's cost
+// per block and what each sink wrote and dropped.
+//
+// Preset switching: three FX_PRESETS entries are compiled into an
+// FxPresetCache (timed per preset, against configuring a fresh engine as a
+// restart would), then a second thread selects them in turn every 250 ms
+// while the mono engine runs 10 ms blocks paced as the pipeline would be.
+// The latency is select() to the first block processed with the preset.
+//
+// The reverb is also timed alone, on both channels at 48 kHz and on one at
+// 16 kHz. With --sox, sox's `reverb` at the same settings is timed on the
+// same audio for comparison (its CPU time, from getrusage).
+//
+// The mono runs are also compared with the stereo reference in the
+// 300-3400 Hz band the listener hears, after aligning for their extra delay.
+// The reverb is left out of that comparison: its line lengths are rounded
+// at each rate, so its tail differs sample by sample however it is run.
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "oraclebox/audio_fanout.h"
+#include "oraclebox/fx_engine.h"
+#include "oraclebox/hub_clock.h"
+
+using namespace oraclebox;
+
+namespace {
+
+std::vector<int16_t> makeInput(int seconds) {
+  const int rate = FxEngine::IO_RATE;
+  size_t frames = (size_t)seconds * rate;
+  std::vector<int16_t> pcm(frames * 2);
+  std::mt19937 rng(7);
+  std::normal_distribution<double> noise(0.0, 0.05);
+  double phase = 0.0, buzz = 0.0;
+  for (size_t i = 0; i < frames; i++) {
+    double t = (double)i / rate;
+    phase += 2.0 * M_PI * (600.0 + 400.0 * std::sin(2.0 * M_PI * 0.3 * t)) / rate;
+    buzz += 2.0 * M_PI * 140.0 / rate;
+    double burst = std::fmod(t, 0.7) < 0.35 ? 1.0 : 0.2;   // on/off like sweep steps
+    double v = burst * (0.3 * std::sin(phase) + 0.15 * std::tanh(4.0 * std::sin(buzz))) + noise(rng);
+    int16_t s = (int16_t)std::lrint(std::max(-1.0, std::min(1.0, v)) * 32000.0);
+    pcm[2 * i] = s;
+    pcm[2 * i + 1] = (int16_t)(s * 0.9);
+  }
+  return pcm;
+}
+
+struct Run {
+  double usPerSecond = 0.0;
+  std::vector<float> mono;   // the output's left channel
+};
+
+Run run(FxEngine& engine, const std::vector<int16_t>& in, size_t block) {
+  size_t frames = in.size() / 2;
+  std::vector<int16_t> out(engine.maxOutput(block) * 2);
+  Run r;
+  r.mono.reserve(frames + 16);
+  int64_t t0 = hubNowUs();
+  for (size_t at = 0; at < frames; at += block) {
+    size_t n = std::min(block, frames - at);
+    size_t produced = engine.process(in.data() + at * 2, n, out.data());
+    for (size_t i = 0; i < produced; i++) r.mono.push_back((float)out[2 * i]);
+  }
+  r.usPerSecond = (double)(hubNowUs() - t0) / ((double)frames / FxEngine::IO_RATE);
+  return r;
+}
+
+// Band-limits x to 300-3400 Hz (two RBJ biquads each way) for comparing.
+std::vector<float> voiceBand(std::vector<float> x) {
+  Biquad hp, lp;
+  hp.highpass(300, FxEngine::IO_RATE);
+  lp.lowpass(3400, FxEngine::IO_RATE);
+  hp.process(x.data(), x.size());
+  lp.process(x.data(), x.size());
+  return x;
+}
+
+// Best signal-to-difference ratio over lags 0..maxLag of b behind a.
+double matchDb(const std::vector<float>& a, const std::vector<float>& b, int maxLag, int& lagOut) {
+  double best = -1e9;
+  size_t n = std::min(a.size(), b.size());
+  size_t skip = FxEngine::IO_RATE;   // past the AGC settling
+  for (int lag = 0; lag <= maxLag; lag++) {
+    double sig = 0.0, diff = 0.0;
+    for (size_t i = skip; i + (size_t)lag < n; i++) {
+      double d = a[i] - b[i + (size_t)lag];
+      sig += (double)a[i] * a[i];
+      diff += d * d;
+    }
+    double db = 10.0 * std::log10(sig / std::max(diff, 1e-9));
+    if (db > best) {
+      best = db;
+      lagOut = lag;
+    }
+  }
+  return best;
+}
+
+double childCpuUs() {
+  rusage ru{};
+  getrusage(RUSAGE_CHILDREN, &ru);
+  return (double)ru.ru_utime.tv_sec * 1e6 + (double)ru.ru_utime.tv_usec + (double)ru.ru_stime.tv_sec * 1e6 +
+         (double)ru.ru_stime.tv_usec;
+}
+
+// The reverb alone over `channels` of the input at `rate` (every
+// 48000/rate-th frame, which is enough for timing).
+double reverbUsPerSecond(const std::vector<int16_t>& in, const FxParams& p, int rate, int channels) {
+  size_t step = (size_t)(FxEngine::IO_RATE / rate);
+  size_t n = in.size() / 2 / step;
+  std::vector<float> x(n);
+  double us = 0.0;
+  for (int c = 0; c < channels; c++) {
+    for (size_t i = 0; i < n; i++) x[i] = (float)in[2 * i * step + (size_t)c] / 32768.0f;
+    FdnReverb reverb;
+    reverb.setup(p, rate);
+    int64_t t0 = hubNowUs();
+    for (size_t at = 0; at < n; at += 160) reverb.process(x.data() + at, std::min((size_t)160, n - at));
+    us += (double)(hubNowUs() - t0);
+  }
+  return us / ((double)in.size() / 2 / FxEngine::IO_RATE);
+}
+
+// sox's reverb on the same audio: CPU per second of audio, or -1 if sox
+// did not run.
+double soxReverbUsPerSecond(const std::vector<int16_t>& in, const FxParams& p) {
+  char cmd[256];
+  std::snprintf(cmd, sizeof(cmd), "sox -t raw -r 48000 -c 2 -e signed -b 16 - -t raw /dev/null reverb %d %d %d %d",
+                p.reverbRoom, p.reverbDamping, p.reverbWet, p.reverbDry);
+  std::signal(SIGPIPE, SIG_IGN);   // sox missing or failing
+  double before = childCpuUs();
+  FILE* sox = popen(cmd, "w");
+  if (!sox) return -1.0;
+  size_t written = std::fwrite(in.data(), sizeof(int16_t), in.size(), sox);
+  if (pclose(sox) != 0 || written != in.size()) return -1.0;
+  return (childCpuUs() - before) / ((double)in.size() / 2 / FxEngine::IO_RATE);
+}
+
+struct DenoiseResult {
+  double staticDb = 0.0, toneDb = 0.0, usPerSecond = 0.0, latencyMs = 0.0;
+};
+
+DenoiseResult denoise(int seconds, int amount) {
+  const int rate = 16000;
+  size_t n = (size_t)seconds * rate;
+  std::vector<float> x(n), tone(n);
+  std::vector<bool> gap(n);
+  std::mt19937 rng(11);
+  std::normal_distribution<float> noise(0.0f, 0.1f);
+  for (size_t i = 0; i < n; i++) {
+    gap[i] = (i / (rate / 2)) % 2 == 0;   // 500 ms of static, then 500 ms of station
+    tone[i] = gap[i] ? 0.0f : 0.3f * std::sin(2.0f * (float)M_PI * 700.0f * (float)i / rate);
+    x[i] = tone[i] + noise(rng);
+  }
+  NoiseSuppressor ns;
+  ns.setup(amount, rate);
+  std::vector<float> y = x;
+  int64_t t0 = hubNowUs();
+  for (size_t at = 0; at < n; at += 160) ns.process(y.data() + at, std::min((size_t)160, n - at));
+  DenoiseResult r;
+  r.usPerSecond = (double)(hubNowUs() - t0) / seconds;
+  size_t lag = ns.latency();
+  r.latencyMs = 1000.0 * (double)lag / rate;
+
+  // After the first second, in the middle of each segment (clear of the
+  // transitions the suppressor is still adapting to)
+  double staticIn = 0, staticOut = 0, toneIn = 0, toneOut = 0;
+  for (size_t i = rate; i + lag < n; i++) {
+    size_t pos = i % (rate / 2);
+    if (pos < rate / 8 || pos > rate * 3 / 8) continue;
+    float out = y[i + lag];
+    if (gap[i]) {
+      staticIn += (double)x[i] * x[i];
+      staticOut += (double)out * out;
+    } else {
+      double d = out - tone[i];
+      toneIn += (double)tone[i] * tone[i];
+      toneOut += d * d;
+    }
+  }
+  r.staticDb = 10.0 * std::log10(staticOut / staticIn);
+  r.toneDb = 10.0 * std::log10(toneOut / toneIn);   // what is left that is not the tone
+  return r;
+}
+
+void levels(int seconds) {
+  const int rate = FxEngine::IO_RATE;
+  static const float LEVELS_DB[] = {-40.0f, -10.0f, -25.0f, -6.0f, -32.0f, -16.0f};
+  const size_t segment = (size_t)rate * 4;
+  size_t segments = std::max((size_t)2, (size_t)seconds / 4);
+  std::vector<int16_t> in(segments * segment * 2);
+  std::mt19937 rng(5);
+  std::normal_distribution<float> noise(0.0f, 0.3f);
+  for (size_t i = 0; i < segments * segment; i++) {
+    float amp = std::pow(10.0f, LEVELS_DB[(i / segment) % 6] / 20.0f) * 1.4f;   // ~level RMS
+    float t = (float)i / rate;
+    float v = amp * (0.8f * std::sin(2.0f * (float)M_PI * 800.0f * t) * (0.6f + 0.4f * std::sin(6.0f * t)) + noise(rng));
+    in[2 * i] = in[2 * i + 1] = (int16_t)std::lrint(std::max(-1.0f, std::min(1.0f, v)) * 32767.0f);
+  }
+  FxEngine engine;
+  engine.configure(FxParams());
+  std::vector<int16_t> out(engine.maxOutput(480) * 2);
+  std::vector<float> y;
+  for (size_t at = 0; at < in.size() / 2; at += 480) {
+    size_t produced = engine.process(in.data() + at * 2, std::min((size_t)480, in.size() / 2 - at), out.data());
+    for (size_t i = 0; i < produced; i++) y.push_back((float)out[2 * i] / 32768.0f);
+  }
+  // Level over the second half of each segment, once the AGC has moved
+  float minIn = 0, maxIn = -200, minOut = 0, maxOut = -200, peak = 0;
+  for (size_t s = 0; s < segments; s++) {
+    double pin = 0, pout = 0;
+    for (size_t i = s * segment + segment / 2; i < (s + 1) * segment && i < y.size(); i++) {
+      pin += std::pow(in[2 * i] / 32768.0, 2);
+      pout += (double)y[i] * y[i];
+    }
+    float dbIn = (float)(10.0 * std::log10(pin / (segment / 2) + 1e-12));
+    float dbOut = (float)(10.0 * std::log10(pout / (segment / 2) + 1e-12));
+    minIn = std::min(minIn, dbIn);
+    maxIn = std::max(maxIn, dbIn);
+    minOut = std::min(minOut, dbOut);
+    maxOut = std::max(maxOut, dbOut);
+  }
+  for (float v : y) peak = std::max(peak, std::fabs(v));
+  std::printf("levels: stations from %.1f to %.1f dBFS RMS come out from %.1f to %.1f (%.1f dB spread), "
+              "peak %.2f dBFS\n",
+              minIn, maxIn, minOut, maxOut, maxOut - minOut, 20.0 * std::log10(peak));
+}
+
+void retunes(int seconds) {
+  const int rate = FxEngine::IO_RATE;
+  const size_t n = (size_t)seconds * rate;
+  const size_t period = (size_t)rate / 10, click = (size_t)rate * 3 / 1000;
+  std::mt19937 rng(13);
+  std::uniform_int_distribution<size_t> offset(0, period / 2), writeLate(0, (size_t)rate / 1000);
+  std::normal_distribution<float> burst(0.0f, 0.5f);
+  std::vector<int64_t> at;
+  for (size_t r = period; r + period < n; r += period) at.push_back((int64_t)(r + offset(rng)));
+  std::vector<int16_t> clean(n * 2), clicked(n * 2);
+  for (size_t i = 0; i < n; i++) {
+    float v = 0.3f * std::sin(2.0f * (float)M_PI * 900.0f * (float)i / rate);
+    clean[2 * i] = clean[2 * i + 1] = (int16_t)std::lrint(v * 32767.0f);
+  }
+  clicked = clean;
+  for (int64_t deadline : at) {
+    size_t r = (size_t)deadline + writeLate(rng);
+    for (size_t i = 0; i < click && r + i < n; i++) {
+      // PLL settling: a decaying burst
+      float v = clicked[2 * (r + i)] / 32768.0f + burst(rng) * (1.0f - (float)i / click);
+      clicked[2 * (r + i)] = clicked[2 * (r + i) + 1] = (int16_t)std::lrint(std::max(-1.0f, std::min(1.0f, v)) * 32767.0f);
+    }
+  }
+
+  auto runWith = [&](const std::vector<int16_t>& in, int muteMs) {
+    FxParams p;
+    p.retuneMuteMs = muteMs;
+    FxEngine engine;
+    engine.configure(p);
+    std::vector<int16_t> out(engine.maxOutput(480) * 2);
+    std::vector<float> y;
+    size_t next = 0;
+    for (size_t pos = 0; pos < n; pos += 480) {
+      // Announced a block ahead
+      while (next < at.size() && at[next] < (int64_t)(pos + 960)) engine.retuneAt(at[next++]);
+      size_t produced = engine.process(in.data() + pos * 2, std::min((size_t)480, n - pos), out.data());
+      for (size_t i = 0; i < produced; i++) y.push_back((float)out[2 * i] / 32768.0f);
+    }
+    return y;
+  };
+  std::printf("retunes: %zu clicks of 3 ms, one per 100 ms step\n", at.size());
+  for (int muteMs : {0, FxParams().retuneMuteMs}) {
+    std::vector<float> a = runWith(clean, muteMs), b = runWith(clicked, muteMs);
+    double station = 0, residue = 0;
+    for (size_t i = 0; i < std::min(a.size(), b.size()); i++) {
+      station += (double)a[i] * a[i];
+      residue += (double)(b[i] - a[i]) * (b[i] - a[i]);
+    }
+    if (residue == 0) std::printf("  mute %2d ms   no click energy reaches the output\n", muteMs);
+    else
+      std::printf("  mute %2d ms   click energy at the output %6.1f dB under the station\n", muteMs,
+                  -10.0 * std::log10(residue / station));
+  }
+}
+
+// Counts what it is given; with stallMs, stops for that long once a second
+class BenchSink : public AudioSink {
+public:
+  explicit BenchSink(int stallMs) : stallMs_(stallMs) {}
+  bool write(const int16_t* samples, size_t frames) override {
+    sum_ += samples[0] + samples[frames * 2 - 1];
+    if (stallMs_ > 0 && ++blocks_ % 100 == 0) std::this_thread::sleep_for(std::chrono::milliseconds(stallMs_));
+    return true;
+  }
+
+private:
+  int stallMs_;
+  uint64_t blocks_ = 0;
+  int64_t sum_ = 0;
+};
+
+void fanout(const std::vector<int16_t>& input, int seconds) {
+  const size_t BLOCK = (size_t)FxEngine::IO_RATE / 100;
+  AudioFanout fan;
+  fan.add("steady", std::make_unique<BenchSink>(0));
+  int devNull = ::open("/dev/null", O_WRONLY | O_CLOEXEC);
+  fan.add("file", std::make_unique<FdSink>(devNull));
+  fan.add("stalling", std::make_unique<BenchSink>(500));
+  BlockPool pool(fan.poolBlocksNeeded(), BLOCK);
+  fan.start();
+  size_t frames = std::min(input.size() / 2, (size_t)std::min(seconds, 5) * FxEngine::IO_RATE);
+  double publishUs = 0;
+  uint64_t blocks = 0, exhausted = 0;
+  auto next = std::chrono::steady_clock::now();
+  for (size_t at = 0; at + BLOCK <= frames; at += BLOCK) {
+    next += std::chrono::milliseconds(10);
+    std::this_thread::sleep_until(next);
+    int64_t t0 = hubNowUs();
+    AudioBlock* b = pool.acquire();
+    if (!b) {
+      exhausted++;
+      continue;
+    }
+    // Stands in for FxEngine::process() writing into the block
+    std::memcpy(b->samples, input.data() + at * 2, BLOCK * 4);
+    b->frames = BLOCK;
+    fan.publish(b);
+    publishUs += (double)(hubNowUs() - t0);
+    blocks++;
+  }
+  fan.stop();
+  ::close(devNull);
+  std::printf("fan-out: %llu blocks to 3 sinks, pool of %zu, %.1f us per block to fill and publish\n",
+              (unsigned long long)blocks, pool.blocks(), publishUs / (double)std::max<uint64_t>(1, blocks));
+  for (const AudioFanout::SinkStats& st : fan.stats())
+    std::printf("  %-9s %5llu written %5llu dropped\n", st.name.c_str(), (unsigned long long)st.written,
+                (unsigned long long)st.dropped);
+  if (exhausted) std::printf("  %llu blocks lost to a full pool\n", (unsigned long long)exhausted);
+}
+
+// From FX_PRESETS in oraclebox.py
+const char* const PRESET_LINES[] = {
+    R"({"name": "SB7_CLASSIC", "bp_low": 500, "bp_high": 2600, "reverb_room": 35, "reverb_damping": 40, )"
+    R"("reverb_wet": 100, "reverb_dry": 55, "contrast_amount": 20, "pre_gain_db": -6, "post_gain_db": 8})",
+    R"({"name": "SB7_CRYSTAL_CLEAR", "bp_low": 550, "bp_high": 2400, "reverb_room": 32, "reverb_damping": 42, )"
+    R"("reverb_wet": 95, "reverb_dry": 60, "contrast_amount": 17, "pre_gain_db": -7, "post_gain_db": 7})",
+    R"({"name": "SB7_DEEP_VOICE", "bp_low": 400, "bp_high": 2200, "reverb_room": 33, "reverb_damping": 38, )"
+    R"("reverb_wet": 98, "reverb_dry": 57, "contrast_amount": 19, "pre_gain_db": -6, "post_gain_db": 9})",
+};
+
+void presetSwitch(const std::vector<int16_t>& input, int seconds) {
+  FxEngine engine;
+  engine.configure(FxParams());
+  FxPresetCache cache(engine.internalRate());
+  std::vector<const CompiledFx*> presets;
+  int64_t t0 = hubNowUs();
+  for (const char* line : PRESET_LINES) presets.push_back(cache.defineJson(line));
+  double compileUs = (double)(hubNowUs() - t0) / (double)presets.size();
+  t0 = hubNowUs();
+  for (const CompiledFx* fx : presets) {
+    FxEngine fresh;
+    fresh.configure(fx->params);
+  }
+  double configureUs = (double)(hubNowUs() - t0) / (double)presets.size();
+  std::printf("preset switching @ %d (%zu presets, %d ms crossfade)\n", engine.internalRate(), cache.size(),
+              FxEngine::FADE_MS);
+  std::printf("  compile %6.0f us per preset, once; a fresh engine configured for one %6.0f us\n", compileUs,
+              configureUs);
+
+  std::atomic<bool> done{false};
+  double sumUs = 0;
+  int switches = 0;
+  std::thread selector([&] {
+    for (size_t k = 0; !done.load(); k++) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(250));
+      uint64_t before = engine.switchStats().switches;
+      engine.select(presets[k % presets.size()]);
+      while (!done.load() && engine.switchStats().switches == before)
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+      if (done.load()) break;
+      sumUs += engine.switchStats().lastUs;
+      switches++;
+    }
+  });
+  const size_t BLOCK = (size_t)FxEngine::IO_RATE / 100;
+  std::vector<int16_t> out(engine.maxOutput(BLOCK) * 2);
+  size_t frames = std::min(input.size() / 2, (size_t)std::min(seconds, 5) * FxEngine::IO_RATE);
+  auto next = std::chrono::steady_clock::now();
+  for (size_t at = 0; at + BLOCK <= frames; at += BLOCK) {
+    next += std::chrono::milliseconds(10);
+    std::this_thread::sleep_until(next);
+    engine.process(input.data() + at * 2, BLOCK, out.data());
+  }
+  done.store(true);
+  selector.join();
+  FxEngine::SwitchStats st = engine.switchStats();
+  std::printf("  %d switches while running: select to first block %6.0f us mean, %6.0f us max\n", switches,
+              switches ? sumUs / switches : 0.0, st.maxUs);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int seconds = 20;
+  size_t block = 480;
+  bool sox = false;
+  for (int i = 1; i < argc; i++) {
+    if (!std::strcmp(argv[i], "--seconds") && i + 1 < argc) seconds = std::max(2, std::atoi(argv[++i]));
+    else if (!std::strcmp(argv[i], "--block") && i + 1 < argc) block = (size_t)std::max(1, std::atoi(argv[++i]));
+    else if (!std::strcmp(argv[i], "--sox")) sox = true;
+  }
+
+  std::vector<int16_t> input = makeInput(seconds);
+  FxParams params;
+
+  FxEngine reference(FxEngine::IO_RATE, FxEngine::Mode::Stereo);
+  reference.configure(params);
+  Run ref = run(reference, input, block);
+  std::printf("%d s of audio in %zu-frame blocks\n", seconds, block);
+  std::printf("  stereo @ 48000   %7.0f us/s  %5.2f%% of a core  (band-pass %zu taps)\n", ref.usPerSecond,
+              ref.usPerSecond / 1e4, reference.bandpassTaps());
+
+  FxParams dry = params;
+  dry.reverbWet = 0;
+  dry.reverbDry = 100;
+  FxEngine dryReference(FxEngine::IO_RATE, FxEngine::Mode::Stereo);
+  dryReference.configure(dry);
+  std::vector<float> refBand = voiceBand(run(dryReference, input, block).mono);
+
+  for (int rate : {24000, 16000}) {
+    FxEngine engine(rate);
+    engine.configure(params);
+    Run r = run(engine, input, block);
+    std::printf("  mono   @ %5d   %7.0f us/s  %5.2f%% of a core  (band-pass %zu taps)  %.1fx less\n", rate,
+                r.usPerSecond, r.usPerSecond / 1e4, engine.bandpassTaps(), ref.usPerSecond / r.usPerSecond);
+
+    FxEngine dryEngine(rate);
+    dryEngine.configure(dry);
+    int lag = 0;
+    double db = matchDb(refBand, voiceBand(run(dryEngine, input, block).mono), 256, lag);
+    std::printf("                   without reverb, voice band matches the reference to %.1f dB, %d samples later\n",
+                db, lag);
+  }
+
+  std::printf("reverb alone (room %d, damping %d, wet %d, dry %d)\n", params.reverbRoom, params.reverbDamping,
+              params.reverbWet, params.reverbDry);
+  std::printf("  FDN stereo @ 48000   %7.0f us/s\n", reverbUsPerSecond(input, params, FxEngine::IO_RATE, 2));
+  std::printf("  FDN mono   @ 16000   %7.0f us/s\n", reverbUsPerSecond(input, params, 16000, 1));
+  if (sox) {
+    double us = soxReverbUsPerSecond(input, params);
+    if (us < 0) std::printf("  sox reverb           did not run\n");
+    else std::printf("  sox reverb @ 48000   %7.0f us/s (process CPU, including its raw I/O)\n", us);
+  }
+
+  for (int amount : {50, 100}) {
+    DenoiseResult d = denoise(seconds, amount);
+    if (amount == 50) std::printf("noise suppression @ 16000, %.1f ms delay\n", d.latencyMs);
+    std::printf("  amount %3d   static %6.1f dB   tone + residue vs tone %6.1f dB   %5.0f us/s\n", amount,
+                d.staticDb, d.toneDb, d.usPerSecond);
+  }
+
+  levels(seconds);
+  retunes(seconds);
+  fanout(input, seconds);
+  presetSwitch(input, seconds);
+  return 0;
+}
@@ -0,0 +1,193 @@
+// Stand-in hub for exercising satellites without the full Pi daemon.
+//
+// Accepts satellite connections on the hub port, logs every event, and runs
+// synchronized playback rounds: once enough music boxes are connected and
+// time-synced, it broadcasts "play melody X at hub time T" and collects each
+// box's melody_onset report to measure how tightly the boxes started.
+//
+//   hub_standin --boxes 3 --melody lullaby --lead-ms 500 --rounds 10
+
+#include <algorithm>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "oraclebox/hub_clock.h"
+#include "oraclebox/satellite_link.h"
+
+using namespace oraclebox;
+
+namespace {
+
+volatile sig_atomic_t stopRequested = 0;
+
+void onSignal(int) { stopRequested = 1; }
+
+struct Options {
+  int port = 8888;
+  int boxes = 2;
+  const char* melody = "twinkle_star";
+  int leadMs = 500;          // how far ahead of "now" T is set
+  int rounds = 5;
+  int intervalMs = 15000;    // between rounds (melodies must finish first)
+  int onsetTimeoutMs = 3000; // wait after T for onset reports
+  bool quiet = false;
+};
+
+void usage(const char* argv0) {
+  std::printf(
+      "Usage: %s [options]\n"
+      "  --port N          hub port (default 8888)\n"
+      "  --boxes N         music boxes to wait for (default 2)\n"
+      "  --melody NAME     melody to play (default twinkle_star)\n"
+      "  --lead-ms N       schedule T this far ahead (default 500)\n"
+      "  --rounds N        playback rounds (default 5, 0 = only log events)\n"
+      "  --interval-ms N   time between rounds (default 15000)\n"
+      "  --quiet           do not log individual events\n",
+      argv0);
+}
+
+bool parseArgs(int argc, char** argv, Options& opt) {
+  for (int i = 1; i < argc; i++) {
+    auto next = [&](void) -> const char* { return i + 1 < argc ? argv[++i] : nullptr; };
+    const char* a = argv[i];
+    const char* v = nullptr;
+    if (!std::strcmp(a, "--port") && (v = next())) opt.port = std::atoi(v);
+    else if (!std::strcmp(a, "--boxes") && (v = next())) opt.boxes = std::atoi(v);
+    else if (!std::strcmp(a, "--melody") && (v = next())) opt.melody = v;
+    else if (!std::strcmp(a, "--lead-ms") && (v = next())) opt.leadMs = std::atoi(v);
+    else if (!std::strcmp(a, "--rounds") && (v = next())) opt.rounds = std::atoi(v);
+    else if (!std::strcmp(a, "--interval-ms") && (v = next())) opt.intervalMs = std::atoi(v);
+    else if (!std::strcmp(a, "--quiet")) opt.quiet = true;
+    else {
+      usage(argv[0]);
+      return false;
+    }
+  }
+  return true;
+}
+
+struct BoxSync {
+  int64_t offsetUs = 0;
+  int64_t rttUs = 0;
+  bool synced = false;
+};
+
+struct Round {
+  int64_t atUs = 0;
+  std::map<std::string, int64_t> onsets;  // device id -> onset (hub time)
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options opt;
+  if (!parseArgs(argc, argv, opt)) return 2;
+
+  std::signal(SIGINT, onSignal);
+  std::signal(SIGTERM, onSignal);
+
+  SatelliteLink link;
+  if (!link.listen((uint16_t)opt.port)) return 1;
+  std::printf("[HUB] Stand-in hub listening on port %d, waiting for %d music box(es)\n", opt.port, opt.boxes);
+
+  std::map<std::string, BoxSync> boxes;
+  Round current;
+  bool roundOpen = false;
+  std::vector<double> spreadsMs;
+  std::vector<double> errorsMs;
+  int roundsDone = 0;
+  int64_t nextRoundUs = 0;
+
+  link.onLine([&](SatelliteConn& conn, const JsonLine& msg, int64_t rxUs) {
+    std::string_view event = msg.str("event");
+    if (!opt.quiet) {
+      std::printf("[EVENT] %-12s %-10s %-14.*s (%s)\n", conn.deviceId.c_str(), conn.location.c_str(),
+                  (int)event.size(), event.data(), conn.peer.c_str());
+    }
+
+    if (event == "time_synced") {
+      BoxSync& b = boxes[conn.deviceId];
+      b.offsetUs = msg.i64("offset_us");
+      b.rttUs = msg.i64("rtt_us");
+      b.synced = true;
+      std::printf("[SYNC] %s offset %+.3f ms, best RTT %.3f ms\n", conn.deviceId.c_str(), b.offsetUs / 1000.0,
+                  b.rttUs / 1000.0);
+    } else if (event == "melody_onset" && roundOpen) {
+      int64_t onset = msg.i64("onset_hub_us");
+      current.onsets[conn.deviceId] = onset;
+      std::printf("[ONSET] %s started %+.3f ms from T (reported late %.3f ms)\n", conn.deviceId.c_str(),
+                  (onset - current.atUs) / 1000.0, msg.i64("late_us") / 1000.0);
+    }
+    (void)rxUs;
+  });
+
+  link.onDisconnect([&](SatelliteConn& conn) {
+    if (!conn.deviceId.empty() && conn.deviceType == "musicbox") {
+      boxes.erase(conn.deviceId);
+      std::printf("[HUB] %s disconnected\n", conn.deviceId.c_str());
+    }
+  });
+
+  auto closeRound = [&]() {
+    roundOpen = false;
+    roundsDone++;
+    if (current.onsets.empty()) {
+      std::printf("[ROUND %d] no onset reports\n", roundsDone);
+      return;
+    }
+    int64_t lo = INT64_MAX, hi = INT64_MIN;
+    for (auto& kv : current.onsets) {
+      lo = std::min(lo, kv.second);
+      hi = std::max(hi, kv.second);
+      errorsMs.push_back(std::fabs((kv.second - current.atUs) / 1000.0));
+    }
+    double spread = (hi - lo) / 1000.0;
+    if (current.onsets.size() > 1) spreadsMs.push_back(spread);
+    std::printf("[ROUND %d] %zu box(es) reported, onset spread %.3f ms\n", roundsDone, current.onsets.size(), spread);
+  };
+
+  while (!stopRequested) {
+    if (link.poll(20) < 0) break;
+    int64_t now = hubNowUs();
+
+    if (roundOpen && now > current.atUs + (int64_t)opt.onsetTimeoutMs * 1000) closeRound();
+    if (roundOpen || opt.rounds <= 0) continue;
+    if (roundsDone >= opt.rounds) break;
+
+    int synced = 0;
+    for (auto& kv : boxes) synced += kv.second.synced ? 1 : 0;
+    if (synced < opt.boxes || now < nextRoundUs) continue;
+
+    // Pre-load lead time covers the command's network trip plus melody setup
+    current = Round();
+    current.atUs = now + (int64_t)opt.leadMs * 1000;
+    JsonWriter cmd;
+    cmd.add("cmd", "play_at").add("melody", opt.melody).add("at", current.atUs);
+    int sent = link.broadcast("musicbox", cmd.line());
+    roundOpen = true;
+    nextRoundUs = current.atUs + (int64_t)opt.intervalMs * 1000;
+    std::printf("[ROUND %d] play_at %s sent to %d box(es), T = now + %d ms\n", roundsDone + 1, opt.melody, sent,
+                opt.leadMs);
+  }
+
+  if (!spreadsMs.empty() || !errorsMs.empty()) {
+    std::sort(spreadsMs.begin(), spreadsMs.end());
+    double sum = 0;
+    for (double s : spreadsMs) sum += s;
+    double maxErr = errorsMs.empty() ? 0.0 : *std::max_element(errorsMs.begin(), errorsMs.end());
+    std::printf("\n=== SYNC PLAYBACK SUMMARY ===\n");
+    std::printf("Rounds:            %d\n", roundsDone);
+    if (!spreadsMs.empty()) {
+      std::printf("Onset spread:      min %.3f / avg %.3f / max %.3f ms\n", spreadsMs.front(), sum / spreadsMs.size(),
+                  spreadsMs.back());
+    }
+    std::printf("Max error vs T:    %.3f ms\n", maxErr);
+  }
+  return 0;
+}
@@ -0,0 +1,331 @@
+// Ghost-box FX filter: the effects chain of build_sox_cmd_from_fx() on the
+// native engine (fx_engine.h). Raw S16 stereo at 48 kHz in on stdin, the
+// same out on stdout, so it takes sox's place in the pipeline:
+//
+//   arecord -D plughw:3,0 -f S16_LE -r 48000 -c 2 -t raw |
+//     oraclebox_fx --bp-low 500 --bp-high 2600 --reverb 30 ... |
+//     aplay -D plughw:0,0 -f S16_LE -r 48000 -c 2 -t raw
+//
+// Options carry the FxConfig fields, named after the FX SET keys:
+//   --bp-low HZ --bp-high HZ --reverb N --reverb-damp N --reverb-wet N
+//   --reverb-dry N --contrast N --pre-gain DB --post-gain DB
+//   --noise-reduce N       static suppression, 0 (off) to 100; adds up to 16 ms
+//   --agc-target DB        RMS level the AGC holds (default -18)
+//   --lookahead MS         limiter look-ahead, 1-20 (default 5); adds as much
+//   --internal-rate HZ     rate the mono chain runs at (default 16000)
+//   --stereo-internal      both channels at 48 kHz, as sox ran it
+//   --control PATH         FIFO (created if missing) of "PARAM value" lines:
+//                          PRE_GAIN, POST_GAIN and AGC_TARGET apply at once,
+//                          without restarting the pipeline; "PRESET NAME"
+//                          crossfades to a preset from --presets in 5 ms, and
+//                          "DEFINE {json}" adds or replaces one
+//   --presets FILE         FX_PRESETS as JSON lines ({"name": ..., "bp_low": ...}),
+//                          compiled for the internal rate at startup
+//   --retune-mute MS       input muted for MS after each retune (default 8, 0 off)
+//   --segments FILE        frequency-tagged segments as JSON lines, one per
+//                          retune; at 1 MB the file moves to FILE.1
+//   --sink-pcm DEVICE      also play on an ALSA device (repeatable)
+//   --sink-cmd "CMD"       also pipe the output into CMD, e.g. aplay on a
+//                          Bluetooth or Pulse device (repeatable)
+//   --record FILE.wav      also record the output
+//   --no-stdout            only the sinks above
+//
+// Each processed block is written once, into a block of a shared pool, and
+// published by reference to every sink (AudioFanout). Each sink has its own
+// thread and a bounded queue, so a slow one drops blocks of its own and
+// holds up nothing else. SIGUSR1 prints per-sink written/dropped counts,
+// which are also printed at exit. The process ends when stdout's reader
+// goes away, as it did when stdout was the only output.
+//
+// "RETUNE <mhz> <hub us>" on the control FIFO (the sweep's announcement of
+// its next step, or a manual tune) places a retune on the input frame
+// captured at that CLOCK_MONOTONIC time. The frame comes from the arrival
+// times of the reads (StreamClock).
+//
+// Processing is in 10 ms blocks, so the filter adds that much plus the
+// filters' own delay.
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "oraclebox/audio_fanout.h"
+#include "oraclebox/fx_engine.h"
+#include "oraclebox/hub_clock.h"
+
+using namespace oraclebox;
+
+namespace {
+
+volatile sig_atomic_t statsRequested = 0;
+
+void onSignal(int) { statsRequested = 1; }
+
+void printSinkStats(const AudioFanout& fanout, uint64_t poolExhausted) {
+  for (const AudioFanout::SinkStats& st : fanout.stats())
+    std::fprintf(stderr, "[FX] sink %-12s %10llu written %8llu dropped %3zu queued%s\n", st.name.c_str(),
+                 (unsigned long long)st.written, (unsigned long long)st.dropped, st.queued,
+                 st.failed ? "  (failed)" : "");
+  if (poolExhausted) std::fprintf(stderr, "[FX] %llu blocks lost to a full pool\n", (unsigned long long)poolExhausted);
+}
+
+// Retunes from the control thread, for the audio loop to place
+struct RetuneInbox {
+  struct Retune {
+    double mhz;
+    int64_t atUs;
+  };
+  std::mutex mutex;
+  std::vector<Retune> retunes;
+};
+
+// Closed segments: the audio between one retune and the next, tagged with
+// the frequency it was tuned to. Times are hub (monotonic) and wall clock,
+// so the lines line up with stored events.
+class SegmentLog {
+public:
+  static constexpr long MAX_BYTES = 1 << 20;
+
+  explicit SegmentLog(std::string path) : path_(std::move(path)) {}
+  ~SegmentLog() {
+    if (f_) std::fclose(f_);
+  }
+
+  void write(double mhz, int64_t startFrame, int64_t endFrame, int64_t startUs, int64_t endUs) {
+    if (!f_ && !(f_ = std::fopen(path_.c_str(), "a"))) return;
+    int64_t wallOffset = hubWallUs() - hubNowUs();
+    std::fprintf(f_,
+                 "{\"mhz\": %.1f, \"start_frame\": %lld, \"frames\": %lld, \"start_us\": %lld, "
+                 "\"end_us\": %lld, \"start_wall_us\": %lld}\n",
+                 mhz, (long long)startFrame, (long long)(endFrame - startFrame), (long long)startUs,
+                 (long long)endUs, (long long)(startUs + wallOffset));
+    std::fflush(f_);
+    if (std::ftell(f_) > MAX_BYTES) {
+      std::fclose(f_);
+      f_ = nullptr;
+      std::rename(path_.c_str(), (path_ + ".1").c_str());
+    }
+  }
+
+private:
+  std::string path_;
+  FILE* f_ = nullptr;
+};
+
+// Applies control lines to the engine for as long as the process runs.
+// The FIFO is held open for writing too, so writers coming and going never
+// end the read with EOF.
+void runControl(FxEngine& engine, FxPresetCache& presets, RetuneInbox& inbox, const std::string& path) {
+  if (mkfifo(path.c_str(), 0600) < 0 && errno != EEXIST) {
+    std::fprintf(stderr, "[FX] control %s: %s\n", path.c_str(), std::strerror(errno));
+    return;
+  }
+  int fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+  if (fd < 0) {
+    std::fprintf(stderr, "[FX] control %s: %s\n", path.c_str(), std::strerror(errno));
+    return;
+  }
+  std::string pending;
+  char buf[256];
+  for (;;) {
+    ssize_t r = ::read(fd, buf, sizeof(buf));
+    if (r < 0 && errno == EINTR) continue;
+    if (r <= 0) break;
+    pending.append(buf, (size_t)r);
+    size_t nl;
+    while ((nl = pending.find('\n')) != std::string::npos) {
+      std::string line = pending.substr(0, nl);
+      pending.erase(0, nl + 1);
+      if (line.compare(0, 7, "PRESET ") == 0) {
+        std::string name = line.substr(7);
+        const CompiledFx* fx = presets.find(name);
+        if (!fx) std::fprintf(stderr, "[FX] control: no preset %s\n", name.c_str());
+        else if (engine.select(fx)) std::fprintf(stderr, "[FX] preset %s\n", name.c_str());
+        continue;
+      }
+      double mhz;
+      long long atUs;
+      if (std::sscanf(line.c_str(), "RETUNE %lf %lld", &mhz, &atUs) == 2) {
+        std::lock_guard<std::mutex> lock(inbox.mutex);
+        inbox.retunes.push_back({mhz, (int64_t)atUs});
+        continue;
+      }
+      if (line.compare(0, 7, "DEFINE ") == 0) {
+        if (!presets.defineJson(std::string_view(line).substr(7)))
+          std::fprintf(stderr, "[FX] control: bad preset %s\n", line.c_str() + 7);
+        continue;
+      }
+      char param[32];
+      float value;
+      if (std::sscanf(line.c_str(), "%31s %f", param, &value) != 2) continue;
+      if (!std::strcmp(param, "PRE_GAIN")) engine.setPreGainDb(value);
+      else if (!std::strcmp(param, "POST_GAIN")) engine.setPostGainDb(value);
+      else if (!std::strcmp(param, "AGC_TARGET")) engine.setAgcTargetDb(value);
+      else std::fprintf(stderr, "[FX] control: unknown %s\n", param);
+    }
+  }
+  ::close(fd);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  FxParams p;
+  int internalRate = FxEngine::DEFAULT_INTERNAL_RATE;
+  bool stereo = false;
+  std::string control, presetFile, segmentFile, recordFile;
+  std::vector<std::string> pcmSinks, cmdSinks;
+  bool toStdout = true;
+  for (int i = 1; i < argc; i++) {
+    if (!std::strcmp(argv[i], "--bp-low") && i + 1 < argc) p.bpLow = std::atoi(argv[++i]);
+    else if (!std::strcmp(argv[i], "--bp-high") && i + 1 < argc) p.bpHigh = std::atoi(argv[++i]);
+    else if (!std::strcmp(argv[i], "--reverb") && i + 1 < argc) p.reverbRoom = std::atoi(argv[++i]);
+    else if (!std::strcmp(argv[i], "--reverb-damp") && i + 1 < argc) p.reverbDamping = std::atoi(argv[++i]);
+    else if (!std::strcmp(argv[i], "--reverb-wet") && i + 1 < argc) p.reverbWet = std::atoi(argv[++i]);
+    else if (!std::strcmp(argv[i], "--reverb-dry") && i + 1 < argc) p.reverbDry = std::atoi(argv[++i]);
+    else if (!std::strcmp(argv[i], "--contrast") && i + 1 < argc) p.contrastAmount = std::atoi(argv[++i]);
+    else if (!std::strcmp(argv[i], "--pre-gain") && i + 1 < argc) p.preGainDb = std::atoi(argv[++i]);
+    else if (!std::strcmp(argv[i], "--post-gain") && i + 1 < argc) p.postGainDb = std::atoi(argv[++i]);
+    else if (!std::strcmp(argv[i], "--noise-reduce") && i + 1 < argc) p.noiseReduce = std::atoi(argv[++i]);
+    else if (!std::strcmp(argv[i], "--agc-target") && i + 1 < argc) p.agcTargetDb = std::atoi(argv[++i]);
+    else if (!std::strcmp(argv[i], "--lookahead") && i + 1 < argc) p.lookaheadMs = std::atoi(argv[++i]);
+    else if (!std::strcmp(argv[i], "--control") && i + 1 < argc) control = argv[++i];
+    else if (!std::strcmp(argv[i], "--presets") && i + 1 < argc) presetFile = argv[++i];
+    else if (!std::strcmp(argv[i], "--retune-mute") && i + 1 < argc) p.retuneMuteMs = std::atoi(argv[++i]);
+    else if (!std::strcmp(argv[i], "--segments") && i + 1 < argc) segmentFile = argv[++i];
+    else if (!std::strcmp(argv[i], "--sink-pcm") && i + 1 < argc) pcmSinks.push_back(argv[++i]);
+    else if (!std::strcmp(argv[i], "--sink-cmd") && i + 1 < argc) cmdSinks.push_back(argv[++i]);
+    else if (!std::strcmp(argv[i], "--record") && i + 1 < argc) recordFile = argv[++i];
+    else if (!std::strcmp(argv[i], "--no-stdout")) toStdout = false;
+    else if (!std::strcmp(argv[i], "--internal-rate") && i + 1 < argc) internalRate = std::atoi(argv[++i]);
+    else if (!std::strcmp(argv[i], "--stereo-internal")) stereo = true;
+  }
+  if (internalRate < 8000 || internalRate > FxEngine::IO_RATE) {
+    std::fprintf(stderr, "[FX] internal rate %d out of range\n", internalRate);
+    return 2;
+  }
+
+  FxEngine engine(internalRate, stereo ? FxEngine::Mode::Stereo : FxEngine::Mode::Mono);
+  engine.configure(p);
+  std::fprintf(stderr, "[FX] %s at %d Hz, band-pass %d-%d Hz (%zu taps)\n", stereo ? "stereo" : "mono",
+               engine.internalRate(), p.bpLow, p.bpHigh, engine.bandpassTaps());
+  // Lives as long as main, so past the control thread's last use
+  FxPresetCache presets(engine.internalRate());
+  if (!presetFile.empty()) {
+    int64_t t0 = hubNowUs();
+    int n = presets.load(presetFile);
+    std::fprintf(stderr, "[FX] %d presets compiled in %.1f ms\n", n, (double)(hubNowUs() - t0) / 1000.0);
+  }
+  // Blocked in read() for the life of the process; exit ends it
+  RetuneInbox inbox;
+  if (!control.empty())
+    std::thread(runControl, std::ref(engine), std::ref(presets), std::ref(inbox), control).detach();
+  std::unique_ptr<SegmentLog> segments;
+  if (!segmentFile.empty()) segments = std::make_unique<SegmentLog>(segmentFile);
+
+  const size_t BLOCK = (size_t)FxEngine::IO_RATE / 100;
+  std::vector<int16_t> in(BLOCK * 2);
+
+  AudioFanout fanout;
+  size_t stdoutSink = SIZE_MAX;
+  if (toStdout) stdoutSink = fanout.add("stdout", std::make_unique<FdSink>(STDOUT_FILENO));
+  for (const std::string& device : pcmSinks) {
+    auto sink = std::make_unique<PcmSink>();
+    if (sink->open(device, FxEngine::IO_RATE)) fanout.add(device, std::move(sink));
+  }
+  for (const std::string& command : cmdSinks) {
+    auto sink = std::make_unique<PipeSink>(command);
+    if (sink->isOpen()) fanout.add(command.substr(0, command.find(' ')), std::move(sink));
+  }
+  if (!recordFile.empty()) {
+    auto sink = std::make_unique<WavRecorder>();
+    if (sink->open(recordFile, FxEngine::IO_RATE)) fanout.add(recordFile, std::move(sink));
+  }
+  BlockPool pool(fanout.poolBlocksNeeded(), engine.maxOutput(BLOCK));
+  std::vector<int16_t> spare(pool.maxFrames() * 2);   // a block's worth when the pool is empty
+  uint64_t poolExhausted = 0;
+  // A sink whose reader exits must not take the process with it
+  std::signal(SIGPIPE, SIG_IGN);
+  std::signal(SIGUSR1, onSignal);
+  fanout.start();
+  size_t have = 0;   // bytes in `in`, which may end mid-frame
+  uint64_t bytesIn = 0;
+  StreamClock clock(FxEngine::IO_RATE);
+  std::vector<RetuneInbox::Retune> arrived;
+  struct Placed {
+    double mhz;
+    int64_t frame;
+  };
+  std::deque<Placed> placed;   // retunes whose frame is still ahead
+  Placed current = {0.0, -1};  // the segment playing
+  uint64_t late = 0;
+  for (;;) {
+    ssize_t r = ::read(STDIN_FILENO, reinterpret_cast<char*>(in.data()) + have, BLOCK * 4 - have);
+    if (r < 0 && errno == EINTR) continue;
+    if (r <= 0) break;
+    have += (size_t)r;
+    bytesIn += (uint64_t)r;
+    clock.onRead(hubNowUs(), bytesIn / 4);
+    size_t frames = have / 4;
+    if (frames == 0) continue;
+
+    {
+      std::lock_guard<std::mutex> lock(inbox.mutex);
+      arrived.swap(inbox.retunes);
+    }
+    for (const RetuneInbox::Retune& rt : arrived) {
+      int64_t frame = clock.frameAt(rt.atUs);
+      if (!engine.retuneAt(frame)) {
+        late++;
+        // Logged at 1, 2, 4, 8... of them
+        if ((late & (late - 1)) == 0)
+          std::fprintf(stderr, "[FX] %llu retunes announced after their audio (last %.1f ms late)\n",
+                       (unsigned long long)late, (double)(engine.framesIn() - frame) * 1000.0 / FxEngine::IO_RATE);
+      }
+      placed.push_back({rt.mhz, frame});
+    }
+    arrived.clear();
+
+    // Processed straight into the pool block the sinks will read
+    AudioBlock* block = pool.acquire();
+    if (!block) poolExhausted++;
+    size_t produced = engine.process(in.data(), frames, block ? block->samples : spare.data());
+    if (block) {
+      block->frames = produced;
+      fanout.publish(block);
+    }
+    if (stdoutSink != SIZE_MAX && fanout.failed(stdoutSink)) break;
+    if (statsRequested) {
+      statsRequested = 0;
+      printSinkStats(fanout, poolExhausted);
+    }
+    while (!placed.empty() && placed.front().frame < engine.framesIn()) {
+      const Placed& next = placed.front();
+      if (segments && current.frame >= 0)
+        segments->write(current.mhz, current.frame, next.frame, clock.timeOf(current.frame), clock.timeOf(next.frame));
+      current = next;
+      placed.pop_front();
+    }
+    size_t rest = have - frames * 4;
+    std::memmove(in.data(), reinterpret_cast<char*>(in.data()) + frames * 4, rest);
+    have = rest;
+  }
+  fanout.stop();
+  printSinkStats(fanout, poolExhausted);
+  return 0;
+}
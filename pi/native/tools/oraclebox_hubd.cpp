@@ -0,0 +1,491 @@
+// Native satellite hub daemon.
+//
+// Terminates the satellite connections on port 8888 and routes reflexes:
+// declarative rules turn an event from one satellite straight into a command
+// for another (REM pod in the hallway -> music box in the bedroom) without
+// going through the Python daemon.
+//
+//   oraclebox_hubd --rules /home/dylan/oraclebox/reflex_rules.jsonl
+//                  [--store /home/dylan/oraclebox/events]
+//                  [--device-rules /home/dylan/oraclebox/device_rules]
+//                  [--correlations /home/dylan/oraclebox/correlations.jsonl]
+//                  [--pods /home/dylan/oraclebox/pods.jsonl --estimate-out /run/oraclebox/source.json]
+//                  [--bus] [--shards 4] [--rate-limit 200 --rate-burst 100]
+//
+// With --store, every satellite event is appended to the event store in DIR
+// (see event_store.h).
+//
+// With --device-rules, <dir>/<device id>.json (a JSON array of local rules)
+// is pushed to a satellite as set_rules whenever it says hello, so the
+// on-device rule tables follow the files on the hub.
+//
+// With --correlations, events from different satellites are joined into
+// incidents ("motion at the music box, then an EM spike within 3 s", see
+// correlator.h). Incidents are logged and, with --store, stored as
+// "incident:<pattern>" events of the satellite that completed them.
+//
+// With --pods, REM pod triggers feed a live estimate of where the disturbance
+// is (see source_locator.h). It is logged as it changes, at most 4 times a
+// second, and written to the --estimate-out JSON file for the web UI.
+//
+// With --bus, satellite events and incidents are also published to the
+// shared-memory event bus (/dev/shm/oraclebox_events, see event_bus.h) for
+// oraclebox.py and other local readers.
+//
+// --shards N spreads satellite connections over N link threads sharing the
+// port (see link_shards.h). Each shard parses, schema-checks and logs its own
+// lines; only the shared stages (reflex router, event store, correlator,
+// locator) take a lock, each its own and only for that stage. The store lock
+// only claims slots; records are copied in outside it, and the bus takes no
+// lock at all. --rate-limit caps each satellite, by device id, at N lines/s
+// (bursts of up to --rate-burst lines), so one chatty or misbehaving
+// satellite cannot crowd out the others. The default, 200 lines/s, is far
+// above what a healthy satellite sends; --rate-limit 0 turns it off.
+//
+// SIGUSR1 prints reflex latency statistics; they are also printed on exit.
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "oraclebox/correlator.h"
+#include "oraclebox/event_bus.h"
+#include "oraclebox/event_schema.h"
+#include "oraclebox/event_store.h"
+#include "oraclebox/hub_clock.h"
+#include "oraclebox/link_shards.h"
+#include "oraclebox/reflex_router.h"
+#include "oraclebox/source_locator.h"
+
+using namespace oraclebox;
+
+namespace {
+
+volatile sig_atomic_t stopRequested = 0;
+volatile sig_atomic_t statsRequested = 0;
+
+void onSignal(int sig) {
+  if (sig == SIGUSR1) statsRequested = 1;
+  else stopRequested = 1;
+}
+
+struct Options {
+  int port = 8888;
+  std::string rulesPath;
+  std::string deviceRulesDir;
+  std::string storeDir;
+  std::string correlationsPath;
+  std::string podsPath;
+  std::string estimatePath;
+  bool bus = false;
+  int shards = 1;
+  double rateLimit = 200.0;   // lines/s per satellite, 0 = unlimited
+  double rateBurst = 100.0;
+  bool quiet = false;
+};
+
+void usage(const char* argv0) {
+  std::printf(
+      "Usage: %s [options]\n"
+      "  --port N            hub port (default 8888)\n"
+      "  --rules PATH        reflex rules file (JSON lines)\n"
+      "  --store DIR         append satellite events to the event store in DIR\n"
+      "  --device-rules DIR  push DIR/<id>.json to each satellite on hello\n"
+      "  --correlations PATH multi-satellite incident patterns (JSON lines)\n"
+      "  --pods PATH         REM pod positions for source localization (JSON lines)\n"
+      "  --estimate-out PATH write the live source estimate to PATH (JSON)\n"
+      "  --bus               publish events to the shared-memory event bus\n"
+      "  --shards N          link threads sharing the port (default 1)\n"
+      "  --rate-limit N      lines/s per satellite, 0 = unlimited (default 200)\n"
+      "  --rate-burst N      lines a satellite may send at once, with --rate-limit\n"
+      "                      (default 100)\n"
+      "  --quiet             do not log individual events\n",
+      argv0);
+}
+
+bool parseArgs(int argc, char** argv, Options& opt) {
+  for (int i = 1; i < argc; i++) {
+    const char* a = argv[i];
+    const char* v = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (!std::strcmp(a, "--port") && v) opt.port = std::atoi(argv[++i]);
+    else if (!std::strcmp(a, "--rules") && v) opt.rulesPath = argv[++i];
+    else if (!std::strcmp(a, "--device-rules") && v) opt.deviceRulesDir = argv[++i];
+    else if (!std::strcmp(a, "--store") && v) opt.storeDir = argv[++i];
+    else if (!std::strcmp(a, "--correlations") && v) opt.correlationsPath = argv[++i];
+    else if (!std::strcmp(a, "--pods") && v) opt.podsPath = argv[++i];
+    else if (!std::strcmp(a, "--estimate-out") && v) opt.estimatePath = argv[++i];
+    else if (!std::strcmp(a, "--bus")) opt.bus = true;
+    else if (!std::strcmp(a, "--shards") && v) opt.shards = std::atoi(argv[++i]);
+    else if (!std::strcmp(a, "--rate-limit") && v) opt.rateLimit = std::atof(argv[++i]);
+    else if (!std::strcmp(a, "--rate-burst") && v) opt.rateBurst = std::atof(argv[++i]);
+    else if (!std::strcmp(a, "--quiet")) opt.quiet = true;
+    else {
+      usage(argv[0]);
+      return false;
+    }
+  }
+  return true;
+}
+
+// Sends the device's local rule table, if one exists on the hub
+void pushDeviceRules(CommandSink& link, const std::string& dir, const SatelliteConn& conn) {
+  std::ifstream in(dir + "/" + conn.deviceId + ".json");
+  if (!in) return;
+  std::stringstream body;
+  body << in.rdbuf();
+  // One protocol line, compacted so a full table fits the satellite's cap
+  std::string rules = compactJson(body.str());
+  if (rules.find('[') == std::string::npos) {
+    std::fprintf(stderr, "[HUB] %s/%s.json is not a JSON array\n", dir.c_str(), conn.deviceId.c_str());
+    return;
+  }
+  std::string line = "{\"cmd\":\"set_rules\",\"rules\":" + rules + "}";
+  if (line.size() > SATELLITE_LINE_MAX) {
+    std::fprintf(stderr, "[HUB] %s/%s.json: %zu bytes, over the satellite's %zu; it will answer rules_rejected\n",
+                 dir.c_str(), conn.deviceId.c_str(), line.size(), SATELLITE_LINE_MAX);
+  }
+  link.sendTo(conn.deviceId, line + "\n");
+  std::printf("[HUB] Pushed local rules to %s\n", conn.deviceId.c_str());
+}
+
+// Link housekeeping, not sensor events
+bool isProtocolEvent(std::string_view event) {
+  return event == "hello" || event == "time_synced" || event == "reflex_ack" || event == "rules_loaded" ||
+         event == "rules_rejected";
+}
+
+// Devices already warned about, shared by the shards
+struct SchemaWarnings {
+  std::mutex mutex;
+  std::unordered_set<std::string> devices;
+};
+
+// Sensor events follow schema/satellite_events.jsonl; says once per device
+// when one does not, so a renamed key is not silently dropped
+void checkSchema(SchemaWarnings& warned, const SatelliteConn& conn, const SatelliteEvent& ev) {
+  if (ev.unknownKeys == 0 && ev.invalid == 0) return;
+  if (ev.event == "melody_onset") return;   // playback sync report, not sendEventToHub()
+  {
+    std::lock_guard<std::mutex> lock(warned.mutex);
+    if (!warned.devices.insert(conn.deviceId).second) return;
+  }
+  std::string problems;
+  if (ev.unknownKeys > 0) {
+    problems = std::to_string(ev.unknownKeys) + " unknown key(s) such as \"" + std::string(ev.firstUnknownKey) + "\"";
+  }
+  for (unsigned f = 0; f < (unsigned)EventField::Count; f++) {
+    if (!(ev.invalid & (1u << f))) continue;
+    problems += problems.empty() ? "invalid " : ", invalid ";
+    problems += eventFieldKey((EventField)f);
+  }
+  std::fprintf(stderr, "[SCHEMA] %s %.*s does not match the schema: %s\n", conn.deviceId.c_str(),
+               (int)ev.event.size(), ev.event.data(), problems.c_str());
+}
+
+// A shard's events on their way to the store and the bus. Records are built
+// on the shard thread, outside any lock, and handed over once per poll()
+// batch: the store lock is held only to claim the batch's slots, and the
+// records are copied in after it is released; the bus needs no lock. Store
+// indexes are cached here; the store is only asked (under its lock) the first
+// time a shard sees a device or an event type.
+struct ShardBatch {
+  std::unordered_map<std::string, int> devices;   // device id -> store index
+  std::unordered_map<std::string, int> types;     // event -> store type index
+  std::vector<EventRecord> records;
+  std::vector<BusRecord> published;
+};
+
+thread_local ShardBatch shardBatch;
+
+void stageStoreEvent(ShardBatch& batch, EventStore& store, std::mutex& storeMutex, const SatelliteConn& conn,
+                     const SatelliteEvent& ev) {
+  auto device = batch.devices.find(conn.deviceId);
+  auto type = batch.types.find(std::string(ev.event));
+  if (device == batch.devices.end() || type == batch.types.end()) {
+    std::lock_guard<std::mutex> lock(storeMutex);
+    int d = store.deviceIndex(conn.deviceId, conn.deviceType, conn.location);
+    int t = store.typeIndex(ev.event);
+    if (d < 0 || t < 0) return;   // not cached, so the next line asks again
+    device = batch.devices.emplace(conn.deviceId, d).first;
+    type = batch.types.emplace(std::string(ev.event), t).first;
+  }
+
+  EventRecord rec{};
+  rec.timeUs = hubWallUs();
+  rec.device = (uint16_t)device->second;
+  rec.type = (uint8_t)type->second;
+  rec.battery = (uint8_t)ev.battery;
+  rec.strength = ev.strength;
+  // 0 F and 0 hPa are readings; a missing field is stored as NaN
+  rec.temperature = ev.has(EventField::Temperature) ? ev.temperature : NAN;
+  rec.pressure = ev.has(EventField::Pressure) ? ev.pressure : NAN;
+  rec.value = ev.duration;
+  batch.records.push_back(rec);
+}
+
+void stageBusEvent(ShardBatch& batch, const SatelliteConn& conn, const SatelliteEvent& ev) {
+  BusRecord rec{};
+  rec.timeUs = hubWallUs();
+  setBusField(rec.device, conn.deviceId);
+  setBusField(rec.location, conn.location);
+  setBusField(rec.event, ev.event);
+  rec.strength = ev.strength;
+  rec.temperature = ev.temperature;
+  rec.pressure = ev.pressure;
+  rec.value = ev.has(EventField::Duration) ? ev.duration : ev.battery;
+  batch.published.push_back(rec);
+}
+
+// Records an incident against the satellite whose event completed it
+void storeIncident(EventStore& store, const Correlator& correlator, const Incident& incident) {
+  int device = store.findDevice(correlator.deviceId(incident.thenDevice));
+  int type = store.typeIndex("incident:" + correlator.pattern(incident.pattern).name);
+  if (device < 0 || type < 0) return;
+
+  EventRecord rec{};
+  rec.timeUs = hubWallUs();
+  rec.device = (uint16_t)device;
+  rec.type = (uint8_t)type;
+  rec.strength = (int32_t)incident.thenValue;
+  rec.temperature = NAN;
+  rec.pressure = NAN;
+  rec.value = (int32_t)((incident.thenUs - incident.firstUs) / 1000);   // gap in ms
+  store.append(rec);
+}
+
+// Logs the source estimate and replaces the estimate file atomically
+void publishEstimate(const SourceEstimate& e, const std::string& path, bool quiet) {
+  if (!quiet) {
+    std::printf("[LOCATE] x %.2f y %.2f m, error %.2f m, confidence %.2f (%d pod%s)\n", e.x, e.y, e.errorM,
+                e.confidence, e.pods, e.pods == 1 ? "" : "s");
+  }
+  if (path.empty()) return;
+  std::string body = JsonWriter()
+                         .add("x", e.x)
+                         .add("y", e.y)
+                         .add("error_m", e.errorM)
+                         .add("confidence", e.confidence)
+                         .add("pods", e.pods)
+                         .add("updated_us", hubWallUs())
+                         .line();
+  std::string tmp = path + ".tmp";
+  FILE* f = std::fopen(tmp.c_str(), "w");
+  if (!f) {
+    std::fprintf(stderr, "[LOCATE] Cannot write %s\n", tmp.c_str());
+    return;
+  }
+  std::fwrite(body.data(), 1, body.size(), f);
+  std::fclose(f);
+  std::rename(tmp.c_str(), path.c_str());
+}
+
+void printStats(const ReflexRouter& router, const Correlator& correlator, const LinkShards& link, int64_t startUs) {
+  const ReflexStats& s = router.stats();
+  double elapsed = (hubNowUs() - startUs) / 1e6;
+  std::printf("[STATS] ingest %llu lines (%.0f/s) on %d shard(s), %zu connection(s), throttled %llu time(s)\n",
+              (unsigned long long)link.linesDispatched(), elapsed > 0 ? link.linesDispatched() / elapsed : 0.0,
+              link.shardCount(), link.connectionCount(), (unsigned long long)link.throttleCount());
+  std::printf("[STATS] events %lld, reflexes fired %lld, suppressed by cooldown %lld\n",
+              (long long)router.evaluated(), (long long)router.fired(), (long long)router.suppressed());
+  if (s.count() == 0) {
+    std::printf("[STATS] no reflex acks yet\n");
+  } else {
+    std::printf("[STATS] reflex latency (%lld acks): mean %.2f / p50 %.1f / p99 %.1f / max %.2f ms\n",
+                (long long)s.count(), s.meanMs(), s.percentileMs(50), s.percentileMs(99), s.maxMs());
+  }
+  if (correlator.patternCount() > 0) {
+    std::printf("[STATS] correlated events %lld, incidents %lld, suppressed by cooldown %lld\n",
+                (long long)correlator.evaluated(), (long long)correlator.incidents(),
+                (long long)correlator.suppressed());
+  }
+  std::fflush(stdout);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options opt;
+  if (!parseArgs(argc, argv, opt)) return 2;
+
+  std::signal(SIGINT, onSignal);
+  std::signal(SIGTERM, onSignal);
+  std::signal(SIGUSR1, onSignal);
+
+  ReflexRouter router;
+  if (!opt.rulesPath.empty() && !router.loadFile(opt.rulesPath)) {
+    std::fprintf(stderr, "[HUB] Fix the rules file and restart\n");
+    return 1;
+  }
+
+  Correlator correlator;
+  if (!opt.correlationsPath.empty() && !correlator.loadFile(opt.correlationsPath)) {
+    std::fprintf(stderr, "[HUB] Fix the correlations file and restart\n");
+    return 1;
+  }
+
+  SourceLocator locator;
+  if (!opt.podsPath.empty() && !locator.loadFile(opt.podsPath)) {
+    std::fprintf(stderr, "[HUB] Fix the pods file and restart\n");
+    return 1;
+  }
+  constexpr int64_t ESTIMATE_PUBLISH_US = 250000;
+  int64_t estimatePublishedUs = 0;
+
+  EventBus bus;
+  if (opt.bus) {
+    if (!bus.create()) return 1;
+    std::printf("[HUB] Publishing events to /dev/shm%s\n", EventBus::DEFAULT_NAME);
+  }
+
+  EventStore store(opt.storeDir);
+  if (!opt.storeDir.empty()) {
+    if (!store.open()) return 1;
+    std::printf("[HUB] Event store %s: %llu events in %zu segment(s)\n", opt.storeDir.c_str(),
+                (unsigned long long)store.recordCount(), store.segmentCount());
+  }
+
+  LinkShards link(opt.shards);
+  link.setRateLimit(opt.rateLimit, opt.rateBurst);
+  if (!link.listen((uint16_t)opt.port)) return 1;
+  std::printf("[HUB] Listening on port %d (%d shard(s)) with %zu reflex rule(s), %zu correlation pattern(s)\n",
+              opt.port, link.shardCount(), router.ruleCount(), correlator.patternCount());
+
+  // Shards handle their lines in parallel. Each shared stage has its own
+  // lock, held only for that stage; the correlator's incident handler is the
+  // one place that nests (correlator, then store). Store and bus records
+  // wait in the shard's ShardBatch until the end of its poll(). The bus is
+  // published through claim/commit, which needs no lock.
+  std::mutex routerMutex, storeMutex, correlatorMutex, locatorMutex;
+  SchemaWarnings schemaWarned;
+  std::atomic<bool> estimateDirty{false};
+
+  correlator.onIncident([&](const Incident& incident) {
+    const CorrelationPattern& pattern = correlator.pattern(incident.pattern);
+    std::printf("[INCIDENT] %-16s %s (%s) -> %s (%s) in %.2f s\n", pattern.name.c_str(),
+                correlator.deviceId(incident.firstDevice).c_str(), correlator.location(incident.firstDevice).c_str(),
+                correlator.deviceId(incident.thenDevice).c_str(), correlator.location(incident.thenDevice).c_str(),
+                (incident.thenUs - incident.firstUs) / 1e6);
+    if (!opt.storeDir.empty()) {
+      std::lock_guard<std::mutex> lock(storeMutex);
+      storeIncident(store, correlator, incident);
+    }
+    if (opt.bus) {
+      BusRecord rec{};
+      rec.timeUs = hubWallUs();
+      setBusField(rec.device, correlator.deviceId(incident.thenDevice));
+      setBusField(rec.location, correlator.location(incident.thenDevice));
+      setBusField(rec.event, "incident:" + pattern.name);
+      rec.strength = (int32_t)incident.thenValue;
+      rec.value = (int32_t)((incident.thenUs - incident.firstUs) / 1000);
+      bus.publish(rec);
+    }
+  });
+
+  // Rules, patterns and pods are fixed once loaded, so their counts are read
+  // without a lock and a stage nobody configured costs nothing
+  link.onLine([&](SatelliteConn& conn, const JsonLine& msg, int64_t rxUs) {
+    std::string_view event = msg.str("event");
+    // Route first - logging must not delay the reflex
+    if (router.ruleCount() > 0 || event == "reflex_ack") {
+      std::lock_guard<std::mutex> lock(routerMutex);
+      router.route(link, conn, msg, rxUs);
+      if (router.onAck(msg, rxUs)) return;
+    }
+    if (!event.empty() && !conn.deviceId.empty() && !isProtocolEvent(event)) {
+      SatelliteEvent ev;
+      bindSatelliteEvent(msg, ev);
+      checkSchema(schemaWarned, conn, ev);
+      if (!opt.storeDir.empty()) stageStoreEvent(shardBatch, store, storeMutex, conn, ev);
+      if (opt.bus) stageBusEvent(shardBatch, conn, ev);
+    }
+    if (correlator.patternCount() > 0) {
+      std::lock_guard<std::mutex> lock(correlatorMutex);
+      correlator.process(conn, msg, rxUs);
+    }
+    if (locator.podCount() > 0) {
+      std::lock_guard<std::mutex> lock(locatorMutex);
+      if (locator.update(conn, msg, rxUs)) estimateDirty.store(true, std::memory_order_relaxed);
+    }
+    if (!opt.deviceRulesDir.empty() && event == "hello") {
+      pushDeviceRules(link, opt.deviceRulesDir, conn);
+    }
+
+    if (!opt.quiet) {
+      std::printf("[EVENT] %-12s %-10s %.*s\n", conn.deviceId.c_str(), conn.location.c_str(), (int)event.size(),
+                  event.data());
+    }
+  });
+
+  // Appends keep the store's times in order, so a batch that lands after a
+  // newer one from another shard is stamped up to it (by under a poll()'s
+  // worth of time)
+  if (!opt.storeDir.empty() || opt.bus) {
+    link.onBatch([&] {
+      ShardBatch& batch = shardBatch;
+      const EventRecord* recs = batch.records.data();
+      uint32_t left = (uint32_t)batch.records.size();
+      while (left > 0) {
+        EventStore::Reservation r;
+        {
+          std::lock_guard<std::mutex> lock(storeMutex);
+          r = store.reserve(recs, left);
+        }
+        if (r.count == 0) break;
+        store.fill(r, recs);
+        recs += r.count;
+        left -= r.count;
+      }
+      batch.records.clear();
+      if (opt.bus) {
+        uint32_t n = (uint32_t)batch.published.size();
+        uint64_t first = bus.claim(n);
+        for (uint32_t i = 0; i < n; i++) bus.write(first + i, batch.published[i]);
+        bus.commit(first, n);
+        bus.notify();   // one wakeup per batch of events
+      }
+      batch.published.clear();
+    });
+  }
+
+  int64_t startUs = hubNowUs();
+  link.start();
+  while (!stopRequested) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    if (!opt.storeDir.empty()) {
+      std::lock_guard<std::mutex> lock(storeMutex);
+      store.maybeFlush(hubNowUs());
+    }
+    if (estimateDirty.load(std::memory_order_relaxed) && hubNowUs() - estimatePublishedUs >= ESTIMATE_PUBLISH_US) {
+      estimateDirty.store(false, std::memory_order_relaxed);
+      estimatePublishedUs = hubNowUs();
+      SourceEstimate e;
+      {
+        std::lock_guard<std::mutex> lock(locatorMutex);
+        e = locator.estimate(estimatePublishedUs);
+      }
+      publishEstimate(e, opt.estimatePath, opt.quiet);
+    }
+    if (statsRequested) {
+      statsRequested = 0;
+      std::scoped_lock lock(routerMutex, correlatorMutex);
+      printStats(router, correlator, link, startUs);
+    }
+  }
+  link.stop();
+  printStats(router, correlator, link, startUs);
+  store.close();
+  bus.close();
+  return 0;
+}
@@ -0,0 +1,214 @@
+// Session timeline queries over the hub's event store.
+//
+//   oraclebox_query --store DIR devices
+//   oraclebox_query --store DIR events --type em_trigger --min-strength 6
+//                   --location hallway --from 02:00 --to 03:00
+//   oraclebox_query --store DIR rate --by location --bucket 1 --from 22:00 --to 06:00
+//
+// Times are local: "YYYY-MM-DD HH:MM", "HH:MM" (the most recent such time
+// before the last stored event; --to is the first such time after --from),
+// or epoch seconds. The store can be queried while oraclebox_hubd writes it.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+
+#include "oraclebox/event_store.h"
+#include "oraclebox/timeline_query.h"
+
+using namespace oraclebox;
+
+namespace {
+
+void usage(const char* argv0) {
+  std::printf(
+      "Usage: %s --store DIR <devices|events|rate> [options]\n"
+      "  --from T / --to T    time window (\"YYYY-MM-DD HH:MM\", \"HH:MM\", epoch s)\n"
+      "  --device ID          restrict to a device (repeatable)\n"
+      "  --location NAME      restrict to devices at a location\n"
+      "  --type EVENT         restrict to an event type (em_trigger, motion_detected, ...)\n"
+      "  --min-strength N     only events with strength >= N\n"
+      "  --limit N            events: print at most N rows (default 200)\n"
+      "  --bucket MIN         rate: bucket size in minutes (default 1)\n"
+      "  --by GROUP           rate: device | location | none (default location)\n",
+      argv0);
+}
+
+// Parses a time argument. HH:MM resolves relative to refUs: the latest such
+// time <= refUs (after = false) or the first such time > refUs (after = true).
+bool parseTime(const char* s, int64_t refUs, bool after, int64_t& outUs) {
+  int y, mo, d, h, mi;
+  if (std::sscanf(s, "%d-%d-%d %d:%d", &y, &mo, &d, &h, &mi) == 5) {
+    std::tm tm{};
+    tm.tm_year = y - 1900;
+    tm.tm_mon = mo - 1;
+    tm.tm_mday = d;
+    tm.tm_hour = h;
+    tm.tm_min = mi;
+    tm.tm_isdst = -1;
+    outUs = (int64_t)std::mktime(&tm) * 1000000;
+    return true;
+  }
+  if (std::strchr(s, ':') && std::sscanf(s, "%d:%d", &h, &mi) == 2) {
+    std::time_t ref = (std::time_t)(refUs / 1000000);
+    std::tm tm{};
+    localtime_r(&ref, &tm);
+    tm.tm_hour = h;
+    tm.tm_min = mi;
+    tm.tm_sec = 0;
+    tm.tm_isdst = -1;
+    int64_t t = (int64_t)std::mktime(&tm) * 1000000;
+    if (!after && t > refUs) t -= 86400LL * 1000000;
+    if (after && t <= refUs) t += 86400LL * 1000000;
+    outUs = t;
+    return true;
+  }
+  char* end = nullptr;
+  double secs = std::strtod(s, &end);
+  if (end == s || *end) return false;
+  outUs = (int64_t)(secs * 1e6);
+  return true;
+}
+
+std::string formatTime(int64_t us) {
+  std::time_t t = (std::time_t)(us / 1000000);
+  std::tm tm{};
+  localtime_r(&t, &tm);
+  char buf[32];
+  std::strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", &tm);
+  return buf;
+}
+
+double msSince(std::chrono::steady_clock::time_point t0) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::string storeDir, command;
+  const char* fromArg = nullptr;
+  const char* toArg = nullptr;
+  std::vector<std::string> deviceIds;
+  std::string location, type, by = "location";
+  int minStrength = INT_MIN, limit = 200, bucket = 1;
+
+  for (int i = 1; i < argc; i++) {
+    const char* a = argv[i];
+    const char* v = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (!std::strcmp(a, "--store") && v) storeDir = argv[++i];
+    else if (!std::strcmp(a, "--from") && v) fromArg = argv[++i];
+    else if (!std::strcmp(a, "--to") && v) toArg = argv[++i];
+    else if (!std::strcmp(a, "--device") && v) deviceIds.push_back(argv[++i]);
+    else if (!std::strcmp(a, "--location") && v) location = argv[++i];
+    else if (!std::strcmp(a, "--type") && v) type = argv[++i];
+    else if (!std::strcmp(a, "--min-strength") && v) minStrength = std::atoi(argv[++i]);
+    else if (!std::strcmp(a, "--limit") && v) limit = std::atoi(argv[++i]);
+    else if (!std::strcmp(a, "--bucket") && v) bucket = std::atoi(argv[++i]);
+    else if (!std::strcmp(a, "--by") && v) by = argv[++i];
+    else if (a[0] != '-' && command.empty()) command = a;
+    else {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  if (storeDir.empty() || command.empty()) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  EventStore store(storeDir);
+  if (!store.open(true)) return 1;
+
+  if (command == "devices") {
+    std::printf("%-16s %-10s %s\n", "DEVICE", "TYPE", "LOCATION");
+    for (const DeviceInfo& d : store.devices()) {
+      std::printf("%-16s %-10s %s\n", d.id.c_str(), d.kind.c_str(), d.location.c_str());
+    }
+    std::printf("\nEvent types:");
+    for (const std::string& t : store.types()) std::printf(" %s", t.c_str());
+    std::printf("\n%llu events, %s .. %s\n", (unsigned long long)store.recordCount(),
+                formatTime(store.firstTimeUs()).c_str(), formatTime(store.lastTimeUs()).c_str());
+    return 0;
+  }
+
+  TimelineFilter f;
+  int64_t lastUs = store.lastTimeUs();
+  if (fromArg && !parseTime(fromArg, lastUs, false, f.fromUs)) {
+    std::fprintf(stderr, "Bad --from time: %s\n", fromArg);
+    return 2;
+  }
+  if (toArg && !parseTime(toArg, fromArg ? f.fromUs : lastUs, fromArg != nullptr, f.toUs)) {
+    std::fprintf(stderr, "Bad --to time: %s\n", toArg);
+    return 2;
+  }
+  for (const std::string& id : deviceIds) {
+    int d = store.findDevice(id);
+    if (d < 0) {
+      std::fprintf(stderr, "Unknown device: %s\n", id.c_str());
+      return 1;
+    }
+    f.devices.push_back(d);
+  }
+  f.location = location;
+  if (!type.empty()) {
+    f.type = store.findType(type);
+    if (f.type < 0) {
+      std::fprintf(stderr, "No %s events stored\n", type.c_str());
+      return 0;
+    }
+  }
+  f.minStrength = minStrength;
+
+  auto t0 = std::chrono::steady_clock::now();
+  TimelineIndex index(store);
+  index.update();
+  double indexMs = msSince(t0);
+
+  const auto& devices = store.devices();
+  const auto& types = store.types();
+  t0 = std::chrono::steady_clock::now();
+  size_t rows = 0;
+
+  if (command == "events") {
+    std::vector<TimelineHit> hits = index.events(f);
+    double queryMs = msSince(t0);
+    std::printf("%-19s  %-14s %-10s %-16s %8s %7s %8s\n", "TIME", "DEVICE", "LOCATION", "EVENT", "STRENGTH",
+                "TEMP", "PRESSURE");
+    for (const TimelineHit& h : hits) {
+      if ((int)rows++ >= limit) break;
+      const EventRecord& r = *h.rec;
+      char temp[16] = "-";
+      if (!std::isnan(r.temperature)) std::snprintf(temp, sizeof(temp), "%.1f", r.temperature);
+      char pressure[16] = "-";
+      if (!std::isnan(r.pressure)) std::snprintf(pressure, sizeof(pressure), "%.1f", r.pressure);
+      std::printf("%-19s  %-14s %-10s %-16s %8d %7s %8s\n", formatTime(r.timeUs).c_str(),
+                  devices[r.device].id.c_str(), devices[r.device].location.c_str(), types[r.type].c_str(),
+                  r.strength, temp, pressure);
+    }
+    std::fprintf(stderr, "%zu matching events (index %.2f ms, query %.3f ms)\n", hits.size(), indexMs, queryMs);
+  } else if (command == "rate") {
+    RollupGroup group = by == "device" ? RollupGroup::Device : by == "none" ? RollupGroup::None : RollupGroup::Location;
+    std::vector<RollupRow> result = index.rollup(f, bucket, group);
+    double queryMs = msSince(t0);
+    std::printf("%-19s  %-14s %6s %6s %13s\n", "BUCKET", "GROUP", "EVENTS", "MAXSTR", "TEMP MIN-MAX");
+    for (const RollupRow& r : result) {
+      char temp[32] = "-";
+      if (!std::isnan(r.tempMin)) std::snprintf(temp, sizeof(temp), "%.1f-%.1f", r.tempMin, r.tempMax);
+      char strength[16] = "-";
+      if (r.maxStrength != INT32_MIN) std::snprintf(strength, sizeof(strength), "%d", r.maxStrength);
+      std::printf("%-19s  %-14s %6u %6s %13s\n", formatTime(r.bucketUs).c_str(), r.group.c_str(), r.count, strength,
+                  temp);
+      rows++;
+    }
+    std::fprintf(stderr, "%zu rows (index %.2f ms, query %.3f ms)\n", rows, indexMs, queryMs);
+  } else {
+    usage(argv[0]);
+    return 2;
+  }
+  return 0;
+}
@@ -0,0 +1,126 @@
+// Trigger sound latency check: decodes the sound folders into the PCM cache,
+// holds the output device open and fires triggers at it, reporting how long
+// each took to reach the DAC.
+//
+//   sound_trigger_bench --dir ../sounds/RemPod --dir ../sounds/MusicBox
+//                       [--device plughw:3,0] [--triggers 50] [--interval-ms 300] [--period 256]
+//                       [--stream]
+//
+// The default device "null" is a clock-paced stand-in, which measures the
+// player's own scheduling only. Compare with play_sound(), which starts an
+// aplay/mpg123 process (and an MP3 decode) per trigger. --stream feeds a
+// 220 Hz tone through a pipe in place of the FX pipeline, so the sounds
+// overlay (and duck) a live stream the way they do on the hub.
+
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "oraclebox/hub_clock.h"
+#include "oraclebox/sound_player.h"
+
+using namespace oraclebox;
+
+namespace {
+
+// Writes a tone into the pipe at real-time pace, a period at a time.
+void feedTone(int fd, int rate, int period, std::atomic<bool>& quit) {
+  std::vector<int16_t> buf((size_t)period * 2);
+  double phase = 0.0;
+  int64_t start = hubNowUs();
+  int64_t frames = 0;
+  while (!quit.load()) {
+    for (int i = 0; i < period; i++) {
+      int16_t v = (int16_t)(std::sin(phase) * 8000.0);
+      buf[(size_t)i * 2] = buf[(size_t)i * 2 + 1] = v;
+      phase += 2.0 * M_PI * 220.0 / rate;
+    }
+    if (::write(fd, buf.data(), buf.size() * 2) < 0) break;
+    frames += period;
+    int64_t due = start + frames * 1000000 / rate;
+    int64_t wait = due - hubNowUs();
+    if (wait > 0) std::this_thread::sleep_for(std::chrono::microseconds(wait));
+  }
+  ::close(fd);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::vector<std::string> dirs;
+  std::string device = "null";
+  int triggers = 50;
+  int intervalMs = 300;
+  int period = SoundPlayer::DEFAULT_PERIOD_FRAMES;
+  bool stream = false;
+  for (int i = 1; i < argc; i++) {
+    if (!std::strcmp(argv[i], "--dir") && i + 1 < argc) dirs.push_back(argv[++i]);
+    else if (!std::strcmp(argv[i], "--device") && i + 1 < argc) device = argv[++i];
+    else if (!std::strcmp(argv[i], "--triggers") && i + 1 < argc) triggers = std::atoi(argv[++i]);
+    else if (!std::strcmp(argv[i], "--interval-ms") && i + 1 < argc) intervalMs = std::atoi(argv[++i]);
+    else if (!std::strcmp(argv[i], "--period") && i + 1 < argc) period = std::atoi(argv[++i]);
+    else if (!std::strcmp(argv[i], "--stream")) stream = true;
+  }
+
+  SoundCache cache;
+  int64_t t0 = hubNowUs();
+  for (const std::string& dir : dirs) cache.loadDirectory(dir);
+  double loadMs = (double)(hubNowUs() - t0) / 1000.0;
+  std::vector<std::string> names = cache.names();
+  std::printf("%zu sound(s) cached in %.1f ms, %.1f MB of PCM\n", names.size(), loadMs,
+              (double)cache.bytes() / (1024.0 * 1024.0));
+  if (names.empty()) {
+    std::fprintf(stderr, "[SOUND] No .wav/.mp3 files in the --dir folders\n");
+    return 1;
+  }
+
+  SoundPlayer player(cache);
+  if (!player.hold(device, period)) return 1;
+
+  std::atomic<bool> quit{false};
+  std::thread feeder;
+  if (stream) {
+    std::signal(SIGPIPE, SIG_IGN);
+    int fds[2];
+    if (pipe(fds) != 0) return 1;
+    player.attachStream(fds[0]);
+    ::close(fds[0]);
+    feeder = std::thread(feedTone, fds[1], cache.rate(), period, std::ref(quit));
+  }
+
+  // Triggers land at random points in the period, like satellite events do
+  std::mt19937 rng(1);
+  std::uniform_int_distribution<int> jitterUs(0, 20000);
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  for (int i = 0; i < triggers; i++) {
+    player.play(names[(size_t)i % names.size()]);
+    std::this_thread::sleep_for(std::chrono::milliseconds(intervalMs) + std::chrono::microseconds(jitterUs(rng)));
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  SoundPlayer::Stats s = player.stats();
+  player.release();
+  quit.store(true);
+  if (feeder.joinable()) feeder.join();
+
+  std::printf("%llu trigger(s) on %s, %.2f ms periods\n", (unsigned long long)s.triggers, device.c_str(),
+              s.periodMs);
+  std::printf("  trigger to DAC   mean %.2f  max %.2f ms (%llu started)\n", s.meanLatencyMs, s.maxLatencyMs,
+              (unsigned long long)s.started);
+  if (s.stolen) std::printf("  voices stolen    %llu\n", (unsigned long long)s.stolen);
+  if (stream) {
+    std::printf("  stream           %llu short period(s), %llu frame(s) dropped\n",
+                (unsigned long long)s.streamUnderflows, (unsigned long long)s.streamDropped);
+  }
+  if (s.underruns) std::printf("  underruns        %llu\n", (unsigned long long)s.underruns);
+  return 0;
+}
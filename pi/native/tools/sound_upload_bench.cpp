@@ -0,0 +1,92 @@
+// Upload path check: replays each sound in the --dir folders through
+// SoundUpload in Bluetooth-sized chunks, as the UPLOAD_SOUND handler feeds
+// it, and reports how long after the last chunk each sound was playable.
+// Every upload is compared with a one-shot decodeSoundFile() of the same
+// file, so chunk boundaries that land mid-frame or mid-header are checked.
+//
+//   sound_upload_bench --dir ../sounds/RemPod [--chunk 990] [--out /tmp/uploads]
+//
+// The old handler joined the chunks, wrote the file, and decoded it again
+// at every play.
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "oraclebox/hub_clock.h"
+#include "oraclebox/sound_upload.h"
+
+using namespace oraclebox;
+
+int main(int argc, char** argv) {
+  std::vector<std::string> dirs;
+  size_t chunk = 990;   // an RFCOMM recv
+  std::string outDir = "/tmp/oraclebox_uploads";
+  for (int i = 1; i < argc; i++) {
+    if (!std::strcmp(argv[i], "--dir") && i + 1 < argc) dirs.push_back(argv[++i]);
+    else if (!std::strcmp(argv[i], "--chunk") && i + 1 < argc) chunk = (size_t)std::max(1, std::atoi(argv[++i]));
+    else if (!std::strcmp(argv[i], "--out") && i + 1 < argc) outDir = argv[++i];
+  }
+  mkdir(outDir.c_str(), 0755);
+
+  SoundCache cache;
+  SoundUpload upload(cache);
+  int files = 0, mismatched = 0, failed = 0;
+  double sumMs = 0.0, maxMs = 0.0;
+  for (const std::string& dir : dirs) {
+    DIR* d = opendir(dir.c_str());
+    if (!d) continue;
+    std::vector<std::string> names;
+    while (dirent* e = readdir(d)) {
+      PcmDecoder::Format format;
+      if (e->d_name[0] != '.' && PcmDecoder::formatOf(e->d_name, format)) names.push_back(e->d_name);
+    }
+    closedir(d);
+
+    for (const std::string& name : names) {
+      std::string src = dir + "/" + name;
+      std::ifstream in(src, std::ios::binary);
+      std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+      files++;
+
+      if (!upload.begin(outDir, name, bytes.size())) {
+        failed++;
+        continue;
+      }
+      for (size_t at = 0; at < bytes.size(); at += chunk) {
+        upload.write(bytes.data() + at, std::min(chunk, bytes.size() - at));
+      }
+      uint32_t crc = crc32Update(0, bytes.data(), bytes.size());
+      int64_t t0 = hubNowUs();
+      if (!upload.finish(crc) || !upload.decoded()) {
+        failed++;
+        continue;
+      }
+      double ms = (double)(hubNowUs() - t0) / 1000.0;
+      sumMs += ms;
+      if (ms > maxMs) maxMs = ms;
+
+      std::vector<int16_t> reference;
+      decodeSoundFile(src, cache.rate(), reference);
+      auto clip = cache.find(name);
+      if (!clip || clip->samples != reference) {
+        mismatched++;
+        std::printf("  %s: decoded upload differs from the file decode\n", name.c_str());
+      }
+    }
+  }
+
+  int ok = files - failed;
+  std::printf("%d upload(s) in %zu-byte chunks, %d failed, %d differing from the file decode\n", files, chunk, failed,
+              mismatched);
+  if (ok > 0) std::printf("  last chunk to playable   mean %.2f  max %.2f ms\n", sumMs / ok, maxMs);
+  return mismatched || failed ? 1 : 0;
+}
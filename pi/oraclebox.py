@@ -11,11 +11,16 @@ Changes:
 """
 
 import os
+import sys
 import signal
 import time
 import json
 import threading
 import subprocess
+import re
+import shlex
+import zlib
+from collections import deque
 
 # Optional Bluetooth library
 try:
@@ -32,6 +37,16 @@ except ImportError:
 
 from gpiozero import LED, PWMLED
 
+# Satellite events from the native hub (oraclebox_hubd --bus)
+from event_bus import EventBusReader
+
+# Optional native engines (pi/native built with pybind11; see README)
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), "native", "build"))
+try:
+    import oraclebox_native
+except ImportError:
+    oraclebox_native = None
+
 # ==================== DEBUG / LOGGING CONFIGURATION ====================
 # Control what gets logged to the console - set to False to reduce noise
 # ========================================================================
@@ -78,6 +93,9 @@ class DebugConfig:
     CMD_BT_AUDIO = True                # Log BT_AUDIO commands
     CMD_STATUS_PING = False            # Log STATUS and PING commands (can be spammy)
     
+    # === SATELLITES ===
+    SATELLITE_EVENTS = False           # Log every event read from the hub's event bus
+    
     # === SYSTEM / INITIALIZATION ===
     SYSTEM_STARTUP = True              # Log system initialization messages
     CONFIG_LOAD_SAVE = True            # Log config file operations
@@ -98,10 +116,16 @@ ANNOUNCEMENTS_DIR = os.path.join(SOUNDS_DIR, "Announcements")
 STARTUP_SOUNDS_DIR = os.path.join(SOUNDS_DIR, "Startup")
 REMPOD_SOUNDS_DIR = os.path.join(SOUNDS_DIR, "RemPod")
 MUSICBOX_SOUNDS_DIR = os.path.join(SOUNDS_DIR, "MusicBox")
+RECORDINGS_DIR = os.path.join(BASE_DIR, "recordings")
 LED_CONFIG_PATH = os.path.join(BASE_DIR, "oraclebox_led_config.json")
 FX_CONFIG_PATH = os.path.join(BASE_DIR, "oraclebox_fx_config.json")
+SOUND_INDEX_PATH = os.path.join(BASE_DIR, "sound_index.bin")
 
 SUPPORTED_SOUND_EXTENSIONS = (".wav", ".mp3")
+
+# ALSA PCM names a client may pick for FX MONITOR ("bluealsa:DEV=..,PROFILE=a2dp",
+# "plughw:1,0", "default"); the name ends up in an aplay command line
+ALSA_DEVICE_PATTERN = re.compile(r"[A-Za-z0-9_:,.=-]{1,96}")
 STARTUP_SOUND_TIMEOUT = 30.0  # seconds
 
 # Sweep speeds in ms
@@ -327,6 +351,27 @@ class FxConfig:
         # Gains in dB (FM_RAW_PORTAL defaults)
         self.pre_gain_db = -6
         self.post_gain_db = 8
+
+        # Rate the native FX engine runs the (mono) chain at, in Hz; the
+        # sox fallback always runs at 48000
+        self.internal_rate = 16000
+
+        # Spectral suppression of the static between stations, 0 (off) to
+        # 100; native FX engine only
+        self.noise_reduce = 0
+
+        # Native FX engine level control (in place of sox's fixed compand):
+        # the AGC's target RMS level and the output limiter's look-ahead
+        self.agc_target_db = -18
+        self.lookahead_ms = 5
+        self.retune_mute_ms = 8
+
+        # Extra outputs of the native FX engine, fed the same processed
+        # blocks as the main device: a second device to monitor on (e.g. a
+        # Bluetooth sink while the speaker plays) and a WAV recording in
+        # RECORDINGS_DIR. Recording always starts off, like enabled.
+        self.monitor_device = ""
+        self.record = False
         
         # Current preset name (or "CUSTOM" if manually adjusted)
         # Default to FM_RAW_PORTAL since built-in FM tuner is the default mode
@@ -345,6 +390,13 @@ class FxConfig:
             "contrast_amount": self.contrast_amount,
             "pre_gain_db": self.pre_gain_db,
             "post_gain_db": self.post_gain_db,
+            "internal_rate": self.internal_rate,
+            "noise_reduce": self.noise_reduce,
+            "agc_target_db": self.agc_target_db,
+            "lookahead_ms": self.lookahead_ms,
+            "retune_mute_ms": self.retune_mute_ms,
+            "monitor_device": self.monitor_device,
+            "record": self.record,
         }
 
     @classmethod
@@ -361,6 +413,16 @@ class FxConfig:
         fx.contrast_amount = int(data.get("contrast_amount", fx.contrast_amount))
         fx.pre_gain_db = int(data.get("pre_gain_db", fx.pre_gain_db))
         fx.post_gain_db = int(data.get("post_gain_db", fx.post_gain_db))
+        fx.internal_rate = int(data.get("internal_rate", fx.internal_rate))
+        fx.noise_reduce = int(data.get("noise_reduce", fx.noise_reduce))
+        fx.agc_target_db = int(data.get("agc_target_db", fx.agc_target_db))
+        fx.lookahead_ms = int(data.get("lookahead_ms", fx.lookahead_ms))
+        fx.retune_mute_ms = int(data.get("retune_mute_ms", fx.retune_mute_ms))
+        fx.monitor_device = str(data.get("monitor_device", fx.monitor_device))
+        if fx.monitor_device and not ALSA_DEVICE_PATTERN.fullmatch(fx.monitor_device):
+            print(f"[FX] Ignoring saved monitor device {fx.monitor_device!r}: not an ALSA device name")
+            fx.monitor_device = ""
+        fx.record = bool(data.get("record", fx.record))
         return fx
 
     def load(self):
@@ -383,6 +445,12 @@ class FxConfig:
             self.contrast_amount = loaded.contrast_amount
             self.pre_gain_db = loaded.pre_gain_db
             self.post_gain_db = loaded.post_gain_db
+            self.internal_rate = loaded.internal_rate
+            self.noise_reduce = loaded.noise_reduce
+            self.agc_target_db = loaded.agc_target_db
+            self.lookahead_ms = loaded.lookahead_ms
+            self.retune_mute_ms = loaded.retune_mute_ms
+            self.monitor_device = loaded.monitor_device
         except Exception as e:
             if debug.ERROR_MESSAGES:
                 print("Error loading FX config:", e)
@@ -645,6 +713,12 @@ rempod_lock = threading.Lock()
 musicbox_state = MusicBoxState()
 musicbox_lock = threading.Lock()
 
+# Satellite events seen on the hub's event bus
+satellite_recent = deque(maxlen=50)   # newest last
+satellite_devices = {}                # device id -> last event
+satellite_bus_attached = False
+satellite_lock = threading.Lock()
+
 # Lock to protect shared state between threads
 state_lock = threading.Lock()
 audio_lock = threading.Lock()
@@ -747,6 +821,271 @@ def set_freq(freq_mhz):
     return success
 
 
+# -------------------- NATIVE SWEEP --------------------
+# With oraclebox_native available the sweep runs in C++ on its own thread:
+# the tuner stays open, steps land on a fixed schedule whatever the GIL is
+# doing, and commands just push new settings into it (microseconds).
+# Without it, sweep_thread() steps the tuner from Python as before.
+
+native_sweep = None
+
+
+def init_native_sweep():
+    """Start the native sweep engine if the module is built."""
+    global native_sweep
+    if oraclebox_native is None:
+        return False
+    engine = oraclebox_native.SweepEngine()
+    if fm_radio_available and not engine.open_tuner(I2C_BUS, TEA5767_ADDR):
+        if debug.FM_TUNER_OPERATIONS:
+            print("[FM] Native sweep could not open the tuner (sweeping without FM)")
+    engine.set_retune_pipe(NATIVE_FX_CONTROL)
+    engine.start()
+    native_sweep = engine
+    sync_native_sweep()
+    return True
+
+
+def sync_native_sweep():
+    """Push running/direction/speed into the native sweep. Call after
+    changing them, outside state_lock."""
+    if native_sweep is None:
+        return
+    with state_lock:
+        running = state.running
+        direction = state.direction
+        delay_ms = SWEEP_SPEEDS_MS[state.speed_index]
+    native_sweep.set_direction(direction)
+    native_sweep.set_delay_ms(delay_ms)
+    native_sweep.set_running(running)
+
+
+def fm_tune(freq_mhz):
+    """Manual tuning (FM TUNE/TEST), through the native engine's open tuner when there is one."""
+    if native_sweep is not None:
+        return native_sweep.tune(freq_mhz)  # announces the retune itself
+    announce_retune(freq_mhz)
+    return tea5767_write(freq_mhz)
+
+
+# -------------------- NATIVE TRIGGER SOUNDS --------------------
+# With oraclebox_native available, REM pod and music box trigger sounds are
+# decoded once at startup and played on an output device the native player
+# keeps open, a few milliseconds after the trigger instead of after an
+# aplay/mpg123 start and an MP3 decode. The player is a mixer: while it holds
+# the device the sox pipelines write raw PCM into it instead of into aplay,
+# and trigger sounds and announcements overlay (and duck) the FX audio
+# rather than stopping it. Without the native player, or when the device
+# cannot be held, everything falls back to aplay and play_sound().
+
+NATIVE_STREAM_FORMAT = "-t raw -r 48000 -c 2 -e signed -b 16"
+
+# The FX chain on the native engine: the FM audio is mono, so it is
+# downmixed and run once at FxConfig.internal_rate instead of twice at
+# 48 kHz as sox does it. Used in place of sox when it is built.
+NATIVE_FX_BIN = os.path.join(BASE_DIR, "native", "build", "oraclebox_fx")
+FX_INTERNAL_RATES = (12000, 16000, 24000, 32000, 48000)
+
+# oraclebox_fx reads "PARAM value" lines from this pipe while it runs, so
+# these FX SET params apply without restarting the pipeline
+NATIVE_FX_CONTROL = "/tmp/oraclebox_fx.control"
+FX_LIVE_PARAMS = ("PRE_GAIN", "POST_GAIN", "AGC_TARGET")
+# FX_PRESETS as JSON lines, compiled by oraclebox_fx at startup so that
+# FX PRESET SET switches over the pipe ("PRESET name") with a short crossfade
+NATIVE_FX_PRESETS = "/tmp/oraclebox_fx_presets.jsonl"
+# The sweep announces each step on NATIVE_FX_CONTROL a period ahead
+# ("RETUNE mhz monotonic_us"); oraclebox_fx mutes the input around it and
+# logs what it played at each frequency here (moved to .1 at 1 MB)
+NATIVE_FX_SEGMENTS = "/tmp/oraclebox_fx_segments.jsonl"
+
+native_sound = None
+native_sound_cache = None
+sound_library = None  # name -> file index of the sound folders, kept by inotify
+
+# play_sound()'s search order; a name in several folders is the first one's
+SOUND_FOLDERS = (
+    ("announcements", ANNOUNCEMENTS_DIR),
+    ("startup", STARTUP_SOUNDS_DIR),
+    ("rempod", REMPOD_SOUNDS_DIR),
+    ("musicbox", MUSICBOX_SOUNDS_DIR),
+    ("root", SOUNDS_DIR),
+)
+native_sound_lock = threading.Lock()
+_native_sound_borrowers = 0      # play_sound() calls using the device
+_native_sound_retry_at = 0.0
+
+
+def init_native_sound():
+    """Decode the trigger sound folders and create the native player."""
+    global native_sound, native_sound_cache
+    if oraclebox_native is None:
+        return False
+    cache = oraclebox_native.SoundCache()
+    t0 = time.time()
+    # Same order as play_sound() searches them, so a name finds the same file
+    for folder in (REMPOD_SOUNDS_DIR, MUSICBOX_SOUNDS_DIR, SOUNDS_DIR):
+        cache.load_dir(folder)
+    native_sound_cache = cache
+    native_sound = oraclebox_native.SoundPlayer(cache)
+    if debug.SOUND_PLAYBACK:
+        print(f"[SOUND] {len(cache)} trigger sound(s) cached in {(time.time() - t0) * 1000:.0f} ms "
+              f"({cache.bytes / 1048576:.1f} MB)")
+    init_sound_library(cache)
+    return True
+
+
+def init_sound_library(cache):
+    """Index the sound folders (from the saved index where files are unchanged)."""
+    global sound_library
+    library = oraclebox_native.SoundLibrary(cache)
+    for tag, folder in SOUND_FOLDERS:
+        library.add_folder(tag, folder)
+    t0 = time.time()
+    library.start(SOUND_INDEX_PATH)
+    library.save(SOUND_INDEX_PATH)
+    sound_library = library
+    if debug.SOUND_PLAYBACK:
+        stats = library.stats()
+        print(f"[SOUND] {stats['sounds']} sound(s) indexed in {(time.time() - t0) * 1000:.0f} ms "
+              f"({stats['reused']} from the saved index)")
+
+
+def native_sound_hold():
+    """Open the output device in the native player (unless play_sound() has it)."""
+    global _native_sound_retry_at
+    if native_sound is None:
+        return
+    with audio_lock:
+        device = audio_config.current_device
+    with native_sound_lock:
+        if _native_sound_borrowers or (native_sound.holding and native_sound.device == device):
+            return
+        now = time.time()
+        if now < _native_sound_retry_at:
+            return
+        if not native_sound.hold(device):
+            _native_sound_retry_at = now + 5.0  # busy (another player); don't retry every tick
+
+
+def native_sound_release():
+    """Close the native player's device so another process can open it."""
+    if native_sound is None:
+        return
+    with native_sound_lock:
+        if native_sound.holding:
+            native_sound.release()
+
+
+def play_trigger_sound(sound):
+    """Play a REM pod / music box trigger sound, natively when the player holds the device."""
+    if native_sound is not None and native_sound.play(sound):
+        if debug.SOUND_PLAYBACK:
+            print(f"[SOUND] Native trigger: {sound}")
+        return
+    threading.Thread(target=play_sound, args=(sound,), daemon=True).start()
+
+
+def native_stream_device():
+    """Device the sox pipelines should stream into the native mixer, or "" for aplay."""
+    if native_sound is None or not native_sound.holding:
+        return ""
+    with audio_lock:
+        device = audio_config.current_device
+    return device if native_sound.device == device else ""
+
+
+def native_attach_pipeline(proc):
+    """Hand a pipeline's raw stdout to the mixer (it keeps its own copy of the fd)."""
+    native_sound.attach_stream(proc.stdout.fileno())
+    proc.stdout.close()  # sox gets SIGPIPE if the mixer lets go
+
+
+def native_play_overlay(name, path):
+    """Play a sound through the mixer over the FX audio; False if it can't."""
+    if not native_stream_device():
+        return False
+    if name not in native_sound_cache and not native_sound_cache.load_file(path, name):
+        return False
+    voice = native_sound.play(name)
+    if not voice:
+        return False
+    print(f"Playing sound via native mixer: {name}")
+    native_sound.wait_voice(voice, 600000)
+    if debug.SOUND_PLAYBACK:
+        print(f"[SOUND] Playback complete: {name}")
+    return True
+
+
+def native_sound_status():
+    """Native player state and trigger-to-sound latency, or None without it."""
+    if native_sound is None:
+        return None
+    stats = native_sound.stats()
+    stats["holding"] = native_sound.holding
+    stats["device"] = native_sound.device
+    if sound_library is not None:
+        stats["library"] = sound_library.stats()
+    return stats
+
+
+# -------------------- SOUND UPLOADS --------------------
+# UPLOAD_SOUND chunks are written to disk as they arrive, with a running
+# CRC-32, instead of being collected and joined. With oraclebox_native the
+# sink also decodes them into the trigger sound cache, so the sound plays
+# natively as soon as the upload completes.
+
+class _FileUploadSink:
+    """Streaming upload to DIR/.NAME.upload without the native decoder."""
+
+    def __init__(self, folder, name):
+        self.path = os.path.join(folder, name)
+        self._part = os.path.join(folder, "." + name + ".upload")
+        self._file = open(self._part, "wb")
+        self.crc32 = 0
+        self.decoded = False
+        self.error = ""
+
+    def write(self, chunk):
+        self.crc32 = zlib.crc32(chunk, self.crc32)
+        self._file.write(chunk)
+        return True
+
+    def finish(self, expected_crc=-1):
+        if expected_crc >= 0 and expected_crc != self.crc32:
+            self.error = "checksum mismatch"
+            self.abort()
+            return False
+        self._file.flush()
+        os.fsync(self._file.fileno())
+        self._file.close()
+        os.replace(self._part, self.path)
+        return True
+
+    def abort(self):
+        if not self._file.closed:
+            self._file.close()
+            try:
+                os.unlink(self._part)
+            except OSError:
+                pass
+
+
+def open_upload_sink(name, size):
+    """Sink for an uploaded sound in SOUNDS_DIR, or None if it can't be created."""
+    if not name or name.startswith(".") or "/" in name:
+        return None
+    os.makedirs(SOUNDS_DIR, exist_ok=True)
+    if native_sound_cache is not None:
+        sink = oraclebox_native.SoundUpload(native_sound_cache)
+        return sink if sink.begin(SOUNDS_DIR, name, size) else None
+    try:
+        return _FileUploadSink(SOUNDS_DIR, name)
+    except OSError as e:
+        if debug.ERROR_MESSAGES:
+            print("[UPLOAD_SOUND] cannot create file:", e)
+        return None
+
+
 # -------------------- HELPERS --------------------
 
 def closest_speed_index(ms):
@@ -960,9 +1299,26 @@ def _blocking_playback(cmd, player, timeout_s=None):
         return -1
 
 
+def find_sound_path(name):
+    """Path of a sound by name, searching SOUND_FOLDERS in order; None if missing."""
+    if sound_library is not None:
+        return sound_library.path(name) or None
+    for _, folder in SOUND_FOLDERS:
+        path = os.path.join(folder, name)
+        if os.path.exists(path):
+            return path
+    return None
+
+
+def _indexed_sounds(tag=""):
+    """Sorted names from the sound index, limited to the formats we play."""
+    return [f for f in sound_library.names(tag)
+            if os.path.splitext(f.lower())[1] in SUPPORTED_SOUND_EXTENSIONS]
+
+
 def play_sound(name=None):
-    """Play a sound file (WAV via aplay, MP3 via mpg123).
-    Temporarily stops FX to avoid audio device conflicts."""
+    """Play a sound file: over the FX audio through the native mixer when it
+    holds the device, otherwise via aplay/mpg123 with FX stopped meanwhile."""
     if name is None:
         with state_lock:
             name = state.startup_sound
@@ -971,19 +1327,13 @@ def play_sound(name=None):
         print("No sound configured")
         return
 
-    # Check in order: Announcements, Startup, RemPod, MusicBox, sounds root
-    path = os.path.join(ANNOUNCEMENTS_DIR, name)
-    if not os.path.exists(path):
-        path = os.path.join(STARTUP_SOUNDS_DIR, name)
-        if not os.path.exists(path):
-            path = os.path.join(REMPOD_SOUNDS_DIR, name)
-            if not os.path.exists(path):
-                path = os.path.join(MUSICBOX_SOUNDS_DIR, name)
-                if not os.path.exists(path):
-                    path = os.path.join(SOUNDS_DIR, name)
-                    if not os.path.exists(path):
-                        print("Sound file not found:", name)
-                        return
+    path = find_sound_path(name)
+    if path is None:
+        print("Sound file not found:", name)
+        return
+
+    if native_play_overlay(name, path):
+        return
 
     cmd, player = _player_command_for(path)
     if not cmd:
@@ -991,12 +1341,17 @@ def play_sound(name=None):
         return
 
     # Pause FX to free audio device
-    global _fx_proc, _fx_needs_restart
+    global _fx_proc, _fx_needs_restart, _native_sound_borrowers
     fx_was_running = (_fx_proc is not None)
     if fx_was_running:
         if debug.SOUND_PLAYBACK:
             print("[SOUND] Pausing FX for announcement playback")
         _stop_fx_proc()
+    if native_sound is not None:
+        with native_sound_lock:
+            _native_sound_borrowers += 1
+            if native_sound.holding:
+                native_sound.release()
 
     try:
         # Play and wait for completion
@@ -1010,6 +1365,9 @@ def play_sound(name=None):
     except Exception as e:
         print("Error playing sound:", e)
     finally:
+        if native_sound is not None:
+            with native_sound_lock:
+                _native_sound_borrowers -= 1
         # Resume FX if it was running
         if fx_was_running:
             if debug.SOUND_PLAYBACK:
@@ -1022,6 +1380,12 @@ def list_sounds(folder=None):
     Args:
         folder: None for all sounds, or 'startup', 'rempod', 'musicbox', 'announcements'
     """
+    if sound_library is not None:
+        if folder:
+            tag = folder.lower()
+            return _indexed_sounds(tag) if tag in ('startup', 'rempod', 'musicbox', 'announcements') else []
+        return _indexed_sounds()
+
     if folder:
         folder_map = {
             'startup': STARTUP_SOUNDS_DIR,
@@ -1180,7 +1544,7 @@ def _rempod_trigger(trigger_type="EMF"):
                 path = os.path.join(SOUNDS_DIR, sound)
             
             if os.path.exists(path):
-                threading.Thread(target=play_sound, args=(sound,), daemon=True).start()
+                play_trigger_sound(sound)
         except Exception as e:
             if debug.ERROR_MESSAGES:
                 print(f"[REMPOD] Error playing sound: {e}")
@@ -1262,7 +1626,7 @@ def _musicbox_trigger():
                 path = os.path.join(SOUNDS_DIR, sound)
             
             if os.path.exists(path):
-                threading.Thread(target=play_sound, args=(sound,), daemon=True).start()
+                play_trigger_sound(sound)
         except Exception as e:
             if debug.ERROR_MESSAGES:
                 print(f"[MUSICBOX] Error playing sound: {e}")
@@ -1724,15 +2088,74 @@ fx_lock = threading.Lock()
 
 _fx_proc = None  # type: subprocess.Popen | None
 _fx_needs_restart = False
+_fx_sink = ""  # native mixer device _fx_proc streams into, "" for aplay
 
 # FM audio passthrough (raw FM → speaker when FX is off)
 _passthrough_proc = None
+_passthrough_sink = ""
 
 
 # -------------------- SOX FX HELPERS --------------------
 
+def _native_fx_cmd(options):
+    """oraclebox_fx with (flag, clamped FxConfig value) options, or None without the binary."""
+    if not os.access(NATIVE_FX_BIN, os.X_OK):
+        return None
+    args = [NATIVE_FX_BIN, "--control", NATIVE_FX_CONTROL]
+    try:
+        with open(NATIVE_FX_PRESETS, "w") as f:
+            for name, preset in FX_PRESETS.items():
+                f.write(json.dumps({"name": name, **preset}) + "\n")
+        args += ["--presets", NATIVE_FX_PRESETS]
+    except OSError as e:
+        print(f"[FX] Could not write {NATIVE_FX_PRESETS}: {e}")
+    args += [f"{flag} {value}" for flag, value in options]
+    return " ".join(args)
+
+
+def announce_retune(freq_mhz):
+    """Tell a running oraclebox_fx the tuner is being written now (Python sweep, manual tunes)."""
+    # time.monotonic_ns() is CLOCK_MONOTONIC, the clock oraclebox_fx times its input on
+    native_fx_control("RETUNE", f"{freq_mhz:.1f} {time.monotonic_ns() // 1000}")
+
+
+def native_fx_control(param, value):
+    """Apply a live FX SET param to the running oraclebox_fx. False if none is reading."""
+    try:
+        fd = os.open(NATIVE_FX_CONTROL, os.O_WRONLY | os.O_NONBLOCK)
+    except OSError:
+        return False  # no pipe, or no oraclebox_fx on the other end
+    try:
+        os.write(fd, f"{param} {value}\n".encode())
+        return True
+    except OSError:
+        return False
+    finally:
+        os.close(fd)
+
+
+def _native_fx_sinks(monitor_device, record):
+    """oraclebox_fx options for the outputs besides the main one (FX MONITOR, FX RECORD)."""
+    options = []
+    if monitor_device and ALSA_DEVICE_PATTERN.fullmatch(monitor_device):
+        monitor = f"aplay -D {shlex.quote(monitor_device)} -f S16_LE -r 48000 -c 2 -t raw"
+        options.append(("--sink-cmd", shlex.quote(monitor)))
+    if record:
+        try:
+            os.makedirs(RECORDINGS_DIR, exist_ok=True)
+            path = os.path.join(RECORDINGS_DIR, time.strftime("fx-%Y%m%d-%H%M%S.wav"))
+            options.append(("--record", shlex.quote(path)))
+        except OSError as e:
+            print(f"[FX] Cannot record to {RECORDINGS_DIR}: {e}")
+    return options
+
+
 def build_sox_cmd_from_fx():
-    """Build pure ALSA FX pipeline using arecord | sox | aplay (matches manual test base)."""
+    """Build pure ALSA FX pipeline: arecord | FX | aplay (or the native mixer).
+
+    The effects run in the native FX engine (oraclebox_fx) when it is built,
+    otherwise in sox (matches manual test base).
+    """
     with fx_lock:
         fx = fx_config
 
@@ -1749,12 +2172,41 @@ def build_sox_cmd_from_fx():
         damp = max(0, min(100, fx.reverb_damping))
         wet = max(0, min(100, fx.reverb_wet))
         dry = max(0, min(100, fx.reverb_dry))
+        internal_rate = fx.internal_rate if fx.internal_rate in FX_INTERNAL_RATES else 16000
+        noise_reduce = max(0, min(100, fx.noise_reduce))
+        agc_target = max(-30, min(-6, fx.agc_target_db))
+        lookahead = max(1, min(20, fx.lookahead_ms))
+        retune_mute = max(0, min(30, fx.retune_mute_ms))
+        monitor_device = fx.monitor_device
+        record = fx.record
     
     with audio_lock:
         output_device = audio_config.current_device
+    sink = native_stream_device()
 
     # Pure ALSA pipeline - same base as manual test, then add user FX on top
     # This bypasses PulseAudio to get the same clean, dynamic audio
+
+    native_fx = _native_fx_cmd([
+        ("--bp-low", bp_low), ("--bp-high", bp_high),
+        ("--reverb", room), ("--reverb-damp", damp), ("--reverb-wet", wet), ("--reverb-dry", dry),
+        ("--contrast", contrast_amount), ("--pre-gain", pre_gain), ("--post-gain", post_gain),
+        ("--internal-rate", internal_rate), ("--noise-reduce", noise_reduce),
+        ("--agc-target", agc_target), ("--lookahead", lookahead),
+        ("--retune-mute", retune_mute), ("--segments", NATIVE_FX_SEGMENTS),
+    ] + _native_fx_sinks(monitor_device, record))
+    if native_fx:
+        # Raw S16 stereo at 48 kHz through, the format the mixer takes too
+        capture = "arecord -D plughw:3,0 -f S16_LE -r 48000 -c 2 -t raw"
+        if sink:
+            cmd = ["sh", "-c", f"{capture} | {native_fx}"]
+        else:
+            cmd = [
+                "sh", "-c",
+                f"{capture} | {native_fx} | "
+                f"aplay -D {output_device} -f S16_LE -r 48000 -c 2 -t raw"
+            ]
+        return cmd, sink
     
     # Build the sox effects chain
     effects = [
@@ -1777,15 +2229,23 @@ def build_sox_cmd_from_fx():
     # Join effects with spaces for shell command
     sox_effects = " ".join(effects)
 
-    # Use shell pipeline: arecord | sox | aplay (pure ALSA, no PulseAudio)
-    cmd = [
-        "sh", "-c",
-        f"arecord -D plughw:3,0 -f S16_LE -r 48000 -c 2 | "
-        f"sox -t wav - -t wav - {sox_effects} | "
-        f"aplay -D {output_device}"
-    ]
+    # Use shell pipeline: arecord | sox | aplay (pure ALSA, no PulseAudio),
+    # or sox straight into the native mixer while it holds the device
+    if sink:
+        cmd = [
+            "sh", "-c",
+            f"arecord -D plughw:3,0 -f S16_LE -r 48000 -c 2 | "
+            f"sox -t wav - {NATIVE_STREAM_FORMAT} - {sox_effects}"
+        ]
+    else:
+        cmd = [
+            "sh", "-c",
+            f"arecord -D plughw:3,0 -f S16_LE -r 48000 -c 2 | "
+            f"sox -t wav - -t wav - {sox_effects} | "
+            f"aplay -D {output_device}"
+        ]
 
-    return cmd
+    return cmd, sink
 
 
 def _stop_fx_proc():
@@ -1817,22 +2277,31 @@ def _stop_fx_proc():
 
 def _start_passthrough():
     """Start pure ALSA FM audio passthrough - matches manual test exactly."""
-    global _passthrough_proc
+    global _passthrough_proc, _passthrough_sink
     if _passthrough_proc is not None:
         return
     
     with audio_lock:
         output_device = audio_config.current_device
+    sink = native_stream_device()
     
     # Pure ALSA pipeline - EXACT match to manual test for perfect audio quality
     # This bypasses PulseAudio completely to get raw, clean, dynamic audio
     # Convert mono FM to stereo output by duplicating to both speakers
-    cmd = [
-        "sh", "-c",
-        f"arecord -D plughw:3,0 -f S16_LE -r 48000 -c 2 | "
-        f"sox -t wav - -t wav - highpass 250 lowpass 4800 compand 0.08,0.2 -28,-18 6 gain -3 remix 1,2 1,2 | "
-        f"aplay -D {output_device}"
-    ]
+    effects = "highpass 250 lowpass 4800 compand 0.08,0.2 -28,-18 6 gain -3 remix 1,2 1,2"
+    if sink:
+        cmd = [
+            "sh", "-c",
+            f"arecord -D plughw:3,0 -f S16_LE -r 48000 -c 2 | "
+            f"sox -t wav - {NATIVE_STREAM_FORMAT} - {effects}"
+        ]
+    else:
+        cmd = [
+            "sh", "-c",
+            f"arecord -D plughw:3,0 -f S16_LE -r 48000 -c 2 | "
+            f"sox -t wav - -t wav - {effects} | "
+            f"aplay -D {output_device}"
+        ]
     
     if debug.AUDIO_PASSTHROUGH:
         print(f"[AUDIO] Pure ALSA passthrough command: {cmd[2]}")
@@ -1841,12 +2310,16 @@ def _start_passthrough():
         # Start with new process group so we can kill entire pipeline
         _passthrough_proc = subprocess.Popen(
             cmd,
-            stdout=subprocess.DEVNULL,
+            stdout=subprocess.PIPE if sink else subprocess.DEVNULL,
             stderr=subprocess.DEVNULL,
             preexec_fn=os.setsid,  # Create new process group
         )
+        _passthrough_sink = sink
+        if sink:
+            native_attach_pipeline(_passthrough_proc)
         if debug.AUDIO_PASSTHROUGH:
-            print(f"[AUDIO] Pure ALSA passthrough started (no PulseAudio) to {output_device}")
+            where = "native mixer" if sink else "no PulseAudio"
+            print(f"[AUDIO] Pure ALSA passthrough started ({where}) to {output_device}")
     except Exception as e:
         if debug.ERROR_MESSAGES:
             print(f"[AUDIO] ERROR starting passthrough: {e}")
@@ -1950,6 +2423,7 @@ def handle_command(command):
             state.speed_index = closest_speed_index(ms)
             state.save_to_config()
             ms_actual = SWEEP_SPEEDS_MS[state.speed_index]
+        sync_native_sweep()
         return "OK SPEED " + str(ms_actual)
 
     if cmd == "FASTER":
@@ -1958,6 +2432,7 @@ def handle_command(command):
                 state.speed_index -= 1
                 state.save_to_config()
             ms = SWEEP_SPEEDS_MS[state.speed_index]
+        sync_native_sweep()
         return "OK SPEED " + str(ms)
 
     if cmd == "SLOWER":
@@ -1966,6 +2441,7 @@ def handle_command(command):
                 state.speed_index += 1
                 state.save_to_config()
             ms = SWEEP_SPEEDS_MS[state.speed_index]
+        sync_native_sweep()
         return "OK SPEED " + str(ms)
 
     if cmd == "DIR":
@@ -1983,18 +2459,21 @@ def handle_command(command):
                 return "ERR DIR bad value"
             state.save_to_config()
             d = "UP" if state.direction == 1 else "DOWN"
+        sync_native_sweep()
         return "OK DIR " + d
 
     if cmd == "START":
         with state_lock:
             state.running = True
             state.save_to_config()
+        sync_native_sweep()
         return "OK START"
 
     if cmd == "STOP":
         with state_lock:
             state.running = False
             state.save_to_config()
+        sync_native_sweep()
         return "OK STOP"
 
     if cmd == "SWEEP_CFG":
@@ -2166,7 +2645,8 @@ def handle_command(command):
             with state_lock:
                 current = state.startup_sound or ""
             exists = bool(current) and os.path.exists(os.path.join(SOUNDS_DIR, current))
-            payload = {"startup_sound": current, "startup_exists": exists}
+            payload = {"startup_sound": current, "startup_exists": exists,
+                       "native": native_sound_status()}
             return "OK SOUND STATUS " + json.dumps(payload)
 
         if sub == "LIST":
@@ -2234,6 +2714,29 @@ def handle_command(command):
             _fx_needs_restart = True
             return "OK FX DISABLED"
 
+        if sub == "RECORD":
+            # FX RECORD ON|OFF - the processed audio to a WAV file as well
+            # (native FX engine; a new file each time the pipeline starts)
+            if len(args) != 2 or args[1].upper() not in ("ON", "OFF"):
+                return "ERR FX RECORD needs ON/OFF"
+            with fx_lock:
+                fx_config.record = args[1].upper() == "ON"
+            _fx_needs_restart = True
+            return "OK FX RECORD " + args[1].upper()
+
+        if sub == "MONITOR":
+            # FX MONITOR <device>|OFF - a second output alongside the main one
+            if len(args) != 2:
+                return "ERR FX MONITOR needs device or OFF"
+            device = "" if args[1].upper() == "OFF" else args[1]
+            if device and not ALSA_DEVICE_PATTERN.fullmatch(device):
+                return "ERR FX MONITOR device must be an ALSA name (letters, digits, _:,.=-)"
+            with fx_lock:
+                fx_config.monitor_device = device
+                fx_config.save()
+            _fx_needs_restart = True
+            return "OK FX MONITOR " + (device or "OFF")
+
         if sub == "SET":
             if len(args) != 3:
                 return "ERR FX SET needs param and value"
@@ -2318,6 +2821,49 @@ def handle_command(command):
                         return "ERR POST_GAIN range 0-18"
                     fx_config.post_gain_db = value
                     changed = True
+
+                elif param == "NOISE_REDUCE":
+                    # Static suppression (native FX engine): 0 = off, 100 = -24 dB
+                    if not 0 <= value <= 100:
+                        return "ERR NOISE_REDUCE range 0-100"
+                    fx_config.noise_reduce = value
+                    changed = True
+
+                elif param == "AGC_TARGET":
+                    # Level the native engine's AGC holds, dBFS RMS
+                    if not -30 <= value <= -6:
+                        return "ERR AGC_TARGET range -30 to -6"
+                    fx_config.agc_target_db = value
+                    changed = True
+
+                elif param == "LOOKAHEAD":
+                    # Native engine's limiter look-ahead in ms (adds as much delay)
+                    if not 1 <= value <= 20:
+                        return "ERR LOOKAHEAD range 1-20"
+                    fx_config.lookahead_ms = value
+                    changed = True
+
+                elif param == "RETUNE_MUTE":
+                    # Native engine's mute after each retune in ms, 0 = off;
+                    # not part of the sound, so the preset name is kept
+                    if not 0 <= value <= 30:
+                        return "ERR RETUNE_MUTE range 0-30"
+                    if value != fx_config.retune_mute_ms:
+                        fx_config.retune_mute_ms = value
+                        fx_config.save()
+                        _fx_needs_restart = True
+                    return "OK FX SET " + param + " " + str(value)
+
+                elif param == "INTERNAL_RATE":
+                    # Native engine processing rate; not part of the sound,
+                    # so the preset name is kept
+                    if value not in FX_INTERNAL_RATES:
+                        return "ERR INTERNAL_RATE one of " + ",".join(str(r) for r in FX_INTERNAL_RATES)
+                    if value != fx_config.internal_rate:
+                        fx_config.internal_rate = value
+                        fx_config.save()
+                        _fx_needs_restart = True
+                    return "OK FX SET " + param + " " + str(value)
                     
                 else:
                     return "ERR FX SET unknown param"
@@ -2327,7 +2873,9 @@ def handle_command(command):
                     fx_config.preset = "CUSTOM"
                     fx_config.save()
             
-            if changed:
+            # Gains go straight into a running native engine; the rest
+            # rebuild the pipeline
+            if changed and not (param in FX_LIVE_PARAMS and native_fx_control(param, value)):
                 _fx_needs_restart = True
 
             return "OK FX SET " + param + " " + str(value)
@@ -2381,7 +2929,9 @@ def handle_command(command):
                         return f"ERR FX PRESET unknown (available: {available})"
                     fx_config.save()
                 
-                _fx_needs_restart = True
+                # A running oraclebox_fx crossfades to it; anything else restarts
+                if not native_fx_control("PRESET", preset_name):
+                    _fx_needs_restart = True
                     
                 return "OK FX PRESET SET " + preset_name
             
@@ -2422,7 +2972,10 @@ def handle_command(command):
                         fx_config.apply_preset(preset_name)
                         fx_config.save()
                     
-                    _fx_needs_restart = True
+                    # Compiled into the running oraclebox_fx, then switched to
+                    defined = native_fx_control("DEFINE", json.dumps({"name": preset_name, **new_preset}))
+                    if not (defined and native_fx_control("PRESET", preset_name)):
+                        _fx_needs_restart = True
                     
                     return "OK FX PRESET SAVED " + preset_name
                     
@@ -2772,6 +3325,8 @@ def handle_command(command):
         if sub == "SOUNDS":
             # List actual sound files from RemPod folder
             try:
+                if sound_library is not None:
+                    return "OK REMPOD SOUNDS " + json.dumps(sound_library.names("rempod"))
                 sound_files = []
                 if os.path.exists(REMPOD_SOUNDS_DIR):
                     for fname in os.listdir(REMPOD_SOUNDS_DIR):
@@ -2870,6 +3425,8 @@ def handle_command(command):
         if sub == "SOUNDS":
             # List actual sound files from MusicBox folder
             try:
+                if sound_library is not None:
+                    return "OK MUSICBOX SOUNDS " + json.dumps(sound_library.names("musicbox"))
                 sound_files = []
                 if os.path.exists(MUSICBOX_SOUNDS_DIR):
                     for fname in os.listdir(MUSICBOX_SOUNDS_DIR):
@@ -2902,7 +3459,7 @@ def handle_command(command):
                 return "ERR FM TEST bad frequency"
             
             # Tune to frequency
-            if tea5767_write(freq):
+            if fm_tune(freq):
                 # Start passthrough for 10 seconds to hear it
                 _start_passthrough()
                 threading.Timer(10.0, _stop_passthrough).start()
@@ -2921,13 +3478,25 @@ def handle_command(command):
                 return "ERR FM TUNE bad frequency"
             
             # Just tune, don't start playback
-            if tea5767_write(freq):
+            if fm_tune(freq):
                 return f"OK FM TUNE {freq}"
             else:
                 return "ERR FM TUNE tuner not available"
         
         return "ERR FM unknown subcommand"
 
+    if cmd == "SATELLITES":
+        sub = args[0].upper() if args else "STATUS"
+        if sub == "STATUS":
+            with satellite_lock:
+                data = {
+                    "bus": satellite_bus_attached,
+                    "devices": dict(satellite_devices),
+                    "recent": list(satellite_recent)[-10:],
+                }
+            return "OK SATELLITES STATUS " + json.dumps(data)
+        return "ERR SATELLITES unknown subcommand"
+
     if cmd == "MIC":
         if not args:
             return "ERR MIC needs subcommand"
@@ -2964,24 +3533,73 @@ def handle_command(command):
     return "ERR Unknown command"
 
 
+# -------------------- SATELLITE EVENT BUS --------------------
+
+def satellite_bus_thread():
+    """Follows the native hub's shared-memory event bus.
+
+    Events are decoded straight from shared memory and the thread sleeps on
+    the bus doorbell between batches, so following the satellites costs no
+    sockets or polling. Re-attaches when the hub restarts.
+    """
+    global satellite_bus_attached
+    reader = EventBusReader()
+
+    while True:
+        if reader.stale():
+            attached = reader.attach()
+            with satellite_lock:
+                satellite_bus_attached = attached
+            if not attached:
+                time.sleep(5.0)
+                continue
+            if debug.SYSTEM_STARTUP:
+                print("[SATELLITE] Attached to hub event bus")
+
+        for ev in reader.read():
+            entry = {
+                "device": ev.device,
+                "location": ev.location,
+                "event": ev.event,
+                "strength": ev.strength,
+                "temperature": round(ev.temperature, 1),
+                "value": ev.value,
+                "time": ev.time_us / 1e6,
+            }
+            with satellite_lock:
+                satellite_recent.append(entry)
+                satellite_devices[ev.device] = entry
+            if debug.SATELLITE_EVENTS:
+                print(f"[SATELLITE] {ev.device} {ev.event} strength={ev.strength}")
+        reader.wait(1.0)
+
+
 # -------------------- FX THREAD --------------------
 
 def fx_thread():
     """Background thread that keeps the SoX portal chain running."""
-    global _fx_proc, _fx_needs_restart
+    global _fx_proc, _fx_needs_restart, _fx_sink
 
     if debug.SYSTEM_STARTUP:
         print("[FX] thread started")
 
     while True:
+        # The native mixer keeps the device whether or not a pipeline runs
+        native_sound_hold()
+        sink = native_stream_device()
+
         with fx_lock:
             enabled = fx_config.enabled
-            needs_restart = _fx_needs_restart
+            needs_restart = _fx_needs_restart or (_fx_proc is not None and _fx_sink != sink)
             _fx_needs_restart = False
         
         with state_lock:
             sweep_running = state.running
 
+        # Mixer gained, lost or switched the device: move the passthrough too
+        if _passthrough_proc is not None and _passthrough_sink != sink:
+            _stop_passthrough()
+
         # Only process audio (FX or passthrough) when Spirit Box sweep is running
         if not sweep_running:
             # Stop both FX and passthrough when not in Spirit Box mode
@@ -3027,10 +3645,11 @@ def fx_thread():
                     print("[FX] restarting sox with new parameters")
                 _stop_fx_proc()
 
-            cmd = build_sox_cmd_from_fx()
-            if cmd is None:
+            built = build_sox_cmd_from_fx()
+            if built is None:
                 time.sleep(0.2)
                 continue
+            cmd, _fx_sink = built
 
             if debug.FX_STATE_CHANGES:
                 print("[FX] Pure ALSA FX pipeline:", cmd[2] if len(cmd) > 2 else cmd)
@@ -3042,8 +3661,10 @@ def fx_thread():
                     stderr=subprocess.PIPE,
                     preexec_fn=os.setsid,  # Create new process group
                 )
+                if _fx_sink:
+                    native_attach_pipeline(_fx_proc)
                 if debug.FX_STATE_CHANGES:
-                    print("[FX] Pure ALSA FX started (no PulseAudio)")
+                    print("[FX] Pure ALSA FX started " + ("(native mixer)" if _fx_sink else "(no PulseAudio)"))
                     # Give it a moment to see if it crashes immediately
                     time.sleep(0.1)
                     poll = _fx_proc.poll()
@@ -3067,11 +3688,68 @@ def fx_thread():
 
 # -------------------- SWEEP THREAD --------------------
 
+def pulse_sweep_leds(sweep_mode, box_mode):
+    """Per-step flash of the sweep LED / box LED."""
+    speed_scale = max(1, min(10, led_config.sweep_speed))
+    pulse_ms = 10 + (11 - speed_scale) * 3  # ~13ms..40ms
+    pulse_sec = pulse_ms / 1000.0
+
+    if sweep_mode == "on":
+        sweep_led.on()
+    if box_mode == "sweep":
+        span = max(0, led_config.box_max_brightness - led_config.box_min_brightness)
+        val = led_config.box_max_brightness
+        level = max(0.0, min(1.0, val / 255.0)) if span > 0 else 1.0
+        box_led.value = level
+
+    time.sleep(pulse_sec)
+
+    if sweep_mode == "on":
+        sweep_led.off()
+    if box_mode == "sweep":
+        box_led.value = 0.0
+
+
+def native_sweep_leds():
+    """LED side of the native sweep: flash on each step the engine reports.
+    The pulse runs alongside the schedule instead of adding to the step period."""
+    seq = 0
+    was_running = False
+    while True:
+        step_seq, freq_mhz, _ = native_sweep.wait_step(seq, 200)
+        with state_lock:
+            running = state.running
+            direction = state.direction
+            sweep_mode = state.sweep_led_mode
+            box_mode = state.box_led_mode
+
+        if running != was_running and debug.SWEEP_CYCLES:
+            if running:
+                print(f"[SWEEP] Native sweep started ({'UP' if direction == 1 else 'DOWN'})")
+            else:
+                stats = native_sweep.stats()
+                print(f"[SWEEP] Native sweep stopped after {stats['steps']} steps "
+                      f"(max lateness {stats['max_late_ms']:.1f} ms)")
+        was_running = running
+
+        if step_seq == seq:
+            continue
+        seq = step_seq
+        if debug.SWEEP_FREQUENCY_CHANGES:
+            print(f"[FM] Tuned to {freq_mhz:.1f} MHz")
+        if running and (sweep_mode == "on" or box_mode == "sweep"):
+            pulse_sweep_leds(sweep_mode, box_mode)
+
+
 def sweep_thread():
     apply_led_modes()
     if debug.SYSTEM_STARTUP:
         print("[SWEEP] Thread started")
 
+    if native_sweep is not None:
+        native_sweep_leds()
+        return
+
     while True:
         with state_lock:
             running = state.running
@@ -3104,29 +3782,13 @@ def sweep_thread():
                 break
 
             freq_mhz = step / 10.0
+            announce_retune(freq_mhz)
             set_freq(freq_mhz)
             step_count += 1
 
             # Per-step flash behaviour
             if sweep_mode == "on" or box_mode == "sweep":
-                speed_scale = max(1, min(10, led_config.sweep_speed))
-                pulse_ms = 10 + (11 - speed_scale) * 3  # ~13ms..40ms
-                pulse_sec = pulse_ms / 1000.0
-
-                if sweep_mode == "on":
-                    sweep_led.on()
-                if box_mode == "sweep":
-                    span = max(0, led_config.box_max_brightness - led_config.box_min_brightness)
-                    val = led_config.box_max_brightness
-                    level = max(0.0, min(1.0, val / 255.0)) if span > 0 else 1.0
-                    box_led.value = level
-
-                time.sleep(pulse_sec)
-
-                if sweep_mode == "on":
-                    sweep_led.off()
-                if box_mode == "sweep":
-                    box_led.value = 0.0
+                pulse_sweep_leds(sweep_mode, box_mode)
 
             time.sleep(current_delay_seconds())
 
@@ -3189,6 +3851,8 @@ def bluetooth_server():
                             _, name_str, size_str = parts[0], parts[1], parts[2]
                             try:
                                 size = int(size_str)
+                                # Optional CRC-32 (hex) of the whole file
+                                expected_crc = int(parts[3], 16) if len(parts) > 3 else -1
                             except ValueError:
                                 err = "ERR invalid size\n".encode("utf-8")
                                 client_sock.send(err)
@@ -3198,37 +3862,44 @@ def bluetooth_server():
 
                             if debug.SOUND_UPLOADS:
                                 print(f"[UPLOAD_SOUND] name={name_str} size={size}")
+                            sink = open_upload_sink(name_str, size)
+                            if sink is None:
+                                client_sock.send(b"ERR save failed\n")
+                                continue
                             client_sock.send(b"OK READY\n")
                             if debug.SOUND_UPLOADS:
                                 print("[UPLOAD_SOUND] sent OK READY")
 
                             remaining = size
-                            chunks = []
                             while remaining > 0:
-                                chunk = client_sock.recv(remaining)
+                                chunk = client_sock.recv(min(remaining, 65536))
                                 if not chunk:
                                     print("[UPLOAD_SOUND] connection closed early")
                                     client_sock.send(b"ERR incomplete upload\n")
                                     break
-                                chunks.append(chunk)
+                                sink.write(chunk)
                                 remaining -= len(chunk)
                                 if debug.SOUND_UPLOADS:
                                     print(f"[UPLOAD_SOUND] received {size - remaining}/{size} bytes")
 
                             if remaining > 0:
+                                sink.abort()
                                 continue
 
-                            data_bytes = b"".join(chunks)
-
                             try:
-                                os.makedirs(SOUNDS_DIR, exist_ok=True)
-                                path = os.path.join(SOUNDS_DIR, name_str)
-                                with open(path, "wb") as f:
-                                    f.write(data_bytes)
-                                if debug.SOUND_UPLOADS:
-                                    print(f"[UPLOAD_SOUND] saved {len(data_bytes)} bytes to {path}")
-                                client_sock.send(b"OK SAVED\n")
+                                if sink.finish(expected_crc):
+                                    if debug.SOUND_UPLOADS:
+                                        cached = " (cached for playback)" if sink.decoded else ""
+                                        print(f"[UPLOAD_SOUND] saved {size} bytes to {sink.path}{cached}")
+                                    client_sock.send(f"OK SAVED {sink.crc32:08x}\n".encode("utf-8"))
+                                elif sink.error == "checksum mismatch":
+                                    client_sock.send(f"ERR checksum mismatch {sink.crc32:08x}\n".encode("utf-8"))
+                                else:
+                                    if debug.ERROR_MESSAGES:
+                                        print("[UPLOAD_SOUND] error saving file:", sink.error)
+                                    client_sock.send(b"ERR save failed\n")
                             except Exception as e:
+                                sink.abort()
                                 if debug.ERROR_MESSAGES:
                                     print("[UPLOAD_SOUND] error saving file:", e)
                                 client_sock.send(b"ERR save failed\n")
@@ -3290,6 +3961,15 @@ if __name__ == "__main__":
             print("[INIT] [FAIL] TEA5767 FM tuner not found (sweeps will run without FM)")
         print()
 
+    # Native sweep engine (oraclebox_native), if built
+    if init_native_sweep():
+        if debug.SYSTEM_STARTUP:
+            print("[INIT] [OK] Native sweep engine running")
+    elif debug.SYSTEM_STARTUP:
+        print("[INIT] oraclebox_native not built - sweeping from Python")
+    if init_native_sound() and debug.SYSTEM_STARTUP:
+        print("[INIT] [OK] Native trigger sound player ready")
+
     # Set speaker volume to 75% (level 28) at startup
     if debug.SYSTEM_STARTUP:
         print("[INIT] Setting speaker volume to 75%...")
@@ -3403,6 +4083,11 @@ if __name__ == "__main__":
     musicbox_t = threading.Thread(target=musicbox_simulation_thread, daemon=True)
     musicbox_t.start()
 
+    if debug.SYSTEM_STARTUP:
+        print("[INIT] Starting satellite event bus thread...")
+    satellite_t = threading.Thread(target=satellite_bus_thread, daemon=True)
+    satellite_t.start()
+
     if debug.SYSTEM_STARTUP:
         print("[INIT] Making Bluetooth discoverable...")
     try: